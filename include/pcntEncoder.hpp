@@ -0,0 +1,99 @@
+#ifndef __PCNT_ENCODER_HPP__
+#define __PCNT_ENCODER_HPP__
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+#include <atomic>
+#include <memory>
+
+#include "DeviceTime.h"
+#include "ModalLights.h"
+#include "EncoderInterface.hpp"
+
+/**
+ * @brief a quadrature rotary encoder counted by the ESP32 pulse counter peripheral. every edge of both pins gets counted in hardware, so the CPU only gets involved when update() reads the count, or when the 16 bit counter hits a limit
+ *
+ */
+class PCNTEncoder : public EncoderInterface {
+  private:
+    static constexpr int16_t _counterLimit = 10000;  // the counter resets to 0 when it hits +/- this
+
+    const pcnt_unit_t _unit;
+    std::atomic<int32_t> _overflow{0}; // the counts lost to the counter resetting
+
+    static void IRAM_ATTR _limitISR(void* arg){
+      PCNTEncoder* encoder = static_cast<PCNTEncoder*>(arg);
+      uint32_t status = 0;
+      pcnt_get_event_status(encoder->_unit, &status);
+      if(status & PCNT_EVT_H_LIM){
+        encoder->_overflow.fetch_add(_counterLimit, std::memory_order_relaxed);
+      }
+      else if(status & PCNT_EVT_L_LIM){
+        encoder->_overflow.fetch_sub(_counterLimit, std::memory_order_relaxed);
+      }
+    }
+
+  public:
+    PCNTEncoder(
+      std::shared_ptr<DeviceTimeClass> deviceTime,
+      std::shared_ptr<ModalLightsInterface> modalLights,
+      int pinA,
+      int pinB,
+      pcnt_unit_t unit = PCNT_UNIT_0,
+      EncoderConfigs configs = EncoderConfigs{}
+    ) : EncoderInterface(deviceTime, modalLights, configs), _unit(unit) {
+      // channel 0 counts the edges of A, using B as the direction
+      pcnt_config_t config = {
+        .pulse_gpio_num = pinA,
+        .ctrl_gpio_num = pinB,
+        .lctrl_mode = PCNT_MODE_REVERSE,
+        .hctrl_mode = PCNT_MODE_KEEP,
+        .pos_mode = PCNT_COUNT_DEC,
+        .neg_mode = PCNT_COUNT_INC,
+        .counter_h_lim = _counterLimit,
+        .counter_l_lim = -_counterLimit,
+        .unit = _unit,
+        .channel = PCNT_CHANNEL_0,
+      };
+      pcnt_unit_config(&config);
+
+      // channel 1 counts the edges of B, using A as the direction
+      config.pulse_gpio_num = pinB;
+      config.ctrl_gpio_num = pinA;
+      config.pos_mode = PCNT_COUNT_INC;
+      config.neg_mode = PCNT_COUNT_DEC;
+      config.channel = PCNT_CHANNEL_1;
+      pcnt_unit_config(&config);
+
+      // ignore contact bounce shorter than about 12 uS (1023 APB clock cycles)
+      pcnt_set_filter_value(_unit, 1023);
+      pcnt_filter_enable(_unit);
+
+      pcnt_event_enable(_unit, PCNT_EVT_H_LIM);
+      pcnt_event_enable(_unit, PCNT_EVT_L_LIM);
+      pcnt_isr_service_install(0);
+      pcnt_isr_handler_add(_unit, _limitISR, this);
+
+      pcnt_counter_pause(_unit);
+      pcnt_counter_clear(_unit);
+      pcnt_counter_resume(_unit);
+    }
+
+    ~PCNTEncoder(){
+      pcnt_counter_pause(_unit);
+      pcnt_isr_handler_remove(_unit);
+    }
+
+    int32_t getCount() override {
+      // re-read if the counter hit a limit halfway through
+      int32_t overflow;
+      int16_t count;
+      do{
+        overflow = _overflow.load(std::memory_order_relaxed);
+        pcnt_get_counter_value(_unit, &count);
+      } while(overflow != _overflow.load(std::memory_order_relaxed));
+      return overflow + count;
+    }
+};
+
+#endif
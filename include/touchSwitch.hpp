@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <driver/touch_sensor.h>
+#include <esp_timer.h>
 #include <memory>
 
 #include "DeviceTime.h"
@@ -10,7 +11,8 @@
 #include "OneButtonInterface.hpp"
 
 /**
- * @brief initialise the ESP32 S3 touch peripheral, and use it as a single button physical interface
+ * @brief initialise the ESP32 S3 touch peripheral, and use it as a single button physical interface.
+ * the active/inactive interrupts push timestamped edges into a queue, so presses are timed exactly instead of at the next poll
  * 
  */
 class S3TouchButton : public OneButtonInterface {
@@ -26,6 +28,22 @@ class S3TouchButton : public OneButtonInterface {
     const touch_pad_t _touchPin;
     const uint32_t _touchThreshold;
 
+    ButtonEdgeQueue<8> _edges;
+
+    static void IRAM_ATTR _touchISR(void* arg){
+      S3TouchButton* button = static_cast<S3TouchButton*>(arg);
+      const uint32_t intrMask = touch_pad_read_intr_status_mask();
+      if(
+        (intrMask & (TOUCH_PAD_INTR_MASK_ACTIVE | TOUCH_PAD_INTR_MASK_INACTIVE)) == 0
+        || touch_pad_get_current_meas_channel() != button->_touchPin
+      ){return;}
+      
+      ButtonEdge edge;
+      edge.timestamp_uS = esp_timer_get_time();
+      edge.isPressed = (intrMask & TOUCH_PAD_INTR_MASK_ACTIVE) != 0;
+      button->_edges.push(edge);
+    }
+
   public:
 
     S3TouchButton(
@@ -50,9 +68,8 @@ class S3TouchButton : public OneButtonInterface {
       touch_pad_denoise_set_config(&denoise);
       touch_pad_denoise_enable();
 
-      // touch_pad_isr_register(active_handler, NULL, TOUCH_PAD_INTR_MASK_ACTIVE);
-      // touch_pad_isr_register(inactive_handler, NULL, TOUCH_PAD_INTR_MASK_INACTIVE);
-      // touch_pad_intr_enable(TOUCH_PAD_INTR_MASK_ACTIVE | TOUCH_PAD_INTR_MASK_INACTIVE);
+      touch_pad_isr_register(_touchISR, this, static_cast<touch_pad_intr_mask_t>(TOUCH_PAD_INTR_MASK_ACTIVE | TOUCH_PAD_INTR_MASK_INACTIVE));
+      touch_pad_intr_enable(static_cast<touch_pad_intr_mask_t>(TOUCH_PAD_INTR_MASK_ACTIVE | TOUCH_PAD_INTR_MASK_INACTIVE));
       // TODO: timeout interrupt
 
 
@@ -61,6 +78,19 @@ class S3TouchButton : public OneButtonInterface {
       touch_pad_set_thresh(_touchPin, _touchThreshold); // this make _benchmark stable
     }
 
+    ~S3TouchButton(){
+      touch_pad_intr_disable(static_cast<touch_pad_intr_mask_t>(TOUCH_PAD_INTR_MASK_ACTIVE | TOUCH_PAD_INTR_MASK_INACTIVE));
+      touch_pad_isr_deregister(_touchISR, this);
+    }
+
+    /**
+     * @brief consume the edges from the ISR. only needs calling often while the button is held, see isIdle()
+     * 
+     */
+    void update() override {
+      processEdges(_edges, esp_timer_get_time());
+    }
+
     bool getCurrentStatus() override {
       return (touch_pad_get_status() & BIT(_touchPin)) != 0;
     }
@@ -1,13 +1,44 @@
 #include "ConfigManager.h"
 
+bool ConfigManagerClass::update(uint64_t now_uS){
+  const uint32_t changeCount = _changeCount.load(std::memory_order_relaxed);
+  if(changeCount != _lastSeenChangeCount){
+    // something changed, so start waiting again
+    _lastSeenChangeCount = changeCount;
+    _lastChangeTime_uS = now_uS;
+  }
+  if(getDirtyFields() == ConfigFields::none){return false;}
+  if(now_uS - _lastChangeTime_uS < _flushDelay_uS){return false;}
+  const bool success = flush();
+  if(!success){_lastChangeTime_uS = now_uS;} // don't hammer a broken HAL
+  return success;
+}
+
+bool ConfigManagerClass::flush(){
+  const configFields_t dirtyFields = _dirtyFields.exchange(ConfigFields::none, std::memory_order_acquire);
+  if(dirtyFields == ConfigFields::none){return true;}
+  if(_configHAL->setConfigFields(_configs, dirtyFields)){return true;}
+  _dirtyFields.fetch_or(dirtyFields, std::memory_order_relaxed);
+  return false;
+}
+
 RTCConfigsStruct ConfigManagerClass::getRTCConfigs(){
   return _configs.rtcConfigs;
 };
 
 bool ConfigManagerClass::setRTCConfigs(RTCConfigsStruct rtcConfigs){
   // TODO: lower limit for maxSecondsBetweenSyncs (maybe change to hours between syncs?)
-  _configs.rtcConfigs = rtcConfigs;
-  return _configHAL->setConfigs(_configs);
+  _setField(_configs.rtcConfigs, rtcConfigs, ConfigFields::rtcConfigs);
+  return true;
+}
+
+DSTRulesStruct ConfigManagerClass::getDSTRules(){
+  return _configs.dstRules;
+}
+
+bool ConfigManagerClass::setDSTRules(DSTRulesStruct dstRules){
+  _setField(_configs.dstRules, dstRules, ConfigFields::dstRules);
+  return true;
 }
 
 EventManagerConfigsStruct ConfigManagerClass::getEventManagerConfigs()
@@ -18,8 +49,8 @@ EventManagerConfigsStruct ConfigManagerClass::getEventManagerConfigs()
 bool ConfigManagerClass::setEventManagerConfigs(EventManagerConfigsStruct eventConfigs)
 {
   if(eventConfigs.defaultEventWindow_S == 0){return false;}
-  _configs.eventConfigs = eventConfigs;
-  return _configHAL->setConfigs(_configs);
+  _setField(_configs.eventConfigs, eventConfigs, ConfigFields::eventConfigs);
+  return true;
 }
 
 ModalConfigsStruct ConfigManagerClass::getModalConfigs()
@@ -37,6 +68,6 @@ bool ConfigManagerClass::setModalConfigs(ModalConfigsStruct modalConfigs)
     || modalConfigs.softChangeWindow >= (1 << 4)
   )
   {return false;}
-  _configs.modalConfigs = modalConfigs;
-  return _configHAL->setConfigs(_configs);
+  _setField(_configs.modalConfigs, modalConfigs, ConfigFields::modalConfigs);
+  return true;
 }
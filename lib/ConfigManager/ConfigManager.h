@@ -2,6 +2,7 @@
 #define __CONFIGMANAGER_H__
 
 #include <Arduino.h>
+#include <atomic>
 #include <memory>
 
 #include "projectDefines.h"
@@ -17,14 +18,36 @@ TODO: the subclasses should access the same quasi-singleton HAL, or hard-coded p
  * for FRAM/EEPROM:
  *  - the config hal should store the address of each value in a second map. then, when writing, only the necessery addresses are written to
  * 
+ * writes are coalesced: the setters only change the local copy and mark the field as dirty. update() writes the dirty fields once nothing has changed for CONFIG_FLUSH_DELAY_uS, so dragging a setting around is one write instead of dozens
  */
 
+#ifndef CONFIG_FLUSH_DELAY_uS
+  #define CONFIG_FLUSH_DELAY_uS 5000000 // how long the configs have to stay unchanged before they get written
+#endif
+
+typedef uint8_t configFields_t;
+
+/**
+ * @brief one bit per ConfigsStruct member
+ */
+namespace ConfigFields{
+  constexpr configFields_t none = 0;
+  constexpr configFields_t rtcConfigs = 1;
+  constexpr configFields_t dstRules = 2;
+  constexpr configFields_t eventConfigs = 4;
+  constexpr configFields_t modalConfigs = 8;
+  constexpr configFields_t all = 15;
+};
+
  // TODO: move all config structs to the same header
 struct ConfigsStruct
 {
   // RTC_interface
   RTCConfigsStruct rtcConfigs;
 
+  // DeviceTime
+  DSTRulesStruct dstRules;
+
   // EventManager
   EventManagerConfigsStruct eventConfigs;
 
@@ -44,6 +67,17 @@ class ConfigAbstractHAL{
 
     virtual bool setConfigs(ConfigsStruct configs) = 0;
 
+    /**
+     * @brief write the fields that have changed. HALs that can address individual fields should override this; the default writes everything
+     * 
+     * @param configs 
+     * @param changedFields ConfigFields
+     * @return bool if operation was successful
+     */
+    virtual bool setConfigFields(const ConfigsStruct& configs, configFields_t changedFields){
+      return setConfigs(configs);
+    }
+
     /**
      * @brief reload the configs from storage
      * 
@@ -67,15 +101,87 @@ class ConfigManagerClass {
   private:
     std::unique_ptr<ConfigAbstractHAL> _configHAL;
     ConfigsStruct _configs;
+
+    // the setters and update() can be on different tasks. a setter changes the field before marking it, so a write that races a setter gets redone on the next flush
+    std::atomic<configFields_t> _dirtyFields{ConfigFields::none};
+    std::atomic<uint32_t> _changeCount{0};  // incremented by every change, so update() can tell if something changed since it last looked
+    uint32_t _lastSeenChangeCount = 0;
+    uint64_t _lastChangeTime_uS = 0;
+    uint32_t _flushDelay_uS = CONFIG_FLUSH_DELAY_uS;
+
+    template<typename ConfigT>
+    static bool _isSameConfig(const ConfigT& a, const ConfigT& b){return a == b;}
+
+    // RTCConfigsStruct belongs to RTC_interface, so it doesn't have an operator==
+    static bool _isSameConfig(const RTCConfigsStruct& a, const RTCConfigsStruct& b){
+      return a.timezone == b.timezone
+        && a.DST == b.DST
+        && a.maxSecondsBetweenSyncs == b.maxSecondsBetweenSyncs;
+    }
+
+    /**
+     * @brief mark a field as needing a write, if it's actually different
+     * 
+     * @tparam ConfigT 
+     * @param field the member of _configs
+     * @param newValue 
+     * @param fieldFlag ConfigFields
+     */
+    template<typename ConfigT>
+    void _setField(ConfigT& field, const ConfigT& newValue, configFields_t fieldFlag){
+      // member by member, so that the padding can't make an unchanged value look dirty
+      if(_isSameConfig(field, newValue)){return;}
+      field = newValue;
+      _dirtyFields.fetch_or(fieldFlag, std::memory_order_release);
+      _changeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
   public:
     ConfigManagerClass(std::unique_ptr<ConfigAbstractHAL>&& configHAL) : _configHAL(std::move(configHAL)){
       _configs = _configHAL->getAllConfigs();
     };
 
+    /**
+     * @brief write the dirty fields if nothing has changed for the flush delay. call regularly from a task that's allowed to block on storage
+     * 
+     * @param now_uS any monotonic time
+     * @return true if a write happened and succeeded
+     */
+    bool update(uint64_t now_uS);
+
+    /**
+     * @brief write the dirty fields now, i.e. before sleeping or restarting
+     * 
+     * @return true if there was nothing to write, or the write succeeded. the fields stay dirty if it fails
+     */
+    bool flush();
+
+    /**
+     * @brief the fields that have changed since the last successful write
+     * 
+     * @return configFields_t ConfigFields
+     */
+    configFields_t getDirtyFields(){
+      return _dirtyFields.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 0 writes on the first update() after a change
+     * 
+     * @param delay_uS 
+     */
+    void setFlushDelay(uint32_t delay_uS){
+      _flushDelay_uS = delay_uS;
+    }
+
     // RTC_interface configs
     RTCConfigsStruct getRTCConfigs();
     bool setRTCConfigs(RTCConfigsStruct rtcConfigs);
 
+    // DeviceTime configs
+    DSTRulesStruct getDSTRules();
+    bool setDSTRules(DSTRulesStruct dstRules);
+
     // EventManager configs
     EventManagerConfigsStruct getEventManagerConfigs();
 
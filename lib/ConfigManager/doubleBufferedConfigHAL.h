@@ -0,0 +1,198 @@
+/**
+ * notes:
+ *  - the configs get written to two slots alternately, each with a sequence number and a CRC. a commit is one slot write, and it never touches the slot holding the newest good copy, so losing power mid-write only loses that commit
+ *  - on boot, the headers of both slots are read, and only the newest slot gets read in full. if its CRC is bad, the other slot is used instead
+ *  - where the slots live is up to the ConfigSlotStorageInterface. on the esp32 that's NVS (preferencesConfigSlots.h); the native tests use simulated flash (flashSimulator.h)
+ */
+
+#ifndef __DOUBLE_BUFFERED_CONFIG_HAL_H__
+#define __DOUBLE_BUFFERED_CONFIG_HAL_H__
+
+#include <Arduino.h>
+#include <memory>
+#include <type_traits>
+#include <etl/crc32.h>
+
+#include "ConfigManager.h"
+
+/**
+ * @brief somewhere to keep the config slots. a slot has to be written in one go, but it can be read in parts
+ */
+class ConfigSlotStorageInterface {
+  public:
+    static constexpr uint8_t nSlots = 2;
+
+    virtual ~ConfigSlotStorageInterface() = default;
+
+    /**
+     * @brief read part of a slot
+     *
+     * @param slot
+     * @param offset from the start of the slot
+     * @param buffer
+     * @param size
+     * @return false if the slot couldn't be read, i.e. it's never been written
+     */
+    virtual bool readSlot(uint8_t slot, uint16_t offset, uint8_t* buffer, uint16_t size) = 0;
+
+    /**
+     * @brief replace everything in a slot
+     *
+     * @param slot
+     * @param buffer
+     * @param size
+     * @return bool if operation was successful
+     */
+    virtual bool writeSlot(uint8_t slot, const uint8_t* buffer, uint16_t size) = 0;
+};
+
+/**
+ * @brief what goes in a slot. the CRC covers everything before it
+ */
+struct ConfigSlotRecord {
+  static constexpr uint32_t expectedMagic = 0x43464753;  // "CFGS"
+
+  uint32_t magic = 0;
+  uint32_t sequence = 0;    // incremented by every commit. the bigger one is newer, allowing for wrapping
+  uint32_t size = 0;        // sizeof(ConfigsStruct), so that a firmware with a different struct doesn't read garbage
+  ConfigsStruct configs;
+  uint32_t crc = 0;
+
+  uint32_t calculateCRC() const {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(this);
+    return etl::crc32(bytes, bytes + offsetof(ConfigSlotRecord, crc)).value();
+  }
+};
+static_assert(std::is_trivially_copyable<ConfigSlotRecord>::value, "slots are written and read as raw bytes");
+
+class DoubleBufferedConfigHAL : public ConfigAbstractHAL {
+  private:
+    static constexpr uint8_t _noSlot = 0xFF;
+
+    std::unique_ptr<ConfigSlotStorageInterface> _slots;
+    ConfigsStruct _configs;
+    uint32_t _sequence = 0;
+    uint8_t _newestSlot = _noSlot;
+
+    static bool _isNewer(uint32_t sequence, uint32_t than){
+      return static_cast<int32_t>(sequence - than) > 0;
+    }
+
+    /**
+     * @brief read the start of a slot
+     *
+     * @param slot
+     * @param sequence filled with the slot's sequence number
+     * @return true if the slot looks like it has a record for this firmware's ConfigsStruct
+     */
+    bool _readHeader(uint8_t slot, uint32_t& sequence){
+      uint32_t header[3];
+      static_assert(offsetof(ConfigSlotRecord, configs) >= sizeof(header), "the header should come before the configs");
+      if(!_slots->readSlot(slot, 0, reinterpret_cast<uint8_t*>(header), sizeof(header))){return false;}
+      sequence = header[1];
+      return header[0] == ConfigSlotRecord::expectedMagic && header[2] == sizeof(ConfigsStruct);
+    }
+
+    /**
+     * @brief read a whole slot and check the CRC
+     *
+     * @param slot
+     * @param record
+     * @return true if the record is good
+     */
+    bool _readRecord(uint8_t slot, ConfigSlotRecord& record){
+      if(!_slots->readSlot(slot, 0, reinterpret_cast<uint8_t*>(&record), sizeof(ConfigSlotRecord))){return false;}
+      return record.magic == ConfigSlotRecord::expectedMagic
+        && record.size == sizeof(ConfigsStruct)
+        && record.crc == record.calculateCRC();
+    }
+
+  public:
+    /**
+     * @brief loads the newest good slot. if neither slot is good, the configs are the defaults until the first commit
+     *
+     * @param slots
+     */
+    DoubleBufferedConfigHAL(std::unique_ptr<ConfigSlotStorageInterface>&& slots) : _slots(std::move(slots)){
+      reloadConfigs();
+    }
+
+    ConfigsStruct getAllConfigs() override {
+      return _configs;
+    }
+
+    /**
+     * @brief write the configs into the older slot
+     *
+     * @param configs
+     * @return bool if operation was successful. if not, the previous configs are still in storage
+     */
+    bool setConfigs(ConfigsStruct configs) override {
+      // the CRC is over the bytes that get written, so whatever is in the padding gets checked as well
+      ConfigSlotRecord record{};
+      record.magic = ConfigSlotRecord::expectedMagic;
+      record.sequence = _sequence + 1;
+      record.size = sizeof(ConfigsStruct);
+      record.configs = configs;
+      record.crc = record.calculateCRC();
+
+      const uint8_t slot = _newestSlot == 0 ? 1 : 0;
+      if(!_slots->writeSlot(slot, reinterpret_cast<const uint8_t*>(&record), sizeof(record))){
+        return false;
+      }
+      _configs = configs;
+      _sequence = record.sequence;
+      _newestSlot = slot;
+      return true;
+    }
+
+    // setConfigFields() isn't overridden: a commit is one slot write however many fields changed
+
+    /**
+     * @brief reload the configs from the newest good slot
+     *
+     * @return true if a good slot was found
+     */
+    bool reloadConfigs() override {
+      // newest first, going by the headers
+      uint8_t order[ConfigSlotStorageInterface::nSlots];
+      uint8_t nCandidates = 0;
+      uint32_t sequences[ConfigSlotStorageInterface::nSlots];
+      for(uint8_t slot = 0; slot < ConfigSlotStorageInterface::nSlots; slot++){
+        if(!_readHeader(slot, sequences[slot])){continue;}
+        if(nCandidates > 0 && _isNewer(sequences[slot], sequences[order[0]])){
+          order[1] = order[0];
+          order[0] = slot;
+        }
+        else{
+          order[nCandidates] = slot;
+        }
+        nCandidates++;
+      }
+
+      ConfigSlotRecord record;
+      for(uint8_t i = 0; i < nCandidates; i++){
+        if(_readRecord(order[i], record)){
+          _configs = record.configs;
+          _sequence = record.sequence;
+          _newestSlot = order[i];
+          return true;
+        }
+      }
+      _configs = ConfigsStruct();
+      _sequence = 0;
+      _newestSlot = _noSlot;
+      return false;
+    }
+
+    /**
+     * @brief the slot that the configs were last loaded from or committed to
+     *
+     * @return uint8_t 0xFF if neither slot is good
+     */
+    uint8_t getNewestSlot(){return _newestSlot;}
+
+    uint32_t getSequence(){return _sequence;}
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "preferencesConfigSlots.h"
+
+#if defined ESP32 || defined ESP32S3
+
+PreferencesConfigSlots::PreferencesConfigSlots(const char* nvsNamespace){
+  _preferences.begin(nvsNamespace, false);
+}
+
+PreferencesConfigSlots::~PreferencesConfigSlots(){
+  _preferences.end();
+}
+
+bool PreferencesConfigSlots::readSlot(uint8_t slot, uint16_t offset, uint8_t* buffer, uint16_t size){
+  if(slot >= nSlots){return false;}
+  uint8_t blob[sizeof(ConfigSlotRecord)];
+  const size_t length = _preferences.getBytesLength(_keys[slot]);
+  if(length == 0 || length > sizeof(blob) || offset + size > length){return false;}
+  if(_preferences.getBytes(_keys[slot], blob, length) != length){return false;}
+  memcpy(buffer, blob + offset, size);
+  return true;
+}
+
+bool PreferencesConfigSlots::writeSlot(uint8_t slot, const uint8_t* buffer, uint16_t size){
+  if(slot >= nSlots){return false;}
+  return _preferences.putBytes(_keys[slot], buffer, size) == size;
+}
+
+#endif
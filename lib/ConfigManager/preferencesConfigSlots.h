@@ -0,0 +1,31 @@
+#ifndef __PREFERENCES_CONFIG_SLOTS_H__
+#define __PREFERENCES_CONFIG_SLOTS_H__
+
+#if defined ESP32 || defined ESP32S3
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "doubleBufferedConfigHAL.h"
+
+/**
+ * @brief keeps the config slots as two NVS blobs. NVS can't read part of a blob, so partial reads read the whole thing into a buffer first
+ */
+class PreferencesConfigSlots : public ConfigSlotStorageInterface {
+  private:
+    Preferences _preferences;
+    static constexpr const char* _keys[nSlots] = {"slot0", "slot1"};
+
+  public:
+    /**
+     * @param nvsNamespace max 15 characters
+     */
+    PreferencesConfigSlots(const char* nvsNamespace = "configs");
+    ~PreferencesConfigSlots();
+
+    bool readSlot(uint8_t slot, uint16_t offset, uint8_t* buffer, uint16_t size) override;
+    bool writeSlot(uint8_t slot, const uint8_t* buffer, uint16_t size) override;
+};
+
+#endif
+#endif
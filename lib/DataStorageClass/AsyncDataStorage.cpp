@@ -0,0 +1,21 @@
+#include "AsyncDataStorage.h"
+
+#if defined ESP32 || defined ESP32S3
+
+void AsyncDataStorage::_workerLoop(void* parameters){
+  AsyncDataStorage* storage = static_cast<AsyncDataStorage*>(parameters);
+  for(;;){
+    // if a result didn't fit, check back soon instead of waiting for the next request
+    ulTaskNotifyTake(pdTRUE, storage->_hasUndelivered ? pdMS_TO_TICKS(1) : portMAX_DELAY);
+    storage->serviceRequests();
+  }
+}
+
+void AsyncDataStorage::startWorker(BaseType_t core, UBaseType_t priority, uint32_t stackSize){
+  if(_worker != NULL){return;}
+  xTaskCreatePinnedToCore(_workerLoop, "storage", stackSize, this, priority, &_worker, core);
+  // anything requested before the worker existed
+  xTaskNotifyGive(_worker);
+}
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * notes:
+ *  - a non-blocking front-end for DataStorageClass. mode and event reads get queued, a worker does the actual reads, and the results come back through callbacks
+ *  - on the esp32, startWorker() makes a task that sleeps until something's requested. without a worker (i.e. in the native environment), dispatchCompletions() does the reads itself, so the calling code is the same either way
+ *  - callbacks run in whichever task calls dispatchCompletions(), never in the worker, so they can touch the caller's state without a lock
+ *  - both queues are SPSC, so requests and dispatchCompletions() must come from one task. DataStorageClass isn't thread-safe, so nothing else should read storage while the worker is running
+ */
+
+#ifndef __ASYNC_DATA_STORAGE_H__
+#define __ASYNC_DATA_STORAGE_H__
+
+#include <Arduino.h>
+#include <memory>
+
+#include "ProjectDefines.h"
+#include "DataStorageClass.h"
+#include "spscQueue.h"
+
+#if defined ESP32 || defined ESP32S3
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/task.h>
+#endif
+
+#ifndef ASYNC_STORAGE_QUEUE_SIZE
+  #define ASYNC_STORAGE_QUEUE_SIZE 8  // must be a power of 2
+#endif
+
+enum class StorageRequestTypes : uint8_t {
+  mode,
+  event
+};
+
+struct StorageResultStruct;
+
+/**
+ * @brief called with the result of a request
+ *
+ * @param result
+ * @param context whatever was passed in with the request
+ */
+typedef void (*storageCallback_t)(const StorageResultStruct& result, void* context);
+
+struct StorageRequestStruct {
+  StorageRequestTypes type = StorageRequestTypes::mode;
+  uint8_t ID = 0;                     // modeUUID or eventUUID
+  uint8_t tag = 0;                    // passed back in the result untouched, for the caller to tell its requests apart
+  storageCallback_t callback = nullptr;
+  void* context = nullptr;
+};
+
+struct StorageResultStruct {
+  StorageRequestTypes type = StorageRequestTypes::mode;
+  uint8_t ID = 0;
+  uint8_t tag = 0;
+  bool success = false;
+  ModeDataStruct modeData;            // mode requests
+  EventDataPacket eventData;          // event requests
+  storageCallback_t callback = nullptr;
+  void* context = nullptr;
+};
+
+class AsyncDataStorage {
+  private:
+    std::shared_ptr<DataStorageClass> _dataStorage;
+
+    SPSCQueue<StorageRequestStruct, ASYNC_STORAGE_QUEUE_SIZE> _requests;
+    SPSCQueue<StorageResultStruct, ASYNC_STORAGE_QUEUE_SIZE> _results;
+
+    // a result that didn't fit in the results queue. only touched by whoever is doing the reads
+    StorageResultStruct _undelivered;
+    bool _hasUndelivered = false;
+    bool _hasExternalWorker = false;
+
+    #if defined ESP32 || defined ESP32S3
+      TaskHandle_t _worker = NULL;
+      static void _workerLoop(void* parameters);
+    #endif
+
+    bool _isWorkerRunning(){
+      #if defined ESP32 || defined ESP32S3
+        if(_worker != NULL){return true;}
+      #endif
+      return _hasExternalWorker;
+    }
+
+    bool _request(const StorageRequestStruct& request){
+      if(!_requests.push(request)){return false;}
+      #if defined ESP32 || defined ESP32S3
+        if(_worker != NULL){xTaskNotifyGive(_worker);}
+      #endif
+      return true;
+    }
+
+    StorageResultStruct _read(const StorageRequestStruct& request){
+      StorageResultStruct result;
+      result.type = request.type;
+      result.ID = request.ID;
+      result.tag = request.tag;
+      result.callback = request.callback;
+      result.context = request.context;
+      if(request.type == StorageRequestTypes::mode){
+        // TODO: dataStorage should fill a ModeDataStruct instead of an array
+        uint8_t dataArray[modePacketSize];
+        result.success = _dataStorage->getMode(request.ID, dataArray);
+        if(result.success){
+          deserializeModeData(dataArray, &result.modeData);
+        }
+      }
+      else{
+        result.eventData = _dataStorage->getEvent(request.ID);
+        result.success = result.eventData.eventID == request.ID && request.ID != 0;
+      }
+      return result;
+    }
+
+  public:
+    AsyncDataStorage(std::shared_ptr<DataStorageClass> dataStorage) : _dataStorage(dataStorage){};
+
+    /**
+     * @brief queue a mode read. the callback gets the deserialized mode, or success = false if it doesn't exist
+     *
+     * @param modeID
+     * @param callback
+     * @param context passed to the callback
+     * @param tag passed back in the result
+     * @return true if the request was queued
+     * @return false if the queue is full. nothing will be called back
+     */
+    bool requestMode(modeUUID modeID, storageCallback_t callback, void* context, uint8_t tag = 0){
+      StorageRequestStruct request;
+      request.type = StorageRequestTypes::mode;
+      request.ID = modeID;
+      request.tag = tag;
+      request.callback = callback;
+      request.context = context;
+      return _request(request);
+    }
+
+    /**
+     * @brief queue an event read. the callback gets the event packet, or success = false if it doesn't exist
+     *
+     * @param eventID
+     * @param callback
+     * @param context passed to the callback
+     * @param tag passed back in the result
+     * @return true if the request was queued
+     * @return false if the queue is full. nothing will be called back
+     */
+    bool requestEvent(eventUUID eventID, storageCallback_t callback, void* context, uint8_t tag = 0){
+      StorageRequestStruct request;
+      request.type = StorageRequestTypes::event;
+      request.ID = eventID;
+      request.tag = tag;
+      request.callback = callback;
+      request.context = context;
+      return _request(request);
+    }
+
+    /**
+     * @brief the worker's side: do the queued reads, oldest first. stops early if the results queue fills up
+     *
+     * @return uint8_t the number of reads that were done
+     */
+    uint8_t serviceRequests(){
+      if(_hasUndelivered){
+        if(!_results.push(_undelivered)){return 0;}
+        _hasUndelivered = false;
+      }
+      uint8_t nReads = 0;
+      StorageRequestStruct request;
+      while(_requests.pop(request)){
+        StorageResultStruct result = _read(request);
+        nReads++;
+        if(!_results.push(result)){
+          _undelivered = result;
+          _hasUndelivered = true;
+          break;
+        }
+      }
+      return nReads;
+    }
+
+    /**
+     * @brief run the callbacks for any finished requests. if there isn't a worker, this does the reads first
+     *
+     * @return uint8_t the number of callbacks that were run
+     */
+    uint8_t dispatchCompletions(){
+      uint8_t nCallbacks = 0;
+      do{
+        if(!_isWorkerRunning()){serviceRequests();}
+        StorageResultStruct result;
+        while(_results.pop(result)){
+          if(result.callback != nullptr){result.callback(result, result.context);}
+          nCallbacks++;
+        }
+      }while(!_isWorkerRunning() && (_hasUndelivered || !_requests.isEmpty()));
+      return nCallbacks;
+    }
+
+    /**
+     * @brief true if nothing is waiting to be read or dispatched
+     *
+     */
+    bool isIdle(){
+      return _requests.isEmpty() && _results.isEmpty() && !_hasUndelivered;
+    }
+
+    /**
+     * @brief doesn't touch the storage HAL, so it doesn't need queueing
+     *
+     * @param modeID
+     */
+    bool doesModeExist(modeUUID modeID){
+      return _dataStorage->doesModeExist(modeID);
+    }
+
+    /**
+     * @brief something else is going to call serviceRequests() (i.e. a thread in the native tests), so dispatchCompletions() shouldn't do the reads itself
+     *
+     */
+    void useExternalWorker(){
+      _hasExternalWorker = true;
+    }
+
+    #if defined ESP32 || defined ESP32S3
+      /**
+       * @brief start a task that does the reads. after this, dispatchCompletions() only runs callbacks
+       *
+       * @param core
+       * @param priority
+       * @param stackSize
+       */
+      void startWorker(BaseType_t core, UBaseType_t priority = 1, uint32_t stackSize = 4096);
+    #endif
+};
+
+#endif
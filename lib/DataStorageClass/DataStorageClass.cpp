@@ -1,5 +1,7 @@
 #include "DataStorageClass.h"
 #include "ProjectDefines.h"
+#include "trace.h"
+#include "metrics.h"
 
 // ModeStorageIterator DataStorageClass::getAllModes(){
 //   ModeStorageIterator iterator(_storage, _storage->getNumberOfStoredModes());
@@ -12,11 +14,12 @@ EventStorageIterator DataStorageClass::getAllEvents(){
 };
 
 bool DataStorageClass::getMode(modeUUID modeID, uint8_t dataPacket[modePacketSize]){
+  TRACE_SPAN_ARG(storageReadMode, modeID);
   // TODO: if a mode can't be loaded, it should be asynchroniously requested from network
 
   // if default constant brightness:
-  if(modeID == 1){
-    dataPacket[0] = 1;
+  if(modeID == defaultModeID){
+    dataPacket[0] = defaultModeID;
     dataPacket[1] = static_cast<uint8_t>(ModeTypes::constantBrightness);
     for(uint8_t i = 2; i<nChannels+2; i++){
       dataPacket[i] = 255;
@@ -28,15 +31,18 @@ bool DataStorageClass::getMode(modeUUID modeID, uint8_t dataPacket[modePacketSiz
   if(_storedModeIDs.count(modeID) == 0){
     return false;
   };
+  getMetrics().count(MetricCounters::storageReads);
   bool success = _storage->getModeAt(_storedModeIDs[modeID], dataPacket);
   // if(success && CRC_checksOut){} // TODO
   return success;
 };
 
 EventDataPacket DataStorageClass::getEvent(eventUUID eventID){
+  TRACE_SPAN_ARG(storageReadEvent, eventID);
   nEvents_t number = 0;
   bool foundIt = false;
   if(_storedEventIDs.count(eventID) != 0){
+    getMetrics().count(MetricCounters::storageReads);
     return _storage->getEventAt(_storedEventIDs[eventID]);
   };
   EventDataPacket emptyPacket;
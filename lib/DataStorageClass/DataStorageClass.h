@@ -51,7 +51,7 @@ public:
   struct EventDataPacket getEvent(eventUUID eventID);
 
   bool doesModeExist(modeUUID modeID){
-    return _storedModeIDs.contains(modeID) || (modeID == 1);
+    return _storedModeIDs.contains(modeID) || (modeID == defaultModeID);
   }
 };
 
@@ -3,40 +3,90 @@
 
 #include "ProjectDefines.h"
 #include "storageHAL.h"
+#include "trace.h"
+#include "metrics.h"
 
 enum class StoredDataTypes {
   events = 0,
   modes = 1
 };
 
+/**
+ * @brief reads the stored objects a chunk at a time. the chunk size is whatever the storage HAL prefers (up to DataPreloadMaxChunkSize), and there are two chunk buffers:
+ *  - reading straight through fills both buffers in one transfer, so the next chunk is already loaded when the current one runs out
+ *  - anything else only replaces the least recently used buffer, so jumping back and forth between two chunks doesn't keep re-reading them
+ * 
+ * @tparam numberType 
+ * @tparam Struct_t 
+ */
 template<typename numberType, typename Struct_t>
 class IterableCollection{
   private:
+    static_assert(DataPreloadMaxChunkSize >= DataPreloadChunkSize, "the max chunk size can't be smaller than the default");
+    static constexpr uint8_t _nBuffers = 2;
+
     numberType _numberStored;
-    numberType _chunkNumber = 0;
-    numberType _nPacketsInBuffer = 0;
-    Struct_t _buffer[DataPreloadChunkSize];
+    numberType _chunkSize;
+    numberType _chunkStart[_nBuffers] = {0, 0};
+    numberType _nPacketsInBuffer[_nBuffers] = {0, 0};
+    uint8_t _lastUsedBuffer = 0;
+    numberType _nextObjectNumber = 0;   // if this gets asked for, the iteration is sequential
+    Struct_t _buffer[_nBuffers * DataPreloadMaxChunkSize];  // the buffers are next to each other, so both can be filled in one read
 
     std::shared_ptr<StorageHALInterface> _storageHAL;
 
-    void _fetchChunk(numberType chunkNumber);
+    void _fetchChunks(uint8_t bufferIndex, numberType objectNumber, uint8_t nChunks);
   public:
     IterableCollection(
       std::shared_ptr<StorageHALInterface> storageHAL,
       numberType numberStored
     ) : _storageHAL(storageHAL), _numberStored(numberStored){
-      _fetchChunk(0);
+      const numberType preferredSize = _storageHAL->getPreferredChunkSize();
+      _chunkSize = preferredSize == 0 ? 1
+        : preferredSize > DataPreloadMaxChunkSize ? DataPreloadMaxChunkSize
+        : preferredSize;
+      _fetchChunks(0, 0, 1);
     };
 
     Struct_t getObjectAt(numberType objectNumber);
 
     numberType getNumberStored(){return _numberStored;}
+
+    numberType getChunkSize(){return _chunkSize;}
 };
 
+/**
+ * @brief fill one buffer, or both buffers starting with bufferIndex 0
+ * 
+ * @param bufferIndex 
+ * @param objectNumber the chunk that this object is in gets fetched
+ * @param nChunks 1 or 2
+ */
 template <typename numberType, typename Struct_t>
-inline void IterableCollection<numberType, Struct_t>::_fetchChunk(numberType objectNumber){
-  _chunkNumber = objectNumber / DataPreloadChunkSize;
-  _nPacketsInBuffer = _storageHAL->fillChunk(_buffer, objectNumber);
+inline void IterableCollection<numberType, Struct_t>::_fetchChunks(uint8_t bufferIndex, numberType objectNumber, uint8_t nChunks){
+  TRACE_SPAN_ARG(storageReadChunk, objectNumber);
+  const numberType chunkStart = objectNumber - (objectNumber % _chunkSize);
+  numberType nWanted = nChunks * _chunkSize;
+  if(chunkStart >= _numberStored){
+    nWanted = 0;
+  }
+  else if(_numberStored - chunkStart < nWanted){
+    nWanted = _numberStored - chunkStart;
+  }
+
+  numberType nFilled = 0;
+  if(nWanted > 0){
+    getMetrics().count(MetricCounters::storageReads);
+    nFilled = _storageHAL->fillEvents(&_buffer[bufferIndex * _chunkSize], chunkStart, nWanted);
+  }
+  for(uint8_t i = 0; i < nChunks; i++){
+    const numberType offset = i * _chunkSize;
+    _chunkStart[bufferIndex + i] = chunkStart + offset;
+    _nPacketsInBuffer[bufferIndex + i] = nFilled <= offset ? 0
+      : nFilled - offset > _chunkSize ? _chunkSize
+      : nFilled - offset;
+  }
+  _lastUsedBuffer = bufferIndex;
 }
 
 template <typename numberType, typename Struct_t>
@@ -48,14 +98,31 @@ inline Struct_t IterableCollection<numberType, Struct_t>::getObjectAt(numberType
     Struct_t emptyStruct;
     return emptyStruct;
   }
-  if(objectNumber < _chunkNumber*DataPreloadChunkSize
-    || objectNumber >= (_chunkNumber+1)*DataPreloadChunkSize
-  ){
-    // if requested object isn't in the current chunk,
-    // load the correct chunk
-    _fetchChunk(objectNumber);
+  const bool isSequential = objectNumber == _nextObjectNumber;
+  _nextObjectNumber = objectNumber + 1;
+  for(uint8_t i = 0; i < _nBuffers; i++){
+    if(objectNumber >= _chunkStart[i] && objectNumber - _chunkStart[i] < _nPacketsInBuffer[i]){
+      getMetrics().count(MetricCounters::storageCacheHits);
+      _lastUsedBuffer = i;
+      return _buffer[i * _chunkSize + objectNumber - _chunkStart[i]];
+    }
+  }
+
+  // if requested object isn't in either buffer, load the correct chunk.
+  // reading straight through loads the next chunk as well
+  if(isSequential){
+    _fetchChunks(0, objectNumber, 2);
+  }
+  else{
+    _fetchChunks(_lastUsedBuffer == 0 ? 1 : 0, objectNumber, 1);
+  }
+  const uint8_t i = _lastUsedBuffer;
+  if(objectNumber - _chunkStart[i] >= _nPacketsInBuffer[i]){
+    // the storage came back short
+    Struct_t emptyStruct;
+    return emptyStruct;
   }
-  return _buffer[objectNumber % DataPreloadChunkSize];
+  return _buffer[i * _chunkSize + objectNumber - _chunkStart[i]];
 }
 
 template<typename numberType, typename Struct_t>
@@ -58,6 +58,34 @@ class StorageHALInterface{
      */
     virtual nEvents_t fillChunk(EventDataPacket (&buffer)[DataPreloadChunkSize], nEvents_t eventNumber) = 0;
 
+    /**
+     * @brief the number of events that are the most efficient to read in one go, i.e. however many fit in a flash page. the iterator clamps it to DataPreloadMaxChunkSize
+     * 
+     * @return nEvents_t 
+     */
+    virtual nEvents_t getPreferredChunkSize(){return DataPreloadChunkSize;}
+
+    /**
+     * @brief fills a buffer with any number of events, in as few transfers as possible. the default goes through fillChunk(), so override it if the storage can do a bigger read
+     * 
+     * @param buffer must have room for nEvents
+     * @param eventNumber the event number to start with
+     * @param nEvents the number of events wanted
+     * @return nEvents_t the number of elements put in the buffer
+     */
+    virtual nEvents_t fillEvents(EventDataPacket* buffer, nEvents_t eventNumber, nEvents_t nEvents){
+      EventDataPacket chunk[DataPreloadChunkSize];
+      nEvents_t nFilled = 0;
+      while(nFilled < nEvents){
+        const nEvents_t nRead = fillChunk(chunk, eventNumber + nFilled);
+        for(nEvents_t i = 0; i < nRead && nFilled < nEvents; i++){
+          buffer[nFilled++] = chunk[i];
+        }
+        if(nRead < DataPreloadChunkSize){break;}
+      }
+      return nFilled;
+    }
+
     /**
      * @brief fills a buffer with ModeDataPacket. buffer length must be DataPreloadChunkSize. should also fill _storedModeIds map as it is called
      * 
@@ -0,0 +1,186 @@
+/**
+ * notes:
+ *  - the transitions are precomputed for DST_SCHEDULE_YEARS years, so converting a timestamp is just finding the year and comparing against two numbers
+ *  - years outside of the table are computed on the fly. it's still O(1), just with more arithmetic
+ *  - the year maths only works between 2000 and 2099, which is fine because the onboard timestamp uses the 2000 epoch anyway
+ */
+
+#ifndef __DST_SCHEDULE_H__
+#define __DST_SCHEDULE_H__
+
+#include <Arduino.h>
+
+#include "ProjectDefines.h"
+#include "timeHelpers.h"
+
+#ifndef DST_SCHEDULE_YEARS
+#define DST_SCHEDULE_YEARS 4
+#endif
+
+/**
+ * @brief gets the years since 2000 of a timestamp
+ *
+ * @param timestamp_S seconds since 2000
+ * @return uint8_t years since 2000
+ */
+uint8_t static yearsSince2000(uint64_t timestamp_S){
+  const uint32_t days = timestamp_S / secondsInDay;
+  const uint32_t daysIntoCycle = days % (4*365 + 1); // 2000 is a leap year, so every cycle starts with one
+  const uint8_t yearInCycle = daysIntoCycle < 366 ? 0 : 1 + (daysIntoCycle - 366)/365;
+  return 4*(days / (4*365 + 1)) + yearInCycle;
+}
+
+/**
+ * @brief gets the days since 2000 at the start of a month
+ *
+ * @param year years since 2000
+ * @param month from 1 to 12
+ * @return uint32_t days since 2000
+ */
+uint32_t static daysToStartOfMonth(uint8_t year, uint8_t month){
+  static const uint16_t daysBeforeMonth[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  const bool isLeapYear = (year % 4) == 0;
+  return 365*year + (year + 3)/4 + daysBeforeMonth[month - 1] + (isLeapYear && month > 2);
+}
+
+uint8_t static daysInMonth(uint8_t year, uint8_t month){
+  static const uint8_t monthLengths[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return monthLengths[month - 1] + ((year % 4) == 0 && month == 2);
+}
+
+/**
+ * @brief precomputed table of DST transitions for the configured zone
+ *
+ */
+class DSTSchedule{
+  private:
+    struct TransitionsStruct{
+      int64_t start_S = 0;  // UTC timestamp of the start of DST
+      int64_t end_S = 0;    // UTC timestamp of the end of DST
+    };
+
+    DSTRulesStruct _rules;
+    int32_t _timezone = 0;
+
+    uint8_t _firstYear = 0; // years since 2000
+    TransitionsStruct _table[DST_SCHEDULE_YEARS];
+
+    /**
+     * @brief gets the local timestamp of a transition rule in a given year
+     *
+     * @param rule
+     * @param year years since 2000
+     * @return int64_t local timestamp in seconds
+     */
+    static int64_t _ruleToLocalTimestamp(const DSTRuleStruct& rule, uint8_t year){
+      const uint32_t firstDay = daysToStartOfMonth(year, rule.month);
+      const uint8_t firstDayOfWeek = (firstDay + 5) % 7 + 1; // matches UsefulTimeStruct
+      uint32_t day = firstDay + (7 + rule.dayOfWeek - firstDayOfWeek) % 7 + 7*(rule.week - 1);
+      // week 5 means the last week, which might be the 4th
+      while(day >= firstDay + daysInMonth(year, rule.month)){
+        day -= 7;
+      }
+      return (int64_t)day * secondsInDay + rule.timeOfDay_S;
+    }
+
+    TransitionsStruct _computeTransitions(uint8_t year) const {
+      TransitionsStruct transitions;
+      transitions.start_S = _ruleToLocalTimestamp(_rules.start, year) - _timezone;
+      transitions.end_S = _ruleToLocalTimestamp(_rules.end, year) - _timezone - _rules.DST;
+      return transitions;
+    }
+
+    TransitionsStruct _getTransitions(uint8_t year) const {
+      const uint8_t index = year - _firstYear;
+      if(year >= _firstYear && index < DST_SCHEDULE_YEARS){
+        return _table[index];
+      }
+      return _computeTransitions(year);
+    }
+
+  public:
+    /**
+     * @brief sets the rules and rebuilds the table
+     *
+     * @param rules
+     * @param timezone in seconds
+     * @param firstYear years since 2000 of the first year in the table
+     */
+    void setRules(const DSTRulesStruct& rules, int32_t timezone, uint8_t firstYear){
+      _rules = rules;
+      _timezone = timezone;
+      rebuild(firstYear);
+    }
+
+    DSTRulesStruct getRules() const {return _rules;}
+
+    /**
+     * @brief recompute the table, starting at firstYear
+     *
+     * @param firstYear years since 2000
+     */
+    void rebuild(uint8_t firstYear){
+      _firstYear = firstYear;
+      if(!isEnabled()){return;}
+      for(uint8_t i = 0; i < DST_SCHEDULE_YEARS; i++){
+        _table[i] = _computeTransitions(firstYear + i);
+      }
+    }
+
+    /**
+     * @brief true if the timestamp is covered by the precomputed table
+     *
+     * @param utcTimestamp_S seconds since 2000
+     */
+    bool isInTable(uint64_t utcTimestamp_S) const {
+      const uint8_t year = yearsSince2000(utcTimestamp_S);
+      return year >= _firstYear && (year - _firstYear) < DST_SCHEDULE_YEARS;
+    }
+
+    /**
+     * @brief false if there are no rules, in which case DeviceTime should use the static DST
+     *
+     */
+    bool isEnabled() const {
+      return _rules.DST != 0 && _rules.start.month != 0 && _rules.end.month != 0;
+    }
+
+    /**
+     * @brief get the DST offset at a UTC timestamp
+     *
+     * @param utcTimestamp_S seconds since 2000
+     * @return uint16_t DST in seconds
+     */
+    uint16_t getDSTOffset_S(uint64_t utcTimestamp_S) const {
+      if(!isEnabled()){return 0;}
+      const TransitionsStruct transitions = _getTransitions(yearsSince2000(utcTimestamp_S));
+      const int64_t time = utcTimestamp_S;
+      // in the southern hemisphere, DST ends before it starts
+      const bool isDST = transitions.start_S < transitions.end_S
+        ? (time >= transitions.start_S && time < transitions.end_S)
+        : (time >= transitions.start_S || time < transitions.end_S);
+      return isDST ? _rules.DST : 0;
+    }
+
+    /**
+     * @brief get the next transition after a UTC timestamp
+     *
+     * @param utcTimestamp_S seconds since 2000
+     * @return uint64_t UTC timestamp of the next transition in seconds, or 0 if there are no rules
+     */
+    uint64_t getNextTransition_S(uint64_t utcTimestamp_S) const {
+      if(!isEnabled()){return 0;}
+      const int64_t time = utcTimestamp_S;
+      const uint8_t year = yearsSince2000(utcTimestamp_S);
+      for(uint8_t y = year; y <= year + 1; y++){
+        const TransitionsStruct transitions = _getTransitions(y);
+        const int64_t first = transitions.start_S < transitions.end_S ? transitions.start_S : transitions.end_S;
+        const int64_t second = transitions.start_S < transitions.end_S ? transitions.end_S : transitions.start_S;
+        if(first > time){return first;}
+        if(second > time){return second;}
+      }
+      return 0;
+    }
+};
+
+#endif
@@ -2,16 +2,18 @@
  * notes:
  *  - the local timestamp is stored locally and on the RTC chip, but the RTC_interface is built to accept UTC timestamps
  *  - the local timestamp is stored in microseconds because of timer peripheral,but it won't overflow until we're long dead and the world is engulfed in a malestrom of hurricanes and drought
+ *  - the output task reads the time (ModalLightsController, the buttons) while the control task sets it, and they're on different cores. everything the readers use is guarded by a spinlock; anything slow (building the DST table, config writes, notifying observers) is done outside of it
  */
 
 #ifndef __DEVICETIME_H__
 #define __DEVICETIME_H__
 
 #include <Arduino.h>
-#include <etl/observer.h>
 
 #include "ProjectDefines.h"
 #include "onboardTimestamp.h"
+#include "timeUpdateBus.h"
+#include "DSTSchedule.h"
 #include "ConfigManager.h"
 #include "timeHelpers.h"
 
@@ -23,20 +25,14 @@ uint64_t static roundMicrosToMillis(uint64_t time){
   return (time / 1000) + (time % 1000 >= 500);
 }
 
-typedef etl::observer<const TimeUpdateStruct&> TimeObserver;
-
-#ifndef MAX_TIME_OBSERVERS
-#define MAX_TIME_OBSERVERS 2
-#endif
-
 /**
  * @brief interface for DeviceTime. getUTCTimestampMicros() and setUTCTimestamp2000() need to be overriden by concrete implementation, but everything else should be RTC-agnostic so is non-virtual
  * 
  */
-class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>{
+class DeviceTimeClass : public TimeUpdateBus{
   private:
     std::shared_ptr<ConfigManagerClass> _configManager;
-    std::unique_ptr<OnboardTimestamp> _onboardTimestamp = std::make_unique<OnboardTimestamp>();
+    std::shared_ptr<TimeSourceInterface> _timeSource;
 
     bool _timeFault = true;
 
@@ -46,12 +42,69 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
     RTCConfigsStruct _configs;
     int64_t _offset = 0;  // local time = UTC + offset
 
+    DSTSchedule _dstSchedule;
+    uint64_t _nextDSTTransition_uS = 0; // UTC time in micros of the next DST transition. 0 if there's no DST schedule
+
+    int64_t _utcChanges_uS = 0; // the total of every UTC change, for tasks that hear about the changes late. see getUTCTimestampMicros(appliedChanges_uS)
+
+    // guards the time source, _timeFault, _timeOfNextSync_uS, _configs, _offset, _dstSchedule and _utcChanges_uS. only the control task writes them, so it doesn't need the lock to read them
+#if defined ESP32 || defined ESP32S3
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    void _enterCritical(){portENTER_CRITICAL(&_lock);}
+    void _exitCritical(){portEXIT_CRITICAL(&_lock);}
+#else
+    void _enterCritical(){}   // the native tests are single threaded
+    void _exitCritical(){}
+#endif
+
+    /**
+     * @brief reads the time source, and resets it if it's before the build time. the caller has to hold the lock
+     * 
+     * @return uint64_t UTC timestamp in microseconds
+     */
+    uint64_t _readTimeSource();
+
     void _setOffset(){
       _offset = (_configs.DST + _configs.timezone) * secondsToMicros;
     }
 
+    /**
+     * @brief get the offset at a given UTC time. uses the DST schedule if there is one, otherwise the static offset
+     * 
+     * @param utcTimestamp_uS 
+     * @return int64_t offset in microseconds
+     */
+    int64_t _getOffset(uint64_t utcTimestamp_uS){
+      if(!_dstSchedule.isEnabled()){return _offset;}
+      const int64_t offset_S = _configs.timezone + _dstSchedule.getDSTOffset_S(utcTimestamp_uS / secondsToMicros);
+      return offset_S * (int64_t)secondsToMicros;
+    }
+
+    /**
+     * @brief sets the DST to the scheduled DST at the given UTC time, and notifies observers if the offset changed
+     * 
+     * @param utcTimestamp_uS 
+     */
+    void _applyScheduledDST(uint64_t utcTimestamp_uS);
+
   public:
-    DeviceTimeClass(std::shared_ptr<ConfigManagerClass> configManager) : _configManager(configManager), _configs(_configManager->getRTCConfigs()){};
+    /**
+     * @brief Construct a new Device Time object
+     * 
+     * @param configManager 
+     * @param timeSource the clock that holds the UTC timestamp. defaults to the onboard GP timer
+     */
+    DeviceTimeClass(
+      std::shared_ptr<ConfigManagerClass> configManager,
+      std::shared_ptr<TimeSourceInterface> timeSource = std::make_shared<OnboardTimestamp>()
+    ) : _configManager(configManager), _timeSource(timeSource), _configs(_configManager->getRTCConfigs()){
+      _setOffset();
+      // the time source might already be running (i.e. from the RTC chip), and might never get set. so work out where it is in the DST schedule now, instead of waiting for a sync
+      const uint64_t sourceTimestamp_uS = _timeSource->getTimestamp_uS();
+      const uint64_t utcTimestamp_uS = sourceTimestamp_uS > BUILD_TIMESTAMP ? sourceTimestamp_uS : BUILD_TIMESTAMP;
+      _dstSchedule.setRules(_configManager->getDSTRules(), _configs.timezone, yearsSince2000(utcTimestamp_uS / secondsToMicros));
+      _applyScheduledDST(utcTimestamp_uS);
+    };
 
     /**
      * @brief get the UTC timestamp in microseconds
@@ -60,6 +113,21 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
      */
     uint64_t getUTCTimestampMicros();
 
+    /**
+     * @brief get the UTC timestamp, but without the changes that the caller hasn't applied yet. for a task that gets its time updates late (i.e. through a queue), so that its clock only jumps when it applies them
+     * 
+     * @param appliedChanges_uS getUTCChanges_uS() from when the caller started, plus the utcTimeChange_uS of every update it's applied since
+     * @return uint64_t UTC timestamp in microseconds
+     */
+    uint64_t getUTCTimestampMicros(const int64_t appliedChanges_uS);
+
+    /**
+     * @brief the total of every UTC change that's been made. the changes the observers get notified of add up to this
+     * 
+     * @return int64_t 
+     */
+    int64_t getUTCChanges_uS();
+
     /**
      * @brief sets the UTC timestamp from 2000 epoch. Timezone and DST are in seconds
      * 
@@ -205,10 +273,12 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
 
     bool setMaxTimeBetweenSyncs(uint32_t timeBetweenSyncs_S){
       if(timeBetweenSyncs_S == 0){return false;}
+      const uint64_t utcTimestamp_uS = getUTCTimestampMicros();
+      _enterCritical();
       _configs.maxSecondsBetweenSyncs = timeBetweenSyncs_S;
       _timeOfNextSync_uS = _timeofLastSync_uS + (timeBetweenSyncs_S*secondsToMicros);
-
-      _timeFault = getUTCTimestampMicros() >= _timeOfNextSync_uS;
+      _timeFault = utcTimestamp_uS >= _timeOfNextSync_uS;
+      _exitCritical();
       return true;
     }
 
@@ -221,6 +291,31 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
      */
     RTCConfigsStruct getConfigs(){return _configs;}
 
+    /**
+     * @brief set the DST schedule. while there's a schedule, the DST passed to the setters is ignored and the scheduled DST is used instead. rules with DST = 0 remove the schedule
+     * 
+     * @param rules 
+     * @return true if successful
+     * @return false if the rules are invalid
+     */
+    bool setDSTRules(DSTRulesStruct rules);
+
+    DSTRulesStruct getDSTRules(){return _dstSchedule.getRules();}
+
+    /**
+     * @brief Get the UTC time of the next DST transition in microseconds
+     * 
+     * @return uint64_t UTC timestamp in microseconds, or 0 if there's no DST schedule
+     */
+    uint64_t getNextDSTTransition(){return _nextDSTTransition_uS;}
+
+    /**
+     * @brief applies the DST transition if it's been reached, and notifies the observers of the local time change. should be called by whatever wakes up at getNextDSTTransition()
+     * 
+     * @return true if a transition happened
+     */
+    bool checkDSTTransition();
+
     /**
      * @brief checks the validity of the timezone, according to BLE-SIG specifications
      * 
@@ -242,8 +337,7 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
     }
     
     /**
-     * @brief converts a UTC timestamp into a local timestamp, using stored configs.
-     * TODO: integrate DST time window
+     * @brief converts a UTC timestamp into a local timestamp, using stored configs and the DST schedule
      * 
      * @param utcTimestamp_uS utc timestamp in microseconds
      * @return uint64_t local timestamp in microseconds
@@ -251,8 +345,8 @@ class DeviceTimeClass : public etl::observable<TimeObserver, MAX_TIME_OBSERVERS>
     uint64_t convertUTCToLocalMicros(uint64_t utcTimestamp_uS);
 
     /**
-     * @brief converts a local timestamp into a UTC timestamp, using stored configs.
-     * TODO: integrate DST time window
+     * @brief converts a local timestamp into a UTC timestamp, using stored configs and the DST schedule.
+     * local times that are skipped or repeated by a DST transition resolve using the offset after the transition
      * 
      * @param localTimestamp_uS local timestamp in microseconds
      * @return uint64_t utc timestamp in microseconds
@@ -1,5 +1,6 @@
 /**
  * yes i'm using defines to switch in mocks, but the implementation is platform-specific so i'm not going to change it
+ * other time sources (i.e. a virtual clock for simulations) can be injected into DeviceTime, see timeSource.h
  * 
  */
 
@@ -8,6 +9,8 @@
 
 #include <Arduino.h>
 
+#include "timeSource.h"
+
 #if defined ESP32 || defined ESP32S3
   #define ONBOARD_TIMESTAMP_OVERFLOW ((~(uint64_t)0) >> (64-54))
 #else
@@ -18,7 +21,11 @@
 #define TIMESTAMP_TIMER_GROUP TIMER_GROUP_0
 #define TIMESTAMP_TIMER_NUM TIMER_0
 
-class OnboardTimestamp{
+/**
+ * @brief the default time source. uses a General Purpose Timer on the esp32, and a static timestamp in the native environment so that tests can set the time
+ * 
+ */
+class OnboardTimestamp : public TimeSourceInterface{
   public:
 #ifdef native_env
   static uint64_t _localTestingTimestamp;
@@ -36,23 +43,14 @@ class OnboardTimestamp{
    * 
    * @param timeNow the current UTC timestamp in microseconds
    */
-  void setTimestamp_uS(uint64_t startTime);
-
-  /**
-   * @brief initiate a General Purpose Timer to act as an on-board RTC.
-   * It measures in microseconds because it uses the 80MHz clock,
-   * but won't overflow until 2570.
-   * 
-   * @param timeNow the current UTC timestamp in microseconds
-   */
-  void setTimestamp_S(uint64_t timeNow);
+  void setTimestamp_uS(uint64_t startTime) override;
 
   /**
    * @brief Get the timestamp
    * 
    * @return the current UTC timestamp in microseconds
    */
-  uint64_t getTimestamp_uS();
+  uint64_t getTimestamp_uS() override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+/**
+ * notes:
+ *  - a time source is just a settable microsecond counter. DeviceTime treats it as the UTC timestamp since 2000
+ *  - OnboardTimestamp is the GP timer source, and is the default so that nothing changes unless a source is injected
+ *  - the virtual clock only moves when it's told to, so a simulation can run a year of schedule as fast as the cpu allows
+ */
+
+#ifndef __TIME_SOURCE_H__
+#define __TIME_SOURCE_H__
+
+#include <Arduino.h>
+
+/**
+ * @brief interface for a high-resolution time source
+ *
+ */
+class TimeSourceInterface{
+  public:
+    virtual ~TimeSourceInterface() = default;
+
+    /**
+     * @brief Get the timestamp
+     *
+     * @return the current UTC timestamp in microseconds
+     */
+    virtual uint64_t getTimestamp_uS() = 0;
+
+    /**
+     * @brief set the current timestamp
+     *
+     * @param timeNow the current UTC timestamp in microseconds
+     */
+    virtual void setTimestamp_uS(uint64_t timeNow) = 0;
+
+    /**
+     * @brief set the current timestamp
+     *
+     * @param timeNow the current UTC timestamp in seconds
+     */
+    void setTimestamp_S(uint64_t timeNow){
+      setTimestamp_uS(timeNow * 1000000);
+    }
+};
+
+/**
+ * @brief a clock that only moves when it's advanced. use for deterministic simulations
+ *
+ */
+class VirtualClock : public TimeSourceInterface{
+  private:
+    uint64_t _timestamp_uS = 0;
+  public:
+    VirtualClock(uint64_t startTime_uS = 0) : _timestamp_uS(startTime_uS){};
+
+    uint64_t getTimestamp_uS() override {return _timestamp_uS;}
+
+    void setTimestamp_uS(uint64_t timeNow) override {_timestamp_uS = timeNow;}
+
+    /**
+     * @brief move the clock forwards
+     *
+     * @param time_uS in microseconds
+     */
+    void advance_uS(uint64_t time_uS){_timestamp_uS += time_uS;}
+
+    void advance_S(uint64_t time_S){advance_uS(time_S * 1000000);}
+};
+
+/**
+ * @brief uses std::chrono::steady_clock. use in the native environment for benchmarks and real-time simulations
+ *
+ */
+class SteadyClockTimeSource : public TimeSourceInterface{
+  private:
+    int64_t _offset_uS = 0;  // timestamp = steady clock + offset
+    int64_t _getSteadyClock_uS();
+  public:
+    SteadyClockTimeSource(){};
+
+    uint64_t getTimestamp_uS() override {return _getSteadyClock_uS() + _offset_uS;}
+
+    void setTimestamp_uS(uint64_t timeNow) override {_offset_uS = timeNow - _getSteadyClock_uS();}
+};
+
+#if defined ESP32 || defined ESP32S3
+/**
+ * @brief uses esp_timer, which runs off the same 64-bit timer as the rest of the esp-idf. doesn't need a spare timer group, but only counts from boot
+ *
+ */
+class EspTimerTimeSource : public TimeSourceInterface{
+  private:
+    int64_t _offset_uS = 0;  // timestamp = esp_timer + offset
+  public:
+    EspTimerTimeSource(){};
+
+    uint64_t getTimestamp_uS() override;
+
+    void setTimestamp_uS(uint64_t timeNow) override;
+};
+#endif
+
+#endif
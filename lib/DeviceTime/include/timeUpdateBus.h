@@ -0,0 +1,181 @@
+/**
+ * notes:
+ *  - replaces etl::observable so that observers can choose which time changes they care about. EventManager only cares about local time, ModalLightsController only cares about UTC time
+ *  - filtered out changes aren't thrown away, they accumulate in the observer's slot until they pass the filter. this keeps interpolations from drifting when lots of tiny syncs happen
+ *  - when updates are deferred, every set between flushes gets coalesced into one notification per observer, so a burst of sync messages only causes one rebuild
+ */
+
+#ifndef __TIME_UPDATE_BUS_H__
+#define __TIME_UPDATE_BUS_H__
+
+#include <Arduino.h>
+#include <etl/observer.h>
+
+#include "ProjectDefines.h"
+
+typedef etl::observer<const TimeUpdateStruct&> TimeObserver;  // observers need to publicly inherit TimeObserver
+
+#ifndef MAX_TIME_OBSERVERS
+#define MAX_TIME_OBSERVERS 4
+#endif
+
+typedef uint8_t timeUpdateFlags_t;
+
+namespace TimeUpdateFlags{
+  constexpr timeUpdateFlags_t none = 0;
+  constexpr timeUpdateFlags_t utc = 1;    // UTC time changed
+  constexpr timeUpdateFlags_t local = 2;  // local time changed, including timezone and DST changes
+  constexpr timeUpdateFlags_t any = 3;
+};
+
+/**
+ * @brief decides which time updates an observer gets notified of
+ *
+ */
+struct TimeObserverFilter{
+  timeUpdateFlags_t changes = TimeUpdateFlags::any;  // which time changes to be notified of
+  uint64_t threshold_uS = 0;  // the accumulated change must be at least this big before notifying
+};
+
+/**
+ * @brief a fixed-size observable for time updates. the observer and filter are stored together with the pending changes, so there's no heap allocation.
+ *
+ */
+class TimeUpdateBus{
+  private:
+    struct ObserverSlot{
+      TimeObserver* observer = nullptr;
+      TimeObserverFilter filter;
+      TimeUpdateStruct pending{0, 0, 0};
+    };
+
+    ObserverSlot _slots[MAX_TIME_OBSERVERS];
+    uint8_t _nObservers = 0;
+
+    bool _deferUpdates = false;
+
+    /**
+     * @brief returns a bitflag of the accumulated changes that pass the filter
+     *
+     * @param slot
+     * @return timeUpdateFlags_t matches TimeUpdateFlags
+     */
+    timeUpdateFlags_t _filterChanges(const ObserverSlot& slot){
+      const uint64_t absUTCChange = abs(slot.pending.utcTimeChange_uS);
+      const uint64_t absLocalChange = abs(slot.pending.localTimeChange_uS);
+      const uint64_t threshold = slot.filter.threshold_uS;
+
+      const timeUpdateFlags_t changes =
+        ((absUTCChange != 0 && absUTCChange >= threshold) * TimeUpdateFlags::utc)
+        | ((absLocalChange != 0 && absLocalChange >= threshold) * TimeUpdateFlags::local);
+      return changes & slot.filter.changes;
+    }
+
+    /**
+     * @brief notifies the observer if the pending changes pass the filter, and resets the pending changes
+     *
+     * @param slot
+     */
+    void _deliver(ObserverSlot& slot){
+      if(_filterChanges(slot) == TimeUpdateFlags::none){return;}
+
+      // reset before notifying, incase the observer sets the time
+      const TimeUpdateStruct timeUpdates = slot.pending;
+      slot.pending.utcTimeChange_uS = 0;
+      slot.pending.localTimeChange_uS = 0;
+      slot.observer->notification(timeUpdates);
+    }
+
+  protected:
+    /**
+     * @brief adds the time updates to every observer's pending changes, and notifies them if updates aren't deferred
+     *
+     * @param timeUpdates
+     */
+    void notify_observers(const TimeUpdateStruct& timeUpdates){
+      for(uint8_t i = 0; i < _nObservers; i++){
+        ObserverSlot& slot = _slots[i];
+        slot.pending.utcTimeChange_uS += timeUpdates.utcTimeChange_uS;
+        slot.pending.localTimeChange_uS += timeUpdates.localTimeChange_uS;
+        slot.pending.currentLocalTime_uS = timeUpdates.currentLocalTime_uS;
+      }
+      if(!_deferUpdates){flushTimeUpdates();}
+    }
+
+  public:
+    /**
+     * @brief add an observer. if the observer has already been added, its filter gets replaced
+     *
+     * @param observer
+     * @param filter
+     * @return true if successful
+     * @return false if there are already MAX_TIME_OBSERVERS observers
+     */
+    bool add_observer(TimeObserver& observer, TimeObserverFilter filter = TimeObserverFilter{}){
+      for(uint8_t i = 0; i < _nObservers; i++){
+        if(_slots[i].observer == &observer){
+          _slots[i].filter = filter;
+          return true;
+        }
+      }
+      if(_nObservers >= MAX_TIME_OBSERVERS){return false;}
+
+      ObserverSlot& slot = _slots[_nObservers];
+      slot.observer = &observer;
+      slot.filter = filter;
+      slot.pending = TimeUpdateStruct{0, 0, 0};
+      _nObservers++;
+      return true;
+    }
+
+    /**
+     * @brief remove an observer. any pending changes are discarded
+     *
+     * @param observer
+     * @return true if the observer was removed
+     * @return false if the observer wasn't found
+     */
+    bool remove_observer(TimeObserver& observer){
+      for(uint8_t i = 0; i < _nObservers; i++){
+        if(_slots[i].observer != &observer){continue;}
+        for(uint8_t j = i + 1; j < _nObservers; j++){
+          _slots[j-1] = _slots[j];
+        }
+        _nObservers--;
+        _slots[_nObservers] = ObserverSlot{};
+        return true;
+      }
+      return false;
+    }
+
+    void clear_observers(){
+      for(uint8_t i = 0; i < _nObservers; i++){
+        _slots[i] = ObserverSlot{};
+      }
+      _nObservers = 0;
+    }
+
+    size_t number_of_observers(){return _nObservers;}
+
+    /**
+     * @brief if true, time updates are held until flushTimeUpdates() is called. the main loop should call flushTimeUpdates() once per iteration
+     *
+     * @param deferUpdates
+     */
+    void deferTimeUpdates(bool deferUpdates){
+      _deferUpdates = deferUpdates;
+      if(!deferUpdates){flushTimeUpdates();}
+    }
+
+    /**
+     * @brief notify every observer whose pending changes pass its filter
+     *
+     */
+    void flushTimeUpdates(){
+      for(uint8_t i = 0; i < _nObservers; i++){
+        _deliver(_slots[i]);
+      }
+    }
+};
+
+#endif
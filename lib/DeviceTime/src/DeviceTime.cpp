@@ -1,12 +1,13 @@
 #include "DeviceTime.h"
+#include "metrics.h"
 
-uint64_t DeviceTimeClass::getUTCTimestampMicros()
+uint64_t DeviceTimeClass::_readTimeSource()
 {
-  uint64_t utcTime_uS = _onboardTimestamp->getTimestamp_uS();
+  uint64_t utcTime_uS = _timeSource->getTimestamp_uS();
   if(utcTime_uS <= BUILD_TIMESTAMP){
     _timeFault = true;
     utcTime_uS = BUILD_TIMESTAMP;
-    _onboardTimestamp->setTimestamp_uS(BUILD_TIMESTAMP);
+    _timeSource->setTimestamp_uS(BUILD_TIMESTAMP);
   }
   else if(utcTime_uS >= _timeOfNextSync_uS){
     _timeFault = true;  // flags the need for an external sync
@@ -14,6 +15,30 @@ uint64_t DeviceTimeClass::getUTCTimestampMicros()
   return utcTime_uS;
 };
 
+uint64_t DeviceTimeClass::getUTCTimestampMicros()
+{
+  _enterCritical();
+  const uint64_t utcTime_uS = _readTimeSource();
+  _exitCritical();
+  return utcTime_uS;
+};
+
+uint64_t DeviceTimeClass::getUTCTimestampMicros(const int64_t appliedChanges_uS)
+{
+  _enterCritical();
+  const uint64_t utcTime_uS = _readTimeSource() - (_utcChanges_uS - appliedChanges_uS);
+  _exitCritical();
+  return utcTime_uS;
+};
+
+int64_t DeviceTimeClass::getUTCChanges_uS()
+{
+  _enterCritical();
+  const int64_t utcChanges_uS = _utcChanges_uS;
+  _exitCritical();
+  return utcChanges_uS;
+};
+
 bool DeviceTimeClass::setUTCTimestamp2000(uint64_t newTimestamp, int32_t timezone, uint16_t DST)
 {
   const uint64_t newUTCTimestamp_uS = newTimestamp*secondsToMicros;
@@ -26,23 +51,37 @@ bool DeviceTimeClass::setUTCTimestamp2000(uint64_t newTimestamp, int32_t timezon
   ){
     return false;
   }
-  _timeFault = false;
-  const uint64_t oldUTCTimestamp_uS = _onboardTimestamp->getTimestamp_uS();
-  _onboardTimestamp->setTimestamp_S(newTimestamp);
+  // the table gets built before the critical section, and swapped in during it
+  DSTSchedule dstSchedule = _dstSchedule;
+  if(dstSchedule.isEnabled()){
+    // the schedule decides the DST
+    if(timezone != _configs.timezone || !dstSchedule.isInTable(newTimestamp)){
+      dstSchedule.setRules(dstSchedule.getRules(), timezone, yearsSince2000(newTimestamp));
+    }
+    DST = dstSchedule.getDSTOffset_S(newTimestamp);
+  }
+  _nextDSTTransition_uS = dstSchedule.getNextTransition_S(newTimestamp) * secondsToMicros;
 
-  int64_t oldOffset = _offset;
-  if(
-    _configs.DST != DST
-    || _configs.timezone != timezone
-  ){
+  const int64_t oldOffset = _offset;
+  const bool haveConfigsChanged = _configs.DST != DST || _configs.timezone != timezone;
+
+  _enterCritical();
+  _dstSchedule = dstSchedule;
+  _timeFault = false;
+  const uint64_t oldUTCTimestamp_uS = _timeSource->getTimestamp_uS();
+  _timeSource->setTimestamp_S(newTimestamp);
+  _utcChanges_uS += static_cast<int64_t>(newUTCTimestamp_uS - oldUTCTimestamp_uS);
+  if(haveConfigsChanged){
     _configs.DST = DST;
     _configs.timezone = timezone;
     _setOffset();
-    _configManager->setRTCConfigs(_configs);
   }
-  
-  _timeofLastSync_uS = newUTCTimestamp_uS;
   _timeOfNextSync_uS = newUTCTimestamp_uS + _configs.maxSecondsBetweenSyncs*secondsToMicros;
+  _exitCritical();
+
+  if(haveConfigsChanged){_configManager->setRTCConfigs(_configs);}
+  _timeofLastSync_uS = newUTCTimestamp_uS;
+  getMetrics().count(MetricCounters::timeSyncs);
 
   const int64_t utcTimeChange_uS = newUTCTimestamp_uS - oldUTCTimestamp_uS;
   const TimeUpdateStruct timeUpdates{
@@ -138,18 +177,92 @@ bool DeviceTimeClass::hasTimeFault()
 
 uint64_t DeviceTimeClass::convertUTCToLocalMicros(uint64_t utcTimestamp_uS)
 {
-  // TODO: check DST start and end bounds
-  if(abs(_offset) > utcTimestamp_uS){
+  _enterCritical();
+  const int64_t offset = _getOffset(utcTimestamp_uS);
+  _exitCritical();
+  if(abs(offset) > utcTimestamp_uS){
     return 0;
   }
-  return utcTimestamp_uS + _offset;
+  return utcTimestamp_uS + offset;
 }
 
 uint64_t DeviceTimeClass::convertLocalToUTCMicros(uint64_t localTimestamp_uS)
 {
-  // TODO: check DST start and end bounds
-  if(abs(_offset) > localTimestamp_uS){
+  _enterCritical();
+  const int64_t timezone_uS = _configs.timezone * (int64_t)secondsToMicros;
+  const bool isBeforeEpoch = abs(timezone_uS) > localTimestamp_uS;
+  // the DST transitions are in UTC, so look them up with standard time
+  const int64_t offset = isBeforeEpoch ? 0 : _getOffset(localTimestamp_uS - timezone_uS);
+  _exitCritical();
+  if(isBeforeEpoch || abs(offset) > localTimestamp_uS){
     return 0;
   }
-  return localTimestamp_uS - _offset;
+  return localTimestamp_uS - offset;
+}
+
+bool DeviceTimeClass::setDSTRules(DSTRulesStruct rules)
+{
+  if(rules.DST != 0){
+    const DSTRuleStruct transitions[2] = {rules.start, rules.end};
+    for(const DSTRuleStruct& rule : transitions){
+      if(
+        rule.month == 0 || rule.month > 12
+        || rule.week == 0 || rule.week > 5
+        || rule.dayOfWeek == 0 || rule.dayOfWeek > 7
+        || rule.timeOfDay_S >= secondsInDay
+      ){
+        return false;
+      }
+    }
+    if(!isDSTValid(rules.DST)){return false;}
+  }
+  const uint64_t utcTimestamp_uS = getUTCTimestampMicros();
+  DSTSchedule dstSchedule = _dstSchedule;
+  dstSchedule.setRules(rules, _configs.timezone, yearsSince2000(utcTimestamp_uS / secondsToMicros));
+  _enterCritical();
+  _dstSchedule = dstSchedule;
+  _exitCritical();
+  _configManager->setDSTRules(rules);
+  _applyScheduledDST(utcTimestamp_uS);
+  return true;
+}
+
+bool DeviceTimeClass::checkDSTTransition()
+{
+  if(_nextDSTTransition_uS == 0){return false;}
+  const uint64_t utcTimestamp_uS = getUTCTimestampMicros();
+  if(utcTimestamp_uS < _nextDSTTransition_uS){return false;}
+  _applyScheduledDST(utcTimestamp_uS);
+  return true;
+}
+
+void DeviceTimeClass::_applyScheduledDST(uint64_t utcTimestamp_uS)
+{
+  const uint64_t utcTimestamp_S = utcTimestamp_uS / secondsToMicros;
+  if(!_dstSchedule.isInTable(utcTimestamp_S)){
+    DSTSchedule dstSchedule = _dstSchedule;
+    dstSchedule.rebuild(yearsSince2000(utcTimestamp_S));
+    _enterCritical();
+    _dstSchedule = dstSchedule;
+    _exitCritical();
+  }
+  _nextDSTTransition_uS = _dstSchedule.getNextTransition_S(utcTimestamp_S) * secondsToMicros;
+  if(!_dstSchedule.isEnabled()){return;}
+
+  const uint16_t DST = _dstSchedule.getDSTOffset_S(utcTimestamp_S);
+  if(DST == _configs.DST){return;}
+
+  const int64_t oldOffset = _offset;
+  _enterCritical();
+  _configs.DST = DST;
+  _setOffset();
+  _exitCritical();
+  _configManager->setRTCConfigs(_configs);
+
+  const TimeUpdateStruct timeUpdates{
+    .utcTimeChange_uS = 0,
+    .localTimeChange_uS = _offset - oldOffset,
+    .currentLocalTime_uS = utcTimestamp_uS + _offset
+  };
+  notify_observers(timeUpdates);
 }
\ No newline at end of file
@@ -5,10 +5,6 @@
 
 #include "onboardTimestamp.h"
 
-void OnboardTimestamp::setTimestamp_S(uint64_t timeNow){
-  setTimestamp_uS(timeNow * 1000000);
-};
-
 #ifdef ESP32S3
 #include "driver/timer.h"
 
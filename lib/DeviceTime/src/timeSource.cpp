@@ -0,0 +1,21 @@
+// chrono needs to be included before ProjectDefines gets anywhere near it, because of the max macro
+#include <chrono>
+
+#include "timeSource.h"
+
+int64_t SteadyClockTimeSource::_getSteadyClock_uS(){
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+#if defined ESP32 || defined ESP32S3
+#include "esp_timer.h"
+
+uint64_t EspTimerTimeSource::getTimestamp_uS(){
+  return esp_timer_get_time() + _offset_uS;
+}
+
+void EspTimerTimeSource::setTimestamp_uS(uint64_t timeNow){
+  _offset_uS = timeNow - esp_timer_get_time();
+}
+#endif
@@ -0,0 +1,122 @@
+#ifndef __ENCODER_INTERFACE_HPP__
+#define __ENCODER_INTERFACE_HPP__
+
+#include <Arduino.h>
+#include <memory>
+
+#include "DeviceTime.h"
+#include "ModalLights.h"
+
+struct EncoderConfigs {
+  uint8_t countsPerDetent = 4;      // counts per click. a quadrature encoder counting every edge is 4
+  uint8_t stepsPerDetent = 1;       // brightness steps per click when turning slowly
+  uint8_t maxStepsPerDetent = 8;    // brightness steps per click when turning fast
+  uint16_t fastDetentRate = 40;     // clicks per second that get maxStepsPerDetent. anything slower gets scaled down to stepsPerDetent
+};
+
+/**
+ * @brief A class for a rotary encoder physical interface. All it needs is a getCount() and it'll be good to go!
+ * the count should come from a hardware counter, so turning the encoder doesn't cost anything until update() reads it. each update() turns the change in count into clicks, and adjusts modalLights by a number of steps that scales with how fast the encoder was turned. counts that don't make up a whole click carry over to the next update
+ *
+ */
+class EncoderInterface {
+  protected:
+    EncoderConfigs _configs;
+
+    std::shared_ptr<DeviceTimeClass> _deviceTime;
+    std::shared_ptr<ModalLightsInterface> _modalLights;
+
+    int32_t _previousCount = 0;
+    int32_t _remainder = 0;         // counts that didn't make a whole click
+    uint64_t _previousTime_uS = 0;  // the time of the previous click
+    bool _isFirstUpdate = true;
+
+    /**
+     * @brief the number of brightness steps per click, given how many clicks there were since the previous update
+     *
+     * @param detents absolute number of clicks
+     * @param time_uS time since the previous click. 0 if it's unknown
+     * @return uint16_t
+     */
+    uint16_t _stepsPerDetent(const uint32_t detents, const uint64_t time_uS){
+      const uint16_t minSteps = _configs.stepsPerDetent;
+      const uint16_t maxSteps = _configs.maxStepsPerDetent > minSteps ? _configs.maxStepsPerDetent : minSteps;
+      if(time_uS == 0 || _configs.fastDetentRate == 0){return minSteps;}
+
+      // clicks per second, capped at fastDetentRate
+      const uint64_t fastRate = _configs.fastDetentRate;
+      uint64_t rate = (static_cast<uint64_t>(detents) * secondsToMicros) / time_uS;
+      if(rate > fastRate){rate = fastRate;}
+      return minSteps + static_cast<uint16_t>(((maxSteps - minSteps) * rate) / fastRate);
+    }
+
+  public:
+    EncoderInterface(
+      std::shared_ptr<DeviceTimeClass> deviceTime,
+      std::shared_ptr<ModalLightsInterface> modalLights,
+      EncoderConfigs configs = EncoderConfigs{}
+    ) : _configs(configs), _deviceTime(deviceTime), _modalLights(modalLights) {};
+
+    virtual ~EncoderInterface() = default;
+
+    /**
+     * @brief Get the accumulated count. it should never be reset, and can wrap around
+     *
+     * @return int32_t
+     */
+    virtual int32_t getCount() = 0;
+
+    /**
+     * @brief read the count, and adjust modalLights if the encoder has turned by at least one click since the previous update
+     *
+     * @return int16_t the number of clicks, positive for clockwise
+     */
+    int16_t update(){
+      return _update(getCount(), _deviceTime->getUTCTimestampMicros());
+    }
+
+    EncoderConfigs getConfigs(){return _configs;}
+
+  protected:
+    /**
+     * @brief turn the count into an adjustment
+     *
+     * @param count the accumulated count
+     * @param time_uS the time of the count
+     * @return int16_t the number of clicks
+     */
+    int16_t _update(const int32_t count, const uint64_t time_uS){
+      if(_isFirstUpdate){
+        // nothing to compare against yet
+        _isFirstUpdate = false;
+        _previousCount = count;
+        _previousTime_uS = time_uS;
+        return 0;
+      }
+
+      // unsigned subtraction handles the count wrapping around
+      const int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(count) - static_cast<uint32_t>(_previousCount));
+      _previousCount = count;
+
+      // time going backwards (i.e. a time sync) is treated as turning slowly
+      if(time_uS < _previousTime_uS){_previousTime_uS = time_uS;}
+
+      const int32_t countsPerDetent = _configs.countsPerDetent == 0 ? 1 : _configs.countsPerDetent;
+      _remainder += delta;
+      const int32_t detents = _remainder / countsPerDetent;
+      _remainder -= detents * countsPerDetent;
+      if(detents == 0){return 0;}
+
+      // the speed is measured between clicks, not between updates, otherwise one slow click in a fast loop looks fast
+      const uint64_t elapsed_uS = time_uS - _previousTime_uS;
+      _previousTime_uS = time_uS;
+
+      const bool increasing = detents > 0;
+      const uint32_t absDetents = increasing ? detents : -detents;
+      const uint32_t steps = absDetents * _stepsPerDetent(absDetents, elapsed_uS);
+      _modalLights->adjustBrightness(steps > 255 ? 255 : steps, increasing);
+      return detents;
+    }
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "EventManager.h"
+#include "trace.h"
+#include "metrics.h"
 
 EventManager::EventManager(std::shared_ptr<ModalLightsInterface> modalLights, std::shared_ptr<ConfigManagerClass> configManager, std::shared_ptr<DeviceTimeClass> deviceTime, std::shared_ptr<DataStorageClass> storage)
   : _modalLights(modalLights), _configManager(configManager), _configs(configManager->getEventManagerConfigs()),
@@ -12,15 +14,17 @@ EventManager::EventManager(std::shared_ptr<ModalLightsInterface> modalLights, st
     EventDataPacket event = events.getNext();
     eventError_t error = isEventDataPacketValid(event, false);
     if(error == EventManagerErrors::success){
+      const uint32_t leadTime_S = _findLeadTime(event);
       error = event.isActive
-            ? _active->addEvent(timestamp_S, event)
-            : _background->addEvent(timestamp_S, event);
+            ? _active->addEvent(timestamp_S, event, leadTime_S)
+            : _background->addEvent(timestamp_S, event, leadTime_S);
     }
     if(error != EventManagerErrors::success){
       // TODO: alert server of the error
     };
   };
-  _deviceTime->add_observer(*this);
+  // events are scheduled in local time, so UTC-only changes can be ignored
+  _deviceTime->add_observer(*this, TimeObserverFilter{.changes = TimeUpdateFlags::local});
   _check(timestamp_S);
 }
 
@@ -49,16 +53,29 @@ eventError_t EventManager::isEventDataPacketValid(const EventDataPacket &newEven
   return EventManagerErrors::success;
 }
 
+uint32_t EventManager::_findLeadTime(const EventDataPacket& event){
+  uint8_t dataArray[modePacketSize];
+  if(!_storage->getMode(event.modeID, dataArray)){return 0;}
+  ModeDataStruct modeData;
+  deserializeModeData(dataArray, &modeData);
+  if(modeData.type != ModeTypes::sunrise){return 0;}
+  // time[0] is in minutes, so the window is always less than a day
+  return static_cast<uint32_t>(modeData.time[0]) * 60;
+}
+
 void EventManager::_check(const uint64_t timestamp_S){
+  TRACE_SPAN(eventCheck);
   {
     TriggeringModeStruct activeMode = _active->check(timestamp_S);
     if(activeMode.ID != 0){
+      getMetrics().count(MetricCounters::eventTriggers);
       _modalLights->setModeByUUID(activeMode.ID, activeMode.triggerTime, true);
     }
   }
   {
     TriggeringModeStruct backgroundMode = _background->check(timestamp_S);
     if(backgroundMode.ID != 0){
+      getMetrics().count(MetricCounters::eventTriggers);
       _modalLights->setModeByUUID(backgroundMode.ID, backgroundMode.triggerTime, false);
     }
   }
@@ -88,9 +105,10 @@ eventError_t EventManager::addEvent(const EventDataPacket& newEvent){
     return error;
   }
   uint64_t timestamp_S = _deviceTime->getLocalTimestampSeconds();
+  const uint32_t leadTime_S = _findLeadTime(newEvent);
   error = newEvent.isActive
-        ? _active->addEvent(timestamp_S, newEvent)
-        : _background->addEvent(timestamp_S, newEvent);
+        ? _active->addEvent(timestamp_S, newEvent, leadTime_S)
+        : _background->addEvent(timestamp_S, newEvent, leadTime_S);
   _check(timestamp_S);
 
   // TODO: add event to storage
@@ -121,22 +139,23 @@ eventError_t EventManager::updateEvent(EventDataPacket event){
   }
 
   const uint64_t timestamp_S = _deviceTime->getLocalTimestampSeconds();
+  const uint32_t leadTime_S = _findLeadTime(event);
   if(event.isActive){
-    error = _active->updateEvent(timestamp_S, event);
+    error = _active->updateEvent(timestamp_S, event, leadTime_S);
     if(error == EventManagerErrors::event_not_found){
       // if changing background to active
       if(_background->removeEvent(timestamp_S, event.eventID) == EventManagerErrors::success){
-        error = _active->addEvent(timestamp_S, event);
+        error = _active->addEvent(timestamp_S, event, leadTime_S);
       }
     }
   }
   else{
     // if event is background
-    error = _background->updateEvent(timestamp_S, event);
+    error = _background->updateEvent(timestamp_S, event, leadTime_S);
     if(error == EventManagerErrors::event_not_found){
       // if changing active to background
       if(_active->removeEvent(timestamp_S, event.eventID)){
-        error = _background->addEvent(timestamp_S, event);
+        error = _background->addEvent(timestamp_S, event, leadTime_S);
       }
     }
   }
@@ -160,6 +179,8 @@ void EventManager::rebuildTriggerTimes(){
 };
 
 void EventManager::check(){
+  // wakes up at DST transitions. the transition notifies the observers, which adjusts the trigger times
+  _deviceTime->checkDSTTransition();
   _check(_deviceTime->getLocalTimestampSeconds());
 };
 
@@ -27,6 +27,15 @@ private:
 
   void _check(const uint64_t timestamp_S);
 
+  /**
+   * @brief how long before its event time an event should trigger. sunrises finish at the event time, so they trigger a window early. everything else triggers on time
+   * TODO: this reads storage directly, so it needs to go through the storage worker once events can be added at runtime
+   * 
+   * @param event 
+   * @return uint32_t seconds
+   */
+  uint32_t _findLeadTime(const EventDataPacket& event);
+
 public:
   // TODO: integrate ErrorManager
   EventManager(
@@ -47,7 +56,7 @@ public:
   eventError_t isEventDataPacketValid(const EventDataPacket &newEvent, const bool updating);
   
   /**
-   * @brief Get the ID and time of the next event
+   * @brief Get the ID and time of the next event. this is when it triggers, which is a window before the event time for sunrises
    * 
    * @return EventTimeStruct 
    */
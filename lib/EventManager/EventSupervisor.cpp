@@ -1,4 +1,5 @@
 #include "EventSupervisor.h"
+#include "profiler.h"
 
 /*############################################################
 common functions for Background and Active containers
@@ -25,7 +26,8 @@ uint64_t findNextTriggerTime(const UsefulTimeStruct& uts, const EventMappingStru
   uint8_t today = uts.dayOfWeek - 1;
   uint64_t startOfDay = uts.startOfDay;
 
-  for(int x = 0; x < 7; x++){
+  // x = 7 is today next week, for events that only trigger on one day
+  for(int x = 0; x <= 7; x++){
     bool doesEventTriggerOnDay = (1 << ((today + x)%7)) & event->daysOfWeek;
     bool doesEventTriggerAfterTimeInDay = event->timeOfDay > timeInDay;
     if(doesEventTriggerOnDay
@@ -61,7 +63,8 @@ Background Event Container
 uint64_t BackgroundEventSupervisor::_findPreviousTriggerTime(const EventMappingStruct& event, const UsefulTimeStruct &timeStruct){
   uint8_t today = timeStruct.dayOfWeek - 1;
   uint32_t timeInDay = timeStruct.timeInDay;
-  for(int x = 0; x < 7; x++){
+  // x = 7 is today last week, for events that only trigger on one day
+  for(int x = 0; x <= 7; x++){
     uint8_t searchDay = (1 << ((7 + today - x)%7));
     if(searchDay & event.daysOfWeek
         && event.timeOfDay <= timeInDay
@@ -104,10 +107,11 @@ void BackgroundEventSupervisor::_shouldEventBeNext(eventUUID eventID, EventMappi
 }
 
 TriggeringModeStruct BackgroundEventSupervisor::check(uint64_t timestamp_S){
+  PROFILE_SCOPE(backgroundSupervisorCheck);
   TriggeringModeStruct triggeringMode;
   if(_events.size() == 0){
     // no background events defaults to constant brightness mode
-    triggeringMode.ID = 1;
+    triggeringMode.ID = defaultModeID;
     triggeringMode.triggerTime = 0;
     return triggeringMode;
   }
@@ -121,7 +125,7 @@ TriggeringModeStruct BackgroundEventSupervisor::check(uint64_t timestamp_S){
 
     EventMappingStruct* event = _nextEvent.data;
     triggeringMode.ID = event->modeID;
-    triggeringMode.triggerTime = event->nextTriggerTime;
+    triggeringMode.triggerTime = event->nextTriggerTime + event->leadTime;
     _previousEvent.ID = _nextEvent.ID;
     _previousEvent.triggerTime = _nextEvent.getNextTriggerTime();
     event->nextTriggerTime = findNextTriggerTime(UsefulTimeStruct(timestamp_S + 1), event);
@@ -131,14 +135,14 @@ TriggeringModeStruct BackgroundEventSupervisor::check(uint64_t timestamp_S){
   return triggeringMode;
 }
 
-eventError_t BackgroundEventSupervisor::addEvent(uint64_t timestamp_S, const EventDataPacket &newEvent){
+eventError_t BackgroundEventSupervisor::addEvent(uint64_t timestamp_S, const EventDataPacket &newEvent, const uint32_t leadTime_S){
   eventUUID newEventID = newEvent.eventID;
   if(_events.count(newEventID) != 0){
     return EventManagerErrors::bad_uuid;
   }
 
   const UsefulTimeStruct uts = UsefulTimeStruct(timestamp_S);
-  auto pair = _events.emplace(newEventID, EventMappingStruct(newEvent));
+  auto pair = _events.emplace(newEventID, EventMappingStruct(newEvent, leadTime_S));
   EventMappingStruct* event = &pair.first->second;
 
   event->nextTriggerTime = _findPreviousTriggerTime(*event, uts);
@@ -166,7 +170,7 @@ void BackgroundEventSupervisor::_rebuildTriggerTimes(uint64_t timestamp_S){
   }
 }
 
-eventError_t BackgroundEventSupervisor::updateEvent(uint64_t timestamp_S, const EventDataPacket &eventPacket){
+eventError_t BackgroundEventSupervisor::updateEvent(uint64_t timestamp_S, const EventDataPacket &eventPacket, const uint32_t leadTime_S){
   eventUUID eventID = eventPacket.eventID;
   if(_events.count(eventID) == 0){
     return EventManagerErrors::event_not_found;
@@ -174,7 +178,7 @@ eventError_t BackgroundEventSupervisor::updateEvent(uint64_t timestamp_S, const
   UsefulTimeStruct uts = UsefulTimeStruct(timestamp_S);
   auto pair = _events.find(eventID);
   EventMappingStruct* event = &pair->second;
-  *event = EventMappingStruct(eventPacket);
+  *event = EventMappingStruct(eventPacket, leadTime_S);
 
   rebuildTriggerTimes(timestamp_S);
   return EventManagerErrors::success;
@@ -218,6 +222,7 @@ void ActiveEventSupervisor::_shouldEventBeNext(eventUUID eventID, EventMappingSt
 }
 
 TriggeringModeStruct ActiveEventSupervisor::check(uint64_t timestamp_S){
+  PROFILE_SCOPE(activeSupervisorCheck);
   TriggeringModeStruct triggeringMode;
   uint16_t limit = 0;
   while(timestamp_S >= _nextEvent.getNextTriggerTime()){
@@ -232,7 +237,7 @@ TriggeringModeStruct ActiveEventSupervisor::check(uint64_t timestamp_S){
     if(timestamp_S <= _nextEvent.getNextTriggerTime() + _checkEventWindow(event->eventWindow)){
       // only trigger if the event hasn't expired
       triggeringMode.ID = event->modeID;
-      triggeringMode.triggerTime = event->nextTriggerTime;
+      triggeringMode.triggerTime = event->nextTriggerTime + event->leadTime;
       
       _previousEvent.ID = _nextEvent.ID;
       _previousEvent.triggerTime = _nextEvent.getNextTriggerTime();
@@ -244,14 +249,14 @@ TriggeringModeStruct ActiveEventSupervisor::check(uint64_t timestamp_S){
   return triggeringMode;
 }
 
-eventError_t ActiveEventSupervisor::addEvent(uint64_t timestamp_S, const EventDataPacket &newEvent){
+eventError_t ActiveEventSupervisor::addEvent(uint64_t timestamp_S, const EventDataPacket &newEvent, const uint32_t leadTime_S){
   eventUUID newEventID = newEvent.eventID;
   if(_events.count(newEventID) != 0){
     return EventManagerErrors::bad_uuid;
   }
 
   const UsefulTimeStruct uts = UsefulTimeStruct(timestamp_S);
-  auto pair = _events.emplace(newEventID, EventMappingStruct(newEvent));
+  auto pair = _events.emplace(newEventID, EventMappingStruct(newEvent, leadTime_S));
   EventMappingStruct* event = &pair.first->second;
 
   event->nextTriggerTime = _findNextTriggerWithWindow(timestamp_S, event);
@@ -280,7 +285,7 @@ void ActiveEventSupervisor::rebuildTriggerTimes(uint64_t timestamp_S){
   }
 }
 
-eventError_t ActiveEventSupervisor::updateEvent(uint64_t timestamp_S, const EventDataPacket &eventPacket){
+eventError_t ActiveEventSupervisor::updateEvent(uint64_t timestamp_S, const EventDataPacket &eventPacket, const uint32_t leadTime_S){
   eventUUID eventID = eventPacket.eventID;
   if(_events.count(eventID) == 0){
     return EventManagerErrors::event_not_found;
@@ -289,7 +294,7 @@ eventError_t ActiveEventSupervisor::updateEvent(uint64_t timestamp_S, const Even
   UsefulTimeStruct uts = UsefulTimeStruct(timestamp_S);
   auto pair = _events.find(eventID);
   EventMappingStruct* event = &pair->second;
-  *event = EventMappingStruct(eventPacket);
+  *event = EventMappingStruct(eventPacket, leadTime_S);
 
   // if event just triggered, moving it forwards a few minutes but still in the past shouldn't re-trigger.
   const bool eventJustTriggered = (
@@ -17,13 +17,31 @@ struct EventMappingStruct {
   uint8_t daysOfWeek = 0; // lsb = Monday, msb-1 = Sunday, msb is reserved, i.e. 0b01100000 = saturday and sunday
   uint32_t eventWindow = 0; // how long after the time should the event trigger? should equal "timeout" in the Mode Data Struct
   bool isActive = 0;
+  uint32_t leadTime = 0;  // how long before the event time it triggers (i.e. the sunrise window). timeOfDay and daysOfWeek are when it triggers, not the event time
 
-  EventMappingStruct(const EventDataPacket& dataPacket) :
+  /**
+   * @brief Construct a new Event Mapping Struct object. if there's a lead time, the event triggers that much earlier, which can be the day before
+   * 
+   * @param dataPacket 
+   * @param leadTime_S must be less than a day
+   */
+  EventMappingStruct(const EventDataPacket& dataPacket, const uint32_t leadTime_S = 0) :
     modeID(dataPacket.modeID),
     timeOfDay(dataPacket.timeOfDay),
     daysOfWeek(dataPacket.daysOfWeek),
     eventWindow(dataPacket.eventWindow),
-    isActive(dataPacket.isActive){};
+    isActive(dataPacket.isActive),
+    leadTime(leadTime_S)
+  {
+    if(leadTime <= timeOfDay){
+      timeOfDay -= leadTime;
+      return;
+    }
+    // triggers the day before, so Monday becomes Sunday
+    timeOfDay = timeOfDay + maxTimeOfDay + 1 - leadTime;
+    const uint8_t days = daysOfWeek & daysOfWeekMask;
+    daysOfWeek = ((days >> 1) | (days << 6)) & daysOfWeekMask;
+  };
 };
 
 typedef etl::flat_map<eventUUID, EventMappingStruct, MAX_NUMBER_OF_EVENTS> EventMap_t;
@@ -70,9 +88,9 @@ public:
 
   virtual TriggeringModeStruct check(uint64_t timestamp_S) = 0;
 
-  virtual eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket) = 0;
+  virtual eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket, const uint32_t leadTime_S = 0) = 0;
   virtual void rebuildTriggerTimes(uint64_t timestamp_S) = 0;
-  virtual eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event) = 0;
+  virtual eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event, const uint32_t leadTime_S = 0) = 0;
   virtual eventError_t removeEvent(uint64_t timestamp_S, eventUUID eventID) = 0;
 
   virtual EventTimeStruct getNextEvent() = 0;
@@ -124,7 +142,7 @@ public:
    * @brief returns the mode that should be triggered now. if none should trigger, returns an empty TriggeringModeStruct.
    * 
    * @param timestamp_S 
-   * @return TriggeringModeStruct modeID and trigger time of the mode
+   * @return TriggeringModeStruct modeID and event time of the mode, which is after the trigger if the event has a lead time
    */
   TriggeringModeStruct check(uint64_t timestamp_S);
 
@@ -133,9 +151,10 @@ public:
    * 
    * @param timestamp_S 
    * @param newEventPacket 
+   * @param leadTime_S how long before the event time it should trigger
    * @return eventError_t 
    */
-  eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket);
+  eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket, const uint32_t leadTime_S = 0);
 
   /**
    * @brief rebuilds the trigger times and sets the next event. resets previousTriggerTime which can lead to re-triggering a mode, but how this gets handled is dependant on the mode, so it's really a ModalController problem
@@ -153,9 +172,10 @@ public:
    * 
    * @param timestamp_S 
    * @param event 
+   * @param leadTime_S how long before the event time it should trigger
    * @return eventError_t 
    */
-  eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event);
+  eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event, const uint32_t leadTime_S = 0);
 
   /**
    * @brief removes the event, and rebuilds the trigger times.
@@ -241,7 +261,7 @@ public:
    * @brief returns the mode that should be triggered now. if none should trigger, returns an empty TriggeringModeStruct.
    * 
    * @param timestamp_S 
-   * @return TriggeringModeStruct modeID and trigger time of the mode
+   * @return TriggeringModeStruct modeID and event time of the mode, which is after the trigger if the event has a lead time
    */
   TriggeringModeStruct check(uint64_t timestamp_S);
 
@@ -250,9 +270,10 @@ public:
    * 
    * @param timestamp_S 
    * @param newEventPacket 
+   * @param leadTime_S how long before the event time it should trigger
    * @return eventError_t 
    */
-  eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket);
+  eventError_t addEvent(uint64_t timestamp_S, const EventDataPacket &newEventPacket, const uint32_t leadTime_S = 0);
 
   /**
    * @brief rebuilds trigger times, checking for missed events and checking against previousEventTime.
@@ -266,9 +287,10 @@ public:
    * 
    * @param timestamp_S 
    * @param event 
+   * @param leadTime_S how long before the event time it should trigger
    * @return eventError_t 
    */
-  eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event);
+  eventError_t updateEvent(uint64_t timestamp_S, const EventDataPacket &event, const uint32_t leadTime_S = 0);
 
   /**
    * @brief remove an event and rebuild the trigger times using event windows. previousEvent is unchanged, even if it's the removed event
@@ -0,0 +1,302 @@
+#ifndef __GESTURE_ENGINE_HPP__
+#define __GESTURE_ENGINE_HPP__
+
+#include <Arduino.h>
+
+/*
+ * the inputs are packed into a bitmask, where bit i is true while input i is pressed. the engine gets the whole mask once per tick, and only visits the groups that have changed or have a timer running.
+ *
+ * inputs that share a chord get put into the same group, so a chord is just a press where more than one input in the group got pressed. every other input gets a group to itself.
+ */
+
+typedef uint32_t inputMask_t;
+typedef uint8_t gestureID_t;
+
+#define MAX_GESTURE_INPUTS 32
+
+struct GestureConfigs {
+  uint16_t holdTime_mS = 500;       // milliseconds before a press becomes a hold
+  uint16_t multiTapWindow_mS = 300; // milliseconds after a release to wait for another tap
+};
+
+enum class GesturePhases : uint8_t {
+  tap = 0,        // the taps have finished
+  holdStart = 1,  // the inputs have been held for holdTime_mS
+  holdEnd = 2     // the held inputs were released
+};
+
+/**
+ * @brief an entry in the gesture table
+ *
+ */
+struct GestureDefinition {
+  gestureID_t ID = 0;
+  inputMask_t inputs = 0;   // the inputs that make up the gesture. more than one input is a chord
+  uint8_t taps = 1;         // 1 = tap, 2 = double tap, etc. 0 = press and hold
+};
+
+struct GestureEvent {
+  gestureID_t ID = 0;
+  GesturePhases phase = GesturePhases::tap;
+  uint64_t time_uS = 0;     // the time of the tick that recognised the gesture
+  uint64_t pressStart_uS = 0; // holds only: the time the press started, so the hold started at pressStart_uS + holdTime_mS
+};
+
+/**
+ * @brief table-driven gesture recogniser for up to 32 inputs. all the state lives in fixed-size arrays
+ *
+ * @tparam nInputs the number of inputs
+ * @tparam nGestures the number of entries in the gesture table
+ */
+template<uint8_t nInputs, uint8_t nGestures>
+class GestureEngine {
+  static_assert(nInputs > 0 && nInputs <= MAX_GESTURE_INPUTS, "nInputs must be between 1 and 32");
+
+  private:
+    struct GroupState {
+      inputMask_t inputs = 0;       // the inputs in the group
+      inputMask_t pressMask = 0;    // every input pressed since the group was first pressed
+      inputMask_t tapMask = 0;      // the pressMask of the previous taps
+      uint64_t pressStart_uS = 0;
+      uint64_t lastRelease_uS = 0;
+      uint8_t taps = 0;
+      bool isPressed = false;
+      bool isHeld = false;
+    };
+
+    GestureConfigs _configs;
+    GestureDefinition _gestures[nGestures];
+
+    GroupState _groups[nInputs];
+    uint8_t _inputToGroup[nInputs];
+    uint8_t _nGroups = 0;
+
+    inputMask_t _previousInputs = 0;
+    inputMask_t _pendingGroups = 0; // groups with a press or tap in progress
+
+    GestureEvent _events[3*nInputs]; // each group can finish its taps, and start and end a hold, in the same tick
+    uint8_t _nEvents = 0;
+
+    /**
+     * @brief find a gesture in the table
+     *
+     * @param inputs
+     * @param taps 0 for a hold
+     * @return const GestureDefinition* nullptr if there isn't one
+     */
+    const GestureDefinition* _findGesture(const inputMask_t inputs, const uint8_t taps){
+      for(uint8_t i = 0; i < nGestures; i++){
+        if(_gestures[i].inputs == inputs && _gestures[i].taps == taps){
+          return &_gestures[i];
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * @brief true if there's a gesture with more taps than the given number
+     *
+     */
+    bool _hasMoreTaps(const inputMask_t inputs, const uint8_t taps){
+      for(uint8_t i = 0; i < nGestures; i++){
+        if(_gestures[i].inputs == inputs && _gestures[i].taps > taps){
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void _emit(const GestureDefinition* gesture, const GesturePhases phase, const uint64_t time_uS, const uint64_t pressStart_uS){
+      if(gesture == nullptr){return;}
+      _events[_nEvents++] = GestureEvent{.ID = gesture->ID, .phase = phase, .time_uS = time_uS, .pressStart_uS = pressStart_uS};
+    }
+
+    void _finishTaps(GroupState& group, const uint64_t time_uS){
+      _emit(_findGesture(group.tapMask, group.taps), GesturePhases::tap, time_uS, 0);
+      group.taps = 0;
+      group.tapMask = 0;
+    }
+
+    void _updateGroup(GroupState& group, const inputMask_t inputs, const uint64_t time_uS){
+      const inputMask_t pressed = inputs & group.inputs;
+      const uint64_t holdTime_uS = _configs.holdTime_mS * 1000;
+
+      // press started
+      if(pressed != 0 && !group.isPressed){
+        if(group.taps != 0 && time_uS - group.lastRelease_uS > _configs.multiTapWindow_mS * 1000){
+          _finishTaps(group, time_uS);
+        }
+        group.isPressed = true;
+        group.pressStart_uS = time_uS;
+        group.pressMask = pressed;
+        return;
+      }
+
+      // still pressed
+      if(pressed != 0){
+        group.pressMask |= pressed;
+        if(!group.isHeld && time_uS - group.pressStart_uS >= holdTime_uS){
+          const GestureDefinition* hold = _findGesture(group.pressMask, 0);
+          if(hold != nullptr){
+            if(group.taps != 0){_finishTaps(group, time_uS);}
+            _emit(hold, GesturePhases::holdStart, time_uS, group.pressStart_uS);
+            group.isHeld = true;
+          }
+        }
+        return;
+      }
+
+      // released
+      if(group.isPressed){
+        group.isPressed = false;
+        if(group.isHeld){
+          _emit(_findGesture(group.pressMask, 0), GesturePhases::holdEnd, time_uS, group.pressStart_uS);
+          group.isHeld = false;
+          return;
+        }
+        if(time_uS - group.pressStart_uS >= holdTime_uS){
+          const GestureDefinition* hold = _findGesture(group.pressMask, 0);
+          if(hold != nullptr){
+            // the hold started and ended between ticks (i.e. both edges were queued), so it still happened
+            if(group.taps != 0){_finishTaps(group, time_uS);}
+            _emit(hold, GesturePhases::holdStart, time_uS, group.pressStart_uS);
+            _emit(hold, GesturePhases::holdEnd, time_uS, group.pressStart_uS);
+            return;
+          }
+          // too long for a tap, and there isn't a hold for these inputs
+          group.taps = 0;
+          group.tapMask = 0;
+          return;
+        }
+        if(group.taps != 0 && group.tapMask != group.pressMask){
+          // a different chord, so the previous taps are finished
+          _finishTaps(group, time_uS);
+        }
+        group.taps++;
+        group.tapMask = group.pressMask;
+        group.lastRelease_uS = time_uS;
+        if(!_hasMoreTaps(group.tapMask, group.taps)){
+          // nothing to wait for
+          _finishTaps(group, time_uS);
+        }
+        return;
+      }
+
+      // idle, waiting for another tap
+      if(group.taps != 0 && time_uS - group.lastRelease_uS >= _configs.multiTapWindow_mS * 1000){
+        _finishTaps(group, time_uS);
+      }
+    }
+
+  public:
+    /**
+     * @brief Construct a new Gesture Engine
+     *
+     * @param gestures the gesture table. inputs that appear in the same gesture get grouped together
+     * @param configs
+     */
+    GestureEngine(const GestureDefinition (&gestures)[nGestures], GestureConfigs configs = GestureConfigs{}) : _configs(configs){
+      for(uint8_t i = 0; i < nGestures; i++){
+        _gestures[i] = gestures[i];
+      }
+
+      // every input starts in its own group
+      uint8_t root[nInputs];
+      for(uint8_t i = 0; i < nInputs; i++){root[i] = i;}
+      auto findRoot = [&root](uint8_t i){
+        while(root[i] != i){i = root[i];}
+        return i;
+      };
+
+      // merge the inputs of each chord
+      for(const GestureDefinition& gesture : _gestures){
+        int8_t first = -1;
+        for(uint8_t i = 0; i < nInputs; i++){
+          if((gesture.inputs & ((inputMask_t)1 << i)) == 0){continue;}
+          if(first < 0){
+            first = i;
+            continue;
+          }
+          root[findRoot(i)] = findRoot(first);
+        }
+      }
+
+      // turn the roots into group indexes
+      uint8_t rootToGroup[nInputs];
+      for(uint8_t i = 0; i < nInputs; i++){
+        const uint8_t r = findRoot(i);
+        if(r == i){rootToGroup[i] = _nGroups++;}
+      }
+      for(uint8_t i = 0; i < nInputs; i++){
+        _inputToGroup[i] = rootToGroup[findRoot(i)];
+        _groups[_inputToGroup[i]].inputs |= (inputMask_t)1 << i;
+      }
+    }
+
+    /**
+     * @brief process one tick of input
+     *
+     * @param inputs bitmask of the pressed inputs
+     * @param time_uS the time of the tick. should be fetched once per tick
+     * @return uint8_t the number of recognised gestures. get them with getEvent()
+     */
+    uint8_t update(const inputMask_t inputs, const uint64_t time_uS){
+      _nEvents = 0;
+
+      // find the groups that need visiting
+      inputMask_t changed = inputs ^ _previousInputs;
+      _previousInputs = inputs;
+      inputMask_t groupsToVisit = _pendingGroups;
+      while(changed != 0){
+        const uint8_t input = __builtin_ctz(changed);
+        changed &= changed - 1;
+        if(input < nInputs){
+          groupsToVisit |= (inputMask_t)1 << _inputToGroup[input];
+        }
+      }
+
+      while(groupsToVisit != 0){
+        const uint8_t groupIndex = __builtin_ctz(groupsToVisit);
+        groupsToVisit &= groupsToVisit - 1;
+
+        GroupState& group = _groups[groupIndex];
+        _updateGroup(group, inputs, time_uS);
+
+        const inputMask_t groupBit = (inputMask_t)1 << groupIndex;
+        if(group.isPressed || group.taps != 0){
+          _pendingGroups |= groupBit;
+        }
+        else{
+          _pendingGroups &= ~groupBit;
+        }
+      }
+      return _nEvents;
+    }
+
+    const GestureEvent& getEvent(uint8_t index){return _events[index];}
+
+    uint8_t getNumberOfGroups(){return _nGroups;}
+
+    /**
+     * @brief true if nothing is pressed and no taps are waiting, so update() doesn't need calling until an input changes
+     *
+     */
+    bool isIdle(){return _pendingGroups == 0;}
+
+    /**
+     * @brief forget every press and tap in progress, without emitting anything. the group layout is kept
+     *
+     */
+    void reset(){
+      for(uint8_t i = 0; i < _nGroups; i++){
+        const inputMask_t inputs = _groups[i].inputs;
+        _groups[i] = GroupState{};
+        _groups[i].inputs = inputs;
+      }
+      _previousInputs = 0;
+      _pendingGroups = 0;
+      _nEvents = 0;
+    }
+};
+
+#endif
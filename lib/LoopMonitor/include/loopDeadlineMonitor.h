@@ -0,0 +1,195 @@
+/**
+ * notes:
+ *  - times each iteration of a loop against a budget, and feeds the task watchdog at the end of every iteration. the output loop and the control task each get their own monitor and snapshot
+ *  - an iteration that goes over budget gets snapshotted: how long it took, which stage was slowest, the metrics counters, and the newest trace records (if the trace is compiled in)
+ *  - an iteration that never finishes gets caught by the task watchdog, which snapshots the same things from its interrupt before the reset. the current stage is written as the loop goes, so it's known even then
+ *  - on the esp32 the snapshot lives in RTC memory that isn't initialised on boot, so it survives the reset and gets reported by reportPrevious() in setup()
+ */
+
+#ifndef __LOOP_DEADLINE_MONITOR_H__
+#define __LOOP_DEADLINE_MONITOR_H__
+
+#include <Arduino.h>
+
+#include "metrics.h"
+#include "trace.h"
+
+#ifndef OVERRUN_TRACE_RECORDS
+  #define OVERRUN_TRACE_RECORDS 32  // the newest records get copied into the snapshot
+#endif
+
+/**
+ * @brief the parts of the lights output loop and the control task. add new ones before count, and give them a name in loopDeadlineMonitor.cpp
+ */
+enum class LoopStages : uint8_t {
+  idle,         // before the first stage starts
+  button,       // the button interface
+  lights,       // LightsOutputTask::update(), i.e. the control task's commands and ModalLightsController::updateLights()
+  time,         // control task: DeviceTimeClass::flushTimeUpdates()
+  events,       // control task: EventManager::check()
+  proxy,        // control task: ModalLightsProxy::updateLights(), i.e. the output task's reports and the async mode loads
+  config,       // control task: ConfigManagerClass::update(), which can write to flash
+  serial,       // control task: reading the serial commands, which get run by the output task
+  count
+};
+
+/**
+ * @brief what gets kept across a reset. it lives in memory that doesn't get initialised, so it can't have default values; magic says whether it's been set up
+ */
+struct OverrunSnapshotStruct {
+  uint32_t magic;
+  uint32_t overruns;              // since it was last reported
+  uint32_t worstIteration_uS;
+  uint32_t budget_uS;
+  uint32_t slowestStage_uS;       // in the worst iteration
+  uint8_t slowestStage;           // LoopStages
+  uint8_t currentStage;           // LoopStages
+  bool isIterationInProgress;     // true if the reset happened partway through an iteration
+  bool hasWatchdogFired;
+  uint32_t counters[static_cast<uint8_t>(MetricCounters::count)];  // when the snapshot was taken
+  uint16_t nTraceRecords;
+  TraceRecord traceRecords[OVERRUN_TRACE_RECORDS];
+};
+
+/**
+ * @brief the output loop's snapshot that survives a reset
+ *
+ * @return OverrunSnapshotStruct&
+ */
+OverrunSnapshotStruct& getOverrunSnapshot();
+
+/**
+ * @brief the control task's snapshot that survives a reset
+ *
+ * @return OverrunSnapshotStruct&
+ */
+OverrunSnapshotStruct& getControlOverrunSnapshot();
+
+/**
+ * @brief copy the metrics counters and the newest trace records into a snapshot
+ *
+ * @param snapshot
+ */
+void captureOverrunState(OverrunSnapshotStruct& snapshot);
+
+/**
+ * @brief add the current task to the task watchdog, which resets the device if it isn't fed for timeout_S. does nothing in the native environment
+ *
+ * @param timeout_S
+ */
+void loopWatchdogBegin(uint32_t timeout_S);
+
+/**
+ * @brief add the current task to a task watchdog that's already been started by loopWatchdogBegin(). each task feeds itself
+ */
+void loopWatchdogAddTask();
+
+void loopWatchdogFeed();
+
+class LoopDeadlineMonitor {
+  private:
+    static constexpr uint32_t _magic = 0x4C4F4F50;  // "LOOP"
+
+    OverrunSnapshotStruct& _snapshot;
+    const uint32_t _budget_uS;
+
+    uint64_t _iterationStart_uS = 0;
+    uint64_t _stageStart_uS = 0;
+    LoopStages _stage = LoopStages::idle;
+    LoopStages _slowestStage = LoopStages::idle;
+    uint32_t _slowestStage_uS = 0;
+
+    void _endStage(const uint64_t now_uS){
+      const uint32_t stage_uS = now_uS - _stageStart_uS;
+      if(stage_uS >= _slowestStage_uS){
+        _slowestStage_uS = stage_uS;
+        _slowestStage = _stage;
+      }
+      _stageStart_uS = now_uS;
+    }
+
+    void _clearSnapshot(){
+      _snapshot = OverrunSnapshotStruct{};
+      _snapshot.magic = _magic;
+      _snapshot.budget_uS = _budget_uS;
+    }
+
+  public:
+    /**
+     * @brief Construct a new Loop Deadline Monitor. the snapshot is left alone if it's valid, so call reportPrevious() before the first iteration
+     *
+     * @param budget_uS an iteration that takes longer than this is an overrun
+     * @param snapshot where to keep the snapshot. getOverrunSnapshot() for the one that survives a reset
+     */
+    LoopDeadlineMonitor(const uint32_t budget_uS, OverrunSnapshotStruct& snapshot) : _snapshot(snapshot), _budget_uS(budget_uS){
+      if(_snapshot.magic != _magic){_clearSnapshot();}
+    }
+
+    void beginIteration(const uint64_t now_uS){
+      _iterationStart_uS = now_uS;
+      _stageStart_uS = now_uS;
+      _stage = LoopStages::idle;
+      _slowestStage = LoopStages::idle;
+      _slowestStage_uS = 0;
+      _snapshot.currentStage = static_cast<uint8_t>(LoopStages::idle);
+      _snapshot.isIterationInProgress = true;
+    }
+
+    /**
+     * @brief end the current stage and start a new one
+     *
+     * @param stage
+     * @param now_uS
+     */
+    void setStage(const LoopStages stage, const uint64_t now_uS){
+      _endStage(now_uS);
+      _stage = stage;
+      _snapshot.currentStage = static_cast<uint8_t>(stage);
+    }
+
+    /**
+     * @brief end the iteration and feed the watchdog. if it went over budget, and it's the worst one since the last report, the snapshot gets updated
+     *
+     * @param now_uS
+     * @return bool true if the iteration went over budget
+     */
+    bool endIteration(const uint64_t now_uS){
+      _endStage(now_uS);
+      _snapshot.isIterationInProgress = false;
+      loopWatchdogFeed();
+
+      const uint32_t iteration_uS = now_uS - _iterationStart_uS;
+      if(iteration_uS <= _budget_uS){return false;}
+
+      _snapshot.overruns++;
+      if(iteration_uS > _snapshot.worstIteration_uS){
+        _snapshot.worstIteration_uS = iteration_uS;
+        _snapshot.budget_uS = _budget_uS;
+        _snapshot.slowestStage = static_cast<uint8_t>(_slowestStage);
+        _snapshot.slowestStage_uS = _slowestStage_uS;
+        captureOverrunState(_snapshot);
+      }
+      return true;
+    }
+
+    uint32_t getBudget_uS(){return _budget_uS;}
+
+    /**
+     * @brief write out what happened before the reset, then clear it. the format is:
+     *
+     * overrun begin
+     * overruns <number of overruns>
+     * worst <iteration uS> <budget uS> <slowest stage> <slowest stage uS>
+     * interrupted <stage> <"watchdog" if the watchdog fired>   (if the reset happened partway through an iteration)
+     * counter <name> <value>
+     * ...
+     * <trace dump, if the trace is compiled in>
+     * overrun end
+     *
+     * @param writeLine gets called once per line, without a newline
+     * @return bool false if there was nothing to report
+     */
+    bool reportPrevious(void (*writeLine)(const char* line));
+};
+
+#endif
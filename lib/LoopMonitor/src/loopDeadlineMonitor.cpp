@@ -0,0 +1,127 @@
+#include "loopDeadlineMonitor.h"
+
+#include <stdio.h>
+
+#if defined ESP32 || defined ESP32S3
+#include "esp_attr.h"
+#include "esp_task_wdt.h"
+#include "esp_system.h"
+#endif
+
+namespace {
+#if defined ESP32 || defined ESP32S3
+  RTC_NOINIT_ATTR OverrunSnapshotStruct _overrunSnapshot;
+  RTC_NOINIT_ATTR OverrunSnapshotStruct _controlOverrunSnapshot;
+#else
+  OverrunSnapshotStruct _overrunSnapshot;
+  OverrunSnapshotStruct _controlOverrunSnapshot;
+#endif
+
+  const char* _stageNames[] = {
+    "idle",
+    "button",
+    "lights",
+    "time",
+    "events",
+    "proxy",
+    "config",
+    "serial"
+  };
+  static_assert(sizeof(_stageNames) / sizeof(_stageNames[0]) == static_cast<uint8_t>(LoopStages::count), "every stage needs a name");
+
+  const char* _getStageName(const uint8_t stage){
+    return stage < static_cast<uint8_t>(LoopStages::count) ? _stageNames[stage] : "unknown";
+  }
+}
+
+OverrunSnapshotStruct& getOverrunSnapshot(){
+  return _overrunSnapshot;
+}
+
+OverrunSnapshotStruct& getControlOverrunSnapshot(){
+  return _controlOverrunSnapshot;
+}
+
+void captureOverrunState(OverrunSnapshotStruct& snapshot){
+  for(uint8_t c = 0; c < static_cast<uint8_t>(MetricCounters::count); c++){
+    snapshot.counters[c] = getMetrics().getCount(static_cast<MetricCounters>(c));
+  }
+#ifdef esp32_lights_trace
+  snapshot.nTraceRecords = getTraceBuffer().snapshot(snapshot.traceRecords, OVERRUN_TRACE_RECORDS);
+#else
+  snapshot.nTraceRecords = 0;
+#endif
+}
+
+#if defined ESP32 || defined ESP32S3
+void loopWatchdogBegin(uint32_t timeout_S){
+  esp_task_wdt_init(timeout_S, true);   // reconfigures it if it's already running
+  loopWatchdogAddTask();
+}
+
+void loopWatchdogAddTask(){
+  esp_task_wdt_add(NULL);
+}
+
+void loopWatchdogFeed(){
+  esp_task_wdt_reset();
+}
+
+/**
+ * @brief called by the task watchdog's interrupt before it panics. a loop is stuck, so this is the last chance to see what it was doing. only the stuck one will be partway through an iteration, so only that one gets reported as interrupted
+ */
+extern "C" void esp_task_wdt_isr_user_handler(void){
+  OverrunSnapshotStruct* snapshots[] = {&getOverrunSnapshot(), &getControlOverrunSnapshot()};
+  for(OverrunSnapshotStruct* snapshot : snapshots){
+    snapshot->hasWatchdogFired = true;
+    captureOverrunState(*snapshot);
+  }
+}
+#else
+void loopWatchdogBegin(uint32_t timeout_S){}
+
+void loopWatchdogAddTask(){}
+
+void loopWatchdogFeed(){}
+#endif
+
+bool LoopDeadlineMonitor::reportPrevious(void (*writeLine)(const char* line)){
+  const bool wasInterrupted = _snapshot.isIterationInProgress;
+  if(_snapshot.overruns == 0 && !wasInterrupted){
+    return false;
+  }
+
+  char line[64];
+  writeLine("overrun begin");
+#if defined ESP32 || defined ESP32S3
+  snprintf(line, sizeof(line), "reset %d", static_cast<int>(esp_reset_reason()));
+  writeLine(line);
+#endif
+  snprintf(line, sizeof(line), "overruns %lu", static_cast<unsigned long>(_snapshot.overruns));
+  writeLine(line);
+  if(_snapshot.overruns > 0){
+    snprintf(line, sizeof(line), "worst %lu %lu %s %lu",
+      static_cast<unsigned long>(_snapshot.worstIteration_uS),
+      static_cast<unsigned long>(_snapshot.budget_uS),
+      _getStageName(_snapshot.slowestStage),
+      static_cast<unsigned long>(_snapshot.slowestStage_uS)
+    );
+    writeLine(line);
+  }
+  if(wasInterrupted){
+    snprintf(line, sizeof(line), "interrupted %s%s", _getStageName(_snapshot.currentStage), _snapshot.hasWatchdogFired ? " watchdog" : "");
+    writeLine(line);
+  }
+  for(uint8_t c = 0; c < static_cast<uint8_t>(MetricCounters::count); c++){
+    snprintf(line, sizeof(line), "counter %s %lu", getMetricCounterName(static_cast<MetricCounters>(c)), static_cast<unsigned long>(_snapshot.counters[c]));
+    writeLine(line);
+  }
+#ifdef esp32_lights_trace
+  const uint16_t nTraceRecords = _snapshot.nTraceRecords < OVERRUN_TRACE_RECORDS ? _snapshot.nTraceRecords : OVERRUN_TRACE_RECORDS;
+  traceWriteRecords(_snapshot.traceRecords, nTraceRecords, 0, writeLine);
+#endif
+  writeLine("overrun end");
+
+  _clearSnapshot();
+  return true;
+}
@@ -0,0 +1,180 @@
+/**
+ * notes:
+ *  - always compiled in, and the memory is fixed: one uint32_t per counter, and one LatencyHistogram per histogram
+ *  - latencies come from a monotonic microsecond clock (esp_timer on the esp32, steady_clock in the native environment), not DeviceTime, so that time syncs don't end up in the histograms
+ *  - the counters are atomic (relaxed), so they can be counted from any task or core. the histograms aren't, so each histogram should only be written from one task
+ *  - the report is plain text lines, so it can go over Serial now and whatever the network API ends up being later
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief things that get counted. add new ones before count
+ */
+enum class MetricCounters : uint8_t {
+  modeSwitches,     // ModalLightsController changing the current mode or the hidden background layer
+  storageReads,     // calls into the storage HAL
+  storageCacheHits, // reads that were answered without the storage HAL
+  eventTriggers,    // EventManager telling ModalLights to change mode
+  timeSyncs,        // DeviceTime being set from an external source
+  pwmWrites,        // channel values written to the lights
+  lightCommandDrops,// commands from the control task that were lost because the output task's queue was full
+  count
+};
+
+/**
+ * @brief things that get timed. add new ones before count
+ */
+enum class MetricHistograms : uint8_t {
+  mainLoop,         // one iteration of the lights output loop, apart from the delay
+  updateLights,     // ModalLightsController::updateLights()
+  count
+};
+
+/**
+ * @brief counts latencies into power of 2 buckets. bucket 0 is 0 uS, bucket b is [2^(b-1), 2^b) uS, and the last bucket catches everything bigger
+ */
+class LatencyHistogram {
+  public:
+    static constexpr uint8_t nBuckets = 20; // the last bucket starts at 2^18 uS, i.e. about a quarter of a second
+
+  private:
+    uint32_t _buckets[nBuckets] = {};
+    uint32_t _count = 0;
+    uint64_t _total_uS = 0;
+    uint32_t _max_uS = 0;
+
+  public:
+    LatencyHistogram(){};
+
+    static uint8_t getBucket(const uint32_t latency_uS){
+      if(latency_uS == 0){return 0;}
+      const uint8_t bucket = 32 - __builtin_clz(latency_uS);
+      return bucket < nBuckets ? bucket : nBuckets - 1;
+    }
+
+    /**
+     * @brief the smallest latency that goes in a bucket
+     *
+     * @param bucket
+     * @return uint32_t
+     */
+    static uint32_t getBucketFloor_uS(const uint8_t bucket){
+      return bucket == 0 ? 0 : (1UL << (bucket - 1));
+    }
+
+    void record(const uint32_t latency_uS){
+      _buckets[getBucket(latency_uS)]++;
+      _count++;
+      _total_uS += latency_uS;
+      if(latency_uS > _max_uS){_max_uS = latency_uS;}
+    }
+
+    uint32_t getBucketCount(const uint8_t bucket) const {return bucket < nBuckets ? _buckets[bucket] : 0;}
+    uint32_t getCount() const {return _count;}
+    uint32_t getMax_uS() const {return _max_uS;}
+    uint32_t getMean_uS() const {return _count == 0 ? 0 : _total_uS / _count;}
+
+    /**
+     * @brief an upper bound for a percentile, i.e. the top of the bucket that it falls in
+     *
+     * @param percent 0 to 100
+     * @return uint32_t
+     */
+    uint32_t getPercentileCeiling_uS(const uint8_t percent) const {
+      if(_count == 0){return 0;}
+      const uint64_t target = (static_cast<uint64_t>(_count) * percent + 99) / 100;
+      uint64_t seen = 0;
+      for(uint8_t b = 0; b < nBuckets; b++){
+        seen += _buckets[b];
+        if(seen >= target && seen > 0){
+          if(b == 0){return 0;}
+          return b + 1 < nBuckets ? getBucketFloor_uS(b + 1) - 1 : _max_uS;
+        }
+      }
+      return _max_uS;
+    }
+
+    void reset(){*this = LatencyHistogram();}
+};
+
+class MetricsRegistry {
+  private:
+    std::atomic<uint32_t> _counters[static_cast<uint8_t>(MetricCounters::count)] = {};
+    LatencyHistogram _histograms[static_cast<uint8_t>(MetricHistograms::count)];
+
+  public:
+    MetricsRegistry(){};
+
+    void count(const MetricCounters counter, const uint32_t amount = 1){
+      _counters[static_cast<uint8_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint32_t getCount(const MetricCounters counter) const {
+      return _counters[static_cast<uint8_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    void recordLatency(const MetricHistograms histogram, const uint32_t latency_uS){
+      _histograms[static_cast<uint8_t>(histogram)].record(latency_uS);
+    }
+
+    const LatencyHistogram& getHistogram(const MetricHistograms histogram) const {
+      return _histograms[static_cast<uint8_t>(histogram)];
+    }
+
+    void reset(){
+      for(std::atomic<uint32_t>& counter : _counters){counter.store(0, std::memory_order_relaxed);}
+      for(LatencyHistogram& histogram : _histograms){histogram.reset();}
+    }
+
+    /**
+     * @brief write the counters and histograms as text. one line per counter, and one summary line per histogram followed by a line per non-empty bucket
+     *
+     * @param writeLine gets called once per line, without a newline
+     */
+    void report(void (*writeLine)(const char* line)) const;
+};
+
+/**
+ * @brief the global registry
+ *
+ * @return MetricsRegistry&
+ */
+MetricsRegistry& getMetrics();
+
+/**
+ * @brief the name a counter gets in the report
+ *
+ * @param counter
+ * @return const char*
+ */
+const char* getMetricCounterName(MetricCounters counter);
+
+/**
+ * @brief monotonic microseconds for timing things. cheaper than DeviceTime, and doesn't jump when the time gets synced
+ *
+ * @return uint64_t
+ */
+uint64_t metricsClock_uS();
+
+/**
+ * @brief records how long it's in scope for into one of the global histograms
+ */
+class ScopedLatency {
+  private:
+    const MetricHistograms _histogram;
+    const uint64_t _start_uS;
+
+  public:
+    ScopedLatency(const MetricHistograms histogram) : _histogram(histogram), _start_uS(metricsClock_uS()){}
+
+    ~ScopedLatency(){
+      getMetrics().recordLatency(_histogram, metricsClock_uS() - _start_uS);
+    }
+};
+
+#endif
@@ -0,0 +1,79 @@
+// chrono needs to be included before ProjectDefines gets anywhere near it, because of the max macro
+#include <chrono>
+
+#include "metrics.h"
+
+#include <stdio.h>
+
+#if defined ESP32 || defined ESP32S3
+#include "esp_timer.h"
+#endif
+
+namespace {
+  MetricsRegistry _metrics;
+
+  const char* _counterNames[] = {
+    "modeSwitches",
+    "storageReads",
+    "storageCacheHits",
+    "eventTriggers",
+    "timeSyncs",
+    "pwmWrites",
+    "lightCommandDrops"
+  };
+  static_assert(sizeof(_counterNames) / sizeof(_counterNames[0]) == static_cast<uint8_t>(MetricCounters::count), "every counter needs a name");
+
+  const char* _histogramNames[] = {
+    "mainLoop",
+    "updateLights"
+  };
+  static_assert(sizeof(_histogramNames) / sizeof(_histogramNames[0]) == static_cast<uint8_t>(MetricHistograms::count), "every histogram needs a name");
+}
+
+MetricsRegistry& getMetrics(){
+  return _metrics;
+}
+
+const char* getMetricCounterName(MetricCounters counter){
+  return _counterNames[static_cast<uint8_t>(counter)];
+}
+
+uint64_t metricsClock_uS(){
+  #if defined ESP32 || defined ESP32S3
+    return esp_timer_get_time();
+  #else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+  #endif
+}
+
+void MetricsRegistry::report(void (*writeLine)(const char* line)) const {
+  char line[64];
+  writeLine("metrics begin");
+  for(uint8_t c = 0; c < static_cast<uint8_t>(MetricCounters::count); c++){
+    snprintf(line, sizeof(line), "counter %s %lu", _counterNames[c], static_cast<unsigned long>(_counters[c].load(std::memory_order_relaxed)));
+    writeLine(line);
+  }
+  for(uint8_t h = 0; h < static_cast<uint8_t>(MetricHistograms::count); h++){
+    const LatencyHistogram& histogram = _histograms[h];
+    // histogram <name> <count> <mean uS> <p99 ceiling uS> <max uS>
+    snprintf(line, sizeof(line), "histogram %s %lu %lu %lu %lu",
+      _histogramNames[h],
+      static_cast<unsigned long>(histogram.getCount()),
+      static_cast<unsigned long>(histogram.getMean_uS()),
+      static_cast<unsigned long>(histogram.getPercentileCeiling_uS(99)),
+      static_cast<unsigned long>(histogram.getMax_uS())
+    );
+    writeLine(line);
+    for(uint8_t b = 0; b < LatencyHistogram::nBuckets; b++){
+      if(histogram.getBucketCount(b) == 0){continue;}
+      // bucket <lowest uS in the bucket> <count>
+      snprintf(line, sizeof(line), "bucket %lu %lu",
+        static_cast<unsigned long>(LatencyHistogram::getBucketFloor_uS(b)),
+        static_cast<unsigned long>(histogram.getBucketCount(b))
+      );
+      writeLine(line);
+    }
+  }
+  writeLine("metrics end");
+}
@@ -6,8 +6,18 @@
 
 #include "../DeviceTime/include/DeviceTime.h"
 #include "modes.h"
+#include "sunriseMode.h"
+#include "sunsetMode.h"
+#include "pulseMode.h"
+#include "changingMode.h"
+#include "crossfade.h"
+#include "layerCompositor.h"
+#include "trace.h"
+#include "metrics.h"
+#include "profiler.h"
 #include "ProjectDefines.h"
 #include "DataStorageClass.h"
+#include "AsyncDataStorage.h"
 
 class VirtualLightsClass{
   public:
@@ -60,6 +70,23 @@ class ModalLightsInterface{
     virtual duty_t adjustBrightness(duty_t amount, bool increasing) = 0;
     // virtual duty_t adjustBrightness(duty_t adjustment, bool increasing, InteractionSources source) = 0;  // post MVP
 
+    /**
+     * @brief start ramping the brightness towards max (or off) at a steady rate. the ramp is just an interpolation, so nothing needs calling while it runs except updateLights()
+     * 
+     * @param increasing 
+     * @param rampWindow_mS how long it would take to ramp across the whole brightness range
+     * @param startTimeUTC_uS the time the ramp should start from. can be in the past, i.e. when a long press began
+     */
+    virtual void startBrightnessRamp(bool increasing, uint16_t rampWindow_mS, uint64_t startTimeUTC_uS) = 0;
+
+    /**
+     * @brief stop the ramp, and keep the brightness it had at stopTimeUTC_uS. does nothing if there isn't a ramp
+     * 
+     * @param stopTimeUTC_uS the time the ramp should stop at. can be in the past, i.e. when a long press was released
+     * @return duty_t the new brightness level
+     */
+    virtual duty_t stopBrightnessRamp(uint64_t stopTimeUTC_uS) = 0;
+
     // ##### non-virtual methods #####
 
     /**
@@ -110,11 +137,23 @@ private:
 
   std::unique_ptr<VirtualLightsClass> _lights;
   std::shared_ptr<DeviceTimeClass> _deviceTime;
+  int64_t _appliedUTCChanges_uS = 0;  // the modes' clock only jumps when a time update gets applied, which can be a while after DeviceTime changes (see lightsOutputTask.h)
   std::shared_ptr<DataStorageClass> _dataStorage;
   std::shared_ptr<ConfigManagerClass> _configsClass;
   ModalConfigsStruct _configs;
   
-  std::shared_ptr<ModeInterpolationClass<nChannels>> _interpClass = std::make_shared<ModeInterpolationClass<nChannels>>();
+  ModeInterpolationClass<nChannels> _initialInterp;  // the first mode starts from this. after that, each mode carries on from the previous mode's interpolation
+
+  // crossfading out of the previous mode
+  std::unique_ptr<ModalStrategyInterface> _outgoingMode;
+  LightStateStruct _outgoingVals;
+  Crossfade _crossfade;
+  bool _isFadingFromBackground = false;   // the background layer is the outgoing side of the crossfade
+
+  // the background mode keeps running underneath the active mode, so that cancelling the active mode doesn't have to rebuild it
+  std::unique_ptr<ModalStrategyInterface> _backgroundLayer;
+  LightStateStruct _backgroundVals;
+  LayerBlendRules _blendRule = LayerBlendRules::replace;
 
   // TODO: remove mode IDs; they duplicate from the data packets
   modeUUID _activeMode = 0;
@@ -128,20 +167,99 @@ private:
   modeUUID _nextActiveMode = 0;
   uint64_t _nextActiveTriggerTimeUTC_uS = 0;
   
-  modeUUID _nextBackgroundMode = 1; // default mode incase event manager doesn't request any modes
+  modeUUID _nextBackgroundMode = defaultModeID; // default mode incase event manager doesn't request any modes
   uint64_t _nextBackgroundTriggerTimeUTC_uS = 0;
+
+  // mode data that was read from storage by another task (see setModeData()). used instead of reading storage if the ID matches the next mode
+  ModeDataStruct _nextActiveModeData = ModeDataStruct{};
+  ModeDataStruct _nextBackgroundModeData = ModeDataStruct{};
+
+  // with async storage, modes that need reading get requested and the current mode keeps running until they arrive. 0 if nothing is being waited on
+  std::shared_ptr<AsyncDataStorage> _asyncStorage;
+  modeUUID _requestedActiveMode = 0;
+  uint64_t _requestedActiveTriggerTimeUTC_uS = 0;
+  modeUUID _requestedBackgroundMode = 0;
+  uint64_t _requestedBackgroundTriggerTimeUTC_uS = 0;
   
   bool _isSetupComplete = false;
+  bool _isRamping = false;  // true between startBrightnessRamp() and stopBrightnessRamp(). anything else that sets the brightness ends the ramp
+  bool _isIdle = false;     // true when the mode has finished interpolating, so updateLights() has nothing to do. anything that touches the mode clears it
+
+  /**
+   * @brief the time that the modes run on. it's DeviceTime's UTC time, without the changes that haven't been applied yet
+   * 
+   * @return uint64_t 
+   */
+  uint64_t _getUTCTimestampMicros(){
+    return _deviceTime->getUTCTimestampMicros(_appliedUTCChanges_uS);
+  }
+
+  /**
+   * @brief convert a local trigger time to the modes' clock. trigger times come from DeviceTime's local time, which already has the changes that haven't been applied yet
+   * 
+   * @param localTimestamp_uS 
+   * @return uint64_t 
+   */
+  uint64_t _convertLocalToUTCMicros(uint64_t localTimestamp_uS){
+    const int64_t unappliedChanges_uS = _deviceTime->getUTCChanges_uS() - _appliedUTCChanges_uS;
+    return _deviceTime->convertLocalToUTCMicros(localTimestamp_uS) - unappliedChanges_uS;
+  }
+
+  /**
+   * @brief make a new mode strategy from a data packet
+   * 
+   * @param currentTimeUTC_uS 
+   * @param triggerTimeUTC_uS 
+   * @param dataPacket 
+   * @param previousInterp the mode copies it, and carries on from it
+   * @param lightVals the mode starts from these values
+   * @param isActive 
+   * @return std::unique_ptr<ModalStrategyInterface> empty if the mode type isn't recognised
+   */
+  std::unique_ptr<ModalStrategyInterface> _makeMode(
+    uint64_t currentTimeUTC_uS,
+    uint64_t triggerTimeUTC_uS,
+    ModeDataStruct* dataPacket,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& lightVals,
+    bool isActive
+  ){
+    switch(dataPacket->type){
+      case ModeTypes::constantBrightness:
+        return std::make_unique<ConstantBrightnessMode>(
+          currentTimeUTC_uS, triggerTimeUTC_uS, dataPacket, previousInterp, lightVals, isActive, _configs
+        );
+      case ModeTypes::sunrise:
+        return std::make_unique<SunriseMode>(
+          currentTimeUTC_uS, triggerTimeUTC_uS, dataPacket, previousInterp, lightVals, isActive, _configs
+        );
+      case ModeTypes::sunset:
+        return std::make_unique<SunsetMode>(
+          currentTimeUTC_uS, triggerTimeUTC_uS, dataPacket, previousInterp, lightVals, isActive, _configs
+        );
+      case ModeTypes::pulse:
+      case ModeTypes::chirp:
+        return std::make_unique<PulseMode>(
+          currentTimeUTC_uS, triggerTimeUTC_uS, dataPacket, previousInterp, lightVals, isActive, _configs
+        );
+      case ModeTypes::changing:
+        return std::make_unique<ChangingMode>(
+          currentTimeUTC_uS, triggerTimeUTC_uS, dataPacket, previousInterp, lightVals, isActive, _configs
+        );
+      default:
+        return nullptr;
+    }
+  }
 
   /**
    * @brief change the current mode. _activeMode and _backgroundMode values must already be set, and the data already loaded from storage. if _activeMode is unset, it'll load initialise _backgroundMode
    * 
+   * @return false if the mode type isn't recognised. the current mode and layers are left as they were
    */
-  void _changeMode(){
+  bool _changeMode(){
     ModeDataStruct* dataPacket;
     bool isActive;
     uint64_t* triggerTimeUTC_uS;
-    modeUUID* modeID;
 
     // set the pointers to the values
     {
@@ -159,41 +277,186 @@ private:
         triggerTimeUTC_uS = &_backgroundModeTriggerTimeUTC_uS;
       }
     }
+    TRACE_SPAN_ARG(modeChange, dataPacket->ID);
+    PROFILE_SCOPE(modeChange);
 
-    // ModeTypes modeType = static_cast<ModeTypes>(dataPacket[1]);
-    ModeTypes modeType = dataPacket->type;
-    uint64_t currentTimeUTC_uS = _deviceTime->getUTCTimestampMicros();
-    // NOTE: these might be useful when interpolation class is disassembled
-    // duty_t previousValues[nChannels+1];
-    // _mode->getTargetVals(previousValues, currentTimeUTC_uS, _lightVals);
+    uint64_t currentTimeUTC_uS = _getUTCTimestampMicros();
 
-    // initialise the new mode
-    switch(modeType){
-      case ModeTypes::constantBrightness:
-        _mode = std::make_unique<ConstantBrightnessMode>(
-          currentTimeUTC_uS,
-          *triggerTimeUTC_uS,
-          dataPacket,
-          _interpClass,
-          _lightVals,
-          isActive,
-          _configs
-        );
-        break;
-      default:
-        break;
+    if(!isActive && _backgroundLayer && !_backgroundLayer->startsFromCurrentVals()){
+      getMetrics().count(MetricCounters::modeSwitches);
+      _endCrossfade();
+      _isRamping = false;
+      _isIdle = false;
+      _revealBackground(currentTimeUTC_uS);
+      return true;
+    }
+
+    // build the new mode before anything gets moved out of the way, so that a bad data packet doesn't leave a hole.
+    // the previous mode stays alive until the new one has copied its interpolation
+    const LightStateStruct previousVals = _lightVals;
+    std::unique_ptr<ModalStrategyInterface> newMode = _makeMode(
+      currentTimeUTC_uS,
+      *triggerTimeUTC_uS,
+      dataPacket,
+      _mode ? _mode->getInterpolation() : _initialInterp,
+      _lightVals,
+      isActive
+    );
+    if(!newMode){
+      _lightVals = previousVals;
+      return false;
+    }
+
+    getMetrics().count(MetricCounters::modeSwitches);
+    _endCrossfade();
+    _isRamping = false;
+    _isIdle = false;
+
+    if(isActive && _mode && !_backgroundLayer){
+      // the background goes underneath and keeps running
+      _backgroundLayer = std::move(_mode);
+      _backgroundVals = previousVals;
+      _isFadingFromBackground = previousVals.state;
+    }
+    else{
+      // modes that start from the current values get rebuilt, so that they carry on from wherever the active mode was
+      if(!isActive){_backgroundLayer.reset();}
+
+      // keep the old mode running until the crossfade has finished
+      if(_mode && previousVals.state){
+        _outgoingMode = std::move(_mode);
+        _outgoingVals = previousVals;
+      }
+    }
+    _mode = std::move(newMode);
+
+    if(_outgoingMode || _isFadingFromBackground){
+      if(_mode->startsFromCurrentVals()){
+        _endCrossfade();
+      }
+      else{
+        _crossfade.start(currentTimeUTC_uS, _configs.softChangeWindow*secondsToMicros);
+      }
     }
 
     if(!_isSetupComplete){
       _isSetupComplete = true;
       _mode->setState(true, _lightVals, currentTimeUTC_uS);
     }
+    return true;
+  }
+
+  /**
+   * @brief bring the background layer back to the top, and crossfade out of the active mode. the background has been running the whole time, so there's nothing to rebuild
+   * 
+   * @param currentTimeUTC_uS 
+   */
+  void _revealBackground(uint64_t currentTimeUTC_uS){
+    if(_lightVals.state){
+      _outgoingMode = std::move(_mode);
+      _outgoingVals = _lightVals;
+    }
+    _mode = std::move(_backgroundLayer);
+    _lightVals = _backgroundVals;
+    _mode->updateLightVals(currentTimeUTC_uS, _lightVals);
+    if(_outgoingMode){
+      _crossfade.start(currentTimeUTC_uS, _configs.softChangeWindow*secondsToMicros);
+    }
+  }
+
+  /**
+   * @brief replace the background layer underneath the active mode. it's hidden, so there's no crossfade
+   * 
+   * @return false if the mode type isn't recognised. the layer is left as it was
+   */
+  bool _changeBackgroundLayer(){
+    const LightStateStruct previousVals = _backgroundVals;
+    std::unique_ptr<ModalStrategyInterface> newLayer = _makeMode(
+      _getUTCTimestampMicros(),
+      _backgroundModeTriggerTimeUTC_uS,
+      &_backgroundModeData,
+      _backgroundLayer ? _backgroundLayer->getInterpolation() : _initialInterp,
+      _backgroundVals,
+      false
+    );
+    if(!newLayer){
+      _backgroundVals = previousVals;
+      return false;
+    }
+    getMetrics().count(MetricCounters::modeSwitches);
+    _isIdle = false;
+    _isFadingFromBackground = false;
+    _backgroundLayer = std::move(newLayer);
+    return true;
+  }
+
+  /**
+   * @brief drop the outgoing mode, and give its interpolation class back
+   * 
+   */
+  void _endCrossfade(){
+    _crossfade.stop();
+    _outgoingMode.reset();
+    _isFadingFromBackground = false;
+  }
+
+  /**
+   * @brief write the current light values. they get composed with the background layer if the blend rule needs it, then mixed with the outgoing mode if there's a crossfade
+   * 
+   * @param utcTime_uS 
+   */
+  void _writeLights(uint64_t utcTime_uS){
+    PROFILE_SCOPE(writeLights);
+    duty_t* vals = _lightVals.getLightValues();
+    uint16_t weight = Crossfade::fullWeight;
+    if(_outgoingMode || _isFadingFromBackground){
+      weight = _crossfade.getWeight(utcTime_uS);
+      if(weight >= Crossfade::fullWeight){_endCrossfade();}
+    }
+
+    const bool isBackgroundVisible = _backgroundLayer && (LayerCompositor::needsBackground(_blendRule) || _isFadingFromBackground);
+    if(isBackgroundVisible){
+      _backgroundLayer->updateLightVals(utcTime_uS, _backgroundVals);
+    }
+
+    duty_t composedVals[nChannels];
+    if(isBackgroundVisible && LayerCompositor::needsBackground(_blendRule)){
+      LayerCompositor::compose(composedVals, _backgroundVals.getLightValues(), vals, _blendRule, nChannels);
+      vals = composedVals;
+    }
+
+    if(weight < Crossfade::fullWeight){
+      duty_t* outgoing;
+      if(_isFadingFromBackground){
+        outgoing = _backgroundVals.getLightValues();
+      }
+      else{
+        _outgoingMode->updateLightVals(utcTime_uS, _outgoingVals);
+        outgoing = _outgoingVals.getLightValues();
+      }
+      Crossfade::mix(composedVals, outgoing, vals, weight, nChannels);
+      vals = composedVals;
+    }
+    _lights->setChannelValues(vals);
+    getMetrics().count(MetricCounters::pwmWrites);
+  }
+
+  /**
+   * @brief true if nothing underneath or fading out of the current mode needs updating
+   * 
+   * @return bool 
+   */
+  bool _areLayersIdle(){
+    if(_outgoingMode || _isFadingFromBackground){return false;}
+    if(!_backgroundLayer || !LayerCompositor::needsBackground(_blendRule)){return true;}
+    return _backgroundLayer->isIdle();
   }
 
   bool _loadNextActiveMode(){
     if(_nextActiveMode == 0){
       return false;
     }
+    const ModeDataStruct previousModeData = _activeModeData;
 
     // set the mode data packet
     bool success;
@@ -205,8 +468,18 @@ private:
     }
     else if(_nextActiveMode == _backgroundMode){
       _activeModeData = _backgroundModeData;
+      getMetrics().count(MetricCounters::storageCacheHits);
+      success = true;
+    }
+    else if(_nextActiveMode == _nextActiveModeData.ID){
+      _activeModeData = _nextActiveModeData;
       success = true;
     }
+    else if(_asyncStorage && _nextActiveMode != defaultModeID){
+      // the current mode carries on until the data arrives. if the request queue is full, try again next time
+      if(!_requestMode(_nextActiveMode, _nextActiveTriggerTimeUTC_uS, true)){return false;}
+      success = false;
+    }
     else{
       // TODO: dataStorage should fill a ModeDataStruct instead of an array
       uint8_t dataArray[modePacketSize];
@@ -218,14 +491,23 @@ private:
 
     // switch mode if mode data packet was set
     if(success){
+      const modeUUID previousMode = _activeMode;
+      const uint64_t previousTriggerTimeUTC_uS = _activeModeTriggerTimeUTC_uS;
       _activeMode = _nextActiveMode;
       _activeModeTriggerTimeUTC_uS = _nextActiveTriggerTimeUTC_uS;
-      _changeMode();
+      success = _changeMode();
+      if(!success){
+        // bad mode data. the current mode carries on
+        _activeMode = previousMode;
+        _activeModeTriggerTimeUTC_uS = previousTriggerTimeUTC_uS;
+        _activeModeData = previousModeData;
+      }
     }
 
     // reset _next_X_Mode variables
     _nextActiveMode = 0;
     _nextActiveTriggerTimeUTC_uS = 0;
+    _nextActiveModeData.ID = 0;
     return success;
   }
 
@@ -233,6 +515,7 @@ private:
     if(_nextBackgroundMode == 0){
       return false;
     }
+    const ModeDataStruct previousModeData = _backgroundModeData;
 
     // set the mode data packet
     bool success;
@@ -241,8 +524,27 @@ private:
     }
     else if(_nextBackgroundMode == _activeMode){
       _backgroundModeData = _activeModeData;
+      getMetrics().count(MetricCounters::storageCacheHits);
       success = true;
     }
+    else if(_nextBackgroundMode == _nextBackgroundModeData.ID){
+      _backgroundModeData = _nextBackgroundModeData;
+      success = true;
+    }
+    else if(_asyncStorage && _nextBackgroundMode != defaultModeID){
+      success = false;
+      const bool isRequested = _requestMode(_nextBackgroundMode, _nextBackgroundTriggerTimeUTC_uS, false);
+      if(!isRequested && _backgroundMode != 0){return false;}
+      if(_backgroundMode == 0){
+        // nothing is running yet, so the default mode fills in until the data arrives. it isn't in storage, so it doesn't need waiting for
+        uint8_t dataArray[modePacketSize];
+        success = _dataStorage->getMode(defaultModeID, dataArray);
+        if(success){
+          deserializeModeData(dataArray, &_backgroundModeData);
+          _nextBackgroundMode = defaultModeID;
+        }
+      }
+    }
     else{
       // TODO: dataStorage should fill a ModeDataStruct instead of an array
       uint8_t dataArray[modePacketSize];
@@ -254,19 +556,84 @@ private:
 
     // switch mode if mode data packet was set
     if(success){
+      const modeUUID previousMode = _backgroundMode;
+      const uint64_t previousTriggerTimeUTC_uS = _backgroundModeTriggerTimeUTC_uS;
       _backgroundMode = _nextBackgroundMode;
       _backgroundModeTriggerTimeUTC_uS = _nextBackgroundTriggerTimeUTC_uS;
-      if(_activeMode == 0){
-        _changeMode();
+      success = _activeMode == 0 ? _changeMode() : _changeBackgroundLayer();
+      if(!success){
+        // bad mode data. the current mode carries on
+        _backgroundMode = previousMode;
+        _backgroundModeTriggerTimeUTC_uS = previousTriggerTimeUTC_uS;
+        _backgroundModeData = previousModeData;
+        if(!_mode && _nextBackgroundMode != defaultModeID){
+          // nothing is running, so the default mode fills in
+          _nextBackgroundMode = defaultModeID;
+          _nextBackgroundModeData.ID = 0;
+          return _loadNextBackgroundMode();
+        }
       }
     }
 
     // reset _next_X_Mode variables
     _nextBackgroundMode = 0;
     _nextBackgroundTriggerTimeUTC_uS = 0;
+    _nextBackgroundModeData.ID = 0;
     return success;
   }
 
+  /**
+   * @brief ask the async storage for a mode. only the most recent request for each layer gets used when it arrives
+   * 
+   * @param modeID 
+   * @param triggerTimeUTC_uS 
+   * @param isActive 
+   * @return false if the request queue is full
+   */
+  bool _requestMode(modeUUID modeID, uint64_t triggerTimeUTC_uS, bool isActive){
+    if(isActive){
+      if(modeID == _requestedActiveMode && triggerTimeUTC_uS == _requestedActiveTriggerTimeUTC_uS){return true;}
+      _requestedActiveMode = modeID;
+      _requestedActiveTriggerTimeUTC_uS = triggerTimeUTC_uS;
+    }
+    else{
+      if(modeID == _requestedBackgroundMode && triggerTimeUTC_uS == _requestedBackgroundTriggerTimeUTC_uS){return true;}
+      _requestedBackgroundMode = modeID;
+      _requestedBackgroundTriggerTimeUTC_uS = triggerTimeUTC_uS;
+    }
+    if(!_asyncStorage->requestMode(modeID, _onModeLoaded, this, isActive)){
+      if(isActive){_requestedActiveMode = 0;}
+      else{_requestedBackgroundMode = 0;}
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief async storage callback. if the mode is still wanted, it's queued up as the next mode with its data preloaded, so the next _loadMode() doesn't touch storage
+   * 
+   * @param result 
+   * @param context the controller
+   */
+  static void _onModeLoaded(const StorageResultStruct& result, void* context){
+    ModalLightsController* controller = static_cast<ModalLightsController*>(context);
+    const bool isActive = result.tag;
+    modeUUID& requested = isActive ? controller->_requestedActiveMode : controller->_requestedBackgroundMode;
+    if(result.ID != requested){return;}   // something else has been asked for since
+    requested = 0;
+    if(!result.success){return;}
+    if(isActive){
+      controller->_nextActiveModeData = result.modeData;
+      controller->_nextActiveMode = result.ID;
+      controller->_nextActiveTriggerTimeUTC_uS = controller->_requestedActiveTriggerTimeUTC_uS;
+    }
+    else{
+      controller->_nextBackgroundModeData = result.modeData;
+      controller->_nextBackgroundMode = result.ID;
+      controller->_nextBackgroundTriggerTimeUTC_uS = controller->_requestedBackgroundTriggerTimeUTC_uS;
+    }
+  }
+
   /**
    * @brief loads _nextMode from storage, and calls _changeMode if applicable. sets current values to _nextMode if _nextMode is valid, resets _next values if not. if _nextMode is background but current mode is active, it'll load the data from storage but not force a change. _nextMode values must already be set.
    * 
@@ -291,15 +658,16 @@ public:
     std::shared_ptr<DataStorageClass> dataStorage,
     std::shared_ptr<ConfigManagerClass> configs
   ) : _lights(std::move(lightsClass)), _deviceTime(deviceTime), _dataStorage(dataStorage), _configsClass(configs), _configs(configs->getModalConfigs()) {
-    _nextBackgroundTriggerTimeUTC_uS = _deviceTime->getUTCTimestampMicros();  // incase EventManager doesn't set any modes before update is called
+    _appliedUTCChanges_uS = _deviceTime->getUTCChanges_uS();
+    _nextBackgroundTriggerTimeUTC_uS = _getUTCTimestampMicros();  // incase EventManager doesn't set any modes before update is called
 
-    _nextBackgroundMode = 1;
+    _nextBackgroundMode = defaultModeID;
 
-    _interpClass->setTargetBrightness(_configs.minOnBrightness);
+    _initialInterp.setTargetBrightness(_configs.minOnBrightness);
     _lightVals.state = true;
 
-    // register adjustment callback with deviceTime
-    _deviceTime->add_observer(*this);
+    // register adjustment callback with deviceTime. interpolations only care about UTC changes
+    _deviceTime->add_observer(*this, TimeObserverFilter{.changes = TimeUpdateFlags::utc});
   }
 
   /**
@@ -316,27 +684,80 @@ public:
     }
     if(isActive){
       _nextActiveMode = modeID;
-      _nextActiveTriggerTimeUTC_uS = _deviceTime->convertLocalToUTCMicros(triggerTimeLocal_S * secondsToMicros);
+      _nextActiveTriggerTimeUTC_uS = _convertLocalToUTCMicros(triggerTimeLocal_S * secondsToMicros);
+      _requestedActiveMode = 0;
       return;
     }
+    _requestedBackgroundMode = 0;
     if(modeID != _backgroundMode){
       _nextBackgroundMode = modeID;
-      _nextBackgroundTriggerTimeUTC_uS = _deviceTime->convertLocalToUTCMicros(triggerTimeLocal_S * secondsToMicros);
+      _nextBackgroundTriggerTimeUTC_uS = _convertLocalToUTCMicros(triggerTimeLocal_S * secondsToMicros);
     }
   };
 
+  /**
+   * @brief the same as setModeByUUID(), but the mode data has already been read from storage, so loading it won't touch storage. for when storage belongs to another task (see lightsTaskChannel.h)
+   * 
+   * @param modeData 
+   * @param triggerTimeLocal_S 
+   * @param isActive 
+   */
+  void setModeData(const ModeDataStruct& modeData, uint64_t triggerTimeLocal_S, bool isActive){
+    if(modeData.ID == 0){return;}
+    const uint64_t triggerTimeUTC_uS = _convertLocalToUTCMicros(triggerTimeLocal_S * secondsToMicros);
+    if(isActive){
+      _nextActiveModeData = modeData;
+      _nextActiveMode = modeData.ID;
+      _nextActiveTriggerTimeUTC_uS = triggerTimeUTC_uS;
+      _requestedActiveMode = 0;
+      return;
+    }
+    _requestedBackgroundMode = 0;
+    if(modeData.ID != _backgroundMode){
+      _nextBackgroundModeData = modeData;
+      _nextBackgroundMode = modeData.ID;
+      _nextBackgroundTriggerTimeUTC_uS = triggerTimeUTC_uS;
+    }
+  }
+
+  /**
+   * @brief read modes through async storage instead of reading them in updateLights(). a mode that isn't already loaded gets requested, and the current mode (or the default mode, if nothing is running yet) keeps going until it arrives
+   * 
+   * @param asyncStorage must read from the same storage as the constructor's dataStorage
+   */
+  void useAsyncStorage(std::shared_ptr<AsyncDataStorage> asyncStorage){
+    _asyncStorage = asyncStorage;
+  }
+
+  /**
+   * @brief true if a mode has been requested from async storage and hasn't arrived yet
+   * 
+   * @return bool 
+   */
+  bool isModeLoadPending(){
+    return _requestedActiveMode != 0 || _requestedBackgroundMode != 0;
+  }
+
   /**
    * @brief updates the lights. if a new mode is pending, it'll load the new mode
    * 
    */
   void updateLights() override {
+    TRACE_SPAN(updateLights);
+    ScopedLatency latency(MetricHistograms::updateLights);
+    PROFILE_SCOPE(updateLights);
+    if(_asyncStorage){_asyncStorage->dispatchCompletions();}
     // check if a new mode is pending
     if(_nextActiveMode != 0 || _nextBackgroundMode != 0){_loadMode();}
     
+    // nothing is changing, so there's nothing to update
+    if(_isIdle){return;}
+
     // update
-    uint64_t utcTime_uS = _deviceTime->getUTCTimestampMicros();
+    uint64_t utcTime_uS = _getUTCTimestampMicros();
     _mode->updateLightVals(utcTime_uS, _lightVals);
-    _lights->setChannelValues(_lightVals.getLightValues());
+    _writeLights(utcTime_uS);
+    _isIdle = _mode->isIdle() && _areLayersIdle();
   };
   
   /**
@@ -347,8 +768,11 @@ public:
    */
   duty_t setBrightnessLevel(duty_t brightness) override {
     if(_nextActiveMode != 0 || _nextBackgroundMode != 0){_loadMode();}
-    _mode->setBrightness(_deviceTime->getUTCTimestampMicros(), _lightVals, brightness, true);
-    _lights->setChannelValues(_lightVals.getLightValues());
+    _isRamping = false;
+    _isIdle = false;
+    _mode->setBrightness(_getUTCTimestampMicros(), _lightVals, brightness, true);
+    _endCrossfade();
+    _writeLights(_getUTCTimestampMicros());
     return getSetBrightness();
   };
   
@@ -357,10 +781,13 @@ public:
       updateLights();
       return true;
     }
-    if(_mode->setState(_deviceTime->getUTCTimestampMicros(), _lightVals, newState)){
+    _isRamping = false;
+    _isIdle = false;
+    if(_mode->setState(_getUTCTimestampMicros(), _lightVals, newState)){
       cancelActiveMode();
     };
-    _lights->setChannelValues(_lightVals.getLightValues());
+    _endCrossfade();
+    _writeLights(_getUTCTimestampMicros());
     return _lightVals.state;
   }
 
@@ -373,6 +800,8 @@ public:
   duty_t adjustBrightness(duty_t amount, bool increasing) override {
     // return early if lights are off and amount is decreasing
     if(_nextActiveMode != 0 || _nextBackgroundMode != 0){_loadMode();}
+    _isRamping = false;
+    _isIdle = false;
     if(
       amount == 0
       || (!_lightVals.state && !increasing)
@@ -395,8 +824,30 @@ public:
                       : oldBrightness - amount;
     }
     // TODO: can the if statements be cleaned up by moving some logic into updateLights()?
-    _mode->setBrightness(_deviceTime->getUTCTimestampMicros(), _lightVals, newBrightness, false);
-    _lights->setChannelValues(_lightVals.getLightValues());
+    _mode->setBrightness(_getUTCTimestampMicros(), _lightVals, newBrightness, false);
+    _endCrossfade();
+    _writeLights(_getUTCTimestampMicros());
+    return getBrightnessLevel();
+  }
+
+  void startBrightnessRamp(bool increasing, uint16_t rampWindow_mS, uint64_t startTimeUTC_uS) override {
+    if(_nextActiveMode != 0 || _nextBackgroundMode != 0){_loadMode();}
+    _isIdle = false;
+    _mode->startBrightnessRamp(startTimeUTC_uS, _lightVals, increasing, rampWindow_mS*1000);
+    _isRamping = true;
+    _mode->updateLightVals(_getUTCTimestampMicros(), _lightVals);
+    _endCrossfade();
+    _writeLights(_getUTCTimestampMicros());
+  }
+
+  duty_t stopBrightnessRamp(uint64_t stopTimeUTC_uS) override {
+    if(!_isRamping){return getBrightnessLevel();}
+    _isRamping = false;
+    _isIdle = false;
+    _mode->stopBrightnessRamp(stopTimeUTC_uS, _lightVals);
+    _mode->updateLightVals(_getUTCTimestampMicros(), _lightVals);
+    _endCrossfade();
+    _writeLights(_getUTCTimestampMicros());
     return getBrightnessLevel();
   }
 
@@ -407,13 +858,13 @@ public:
    */
   duty_t getSetBrightness() override {
     duty_t minB = _configs.minOnBrightness;
-    // duty_t currentB = _mode->getTargetBrightness();
-    duty_t currentB = _interpClass->getTargetBrightness();
+    duty_t currentB = _mode ? _mode->getTargetBrightness() : _initialInterp.getTargetBrightness();
     duty_t setB = currentB >= minB ? currentB : 0;
     return setB;
   };
 
   bool cancelActiveMode() override {
+    _requestedActiveMode = 0;
     if(_activeMode == 0){return false;}
     _activeMode = 0;
     _activeModeTriggerTimeUTC_uS = 0;
@@ -422,6 +873,13 @@ public:
     return true;
   };
 
+  /**
+   * @brief true if the last updateLights() found nothing left to interpolate. updateLights() won't do anything until something changes the lights
+   * 
+   * @return bool 
+   */
+  bool isIdle(){return _isIdle;}
+
   /**
    * @brief Get the current mode IDs
    * 
@@ -444,9 +902,11 @@ public:
    */
   bool changeSoftChangeWindow(uint8_t newWindow_S){
     if(newWindow_S >= (1 << 4)){return false;}
-    uint64_t utcTimestamp_uS = _deviceTime->getUTCTimestampMicros();
+    uint64_t utcTimestamp_uS = _getUTCTimestampMicros();
+    _isIdle = false;
     _mode->changeSoftChangeWindow(newWindow_S, utcTimestamp_uS, _lightVals);
-    _lights->setChannelValues(_lightVals.getLightValues());
+    if(_backgroundLayer){_backgroundLayer->changeSoftChangeWindow(newWindow_S, utcTimestamp_uS, _backgroundVals);}
+    _writeLights(utcTimestamp_uS);
 
     _configs.softChangeWindow = newWindow_S;
     _configsClass->setModalConfigs(_configs);
@@ -462,9 +922,11 @@ public:
    */
   bool changeMinOnBrightness(duty_t newMinBrightness){
     if(newMinBrightness == 0){return false;}
-    uint64_t utcTimestamp_uS = _deviceTime->getUTCTimestampMicros();
+    uint64_t utcTimestamp_uS = _getUTCTimestampMicros();
+    _isIdle = false;
     _mode->changeMinOnBrightness(newMinBrightness, utcTimestamp_uS, _lightVals);
-    _lights->setChannelValues(_lightVals.getLightValues());
+    if(_backgroundLayer){_backgroundLayer->changeMinOnBrightness(newMinBrightness, utcTimestamp_uS, _backgroundVals);}
+    _writeLights(utcTimestamp_uS);
 
     _configs.minOnBrightness = newMinBrightness;
     _configsClass->setModalConfigs(_configs);
@@ -474,6 +936,7 @@ public:
   bool changeDefaultOnBrightness(duty_t newDefaultOnBrightness){
     _configs.defaultOnBrightness = newDefaultOnBrightness;
     _mode->changeDefaultOnBrightness(newDefaultOnBrightness);
+    if(_backgroundLayer){_backgroundLayer->changeDefaultOnBrightness(newDefaultOnBrightness);}
     _configsClass->setModalConfigs(_configs);
     return true;
   }
@@ -482,9 +945,26 @@ public:
     return _configs;
   }
 
+  /**
+   * @brief set how an active mode gets drawn on top of the background mode. the background keeps running either way, but it only gets updated while it's hidden if the rule needs it
+   * 
+   * @param rule 
+   */
+  void setLayerBlendRule(LayerBlendRules rule){
+    _blendRule = rule;
+    _isIdle = false;
+  }
+
+  LayerBlendRules getLayerBlendRule(){return _blendRule;}
+
   void notification(const TimeUpdateStruct& timeUpdates){
+    _appliedUTCChanges_uS += timeUpdates.utcTimeChange_uS;
     if(timeUpdates.utcTimeChange_uS != 0){
+      _isIdle = false;
       _mode->timeAdjust(timeUpdates);
+      if(_backgroundLayer){_backgroundLayer->timeAdjust(timeUpdates);}
+      if(_outgoingMode){_outgoingMode->timeAdjust(timeUpdates);}
+      _crossfade.adjustTime(timeUpdates.utcTimeChange_uS);
     }
   }
 };
@@ -0,0 +1,125 @@
+#ifndef _CHANGING_MODE_H_
+#define _CHANGING_MODE_H_
+
+#include "modes.h"
+
+/**
+ * @brief the colours (and optionally the brightness) change from the start values to the end values over a long time window, starting at the trigger time. the window is modeData->time[0] (MSB) and time[1] (LSB), in minutes, so it can be up to about 45 days.
+ *
+ * the start values are startColourRatios with minBrightness, and the end values are endColourRatios with maxBrightness. the mode packet only has room for those two points, so the timeline is a single window interpolation. if both brightnesses are 0, the timeline only changes the colours and the brightness behaves like constant brightness.
+ *
+ * active mode: a timeline with brightness can't be adjusted, and any state change cancels it.
+ * background mode: the colours keep following the timeline. changing the brightness or state takes over the brightness, which then behaves like constant brightness.
+ */
+class ChangingMode : public ConstantBrightnessMode
+{
+private:
+  Interpolator<nChannels+1> _timeline;  // [0] is brightness, the rest are colour ratios
+  bool _isFollowingBrightness;    // false when the timeline only does colours, or the user has taken over
+  bool _isTimelineFinished = false;
+
+  /**
+   * @brief hand the brightness over to the user. the brightness interpolation starts from the current value, so there's no jump
+   *
+   * @param utcTimestamp_uS
+   * @param lightVals
+   */
+  void _leaveTimeline(uint64_t utcTimestamp_uS, LightStateStruct& lightVals){
+    if(!_isFollowingBrightness){return;}
+    updateLightVals(utcTimestamp_uS, lightVals);
+    _isFollowingBrightness = false;
+    _interp.newBrightnessVal_window(utcTimestamp_uS, 0, lightVals.values[0], lightVals.values[0]);
+  }
+
+public:
+  const ModeTypes type = ModeTypes::changing;
+
+  /**
+   * @brief Construct a new Changing Mode object
+   *
+   * @param currentTime_uS
+   * @param triggerTime_uS the start of the timeline
+   * @param modeDataStruct
+   * @param previousInterp the interpolation state of the previous mode, which this one carries on from
+   * @param currentVals
+   * @param isActive
+   * @param configs
+   */
+  ChangingMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs
+  ) : ConstantBrightnessMode(currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs)
+  {
+    _isFollowingBrightness = (modeData->minBrightness != 0) || (modeData->maxBrightness != 0);
+    const uint32_t window_S = ((static_cast<uint32_t>(modeData->time[0]) << 8) + modeData->time[1]) * 60;
+
+    duty_t startVals[nChannels+1];
+    startVals[0] = modeData->minBrightness;
+    memcpy(&startVals[1], modeData->startColourRatios, nChannels);
+    duty_t endVals[nChannels+1];
+    endVals[0] = modeData->maxBrightness;
+    memcpy(&endVals[1], modeData->endColourRatios, nChannels);
+    _timeline.newWindowInterpolation(triggerTime_uS, static_cast<uint64_t>(window_S) * secondsToMicros, startVals, endVals);
+
+    if(_isFollowingBrightness){
+      currentVals.state = true;
+      _interp.newBrightnessVal_window(currentTime_uS, 0, modeData->maxBrightness, modeData->maxBrightness);
+    }
+    updateLightVals(currentTime_uS, currentVals);
+  };
+
+  void updateLightVals(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    duty_t timelineVals[nChannels+1];
+    _timeline.findNextValues(timelineVals, utcTimestamp_uS);
+    _isTimelineFinished = utcTimestamp_uS >= _timeline.t1_uS;
+    if(_isFollowingBrightness){
+      memcpy(lightVals.values, timelineVals, nChannels+1);
+      return;
+    }
+    ConstantBrightnessMode::updateLightVals(utcTimestamp_uS, lightVals);
+    memcpy(&lightVals.values[1], &timelineVals[1], nChannels);
+  }
+
+  duty_t setBrightness(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, duty_t brightness, bool softChange) override {
+    if(isActive && _isFollowingBrightness){return getTargetBrightness();}
+    _leaveTimeline(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::setBrightness(utcTimestamp_uS, lightVals, brightness, softChange);
+    return getTargetBrightness();
+  }
+
+  void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) override {
+    if(isActive && _isFollowingBrightness){return;}
+    _leaveTimeline(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::startBrightnessRamp(utcTimestamp_uS, lightVals, increasing, rampWindow_uS);
+  }
+
+  void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    if(_isFollowingBrightness){return;}
+    ConstantBrightnessMode::stopBrightnessRamp(utcTimestamp_uS, lightVals);
+  }
+
+  bool setState(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool newState) override {
+    if(newState == lightVals.state){return false;}
+    if(isActive){return true;}
+    _leaveTimeline(utcTimestamp_uS, lightVals);
+    return ConstantBrightnessMode::setState(utcTimestamp_uS, lightVals, newState);
+  }
+
+  bool startsFromCurrentVals() override {return false;}
+
+  bool isIdle() override {
+    return _isTimelineFinished && ConstantBrightnessMode::isIdle();
+  }
+
+  void timeAdjust(const TimeUpdateStruct& timeUpdates) override {
+    ConstantBrightnessMode::timeAdjust(timeUpdates);
+    _timeline.adjustTime(timeUpdates.utcTimeChange_uS);
+  }
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _CROSSFADE_H_
+#define _CROSSFADE_H_
+
+#include <Arduino.h>
+
+#include "lightDefines.h"
+
+/**
+ * @brief works out how far through a crossfade we are, and mixes two sets of channel values. the weight is fixed point out of 256, and the rate gets worked out in start() so that getWeight() doesn't need to divide.
+ */
+class Crossfade {
+  private:
+    uint64_t _startTime_uS = 0;
+    uint64_t _endTime_uS = 0;
+    uint64_t _weightRate = 0;    // weight per uS, shifted up by 32 bits
+    bool _isActive = false;
+
+  public:
+    static constexpr uint16_t fullWeight = 256;
+
+    Crossfade(){};
+
+    /**
+     * @brief start a new crossfade
+     *
+     * @param startTime_uS
+     * @param window_uS 0 means there won't be a crossfade
+     */
+    void start(const uint64_t startTime_uS, const uint64_t window_uS){
+      _isActive = window_uS > 0;
+      if(!_isActive){return;}
+      _startTime_uS = startTime_uS;
+      _endTime_uS = startTime_uS + window_uS;
+      _weightRate = (static_cast<uint64_t>(fullWeight) << 32) / window_uS;
+    }
+
+    void stop(){_isActive = false;}
+
+    bool isActive(){return _isActive;}
+
+    /**
+     * @brief get the weight of the incoming values. stops the crossfade if it's finished
+     *
+     * @param time_uS
+     * @return uint16_t between 0 (all outgoing) and fullWeight (all incoming)
+     */
+    uint16_t getWeight(const uint64_t time_uS){
+      if(!_isActive){return fullWeight;}
+      if(time_uS >= _endTime_uS){
+        _isActive = false;
+        return fullWeight;
+      }
+      if(time_uS <= _startTime_uS){return 0;}
+      return ((time_uS - _startTime_uS) * _weightRate) >> 32;
+    }
+
+    /**
+     * @brief mix two sets of values
+     *
+     * @param out
+     * @param outgoing
+     * @param incoming
+     * @param weight of the incoming values, out of fullWeight
+     * @param size
+     */
+    static void mix(duty_t *out, const duty_t *outgoing, const duty_t *incoming, const uint16_t weight, const uint8_t size){
+      const uint16_t outgoingWeight = fullWeight - weight;
+      for(uint8_t i = 0; i < size; i++){
+        out[i] = (outgoing[i]*outgoingWeight + incoming[i]*weight + (fullWeight/2)) >> 8;
+      }
+    }
+
+    void adjustTime(const int64_t& utcTimeChange_uS){
+      _startTime_uS += utcTimeChange_uS;
+      _endTime_uS += utcTimeChange_uS;
+    }
+};
+
+#endif
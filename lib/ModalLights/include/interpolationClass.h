@@ -172,11 +172,11 @@ public:
       int16_t dV = targetVals[d] - initialVals[d];
       top[d] = dV < 0 ? -1 : dV > 0;
       const duty_t abs_dV = abs(dV);
-      if(abs_dV > max_dV){max_dV == abs_dV;}
+      if(abs_dV > max_dV){max_dV = abs_dV;}
       _isDone &= dV == 0;
       k[d] = (initialVals[d] * rate_uS) + (rate_uS/2);
     }
-    t1_uS = utcTimestamp_us + (max_dV * rate_uS);
+    t1_uS = utcTimestamp_us + (static_cast<uint64_t>(max_dV) * rate_uS);
 
     return _isDone;
   };
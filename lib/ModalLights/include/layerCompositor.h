@@ -0,0 +1,67 @@
+#ifndef _LAYER_COMPOSITOR_H_
+#define _LAYER_COMPOSITOR_H_
+
+#include <Arduino.h>
+
+#include "lightDefines.h"
+
+/**
+ * @brief how the active mode gets drawn on top of the background mode
+ *
+ * replace: only the active mode is visible. the background isn't updated while it's hidden
+ * max: each channel is whichever layer is brighter
+ * multiply: the active mode filters the background, i.e. 255 lets the background through and 0 blocks it
+ */
+enum class LayerBlendRules : uint8_t {
+  replace,
+  max,
+  multiply
+};
+
+/**
+ * @brief composes the channel values of the background and active layers
+ */
+class LayerCompositor {
+  public:
+    /**
+     * @brief true if the rule needs the background values. if it doesn't, the background can be left alone until it's revealed
+     *
+     * @param rule
+     * @return bool
+     */
+    static bool needsBackground(const LayerBlendRules rule){
+      return rule != LayerBlendRules::replace;
+    }
+
+    /**
+     * @brief compose two sets of channel values
+     *
+     * @param out can be the same as either input
+     * @param background
+     * @param active
+     * @param rule
+     * @param size
+     */
+    static void compose(duty_t *out, const duty_t *background, const duty_t *active, const LayerBlendRules rule, const uint8_t size){
+      switch(rule){
+        case LayerBlendRules::max:
+          for(uint8_t i = 0; i < size; i++){
+            out[i] = active[i] > background[i] ? active[i] : background[i];
+          }
+          return;
+        case LayerBlendRules::multiply:
+          for(uint8_t i = 0; i < size; i++){
+            // rounded divide by 255 without dividing
+            const uint16_t product = background[i]*active[i] + 128;
+            out[i] = (product + (product >> 8)) >> 8;
+          }
+          return;
+        case LayerBlendRules::replace:
+        default:
+          if(out != active){memcpy(out, active, size);}
+          return;
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __LIGHTS_OUTPUT_TASK_H__
+#define __LIGHTS_OUTPUT_TASK_H__
+
+#include <Arduino.h>
+#include <memory>
+
+#include "ModalLights.h"
+#include "lightsTaskChannel.h"
+
+/**
+ * @brief the output task's side of the channel. runs the control task's commands on the controller, updates the lights, and reports any changes back
+ */
+class LightsOutputTask {
+  private:
+    std::shared_ptr<ModalLightsController> _modalLights;
+    std::shared_ptr<LightsTaskChannel> _channel;
+
+    LightsReportStruct _lastReport;
+    bool _isReportPending = true;   // the first report always gets sent
+
+    void _run(const LightCommand& command){
+      switch(command.type){
+        case LightCommands::setMode:
+          _modalLights->setModeData(command.modeData, command.time, command.flag);
+          break;
+        case LightCommands::cancelActiveMode:
+          _modalLights->cancelActiveMode();
+          break;
+        case LightCommands::setState:
+          _modalLights->setState(command.flag);
+          break;
+        case LightCommands::setBrightnessLevel:
+          _modalLights->setBrightnessLevel(command.brightness);
+          break;
+        case LightCommands::adjustBrightness:
+          _modalLights->adjustBrightness(command.brightness, command.flag);
+          break;
+        case LightCommands::startBrightnessRamp:
+          _modalLights->startBrightnessRamp(command.flag, command.rampWindow_mS, command.time);
+          break;
+        case LightCommands::stopBrightnessRamp:
+          _modalLights->stopBrightnessRamp(command.time);
+          break;
+        case LightCommands::timeUpdate:
+          _modalLights->notification(command.timeUpdates);
+          break;
+      }
+    }
+
+    LightsReportStruct _makeReport(){
+      const CurrentModeStruct modes = _modalLights->getCurrentModes();
+      LightsReportStruct report;
+      report.state = _modalLights->getState();
+      report.brightness = _modalLights->getBrightnessLevel();
+      report.setBrightness = _modalLights->getSetBrightness();
+      report.activeMode = modes.activeMode;
+      report.backgroundMode = modes.backgroundMode;
+      return report;
+    }
+
+  public:
+    /**
+     * @brief Construct a new Lights Output Task. the controller shouldn't be observing DeviceTime, because the time updates come through the channel
+     * 
+     * @param modalLights 
+     * @param channel 
+     */
+    LightsOutputTask(
+      std::shared_ptr<ModalLightsController> modalLights,
+      std::shared_ptr<LightsTaskChannel> channel
+    ) : _modalLights(modalLights), _channel(channel){}
+
+    /**
+     * @brief run the waiting commands, update the lights, then report if anything changed. call once per output loop
+     * 
+     */
+    void update(){
+      LightCommand command;
+      while(_channel->commands.pop(command)){
+        _run(command);
+      }
+      _modalLights->updateLights();
+
+      const LightsReportStruct report = _makeReport();
+      if(report != _lastReport){
+        _lastReport = report;
+        _isReportPending = true;
+      }
+      // if the queue is full, try again next time
+      if(_isReportPending && _channel->reports.push(_lastReport)){
+        _isReportPending = false;
+      }
+    }
+};
+
+#endif
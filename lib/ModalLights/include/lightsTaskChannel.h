@@ -0,0 +1,70 @@
+/**
+ * notes:
+ *  - the lights are split across two tasks. the output task owns ModalLightsController (i.e. the interpolation and VirtualLightsClass), and should be pinned to its own core so that nothing slow can delay the PWM updates. the control task owns storage, EventManager, and config, and talks to the lights through ModalLightsProxy
+ *  - everything going between them goes through a LightsTaskChannel: commands one way, state reports the other. both are lock-free SPSC queues, so neither task can block the other
+ *  - storage reads are requested by the control task and done by the storage worker (see AsyncDataStorage.h). the output task gets the mode data in the command, so it never touches the storage HAL
+ *  - time changes reach the output task as timeUpdate commands, so they arrive after DeviceTime has already changed. the controller's clock leaves out the changes it hasn't applied yet (DeviceTime::getUTCTimestampMicros(appliedChanges_uS)), so the interpolations don't see the jump twice
+ */
+
+#ifndef __LIGHTS_TASK_CHANNEL_H__
+#define __LIGHTS_TASK_CHANNEL_H__
+
+#include <Arduino.h>
+
+#include "ProjectDefines.h"
+#include "spscQueue.h"
+
+#ifndef LIGHT_COMMAND_QUEUE_SIZE
+  #define LIGHT_COMMAND_QUEUE_SIZE 8  // must be a power of 2
+#endif
+
+enum class LightCommands : uint8_t {
+  setMode,
+  cancelActiveMode,
+  setState,
+  setBrightnessLevel,
+  adjustBrightness,
+  startBrightnessRamp,
+  stopBrightnessRamp,
+  timeUpdate
+};
+
+/**
+ * @brief a call to ModalLightsInterface, made by the control task and run by the output task. only the fields the command needs get used
+ */
+struct LightCommand {
+  LightCommands type = LightCommands::setMode;
+  bool flag = false;              // isActive for setMode, newState for setState, increasing for adjustBrightness and startBrightnessRamp
+  duty_t brightness = 0;          // setBrightnessLevel and adjustBrightness
+  uint16_t rampWindow_mS = 0;     // startBrightnessRamp
+  uint64_t time = 0;              // the local trigger time in seconds for setMode, the UTC time in uS for the ramps
+  ModeDataStruct modeData;        // setMode
+  TimeUpdateStruct timeUpdates{0, 0, 0};  // timeUpdate
+};
+
+/**
+ * @brief what the lights are doing, sent by the output task whenever it changes
+ */
+struct LightsReportStruct {
+  bool state = false;
+  duty_t brightness = 0;      // the actual brightness, including state
+  duty_t setBrightness = 0;   // the target brightness, ignoring state
+  modeUUID activeMode = 0;
+  modeUUID backgroundMode = 0;
+
+  bool operator==(const LightsReportStruct& other) const {
+    return state == other.state
+      && brightness == other.brightness
+      && setBrightness == other.setBrightness
+      && activeMode == other.activeMode
+      && backgroundMode == other.backgroundMode;
+  }
+  bool operator!=(const LightsReportStruct& other) const {return !(*this == other);}
+};
+
+struct LightsTaskChannel {
+  SPSCQueue<LightCommand, LIGHT_COMMAND_QUEUE_SIZE> commands;   // control task -> output task
+  SPSCQueue<LightsReportStruct, 4> reports;                     // output task -> control task
+};
+
+#endif
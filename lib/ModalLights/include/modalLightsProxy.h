@@ -0,0 +1,232 @@
+#ifndef __MODAL_LIGHTS_PROXY_H__
+#define __MODAL_LIGHTS_PROXY_H__
+
+#include <Arduino.h>
+#include <memory>
+
+#include "ModalLights.h"
+#include "lightsTaskChannel.h"
+#include "AsyncDataStorage.h"
+
+/**
+ * @brief the control task's side of the channel. it looks like a ModalLightsController to EventManager (and anything else on the control task), but every call gets sent to the output task as a command.
+ * the output task runs the commands later, so the return values are whatever was last reported, not the result of the call. mode changes and time updates get retried if the command queue is full; anything else is dropped, and counted in MetricCounters::lightCommandDrops.
+ * modes are read through AsyncDataStorage, so a slow read doesn't hold up the control task either. the mode gets sent once it's been read
+ */
+class ModalLightsProxy : public ModalLightsInterface, public TimeObserver {
+  private:
+    std::shared_ptr<LightsTaskChannel> _channel;
+    std::shared_ptr<AsyncDataStorage> _dataStorage;
+    std::shared_ptr<DeviceTimeClass> _deviceTime;
+
+    LightsReportStruct _report;
+
+    // mode changes and time updates can't be dropped, so they get retried if the queue is full. only the most recent mode of each kind matters
+    LightCommand _pendingActiveMode;
+    LightCommand _pendingBackgroundMode;
+    bool _isActiveModePending = false;
+    bool _isBackgroundModePending = false;
+    TimeUpdateStruct _pendingTimeUpdates{0, 0, 0};
+    bool _isTimeUpdatePending = false;
+
+    // the most recent mode of each kind that's waiting on storage. 0 if nothing is
+    modeUUID _requestedActiveMode = 0;
+    uint64_t _requestedActiveTriggerTime_S = 0;
+    modeUUID _requestedBackgroundMode = 0;
+    uint64_t _requestedBackgroundTriggerTime_S = 0;
+    bool _isActiveRequestUnsent = false;      // the storage request queue was full. retried in updateLights()
+    bool _isBackgroundRequestUnsent = false;
+
+    bool _send(const LightCommand& command){
+      return _channel->commands.push(command);
+    }
+
+    /**
+     * @brief send a command that doesn't get retried. if the queue is full it's lost, so it gets counted
+     * 
+     * @param command 
+     * @return true if it was sent
+     */
+    bool _sendOrDrop(const LightCommand& command){
+      if(_send(command)){return true;}
+      getMetrics().count(MetricCounters::lightCommandDrops);
+      return false;
+    }
+
+    void _sendPending(){
+      if(_isTimeUpdatePending){
+        LightCommand command;
+        command.type = LightCommands::timeUpdate;
+        command.timeUpdates = _pendingTimeUpdates;
+        if(_send(command)){
+          _isTimeUpdatePending = false;
+          _pendingTimeUpdates = TimeUpdateStruct{0, 0, 0};
+        }
+      }
+      if(_isActiveModePending && _send(_pendingActiveMode)){_isActiveModePending = false;}
+      if(_isBackgroundModePending && _send(_pendingBackgroundMode)){_isBackgroundModePending = false;}
+    }
+
+    void _requestMode(bool isActive){
+      const modeUUID modeID = isActive ? _requestedActiveMode : _requestedBackgroundMode;
+      const bool isSent = modeID == 0 || _dataStorage->requestMode(modeID, _onModeLoaded, this, isActive);
+      if(isActive){_isActiveRequestUnsent = !isSent;}
+      else{_isBackgroundRequestUnsent = !isSent;}
+    }
+
+    /**
+     * @brief async storage callback. turns the mode into a command, if it's still the one that's wanted
+     * 
+     * @param result 
+     * @param context the proxy
+     */
+    static void _onModeLoaded(const StorageResultStruct& result, void* context){
+      ModalLightsProxy* proxy = static_cast<ModalLightsProxy*>(context);
+      const bool isActive = result.tag;
+      modeUUID& requested = isActive ? proxy->_requestedActiveMode : proxy->_requestedBackgroundMode;
+      if(result.ID != requested){return;}
+      requested = 0;
+      if(!result.success){return;}
+
+      LightCommand& command = isActive ? proxy->_pendingActiveMode : proxy->_pendingBackgroundMode;
+      command.type = LightCommands::setMode;
+      command.flag = isActive;
+      command.time = isActive ? proxy->_requestedActiveTriggerTime_S : proxy->_requestedBackgroundTriggerTime_S;
+      command.modeData = result.modeData;
+      if(isActive){proxy->_isActiveModePending = true;}
+      else{proxy->_isBackgroundModePending = true;}
+    }
+
+  public:
+    /**
+     * @brief Construct a new Modal Lights Proxy, and start forwarding UTC time changes to the output task
+     * 
+     * @param channel shared with the LightsOutputTask
+     * @param dataStorage the control task is the only thing that should make requests or dispatch completions
+     * @param deviceTime 
+     */
+    ModalLightsProxy(
+      std::shared_ptr<LightsTaskChannel> channel,
+      std::shared_ptr<AsyncDataStorage> dataStorage,
+      std::shared_ptr<DeviceTimeClass> deviceTime
+    ) : _channel(channel), _dataStorage(dataStorage), _deviceTime(deviceTime){
+      _deviceTime->add_observer(*this, TimeObserverFilter{.changes = TimeUpdateFlags::utc});
+    }
+
+    ~ModalLightsProxy(){
+      _deviceTime->remove_observer(*this);
+    }
+
+    /**
+     * @brief collect any modes that have been read, send anything that didn't fit in the queue last time, and read the output task's reports. call once per control loop
+     * 
+     */
+    void updateLights() override {
+      _dataStorage->dispatchCompletions();
+      if(_isActiveRequestUnsent){_requestMode(true);}
+      if(_isBackgroundRequestUnsent){_requestMode(false);}
+      _sendPending();
+      LightsReportStruct report;
+      while(_channel->reports.pop(report)){
+        _report = report;
+      }
+      _lightVals.state = _report.state;
+      _lightVals.values[0] = _report.brightness;
+    }
+
+    /**
+     * @brief request the mode from storage. it gets sent to the output task from updateLights() once it's been read
+     * 
+     * @param modeID 
+     * @param triggerTimeLocal_S 
+     * @param isActive 
+     */
+    void setModeByUUID(modeUUID modeID, uint64_t triggerTimeLocal_S, bool isActive) override {
+      if(!_dataStorage->doesModeExist(modeID)){return;}
+      if(isActive){
+        _requestedActiveMode = modeID;
+        _requestedActiveTriggerTime_S = triggerTimeLocal_S;
+      }
+      else{
+        _requestedBackgroundMode = modeID;
+        _requestedBackgroundTriggerTime_S = triggerTimeLocal_S;
+      }
+      _requestMode(isActive);
+    }
+
+    bool cancelActiveMode() override {
+      LightCommand command;
+      command.type = LightCommands::cancelActiveMode;
+      _isActiveModePending = false;
+      _requestedActiveMode = 0;
+      _isActiveRequestUnsent = false;
+      return _sendOrDrop(command) && _report.activeMode != 0;
+    }
+
+    bool setState(bool newState) override {
+      LightCommand command;
+      command.type = LightCommands::setState;
+      command.flag = newState;
+      _sendOrDrop(command);
+      return _report.state;
+    }
+
+    duty_t setBrightnessLevel(duty_t brightness) override {
+      LightCommand command;
+      command.type = LightCommands::setBrightnessLevel;
+      command.brightness = brightness;
+      _sendOrDrop(command);
+      return _report.setBrightness;
+    }
+
+    duty_t adjustBrightness(duty_t amount, bool increasing) override {
+      LightCommand command;
+      command.type = LightCommands::adjustBrightness;
+      command.brightness = amount;
+      command.flag = increasing;
+      _sendOrDrop(command);
+      return _report.brightness;
+    }
+
+    void startBrightnessRamp(bool increasing, uint16_t rampWindow_mS, uint64_t startTimeUTC_uS) override {
+      LightCommand command;
+      command.type = LightCommands::startBrightnessRamp;
+      command.flag = increasing;
+      command.rampWindow_mS = rampWindow_mS;
+      command.time = startTimeUTC_uS;
+      _sendOrDrop(command);
+    }
+
+    duty_t stopBrightnessRamp(uint64_t stopTimeUTC_uS) override {
+      LightCommand command;
+      command.type = LightCommands::stopBrightnessRamp;
+      command.time = stopTimeUTC_uS;
+      _sendOrDrop(command);
+      return _report.brightness;
+    }
+
+    duty_t getSetBrightness() override {return _report.setBrightness;}
+
+    CurrentModeStruct getCurrentModes(){
+      CurrentModeStruct currentModes = {
+        .activeMode = _report.activeMode,
+        .backgroundMode = _report.backgroundMode
+      };
+      return currentModes;
+    }
+
+    /**
+     * @brief forward UTC time changes to the output task, so that the interpolations can be adjusted
+     * 
+     * @param timeUpdates 
+     */
+    void notification(const TimeUpdateStruct& timeUpdates){
+      _pendingTimeUpdates.utcTimeChange_uS += timeUpdates.utcTimeChange_uS;
+      _pendingTimeUpdates.localTimeChange_uS += timeUpdates.localTimeChange_uS;
+      _pendingTimeUpdates.currentLocalTime_uS = timeUpdates.currentLocalTime_uS;
+      _isTimeUpdatePending = true;
+      _sendPending();
+    }
+};
+
+#endif
@@ -29,6 +29,24 @@ public:
    */
   virtual duty_t setBrightness(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, duty_t brightness, bool softChange) = 0;
 
+  /**
+   * @brief start a steady brightness ramp towards the max (or towards the lowest brightness the mode allows). the ramp is an interpolation, so updateLightVals() does the rest
+   * 
+   * @param utcTimestamp_uS the start of the ramp
+   * @param lightVals 
+   * @param increasing 
+   * @param rampWindow_uS how long it would take to ramp from 0 to 255
+   */
+  virtual void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) = 0;
+
+  /**
+   * @brief hold the brightness at the ramp's value at utcTimestamp_uS
+   * 
+   * @param utcTimestamp_uS the end of the ramp
+   * @param lightVals 
+   */
+  virtual void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) = 0;
+
   /**
    * @brief politely asks the mode to set the state. the mode will update lightVals accordingly. since state change comes from button presses, and button presses cancel active modes, this method returns true if it thinks it's ready to be cancelled. background modes should always return false.
    * 
@@ -46,6 +64,20 @@ public:
    */
   virtual void getTargetVals(duty_t vals[nChannels+1], uint64_t utcTimestamp_uS, LightStateStruct& lightVals) = 0;
 
+  /**
+   * @brief true if the light values won't change until something else changes them, i.e. every interpolation has finished. only valid straight after updateLightVals()
+   * 
+   * @return bool 
+   */
+  virtual bool isIdle() = 0;
+
+  /**
+   * @brief true if the mode starts from the current light values and changes them gradually, so there's no need to crossfade into it
+   * 
+   * @return bool 
+   */
+  virtual bool startsFromCurrentVals() = 0;
+
   /**
    * @brief returns the target brightness
    * 
@@ -53,6 +85,13 @@ public:
    */
   virtual duty_t getTargetBrightness() = 0;
 
+  /**
+   * @brief the mode's interpolation state, so that the next mode can carry on from it
+   * 
+   * @return const ModeInterpolationClass<nChannels>& 
+   */
+  virtual const ModeInterpolationClass<nChannels>& getInterpolation() = 0;
+
   /**
    * @brief alert the mode that the internal clock has been adjusted, and that any stored times also need to be adjusted.
    * 
@@ -84,8 +123,9 @@ public:
 
 class ConstantBrightnessMode : public ModalStrategyInterface
 {
-private:
-  std::shared_ptr<ModeInterpolationClass<nChannels>> _interpClass;
+protected:
+  const ModeDataStruct _modeData;   // a copy, so that the controller can load the next mode while this one is crossfading out
+  ModeInterpolationClass<nChannels> _interp;   // held by value, so the tick path doesn't chase a pointer
 
   // TODO: replace with reference to configs struct
   duty_t _softChangeWindow_S;
@@ -106,7 +146,7 @@ public:
    * @param currentTime_uS 
    * @param triggerTime_uS 
    * @param modeData
-   * @param interpClass
+   * @param previousInterp the interpolation state of the previous mode, which this one carries on from
    * @param currentVals 
    * @param isActive 
    * @param configs 
@@ -115,13 +155,14 @@ public:
     uint64_t currentTime_uS,
     uint64_t triggerTime_uS,
     ModeDataStruct *modeDataStruct,
-    std::shared_ptr<ModeInterpolationClass<nChannels>> interpClass,
+    const ModeInterpolationClass<nChannels>& previousInterp,
     LightStateStruct& currentVals,
     bool isActive,
     const ModalConfigsStruct& configs
   ) : ModalStrategyInterface(),
-      modeData(modeDataStruct),
-      _interpClass(interpClass),
+      _modeData(*modeDataStruct),
+      modeData(&_modeData),
+      _interp(previousInterp),
       isActive(isActive),
       _softChangeWindow_S(configs.softChangeWindow),
       _minOnBrightness(configs.minOnBrightness),
@@ -131,14 +172,14 @@ public:
     _minSettableBrightness = _minOnBrightness;
 
     // fill target colour vals
-    memcpy(_interpClass->colours.targetVals, modeData->endColourRatios, nChannels);
+    memcpy(_interp.colours.targetVals, modeData->endColourRatios, nChannels);
 
     // set current vals to target vals if lights are off
     if(currentVals.state == 0 || currentVals.values[0] < _minOnBrightness){
-      _interpClass->getTargetVals(currentVals.values);
+      _interp.getTargetVals(currentVals.values);
     }
 
-    duty_t *targetB = _interpClass->brightness.targetVals;
+    duty_t *targetB = _interp.brightness.targetVals;
     
     // if mode is active, force on default brightness if brightness is under default
     if(isActive){
@@ -155,18 +196,18 @@ public:
       }
     }
     uint64_t window = _softChangeWindow_S * secondsToMicros;
-    _interpClass->setInitialVals(currentVals.values);
-    _interpClass->rebuildInterpConstants_window(utcStartTime_uS, window);
+    _interp.setInitialVals(currentVals.values);
+    _interp.rebuildInterpConstants_window(utcStartTime_uS, window);
     updateLightVals(utcStartTime_uS, currentVals);
   };
 
   void updateLightVals(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
-    _interpClass->findNextValues(lightVals.values, utcTimestamp_uS);
+    _interp.findNextValues(lightVals.values, utcTimestamp_uS);
 
     if(lightVals.values[0] < _minOnBrightness){
       lightVals.state = false;
-      _interpClass->setTargetBrightness(0);
-      _interpClass->endInterpolation(lightVals.values);
+      _interp.setTargetBrightness(0);
+      _interp.endInterpolation(lightVals.values);
     }
     return;
   }
@@ -187,13 +228,41 @@ public:
       }
     }
     
-    _interpClass->newBrightnessVal_window(
+    _interp.newBrightnessVal_window(
       utcTimestamp_uS, window*secondsToMicros, lightVals.values[0], brightness
     );
     updateLightVals(utcTimestamp_uS, lightVals);
     return brightness;
   }
 
+  void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) override {
+    updateLightVals(utcTimestamp_uS, lightVals);
+    if(!increasing && !lightVals.state){return;}
+
+    if(!lightVals.state || lightVals.values[0] < _minOnBrightness){
+      // ramping up from off starts at the minimum
+      lightVals.state = true;
+      lightVals.values[0] = _minOnBrightness;
+    }
+
+    // ramping down past _minOnBrightness turns the lights off, unless the mode is active
+    const duty_t initialB = lightVals.values[0];
+    const duty_t targetB = increasing
+                          ? LED_LIGHTS_MAX_DUTY
+                          : (isActive ? _minSettableBrightness : 0);
+    const uint64_t steps = increasing ? targetB - initialB : initialB - targetB;
+    _interp.newBrightnessVal_window(
+      utcTimestamp_uS, (steps * rampWindow_uS) / LED_LIGHTS_MAX_DUTY, initialB, targetB
+    );
+    updateLightVals(utcTimestamp_uS, lightVals);
+  }
+
+  void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    updateLightVals(utcTimestamp_uS, lightVals);
+    if(!lightVals.state){return;}
+    _interp.newBrightnessVal_window(utcTimestamp_uS, 0, lightVals.values[0], lightVals.values[0]);
+  }
+
   /**
    * @brief politely asks the mode to set the state. the mode will update lightVals accordingly. since state change comes from button presses, and button presses cancel active modes, this method returns true if it thinks it's ready to be cancelled. background modes should always return false.
    * 
@@ -215,7 +284,7 @@ public:
     lightVals.state = newState;
 
     if(newState == false){
-      _interpClass->endInterpolation(lightVals.values); // yeat on passed the colour interpolation
+      _interp.endInterpolation(lightVals.values); // yeat on passed the colour interpolation
       return false;
     }
 
@@ -226,7 +295,7 @@ public:
                           ? max(lightVals.values[0], _minOnBrightness)
                           : _defaultOnBrightness;
 
-    _interpClass->newBrightnessVal_window(utcTimestamp_uS, _softChangeWindow_S*secondsToMicros, _minOnBrightness, newBrightness);
+    _interp.newBrightnessVal_window(utcTimestamp_uS, _softChangeWindow_S*secondsToMicros, _minOnBrightness, newBrightness);
     updateLightVals(utcTimestamp_uS, lightVals);
     return false;
   }
@@ -240,13 +309,19 @@ public:
    */
   void getTargetVals(duty_t vals[nChannels+1], uint64_t utcTimestamp_uS, LightStateStruct& lightVals){
     updateLightVals(utcTimestamp_uS, lightVals);
-    _interpClass->getTargetVals(vals);
+    _interp.getTargetVals(vals);
   }
 
-  duty_t getTargetBrightness() override {return _interpClass->getTargetBrightness();}
+  duty_t getTargetBrightness() override {return _interp.getTargetBrightness();}
+
+  const ModeInterpolationClass<nChannels>& getInterpolation() override {return _interp;}
+
+  bool isIdle() override {return _interp.isDone() == IsDoneBitFlags::both;}
+
+  bool startsFromCurrentVals() override {return true;}
 
   void timeAdjust(const TimeUpdateStruct& timeUpdates) override {
-    _interpClass->notification(timeUpdates);
+    _interp.notification(timeUpdates);
   }
 
   void changeSoftChangeWindow(uint8_t newWindow_S, uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
@@ -267,4 +342,4 @@ public:
 };
 
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
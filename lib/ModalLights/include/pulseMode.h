@@ -0,0 +1,185 @@
+#ifndef _PULSE_MODE_H_
+#define _PULSE_MODE_H_
+
+#include "modes.h"
+#include "waveform.h"
+
+/**
+ * @brief flashes between minBrightness and maxBrightness, with the colours going between startColourRatios (at min) and endColourRatios (at max). the lights are turned on when it triggers, and the phase starts at the trigger time.
+ *
+ * pulse: the period is modeData->time[0], in tenths of a second.
+ * chirp: the period sweeps from time[0] to time[1] (tenths of a second) over time[2] minutes, and min and max move to finalMinBrightness and finalMaxBrightness over the same time. after that it keeps going at the final values.
+ *
+ * active mode: the brightness can't be changed. any state change cancels it.
+ * background mode: setting the brightness shifts min and max so that max is the new brightness. state toggles the lights, and the wave keeps going while they're off. brightness ramps stop the flashing, after which it behaves like constant brightness.
+ */
+class PulseMode : public ConstantBrightnessMode
+{
+private:
+  Waveform _wave;
+  duty_t _initialMaxB;
+  duty_t _initialMinB;
+  int16_t _maxBChange = 0;  // chirp only
+  int16_t _minBChange = 0;
+  int16_t _brightnessShift = 0; // from the user setting the brightness
+  duty_t _maxB;
+  duty_t _minB;
+
+  bool _isPulsing = true;   // false once the user has taken over with a ramp
+  bool _isOn = true;
+
+  static duty_t _clampBrightness(const int16_t brightness){
+    if(brightness < 0){return 0;}
+    if(brightness > LED_LIGHTS_MAX_DUTY){return LED_LIGHTS_MAX_DUTY;}
+    return brightness;
+  }
+
+  /**
+   * @brief find min and max for the current point in the chirp, then keep the brightness interpolation pointing at max so that getTargetBrightness() makes sense
+   *
+   * @param utcTimestamp_uS
+   */
+  void _updateLimits(const uint64_t utcTimestamp_uS){
+    const int16_t progress = static_cast<int16_t>(_wave.getSweepProgress()) + 1;
+    _maxB = _clampBrightness(_initialMaxB + ((_maxBChange * progress) >> 8) + _brightnessShift);
+    _minB = _clampBrightness(_initialMinB + ((_minBChange * progress) >> 8) + _brightnessShift);
+    if(_interp.brightness.targetVals[0] != _maxB){
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, _maxB, _maxB);
+    }
+  }
+
+public:
+  const ModeTypes type;
+
+  /**
+   * @brief Construct a new Pulse Mode object. handles both pulse and chirp
+   *
+   * @param currentTime_uS
+   * @param triggerTime_uS the start of the wave
+   * @param modeDataStruct
+   * @param previousInterp the interpolation state of the previous mode, which this one carries on from
+   * @param currentVals
+   * @param isActive
+   * @param configs
+   */
+  PulseMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs
+  ) : ConstantBrightnessMode(currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs),
+      type(modeDataStruct->type)
+  {
+    const bool isSwapped = modeData->minBrightness > modeData->maxBrightness;
+    _initialMaxB = isSwapped ? modeData->minBrightness : modeData->maxBrightness;
+    _initialMinB = isSwapped ? modeData->maxBrightness : modeData->minBrightness;
+
+    const uint64_t tenthsToMicros = secondsToMicros / 10;
+    if(type == ModeTypes::chirp){
+      _maxBChange = static_cast<int16_t>(modeData->finalMaxBrightness) - _initialMaxB;
+      _minBChange = static_cast<int16_t>(modeData->finalMinBrightness) - _initialMinB;
+      _wave.startSweep(
+        triggerTime_uS,
+        modeData->time[0] * tenthsToMicros,
+        modeData->time[1] * tenthsToMicros,
+        static_cast<uint64_t>(modeData->time[2]) * 60 * secondsToMicros,
+        WaveShapes::sine
+      );
+    }
+    else{
+      _wave.start(triggerTime_uS, modeData->time[0] * tenthsToMicros, WaveShapes::sine);
+    }
+
+    currentVals.state = true;
+    _interp.colours.newWindowInterpolation(currentTime_uS, 0, modeData->endColourRatios, modeData->endColourRatios);
+    updateLightVals(currentTime_uS, currentVals);
+  };
+
+  void updateLightVals(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    if(!_isPulsing){
+      ConstantBrightnessMode::updateLightVals(utcTimestamp_uS, lightVals);
+      return;
+    }
+
+    const int16_t wave = static_cast<int16_t>(_wave.update(utcTimestamp_uS)) + 1;
+    _updateLimits(utcTimestamp_uS);
+    _isOn = lightVals.state;
+    if(!_isOn){return;}
+
+    lightVals.values[0] = _minB + (((_maxB - _minB) * wave) >> 8);
+    for(uint8_t c = 0; c < nChannels; c++){
+      const int16_t start = modeData->startColourRatios[c];
+      lightVals.values[c+1] = start + (((modeData->endColourRatios[c] - start) * wave) >> 8);
+    }
+  }
+
+  duty_t setBrightness(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, duty_t brightness, bool softChange) override {
+    if(!_isPulsing){
+      return ConstantBrightnessMode::setBrightness(utcTimestamp_uS, lightVals, brightness, softChange);
+    }
+    if(isActive){return _maxB;}
+
+    if(brightness < _minOnBrightness){
+      lightVals.state = false;
+      _isOn = false;
+      return 0;
+    }
+    lightVals.state = true;
+    _brightnessShift += static_cast<int16_t>(brightness) - _maxB;
+    updateLightVals(utcTimestamp_uS, lightVals);
+    return _maxB;
+  }
+
+  void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) override {
+    if(_isPulsing){
+      if(isActive){return;}
+      // take over from wherever the wave is
+      updateLightVals(utcTimestamp_uS, lightVals);
+      _isPulsing = false;
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, lightVals.values[0], lightVals.values[0]);
+      _interp.colours.newWindowInterpolation(
+        utcTimestamp_uS, _softChangeWindow_S*secondsToMicros, &lightVals.values[1], modeData->endColourRatios
+      );
+    }
+    ConstantBrightnessMode::startBrightnessRamp(utcTimestamp_uS, lightVals, increasing, rampWindow_uS);
+  }
+
+  void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    if(_isPulsing){return;}
+    ConstantBrightnessMode::stopBrightnessRamp(utcTimestamp_uS, lightVals);
+  }
+
+  bool setState(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool newState) override {
+    if(newState == lightVals.state){return false;}
+    if(isActive){return true;}
+    if(!_isPulsing){
+      return ConstantBrightnessMode::setState(utcTimestamp_uS, lightVals, newState);
+    }
+
+    lightVals.state = newState;
+    updateLightVals(utcTimestamp_uS, lightVals);
+    return false;
+  }
+
+  bool startsFromCurrentVals() override {return false;}
+
+  /**
+   * @brief a wave is never idle, unless the lights are off
+   *
+   * @return bool
+   */
+  bool isIdle() override {
+    if(!_isPulsing){return ConstantBrightnessMode::isIdle();}
+    return !_isOn;
+  }
+
+  void timeAdjust(const TimeUpdateStruct& timeUpdates) override {
+    ConstantBrightnessMode::timeAdjust(timeUpdates);
+    _wave.adjustTime(timeUpdates.utcTimeChange_uS);
+  }
+};
+
+#endif
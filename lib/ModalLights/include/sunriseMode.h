@@ -0,0 +1,215 @@
+#ifndef _SUNRISE_MODE_H_
+#define _SUNRISE_MODE_H_
+
+#include "modes.h"
+
+/**
+ * @brief brightness and colour rise over the window (modeData->time[0], in minutes) leading up to the trigger time, where they reach maxBrightness and endColourRatios. i.e. the trigger time is when you want to be awake.
+ *
+ * perceived brightness isn't linear with duty, so the brightness follows a squared curve. the curve is approximated with a few straight segments that get built in the constructor, so each update only costs one extra interpolation compared to constant brightness.
+ *
+ * active mode: the curve is the minimum brightness. the lights can be set brighter than the curve, and will stay there until the curve catches up. turning it off cancels it, like constant brightness.
+ * background mode: follows the curve until the user changes the brightness or state, after which it behaves like constant brightness.
+ */
+class SunriseMode : public ConstantBrightnessMode
+{
+public:
+  static constexpr uint8_t curveSegments = 4;
+
+private:
+  Interpolator<1> _curve[curveSegments];
+  uint8_t _segment = 0;       // the curve segment that was used last
+  bool _isCurveFinished = false;
+  duty_t _finalBrightness;
+
+  bool _isFollowingCurve = true;  // false when a background mode has been taken over by the user
+  bool _isAboveCurve = false;     // true when the user has set the brightness above the curve
+
+  /**
+   * @brief build the curve segments. segment k finishes at b0 + (b1 - b0)*((k+1)/curveSegments)^2
+   *
+   * @param startTimeUTC_uS
+   * @param window_uS
+   * @param initialB
+   * @param finalB
+   */
+  void _buildCurve(const uint64_t startTimeUTC_uS, const uint64_t window_uS, const duty_t initialB, const duty_t finalB){
+    const uint32_t range = finalB - initialB;
+    const uint32_t n2 = curveSegments * curveSegments;
+    uint64_t t0 = startTimeUTC_uS;
+    duty_t b0 = initialB;
+    for(uint8_t k = 1; k <= curveSegments; k++){
+      const uint64_t t1 = startTimeUTC_uS + (window_uS * k) / curveSegments;
+      const duty_t b1 = initialB + (range * k * k + n2/2) / n2;
+      _curve[k-1].newWindowInterpolation(t0, t1 - t0, b0, b1);
+      t0 = t1;
+      b0 = b1;
+    }
+    _segment = 0;
+  }
+
+  /**
+   * @brief finds the brightness of the curve at a given time. the segment index only moves forwards, so a time adjustment has to reset it
+   *
+   * @param utcTimestamp_uS
+   * @return duty_t
+   */
+  duty_t _findCurveValue(const uint64_t utcTimestamp_uS){
+    while(
+      (_segment < curveSegments - 1)
+      && (utcTimestamp_uS >= _curve[_segment].t1_uS)
+    ){
+      _segment++;
+    }
+    _isCurveFinished = (_segment == curveSegments - 1) && (utcTimestamp_uS >= _curve[_segment].t1_uS);
+    return _curve[_segment].interpolateValue(utcTimestamp_uS, 0);
+  }
+
+  /**
+   * @brief hand the brightness over to the user. the brightness interpolation starts from the current value, so there's no jump
+   *
+   * @param utcTimestamp_uS
+   * @param lightVals
+   */
+  void _leaveCurve(uint64_t utcTimestamp_uS, LightStateStruct& lightVals){
+    updateLightVals(utcTimestamp_uS, lightVals);
+    if(_isFollowingCurve && !_isAboveCurve){
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, lightVals.values[0], lightVals.values[0]);
+    }
+    if(isActive){_isAboveCurve = true;}
+    else{_isFollowingCurve = false;}
+  }
+
+public:
+  const ModeTypes type = ModeTypes::sunrise;
+
+  /**
+   * @brief Construct a new Sunrise Mode object
+   *
+   * @param currentTime_uS
+   * @param triggerTime_uS the end of the sunrise
+   * @param modeDataStruct
+   * @param previousInterp the interpolation state of the previous mode, which this one carries on from
+   * @param currentVals
+   * @param isActive
+   * @param configs
+   */
+  SunriseMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs
+  ) : SunriseMode(
+        currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs,
+        currentVals.state ? currentVals.values[0] : 0 // the base constructor changes currentVals
+      )
+  {};
+
+private:
+  SunriseMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs,
+    duty_t previousBrightness
+  ) : ConstantBrightnessMode(currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs)
+  {
+    uint64_t window_uS = static_cast<uint64_t>(modeData->time[0]) * 60 * secondsToMicros;
+    if(window_uS > triggerTime_uS){window_uS = triggerTime_uS;}
+    const uint64_t startTimeUTC_uS = triggerTime_uS - window_uS;
+
+    const duty_t initialB = _minOnBrightness;
+    _finalBrightness = modeData->maxBrightness > initialB ? modeData->maxBrightness : initialB;
+    _buildCurve(startTimeUTC_uS, window_uS, initialB, _finalBrightness);
+
+    _interp.colours.newWindowInterpolation(
+      startTimeUTC_uS, window_uS, modeData->startColourRatios, modeData->endColourRatios
+    );
+
+    // if the lights are already brighter than the curve, they stay there until the curve catches up
+    currentVals.state = true;
+    if(previousBrightness > _findCurveValue(currentTime_uS)){
+      _isAboveCurve = true;
+      _interp.newBrightnessVal_window(currentTime_uS, 0, previousBrightness, previousBrightness);
+    }
+    else{
+      _interp.newBrightnessVal_window(currentTime_uS, 0, _finalBrightness, _finalBrightness);
+    }
+    updateLightVals(currentTime_uS, currentVals);
+  };
+
+public:
+  void updateLightVals(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    if(!_isFollowingCurve){
+      ConstantBrightnessMode::updateLightVals(utcTimestamp_uS, lightVals);
+      return;
+    }
+
+    _interp.findNextValues(lightVals.values, utcTimestamp_uS);
+    const duty_t curveB = _findCurveValue(utcTimestamp_uS);
+    if(_isAboveCurve){
+      if(lightVals.values[0] > curveB){return;}
+      if(_interp.getTargetBrightness() > curveB){
+        // still on the way up
+        lightVals.values[0] = curveB;
+        return;
+      }
+      // the curve has caught up
+      _isAboveCurve = false;
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, _finalBrightness, _finalBrightness);
+    }
+    lightVals.values[0] = curveB;
+  }
+
+  duty_t setBrightness(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, duty_t brightness, bool softChange) override {
+    _leaveCurve(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::setBrightness(utcTimestamp_uS, lightVals, brightness, softChange);
+    return getTargetBrightness();
+  }
+
+  void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) override {
+    _leaveCurve(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::startBrightnessRamp(utcTimestamp_uS, lightVals, increasing, rampWindow_uS);
+  }
+
+  void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    updateLightVals(utcTimestamp_uS, lightVals);
+    // ramping down into the curve hands it back to the curve
+    if(_isFollowingCurve && !_isAboveCurve){return;}
+    ConstantBrightnessMode::stopBrightnessRamp(utcTimestamp_uS, lightVals);
+  }
+
+  bool setState(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool newState) override {
+    if(newState == lightVals.state){return false;}
+
+    if(isActive){
+      // hand over to the background mode
+      return true;
+    }
+
+    _leaveCurve(utcTimestamp_uS, lightVals);
+    return ConstantBrightnessMode::setState(utcTimestamp_uS, lightVals, newState);
+  }
+
+  bool startsFromCurrentVals() override {return false;}
+
+  bool isIdle() override {
+    return (_isCurveFinished || !_isFollowingCurve) && ConstantBrightnessMode::isIdle();
+  }
+
+  void timeAdjust(const TimeUpdateStruct& timeUpdates) override {
+    ConstantBrightnessMode::timeAdjust(timeUpdates);
+    for(uint8_t k = 0; k < curveSegments; k++){
+      _curve[k].notification(timeUpdates);
+    }
+    _segment = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef _SUNSET_MODE_H_
+#define _SUNSET_MODE_H_
+
+#include "modes.h"
+
+/**
+ * @brief the brightness dims at a constant rate (modeData->time[0], in seconds per step) until it reaches the target (modeData->maxBrightness). the colours change to endColourRatios over the soft change window.
+ *
+ * the dimming is a rate interpolation, so the lights go idle once the target has been reached. if the lights are off when it triggers, they stay off. turning them back on goes to the target brightness.
+ *
+ * active mode: the slope is the maximum brightness. the lights can be dimmed below the slope, and will stay there until the slope catches up.
+ * background mode: follows the slope until the user changes the brightness or state, after which it behaves like constant brightness.
+ */
+class SunsetMode : public ConstantBrightnessMode
+{
+private:
+  Interpolator<1> _slope;
+  duty_t _targetBrightness;
+
+  bool _isFollowingSlope = true;  // false when a background mode has been taken over by the user, or the slope has turned the lights off
+  bool _isBelowSlope = false;     // true when the user has set the brightness below the slope
+  bool _isSlopeFinished = false;
+
+  /**
+   * @brief hand the brightness over to the user. the brightness interpolation starts from the current value, so there's no jump
+   *
+   * @param utcTimestamp_uS
+   * @param lightVals
+   */
+  void _leaveSlope(uint64_t utcTimestamp_uS, LightStateStruct& lightVals){
+    updateLightVals(utcTimestamp_uS, lightVals);
+    if(_isFollowingSlope && !_isBelowSlope){
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, lightVals.values[0], lightVals.values[0]);
+    }
+    if(isActive && _isFollowingSlope){_isBelowSlope = true;}
+    else{_isFollowingSlope = false;}
+  }
+
+  SunsetMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs,
+    duty_t previousBrightness
+  ) : ConstantBrightnessMode(currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs)
+  {
+    _targetBrightness = modeData->maxBrightness;
+
+    // active modes get forced on by the constructor, so they start from wherever that put them
+    const duty_t initialB = isActive && (previousBrightness < _minOnBrightness)
+                            ? _interp.getTargetBrightness()
+                            : previousBrightness;
+
+    if(initialB < _minOnBrightness){
+      // lights are off and staying off
+      _isFollowingSlope = false;
+      currentVals.state = false;
+      _interp.newBrightnessVal_window(currentTime_uS, 0, _targetBrightness, _targetBrightness);
+      return;
+    }
+
+    // only ever dims
+    _slope.initialVals[0] = initialB;
+    _slope.targetVals[0] = initialB > _targetBrightness ? _targetBrightness : initialB;
+    _slope.newRateInterpolation(currentTime_uS, static_cast<uint64_t>(modeData->time[0]) * secondsToMicros);
+
+    _interp.newBrightnessVal_window(currentTime_uS, 0, _slope.targetVals[0], _slope.targetVals[0]);
+    updateLightVals(currentTime_uS, currentVals);
+  };
+
+public:
+  const ModeTypes type = ModeTypes::sunset;
+
+  /**
+   * @brief Construct a new Sunset Mode object
+   *
+   * @param currentTime_uS the start of the dimming
+   * @param triggerTime_uS
+   * @param modeDataStruct
+   * @param previousInterp the interpolation state of the previous mode, which this one carries on from
+   * @param currentVals
+   * @param isActive
+   * @param configs
+   */
+  SunsetMode(
+    uint64_t currentTime_uS,
+    uint64_t triggerTime_uS,
+    ModeDataStruct *modeDataStruct,
+    const ModeInterpolationClass<nChannels>& previousInterp,
+    LightStateStruct& currentVals,
+    bool isActive,
+    const ModalConfigsStruct& configs
+  ) : SunsetMode(
+        currentTime_uS, triggerTime_uS, modeDataStruct, previousInterp, currentVals, isActive, configs,
+        currentVals.state ? currentVals.values[0] : 0 // the base constructor changes currentVals
+      )
+  {};
+
+  void updateLightVals(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    if(!_isFollowingSlope){
+      ConstantBrightnessMode::updateLightVals(utcTimestamp_uS, lightVals);
+      return;
+    }
+
+    _interp.findNextValues(lightVals.values, utcTimestamp_uS);
+    duty_t slopeB;
+    _isSlopeFinished = _slope.findNextValues(&slopeB, utcTimestamp_uS);
+    if(_isBelowSlope){
+      if(lightVals.values[0] < slopeB){return;}
+      if(_interp.getTargetBrightness() < slopeB){
+        // still on the way down
+        lightVals.values[0] = slopeB;
+        return;
+      }
+      // the slope has caught up
+      _isBelowSlope = false;
+      _interp.newBrightnessVal_window(utcTimestamp_uS, 0, _slope.targetVals[0], _slope.targetVals[0]);
+    }
+    lightVals.values[0] = slopeB;
+
+    if(slopeB < _minOnBrightness){
+      // the sunset has turned the lights off
+      _isFollowingSlope = false;
+      lightVals.state = false;
+      _interp.setTargetBrightness(0);
+      _interp.endInterpolation(lightVals.values);
+    }
+  }
+
+  duty_t setBrightness(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, duty_t brightness, bool softChange) override {
+    _leaveSlope(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::setBrightness(utcTimestamp_uS, lightVals, brightness, softChange);
+    return getTargetBrightness();
+  }
+
+  void startBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool increasing, uint64_t rampWindow_uS) override {
+    _leaveSlope(utcTimestamp_uS, lightVals);
+    ConstantBrightnessMode::startBrightnessRamp(utcTimestamp_uS, lightVals, increasing, rampWindow_uS);
+  }
+
+  void stopBrightnessRamp(uint64_t utcTimestamp_uS, LightStateStruct& lightVals) override {
+    updateLightVals(utcTimestamp_uS, lightVals);
+    // ramping up into the slope hands it back to the slope
+    if(_isFollowingSlope && !_isBelowSlope){return;}
+    ConstantBrightnessMode::stopBrightnessRamp(utcTimestamp_uS, lightVals);
+  }
+
+  bool setState(uint64_t utcTimestamp_uS, LightStateStruct& lightVals, bool newState) override {
+    if(newState == lightVals.state){return false;}
+    if(isActive){return true;}
+
+    _leaveSlope(utcTimestamp_uS, lightVals);
+    if(!newState || (_targetBrightness < _minOnBrightness)){
+      return ConstantBrightnessMode::setState(utcTimestamp_uS, lightVals, newState);
+    }
+
+    // turning on goes to the target brightness
+    lightVals.state = true;
+    _interp.newBrightnessVal_window(utcTimestamp_uS, _softChangeWindow_S*secondsToMicros, _minOnBrightness, _targetBrightness);
+    updateLightVals(utcTimestamp_uS, lightVals);
+    return false;
+  }
+
+  bool isIdle() override {
+    return (_isSlopeFinished || !_isFollowingSlope) && ConstantBrightnessMode::isIdle();
+  }
+
+  void timeAdjust(const TimeUpdateStruct& timeUpdates) override {
+    ConstantBrightnessMode::timeAdjust(timeUpdates);
+    _slope.notification(timeUpdates);
+  }
+};
+
+#endif
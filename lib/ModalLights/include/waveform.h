@@ -0,0 +1,183 @@
+#ifndef _WAVEFORM_H_
+#define _WAVEFORM_H_
+
+#include <Arduino.h>
+
+enum class WaveShapes : uint8_t {
+  sine = 0,     // raised cosine, i.e. starts at 0 and peaks half way through the period
+  triangle = 1
+};
+
+// one period of a raised cosine, 0 at the start and 255 half way
+static const uint8_t waveformSineTable[256] = {
+  0, 0, 0, 0, 1, 1, 1, 2, 2, 3, 4, 5, 5, 6, 7, 9,
+  10, 11, 12, 14, 15, 17, 18, 20, 21, 23, 25, 27, 29, 31, 33, 35,
+  37, 40, 42, 44, 47, 49, 52, 54, 57, 59, 62, 65, 67, 70, 73, 76,
+  79, 82, 85, 88, 90, 93, 97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+  127, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+  176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+  245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+  218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+  176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+  128, 124, 121, 118, 115, 112, 109, 106, 103, 100, 97, 93, 90, 88, 85, 82,
+  79, 76, 73, 70, 67, 65, 62, 59, 57, 54, 52, 49, 47, 44, 42, 40,
+  37, 35, 33, 31, 29, 27, 25, 23, 21, 20, 18, 17, 15, 14, 12, 11,
+  10, 9, 7, 6, 5, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0,
+};
+
+/**
+ * @brief a phase accumulator that turns time into a waveform between 0 and 255.
+ *
+ * the phase is a uint64_t where 2^64 is one whole period, so it wraps around for free. the increment is the phase per microsecond, and gets swept linearly for a chirp. update() is a couple of multiplies, a table lookup and some shifts; the divides all happen in start() and startSweep().
+ */
+class Waveform {
+  private:
+    uint64_t _phase = 0;
+    uint64_t _increment = 0;      // phase per uS, i.e. 2^64/period_uS
+    WaveShapes _shape = WaveShapes::sine;
+    uint64_t _previousTime_uS = 0;
+
+    // chirp
+    bool _isSweeping = false;
+    int64_t _sweep = 0;           // change in _increment per uS
+    uint64_t _finalIncrement = 0;
+    uint64_t _sweepEndTime_uS = 0;
+    uint64_t _progress = 0;       // how far through the sweep, where 2^64 is the end
+    uint64_t _progressRate = 0;   // _progress per uS
+
+    /**
+     * @brief advance the sweep by dt_uS. the phase uses the average increment across dt_uS, which is exact for a linear sweep
+     *
+     * @param dt_uS
+     */
+    void _advanceSweep(const uint64_t dt_uS){
+      const uint64_t nextIncrement = _increment + static_cast<uint64_t>(_sweep) * dt_uS;
+      _phase += ((_increment >> 1) + (nextIncrement >> 1)) * dt_uS;
+      _increment = nextIncrement;
+      _progress += _progressRate * dt_uS;
+    }
+
+  public:
+    Waveform(){};
+
+    /**
+     * @brief convert a period into a phase increment
+     *
+     * @param period_uS
+     * @return uint64_t 2^64/period_uS. 0 if period_uS is 0
+     */
+    static uint64_t periodToIncrement(const uint64_t period_uS){
+      if(period_uS <= 1){return period_uS == 0 ? 0 : ~0ULL;}
+      return (~0ULL / period_uS) + 1;
+    }
+
+    /**
+     * @brief start a waveform with a constant period. the phase is 0 at startTime_uS
+     *
+     * @param startTime_uS
+     * @param period_uS 0 holds the waveform at 0
+     * @param shape
+     */
+    void start(const uint64_t startTime_uS, const uint64_t period_uS, const WaveShapes shape){
+      _phase = 0;
+      _increment = periodToIncrement(period_uS);
+      _shape = shape;
+      _previousTime_uS = startTime_uS;
+      _isSweeping = false;
+      _progress = ~0ULL;
+    }
+
+    /**
+     * @brief start a waveform whose frequency sweeps linearly from 1/initialPeriod_uS to 1/finalPeriod_uS over sweepWindow_uS, then stays at the final period
+     *
+     * @param startTime_uS
+     * @param initialPeriod_uS
+     * @param finalPeriod_uS
+     * @param sweepWindow_uS
+     * @param shape
+     */
+    void startSweep(const uint64_t startTime_uS, const uint64_t initialPeriod_uS, const uint64_t finalPeriod_uS, const uint64_t sweepWindow_uS, const WaveShapes shape){
+      start(startTime_uS, initialPeriod_uS, shape);
+      _finalIncrement = periodToIncrement(finalPeriod_uS);
+      if(sweepWindow_uS == 0){
+        _increment = _finalIncrement;
+        return;
+      }
+      _isSweeping = true;
+      _sweepEndTime_uS = startTime_uS + sweepWindow_uS;
+      const int64_t change = static_cast<int64_t>(_finalIncrement - _increment);
+      _sweep = change / static_cast<int64_t>(sweepWindow_uS);
+      _progress = 0;
+      _progressRate = periodToIncrement(sweepWindow_uS);
+    }
+
+    /**
+     * @brief advance the phase to time_uS and get the value. time going backwards is ignored; use adjustTime() for clock changes
+     *
+     * @param time_uS
+     * @return uint8_t
+     */
+    uint8_t update(const uint64_t time_uS){
+      if(time_uS <= _previousTime_uS){return value();}
+      uint64_t dt_uS = time_uS - _previousTime_uS;
+      _previousTime_uS = time_uS;
+
+      if(_isSweeping){
+        if(time_uS < _sweepEndTime_uS){
+          _advanceSweep(dt_uS);
+          return value();
+        }
+        // finish the sweep, then carry on at the final period
+        const uint64_t afterSweep_uS = time_uS - _sweepEndTime_uS;
+        _advanceSweep(dt_uS - afterSweep_uS);
+        _isSweeping = false;
+        _increment = _finalIncrement;
+        _progress = ~0ULL;
+        dt_uS = afterSweep_uS;
+      }
+      _phase += _increment * dt_uS;
+      return value();
+    }
+
+    /**
+     * @brief the value at the current phase
+     *
+     * @return uint8_t
+     */
+    uint8_t value() const {
+      if(_shape == WaveShapes::triangle){
+        const uint32_t phase = _phase >> 32;
+        return (phase & 0x80000000) ? (~phase) >> 23 : phase >> 23;
+      }
+      // interpolate between the table entries using the next 8 bits of phase
+      const uint8_t index = _phase >> 56;
+      const int16_t fraction = (_phase >> 48) & 0xFF;
+      const int16_t a = waveformSineTable[index];
+      const int16_t b = waveformSineTable[static_cast<uint8_t>(index + 1)];
+      return a + (((b - a) * fraction) >> 8);
+    }
+
+    /**
+     * @brief how far through the sweep the waveform is
+     *
+     * @return uint8_t 0 at the start, 255 at the end. always 255 if there isn't a sweep
+     */
+    uint8_t getSweepProgress() const {return _progress >> 56;}
+
+    /**
+     * @brief the current phase, where 2^32 is a whole period
+     *
+     * @return uint32_t
+     */
+    uint32_t getPhase() const {return _phase >> 32;}
+
+    void adjustTime(const int64_t& utcTimeChange_uS){
+      _previousTime_uS += utcTimeChange_uS;
+      _sweepEndTime_uS += utcTimeChange_uS;
+    }
+};
+
+#endif
@@ -5,7 +5,10 @@
 #include <memory>
 
 #include "DeviceTime.h"
+#include "GestureEngine.hpp"
 #include "ModalLights.h"
+#include "buttonEdgeQueue.h"
+#include "profiler.h"
 
 /*
 TODO: how do I put this into config manager without hardcoding config manager?
@@ -22,201 +25,79 @@ enum class PressStates : uint8_t {
   longPress = 2
 };
 
-enum class ButtonStatus : uint8_t {
-  // currentStatus = 0; previousStatus = 0
-  inactive = 0,
-  // currentStatus = 0; previousStatus = 1
-  fallingEdge = 1,
-  // currentStatus = 1; previousStatus = 0
-  risingEdge = 2,
-  // currentStatus = 1; previousStatus = 1
-  active = 3
-};
-
 namespace {
-  struct ShortPressParams{
-    uint64_t endTimeUTC_uS;
-
-    void reset(){
-      endTimeUTC_uS = 0;
-    };
+  enum OneButtonGestures : gestureID_t {
+    buttonTap = 1,
+    buttonHold
   };
 
-  struct LongPressParams{
-    private:
-    Interpolator<1> _interp;  // TODO: refactor interpolation class to get a 1D interpolator
-    public:
-    bool direction = false;
-    duty_t cumAdj;
-
-    void initInterp(uint64_t startTimeUTC_uS, OneButtonConfigs& configs){
-      _interp.newWindowInterpolation(
-        startTimeUTC_uS, configs.longPressWindow_mS*1000,
-        1, 255
-      );
-    }
-
-    duty_t getAdjustment(const uint64_t& currentTime_uS){
-      // TODO: use single value interpolation instance
-      duty_t newCumAdj = _interp.interpolateValue(currentTime_uS, 0);
-      duty_t adj = newCumAdj - cumAdj;
-      cumAdj = newCumAdj;
-      return adj;
-    }
-
-    /**
-     * @brief sets the interpolation to always return 0, until it's reset
-     * 
-     */
-    void reset(){
-      _interp.t0_uS = 0;
-      _interp.t1_uS = 0;
-      _interp.initialVals[0] = 0;
-      _interp.targetVals[0] = 0;
-      cumAdj = 0;
-    }
+  const GestureDefinition oneButtonGestures[] = {
+    {buttonTap, 0b1, 1},
+    {buttonHold, 0b1, 0}
   };
 }
 
 /**
  * @brief A class for a single button physical interface. All it needs is a getCurrentStatus() and it'll be good to go!
- * Contains a state machine to distinguish between short and long presses. Releasing a short press will call modalLights->toggleState(). Holding a long press will adjust modal lights by {0, 255} interpolated across the window in the configs. The adjustment direction is up if brightness level == 0, down if brightness level == 255, or the oposite to the previous direction.
+ * The press is fed into a one input GestureEngine, which tells taps from holds. A tap calls modalLights->toggleState(). A hold starts a brightness ramp in modal lights that takes the window in the configs to cross {0, 255}, and releasing it stops the ramp. The adjustment direction is up if brightness level == 0, down if brightness level == 255, or the oposite to the previous direction.
  * 
  */
 class OneButtonInterface {
   protected:
     bool _previousStatus = false;  // press state during previous update() call
-    PressStates _buttonState = PressStates::none;
-
-    ShortPressParams _shortPress;
-    LongPressParams _longPress;
+    uint64_t _lastEdgeTime_uS = 0;  // monotonic time of the previous processEdges() call. edges can't be processed before it
+    bool _isHeld = false;          // true while the brightness ramp is running
+    bool _rampDirection = false;
 
     OneButtonConfigs _configs;
 
+    GestureEngine<1, sizeof(oneButtonGestures)/sizeof(GestureDefinition)> _gestures{
+      oneButtonGestures,
+      GestureConfigs{.holdTime_mS = _configs.timeUntilLongPress_mS}
+    };
+
     std::shared_ptr<DeviceTimeClass> _deviceTime;
     std::shared_ptr<ModalLightsInterface> _modalLights;
 
-    void _enterState_none(){
-      _previousStatus = false;
-      _buttonState = PressStates::none;
-      _shortPress.reset();
-      _longPress.reset();
-    }
-    
-    void _enterState_shortPress(){
-      _shortPress.endTimeUTC_uS = _deviceTime->getUTCTimestampMicros() + (_configs.timeUntilLongPress_mS * 1000);
-      _longPress.reset();
-      _buttonState = PressStates::shortPress;
-    }
-
-    void _enterState_longPress(){
-      // set adjustment direction
-      {
-        const duty_t currentBrightness = _modalLights->getBrightnessLevel();
+    void _startRamp(const GestureEvent& event){
+      const duty_t currentBrightness = _modalLights->getBrightnessLevel();
 
-        /*
-        equivalent to:
+      /*
+      equivalent to:
 
-        if(currentBrightness == 0){
-          _longPress.direction = true;
-        }
-        else if(currentBrightness == 255){
-          _longPress.direction = false;
-        }
-        else{
-          _longPress.direction = !_longPress.direction;
-        }
-        */
-        _longPress.direction = (
-          currentBrightness == 0 ||
-          !(currentBrightness == 255 || _longPress.direction)
-        );
+      if(currentBrightness == 0){
+        _rampDirection = true;
       }
-      _buttonState = PressStates::longPress;
-      _longPress.initInterp(_shortPress.endTimeUTC_uS, _configs);
-      _shortPress.reset();
-      _updateState_longPress(ButtonStatus::active);
-    }
-
-
-    void _updateState_none(const ButtonStatus status){
-      switch(status)
-      {
-      case ButtonStatus::inactive:
-        return;
-      case ButtonStatus::fallingEdge:
-        // this shouldn't have happened, so default to none
-        break;
-      case ButtonStatus::risingEdge:
-        _enterState_shortPress();
-        return;
-      case ButtonStatus::active:
-        // this shouldn't happen, but enter short press anyway
-        _enterState_shortPress();
-        return;
-      default:
-        // this should be inaccessible, but default to none state
-        break;
+      else if(currentBrightness == 255){
+        _rampDirection = false;
       }
-      _enterState_none();
-    }
-
-    void _updateState_shortPress(const ButtonStatus status){
-      switch(status)
-      {
-      case ButtonStatus::inactive:
-        // shouldn't happen 
-        break;
-      case ButtonStatus::fallingEdge:
-        _modalLights->toggleState();
-        _enterState_none();
-        return;
-      case ButtonStatus::risingEdge:
-        // shouldn't happen, but re-enter shortPress
-        _enterState_shortPress();
-        return;
-      case ButtonStatus::active:
-        if(_shortPress.endTimeUTC_uS == 0){
-          // if endTime hasn't been set, re-enter the state legally
-          _enterState_shortPress();
-          return;
-        }
-        if(
-          _shortPress.endTimeUTC_uS <= _deviceTime->getUTCTimestampMicros()
-        ){
-          _enterState_longPress();
-        }
-        return;
-      default:
-        // this should be inaccessible, but default to none state
-        break;
+      else{
+        _rampDirection = !_rampDirection;
       }
-      _enterState_none();
+      */
+      _rampDirection = (
+        currentBrightness == 0 ||
+        !(currentBrightness == 255 || _rampDirection)
+      );
+      _isHeld = true;
+      // the ramp starts when the press became long, not when it was noticed
+      _modalLights->startBrightnessRamp(_rampDirection, _configs.longPressWindow_mS, event.pressStart_uS + (_configs.timeUntilLongPress_mS * 1000));
     }
 
-    void _updateState_longPress(const ButtonStatus status){
-      
-      duty_t adj = _longPress.getAdjustment(_deviceTime->getUTCTimestampMicros());
-      switch(status)
+    void _handleGesture(const GestureEvent& event){
+      switch(event.phase)
       {
-      case ButtonStatus::inactive:
-        // shouldn't happen
-        _enterState_none();
-        return;
-      case ButtonStatus::fallingEdge:
-        _modalLights->adjustBrightness(adj, _longPress.direction);
-        _enterState_none();
+      case GesturePhases::tap:
+        _modalLights->toggleState();
         return;
-      case ButtonStatus::risingEdge:
-        // shouldn't happen, but enter state shortPress
-        _enterState_shortPress();
+      case GesturePhases::holdStart:
+        _startRamp(event);
         return;
-      case ButtonStatus::active:
-        _modalLights->adjustBrightness(adj, _longPress.direction);
+      case GesturePhases::holdEnd:
+        _modalLights->stopBrightnessRamp(event.time_uS);
+        _isHeld = false;
         return;
       default:
-        _enterState_none();
-        // this should be inaccessible, but default to none state
         return;
       }
     }
@@ -237,30 +118,70 @@ class OneButtonInterface {
      */
     virtual bool getCurrentStatus() = 0;
 
-    PressStates getFSMState(){return _buttonState;}
+    PressStates getFSMState(){
+      if(_isHeld){return PressStates::longPress;}
+      return _gestures.isIdle() ? PressStates::none : PressStates::shortPress;
+    }
     
     /**
-     * @brief check the button status, update the state machine, and update modalLights
+     * @brief check the button status, update the gesture engine, and update modalLights
      * 
      */
-    void update(){
-      bool currentStatus = getCurrentStatus();
+    virtual void update(){
+      _update(getCurrentStatus(), _deviceTime->getUTCTimestampMicros());
+    }
 
-      const ButtonStatus status = static_cast<ButtonStatus>((currentStatus<<1)|_previousStatus);
-      _previousStatus = currentStatus;
+    /**
+     * @brief true if the button isn't being pressed, so nothing needs updating until the next edge
+     * 
+     */
+    bool isIdle(){return _gestures.isIdle();}
 
-      switch (_buttonState)
-      {
-      case PressStates::shortPress:
-        _updateState_shortPress(status);
-        break;
-      case PressStates::longPress:
-        _updateState_longPress(status);
-        break;
-      default:
-        _updateState_none(status);
-        break;
-      };
+    /**
+     * @brief run the gesture engine on every queued edge, using the time the edge happened instead of the time it's processed. long presses get updated afterwards if the button is still held
+     * 
+     * @param edges 
+     * @param monotonicNow_uS the current time of the clock that timestamped the edges
+     */
+    template<uint8_t SIZE>
+    void processEdges(ButtonEdgeQueue<SIZE>& edges, const uint64_t monotonicNow_uS){
+      const uint64_t utcNow_uS = _deviceTime->getUTCTimestampMicros();
+      ButtonEdge edge;
+      while(edges.pop(edge)){
+        // an edge can land after the previous call read the time, but time can't go backwards or the long press adjustment would underflow
+        const uint64_t edgeTime_uS = edge.timestamp_uS < _lastEdgeTime_uS ? _lastEdgeTime_uS : edge.timestamp_uS;
+        // the edge timestamps aren't UTC, so use their age instead
+        const uint64_t age_uS = monotonicNow_uS > edgeTime_uS ? monotonicNow_uS - edgeTime_uS : 0;
+        _update(edge.isPressed, utcNow_uS - age_uS);
+      }
+      _lastEdgeTime_uS = monotonicNow_uS;
+      if(edges.checkAndClearOverflow()){
+        // edges were lost, so the press can't be trusted
+        if(_isHeld){_modalLights->stopBrightnessRamp(utcNow_uS);}
+        _isHeld = false;
+        _previousStatus = false;
+        _gestures.reset();
+        return;
+      }
+      if(!isIdle()){
+        _update(_previousStatus, utcNow_uS);
+      }
+    }
+
+  protected:
+    /**
+     * @brief update the gesture engine, and act on anything it recognised
+     * 
+     * @param currentStatus true if the button is pressed
+     * @param timeUTC_uS the time of the status
+     */
+    void _update(const bool currentStatus, const uint64_t timeUTC_uS){
+      PROFILE_SCOPE(buttonUpdate);
+      _previousStatus = currentStatus;
+      const uint8_t nEvents = _gestures.update(currentStatus, timeUTC_uS);
+      for(uint8_t i = 0; i < nEvents; i++){
+        _handleGesture(_gestures.getEvent(i));
+      }
     }
 };
 
@@ -0,0 +1,26 @@
+#ifndef __BUTTON_EDGE_QUEUE_H__
+#define __BUTTON_EDGE_QUEUE_H__
+
+#include <Arduino.h>
+
+#include "spscQueue.h"
+
+/**
+ * @brief a change in button status, timestamped by the ISR
+ *
+ */
+struct ButtonEdge {
+  uint64_t timestamp_uS = 0;  // monotonic time of the edge, i.e. esp_timer_get_time(). not UTC, because DeviceTime isn't ISR safe
+  bool isPressed = false;     // true for a rising edge
+};
+
+/**
+ * @brief lock-free single-producer single-consumer queue of button edges. the ISR pushes, the main loop pops.
+ * the size must be a power of 2 that's no bigger than 128
+ *
+ * @tparam SIZE
+ */
+template<uint8_t SIZE = 8>
+using ButtonEdgeQueue = SPSCQueue<ButtonEdge, SIZE>;
+
+#endif
@@ -1,4 +1,6 @@
 /*
+for printing variables while debugging native tests. for timing things on the device, use lib/Trace instead.
+
 to use, open a pio terminal and paste:
 pio test -e native -f "*{test_fileName}*" -v
 (don't add the file type)
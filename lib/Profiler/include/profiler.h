@@ -0,0 +1,137 @@
+/**
+ * notes:
+ *  - cycle-counting profiler for hot paths, for when there isn't an oscilloscope and a spare pin to hand (see documents/polling.md)
+ *  - everything is compiled out unless esp32_lights_profile is defined, the same as lib/Trace
+ *  - cycles come from CCOUNT on the esp32 (Xtensa), rdtsc on x86, and steady_clock nanoseconds anywhere else
+ *  - CCOUNT is per-core and 32 bits, so a region has to start and end on the same core, and take less than 2^32 cycles (~17 seconds at 240 MHz)
+ *  - the stats table is a fixed array indexed by ProfileRegions, so there's no heap use. it isn't atomic, so each region should only be profiled from one task
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <Arduino.h>
+
+#if !defined(__XTENSA__) && (defined(__x86_64__) || defined(__i386__))
+  #include <x86intrin.h>
+#endif
+
+/**
+ * @brief the profiled regions. add new ones before count, and give them a name in profiler.cpp
+ */
+enum class ProfileRegions : uint8_t {
+  updateLights,             // ModalLightsController::updateLights()
+  writeLights,              // ModalLightsController::_writeLights()
+  modeChange,               // ModalLightsController::_changeMode()
+  activeSupervisorCheck,    // ActiveEventSupervisor::check()
+  backgroundSupervisorCheck,// BackgroundEventSupervisor::check()
+  buttonUpdate,             // OneButtonInterface::_update()
+  count
+};
+
+struct ProfileStatsStruct {
+  uint32_t count = 0;
+  uint64_t totalCycles = 0;
+  uint32_t minCycles = UINT32_MAX;
+  uint32_t maxCycles = 0;
+
+  void record(const uint32_t cycles){
+    count++;
+    totalCycles += cycles;
+    if(cycles < minCycles){minCycles = cycles;}
+    if(cycles > maxCycles){maxCycles = cycles;}
+  }
+
+  uint32_t getMeanCycles() const {return count == 0 ? 0 : totalCycles / count;}
+};
+
+/**
+ * @brief nanoseconds from steady_clock, for when there's no cycle counter
+ *
+ * @return uint64_t
+ */
+uint64_t profilerFallbackCycles();
+
+/**
+ * @brief the current cycle count. only differences mean anything
+ *
+ * @return uint32_t
+ */
+inline uint32_t profilerCycles(){
+  #if defined(__XTENSA__)
+    uint32_t ccount;
+    asm volatile("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+  #elif defined(__x86_64__) || defined(__i386__)
+    return static_cast<uint32_t>(__rdtsc());
+  #else
+    return static_cast<uint32_t>(profilerFallbackCycles());
+  #endif
+}
+
+/**
+ * @brief how many cycles there are in a microsecond. on x86 the tsc gets measured against steady_clock the first time this is called, which takes a couple of milliseconds
+ *
+ * @return uint32_t
+ */
+uint32_t profilerCyclesPerMicro();
+
+/**
+ * @brief add a measurement to a region. use the macros instead, so that it gets compiled out
+ *
+ * @param region
+ * @param cycles
+ */
+void profileRecord(ProfileRegions region, uint32_t cycles);
+
+/**
+ * @brief the stats for a region
+ *
+ * @param region
+ * @return const ProfileStatsStruct&
+ */
+const ProfileStatsStruct& getProfileStats(ProfileRegions region);
+
+void profileReset();
+
+/**
+ * @brief write the stats as text lines. the format is:
+ *
+ * profile begin <cycles per uS>
+ * region <name> <count> <min cycles> <mean cycles> <max cycles>
+ * ...
+ * profile end
+ *
+ * regions that haven't been entered are skipped
+ *
+ * @param writeLine gets called once per line, without a newline
+ */
+void profileReport(void (*writeLine)(const char* line));
+
+/**
+ * @brief counts the cycles between being constructed and going out of scope
+ */
+class ScopedProfile {
+  private:
+    const ProfileRegions _region;
+    const uint32_t _start;
+
+  public:
+    ScopedProfile(const ProfileRegions region) : _region(region), _start(profilerCycles()){}
+
+    ~ScopedProfile(){
+      profileRecord(_region, profilerCycles() - _start);
+    }
+};
+
+#ifdef esp32_lights_profile
+  #define _PROFILE_CONCAT(a, b) a##b
+  #define _PROFILE_SCOPE_NAME(line) _PROFILE_CONCAT(_profileScope_, line)
+
+  // profile the rest of the current scope
+  #define PROFILE_SCOPE(region) ScopedProfile _PROFILE_SCOPE_NAME(__LINE__)(ProfileRegions::region)
+#else
+  #define PROFILE_SCOPE(region)
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+// chrono needs to be included before ProjectDefines gets anywhere near it, because of the max macro
+#include <chrono>
+
+#include "profiler.h"
+
+#include <stdio.h>
+
+namespace {
+  ProfileStatsStruct _profileStats[static_cast<uint8_t>(ProfileRegions::count)];
+
+  const char* _regionNames[] = {
+    "updateLights",
+    "writeLights",
+    "modeChange",
+    "activeSupervisorCheck",
+    "backgroundSupervisorCheck",
+    "buttonUpdate"
+  };
+  static_assert(sizeof(_regionNames) / sizeof(_regionNames[0]) == static_cast<uint8_t>(ProfileRegions::count), "every region needs a name");
+
+  uint64_t _steadyClock_nS(){
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+}
+
+uint64_t profilerFallbackCycles(){
+  return _steadyClock_nS();
+}
+
+uint32_t profilerCyclesPerMicro(){
+  #if defined(__XTENSA__)
+    return getCpuFrequencyMhz();
+  #elif defined(__x86_64__) || defined(__i386__)
+    static uint32_t cyclesPerMicro = 0;
+    if(cyclesPerMicro == 0){
+      const uint64_t startTime_nS = _steadyClock_nS();
+      const uint64_t startCycles = __rdtsc();
+      while(_steadyClock_nS() - startTime_nS < 2000000){}
+      const uint64_t cycles = __rdtsc() - startCycles;
+      const uint64_t elapsed_nS = _steadyClock_nS() - startTime_nS;
+      cyclesPerMicro = (cycles * 1000 + elapsed_nS/2) / elapsed_nS;
+      if(cyclesPerMicro == 0){cyclesPerMicro = 1;}
+    }
+    return cyclesPerMicro;
+  #else
+    return 1000;
+  #endif
+}
+
+void profileRecord(ProfileRegions region, uint32_t cycles){
+  _profileStats[static_cast<uint8_t>(region)].record(cycles);
+}
+
+const ProfileStatsStruct& getProfileStats(ProfileRegions region){
+  return _profileStats[static_cast<uint8_t>(region)];
+}
+
+void profileReset(){
+  for(ProfileStatsStruct& stats : _profileStats){
+    stats = ProfileStatsStruct();
+  }
+}
+
+void profileReport(void (*writeLine)(const char* line)){
+  char line[80];
+  snprintf(line, sizeof(line), "profile begin %lu", static_cast<unsigned long>(profilerCyclesPerMicro()));
+  writeLine(line);
+  for(uint8_t r = 0; r < static_cast<uint8_t>(ProfileRegions::count); r++){
+    const ProfileStatsStruct& stats = _profileStats[r];
+    if(stats.count == 0){continue;}
+    snprintf(line, sizeof(line), "region %s %lu %lu %lu %lu",
+      _regionNames[r],
+      static_cast<unsigned long>(stats.count),
+      static_cast<unsigned long>(stats.minCycles),
+      static_cast<unsigned long>(stats.getMeanCycles()),
+      static_cast<unsigned long>(stats.maxCycles)
+    );
+    writeLine(line);
+  }
+  writeLine("profile end");
+}
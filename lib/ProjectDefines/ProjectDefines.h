@@ -40,6 +40,42 @@ struct TimeUpdateStruct{
   uint64_t currentLocalTime_uS;
 };
 
+/**
+ * @brief when a DST transition happens, in the style of POSIX TZ rules. i.e. the UK starts DST at 1am on the last Sunday of March = {3, 5, 7, 1*60*60}
+ *
+ */
+struct DSTRuleStruct {
+  uint8_t month = 0;          // from 1 to 12. 0 means there's no rule
+  uint8_t week = 0;           // from 1 to 5, where 5 is the last week of the month
+  uint8_t dayOfWeek = 7;      // from 1 (Monday) to 7 (Sunday)
+  uint32_t timeOfDay_S = 0;   // local time of the transition, in the offset that's in effect before it
+
+  bool operator==(const DSTRuleStruct& other) const {
+    return month == other.month
+      && week == other.week
+      && dayOfWeek == other.dayOfWeek
+      && timeOfDay_S == other.timeOfDay_S;
+  }
+  bool operator!=(const DSTRuleStruct& other) const {return !(*this == other);}
+};
+
+/**
+ * @brief the DST schedule for the configured zone. if DST is 0, DeviceTime uses the static DST from RTCConfigsStruct instead
+ *
+ */
+struct DSTRulesStruct {
+  DSTRuleStruct start;
+  DSTRuleStruct end;
+  uint16_t DST = 0;           // offset in seconds while DST is active
+
+  bool operator==(const DSTRulesStruct& other) const {
+    return start == other.start
+      && end == other.end
+      && DST == other.DST;
+  }
+  bool operator!=(const DSTRulesStruct& other) const {return !(*this == other);}
+};
+
 /* EventManager */
 #ifndef MAX_NUMBER_OF_EVENTS
 #define MAX_NUMBER_OF_EVENTS (size_t)100
@@ -53,6 +89,11 @@ typedef uint8_t eventUUID;
 
 struct EventManagerConfigsStruct {
   uint32_t defaultEventWindow_S = hardwareDefaultEventWindow;
+
+  bool operator==(const EventManagerConfigsStruct& other) const {
+    return defaultEventWindow_S == other.defaultEventWindow_S;
+  }
+  bool operator!=(const EventManagerConfigsStruct& other) const {return !(*this == other);}
 };
 
 // the data packet that gets recieved from the network and loaded from storage
@@ -79,4 +120,9 @@ typedef etl::flat_map<modeUUID, nModes_t, MAX_NUMBER_OF_MODES> storedModeIDsMap_
   #define DataPreloadChunkSize 5
 #endif
 
+// the biggest chunk the storage iterator will read, if the storage HAL prefers bigger transfers. the iterator keeps two chunks
+#ifndef DataPreloadMaxChunkSize
+  #define DataPreloadMaxChunkSize 12
+#endif
+
 # endif
\ No newline at end of file
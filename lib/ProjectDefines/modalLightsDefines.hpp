@@ -7,6 +7,14 @@
 
 typedef uint8_t modeUUID;
 
+#ifndef DEFAULT_MODE_ID
+  #define DEFAULT_MODE_ID 1
+#endif
+
+// the default constant brightness mode. it always exists, so it never needs loading from storage
+constexpr modeUUID defaultModeID = DEFAULT_MODE_ID;
+static_assert(defaultModeID != 0, "mode ID 0 means no mode");
+
 struct CurrentModeStruct {
   modeUUID activeMode;
   modeUUID backgroundMode;
@@ -16,6 +24,13 @@ struct ModalConfigsStruct {
   duty_t minOnBrightness = 1;       // the absolute minimum brightness when state == on
   uint8_t softChangeWindow = 1;   // 1 second change for sudden brightness changes
   duty_t defaultOnBrightness = 0; // for decorative lights, you might want them to always switch on to max. will get ignored by some modes
+
+  bool operator==(const ModalConfigsStruct& other) const {
+    return minOnBrightness == other.minOnBrightness
+      && softChangeWindow == other.softChangeWindow
+      && defaultOnBrightness == other.defaultOnBrightness;
+  }
+  bool operator!=(const ModalConfigsStruct& other) const {return !(*this == other);}
 };
 
 enum class ModeTypes : uint8_t {
@@ -77,6 +92,80 @@ void static serializeModeDataStruct(ModeDataStruct dataStruct, uint8_t buffer[mo
       i++;
       break;
 
+    case ModeTypes::sunrise:
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.endColourRatios[c];
+        i++;
+      }
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.startColourRatios[c];
+        i++;
+      }
+      buffer[i] = dataStruct.maxBrightness;
+      i++;
+      buffer[i] = dataStruct.time[0];
+      i++;
+      break;
+
+    case ModeTypes::sunset:
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.endColourRatios[c];
+        i++;
+      }
+      buffer[i] = dataStruct.maxBrightness;
+      i++;
+      buffer[i] = dataStruct.time[0];
+      i++;
+      break;
+
+    case ModeTypes::pulse:
+    case ModeTypes::chirp:
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.endColourRatios[c];
+        i++;
+      }
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.startColourRatios[c];
+        i++;
+      }
+      buffer[i] = dataStruct.maxBrightness;
+      i++;
+      buffer[i] = dataStruct.minBrightness;
+      i++;
+      if(dataStruct.type == ModeTypes::pulse){
+        buffer[i] = dataStruct.time[0];
+        i++;
+        break;
+      }
+      buffer[i] = dataStruct.finalMaxBrightness;
+      i++;
+      buffer[i] = dataStruct.finalMinBrightness;
+      i++;
+      for(uint8_t t = 0; t < 3; t++){
+        buffer[i] = dataStruct.time[t];
+        i++;
+      }
+      break;
+
+    case ModeTypes::changing:
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.endColourRatios[c];
+        i++;
+      }
+      for(uint8_t c = 0; c < nChannels; c++){
+        buffer[i] = dataStruct.startColourRatios[c];
+        i++;
+      }
+      buffer[i] = dataStruct.maxBrightness;
+      i++;
+      buffer[i] = dataStruct.minBrightness;
+      i++;
+      buffer[i] = dataStruct.time[0];
+      i++;
+      buffer[i] = dataStruct.time[1];
+      i++;
+      break;
+
     default:
       throw("mode type doesn't exist");
       break;
@@ -108,6 +197,94 @@ void static deserializeModeData(duty_t dataArray[modePacketSize], ModeDataStruct
     memcpy(dataStruct->time, timeVals, 3);
     return;
   }
+  case ModeTypes::sunrise:
+  {
+    int i = 0;
+    dataStruct->ID = dataArray[i]; i++;  // i = 1
+    dataStruct->type = type; i++;        // i = 2
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->endColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + nChannels
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->startColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + 2*nChannels
+    dataStruct->maxBrightness = dataArray[i]; i++;
+    dataStruct->minBrightness = 0;
+    dataStruct->finalMaxBrightness = 0;
+    dataStruct->finalMinBrightness = 0;
+    uint8_t timeVals[3] = {dataArray[i], 0, 0};  // window in minutes
+    memcpy(dataStruct->time, timeVals, 3);
+    return;
+  }
+  case ModeTypes::sunset:
+  {
+    int i = 0;
+    dataStruct->ID = dataArray[i]; i++;  // i = 1
+    dataStruct->type = type; i++;        // i = 2
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->endColourRatios[c] = dataArray[i];
+      dataStruct->startColourRatios[c] = 0;
+      i++;
+    } // i = 2 + nChannels
+    dataStruct->maxBrightness = dataArray[i]; i++;
+    dataStruct->minBrightness = 0;
+    dataStruct->finalMaxBrightness = 0;
+    dataStruct->finalMinBrightness = 0;
+    uint8_t timeVals[3] = {dataArray[i], 0, 0};  // seconds per brightness step
+    memcpy(dataStruct->time, timeVals, 3);
+    return;
+  }
+  case ModeTypes::pulse:
+  case ModeTypes::chirp:
+  {
+    int i = 0;
+    dataStruct->ID = dataArray[i]; i++;  // i = 1
+    dataStruct->type = type; i++;        // i = 2
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->endColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + nChannels
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->startColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + 2*nChannels
+    dataStruct->maxBrightness = dataArray[i]; i++;
+    dataStruct->minBrightness = dataArray[i]; i++;
+    if(type == ModeTypes::pulse){
+      dataStruct->finalMaxBrightness = 0;
+      dataStruct->finalMinBrightness = 0;
+      uint8_t timeVals[3] = {dataArray[i], 0, 0};  // period in tenths of a second
+      memcpy(dataStruct->time, timeVals, 3);
+      return;
+    }
+    dataStruct->finalMaxBrightness = dataArray[i]; i++;
+    dataStruct->finalMinBrightness = dataArray[i]; i++;
+    memcpy(dataStruct->time, &dataArray[i], 3);  // initial and final periods in tenths of a second, duration in minutes
+    return;
+  }
+  case ModeTypes::changing:
+  {
+    int i = 0;
+    dataStruct->ID = dataArray[i]; i++;  // i = 1
+    dataStruct->type = type; i++;        // i = 2
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->endColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + nChannels
+    for(uint8_t c = 0; c < nChannels; c++){
+      dataStruct->startColourRatios[c] = dataArray[i];
+      i++;
+    } // i = 2 + 2*nChannels
+    dataStruct->maxBrightness = dataArray[i]; i++;
+    dataStruct->minBrightness = dataArray[i]; i++;
+    dataStruct->finalMaxBrightness = 0;
+    dataStruct->finalMinBrightness = 0;
+    uint8_t timeVals[3] = {dataArray[i], dataArray[i+1], 0};  // window in minutes, MSB first
+    memcpy(dataStruct->time, timeVals, 3);
+    return;
+  }
   default:
     {
       #ifdef native_env
@@ -119,7 +296,7 @@ void static deserializeModeData(duty_t dataArray[modePacketSize], ModeDataStruct
 }
 
 void static fillDefaultConstantBrightnessStruct(ModeDataStruct *dataStruct, uint8_t numChannels){
-  dataStruct->ID = 1;
+  dataStruct->ID = defaultModeID;
   dataStruct->type = ModeTypes::constantBrightness;
   dataStruct->maxBrightness = 0;
   dataStruct->minBrightness = 0;
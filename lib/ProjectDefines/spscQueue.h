@@ -0,0 +1,73 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief lock-free single-producer single-consumer queue, for passing things between two tasks (or a task and an ISR) without a mutex. ButtonEdgeQueue is one of these.
+ * the indexes are free-running and wrap at 256, so the size must be a power of 2 that's no bigger than 128
+ *
+ * @tparam T must be copyable
+ * @tparam SIZE
+ */
+template<typename T, uint8_t SIZE>
+class SPSCQueue {
+  static_assert(SIZE != 0 && (SIZE & (SIZE - 1)) == 0 && SIZE <= 128, "SIZE must be a power of 2, and no bigger than 128");
+
+  private:
+    T _buffer[SIZE];
+    std::atomic<uint8_t> _head{0};  // only written by the producer
+    std::atomic<uint8_t> _tail{0};  // only written by the consumer
+    std::atomic<bool> _overflowed{false};
+
+  public:
+    /**
+     * @brief add an item to the queue. only call from the producer. safe to call from an ISR
+     *
+     * @param item
+     * @return true if successful
+     * @return false if the queue is full. the item is dropped and the overflow flag is raised
+     */
+    bool push(const T& item){
+      const uint8_t head = _head.load(std::memory_order_relaxed);
+      const uint8_t tail = _tail.load(std::memory_order_acquire);
+      if((uint8_t)(head - tail) >= SIZE){
+        _overflowed.store(true, std::memory_order_relaxed);
+        return false;
+      }
+      _buffer[head & (SIZE - 1)] = item;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * @brief take the oldest item from the queue. only call from the consumer
+     *
+     * @param item filled with the oldest item
+     * @return true if an item was popped
+     * @return false if the queue is empty
+     */
+    bool pop(T& item){
+      const uint8_t tail = _tail.load(std::memory_order_relaxed);
+      const uint8_t head = _head.load(std::memory_order_acquire);
+      if(head == tail){return false;}
+      item = _buffer[tail & (SIZE - 1)];
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool isEmpty(){
+      return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief returns true if items have been dropped since the last call
+     *
+     */
+    bool checkAndClearOverflow(){
+      return _overflowed.exchange(false, std::memory_order_relaxed);
+    }
+};
+
+#endif
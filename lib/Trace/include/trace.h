@@ -0,0 +1,183 @@
+/**
+ * notes:
+ *  - binary tracing for timing on the device, instead of toggling pollPin and watching it on the oscilloscope (see documents/polling.md)
+ *  - everything is compiled out unless esp32_lights_trace is defined. the macros expand to nothing, and nothing references trace.cpp, so the linker drops the buffer as well
+ *  - records are 8 bytes: the bottom 32 bits of the UTC timestamp from DeviceTime, the event ID, the phase, and a 16 bit argument. 32 bits of microseconds wraps every ~71 minutes, which the decoder unwraps
+ *  - dump the buffer with traceDump() and decode it with tools/traceDecoder.py
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+
+#ifndef TRACE_BUFFER_SIZE
+  #define TRACE_BUFFER_SIZE 256   // records. must be a power of 2
+#endif
+
+/**
+ * @brief the things that get traced. the decoder reads the names out of this file, so keep the values in order and only add new events to the end
+ */
+enum class TraceEvents : uint8_t {
+  none = 0,
+  updateLights = 1,     // ModalLightsController::updateLights()
+  modeChange = 2,       // ModalLightsController::_changeMode(). arg is the mode ID
+  eventCheck = 3,       // EventManager::_check()
+  storageReadMode = 4,  // DataStorageClass::getMode(). arg is the mode ID
+  storageReadEvent = 5, // DataStorageClass::getEvent(). arg is the event ID
+  storageReadChunk = 6, // the data storage iterator filling its buffer. arg is the first object number
+};
+
+enum class TracePhases : uint8_t {
+  begin = 0,
+  end = 1,
+  instant = 2
+};
+
+struct TraceRecord {
+  uint32_t time_uS = 0;   // bottom 32 bits of the UTC timestamp
+  uint8_t event = 0;      // TraceEvents
+  uint8_t phase = 0;      // TracePhases
+  uint16_t arg = 0;
+};
+
+/**
+ * @brief a fixed-size ring buffer that overwrites the oldest records. writers claim a slot with a single atomic increment, so it can be written from either core without a lock. reading while something is writing can catch a half-written record, so dump it from the loop that owns it
+ *
+ * @tparam capacity must be a power of 2
+ */
+template <uint16_t capacity>
+class TraceRingBuffer {
+  static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "trace buffer capacity must be a power of 2");
+
+  private:
+    TraceRecord _records[capacity];
+    std::atomic<uint32_t> _head{0};   // total number of records ever written
+
+  public:
+    TraceRingBuffer(){};
+
+    void record(const uint32_t time_uS, const TraceEvents event, const TracePhases phase, const uint16_t arg){
+      const uint32_t slot = _head.fetch_add(1, std::memory_order_relaxed) & (capacity - 1);
+      TraceRecord& r = _records[slot];
+      r.time_uS = time_uS;
+      r.event = static_cast<uint8_t>(event);
+      r.phase = static_cast<uint8_t>(phase);
+      r.arg = arg;
+    }
+
+    /**
+     * @brief copy the records out, oldest first
+     *
+     * @param out
+     * @param maxRecords
+     * @return uint16_t the number of records copied
+     */
+    uint16_t snapshot(TraceRecord* out, const uint16_t maxRecords){
+      const uint32_t head = _head.load(std::memory_order_acquire);
+      const uint32_t stored = head < capacity ? head : capacity;
+      const uint16_t n = stored < maxRecords ? stored : maxRecords;
+      // the newest n records
+      for(uint16_t i = 0; i < n; i++){
+        out[i] = _records[(head - n + i) & (capacity - 1)];
+      }
+      return n;
+    }
+
+    /**
+     * @brief the number of records that have been overwritten before they were dumped
+     *
+     * @return uint32_t
+     */
+    uint32_t getDropped(){
+      const uint32_t head = _head.load(std::memory_order_relaxed);
+      return head > capacity ? head - capacity : 0;
+    }
+
+    uint16_t getCapacity(){return capacity;}
+
+    void clear(){_head.store(0, std::memory_order_relaxed);}
+};
+
+class DeviceTimeClass;
+
+/**
+ * @brief set where the timestamps come from. until this is called, every record has a time of 0
+ *
+ * @param deviceTime
+ */
+void traceSetClock(std::shared_ptr<DeviceTimeClass> deviceTime);
+
+/**
+ * @brief add a record to the global trace buffer. use the macros instead, so that it gets compiled out
+ *
+ * @param event
+ * @param phase
+ * @param arg
+ */
+void traceRecord(TraceEvents event, TracePhases phase, uint16_t arg);
+
+/**
+ * @brief the global trace buffer
+ *
+ * @return TraceRingBuffer<TRACE_BUFFER_SIZE>&
+ */
+TraceRingBuffer<TRACE_BUFFER_SIZE>& getTraceBuffer();
+
+/**
+ * @brief write the buffer out as text lines that tools/traceDecoder.py understands, then clear it. the format is:
+ *
+ * trace begin <number of records> <number dropped>
+ * <time_uS, 8 hex digits><event, 2 hex digits><phase, 2 hex digits><arg, 4 hex digits>
+ * ...
+ * trace end
+ *
+ * @param writeLine gets called once per line, without a newline
+ */
+void traceDump(void (*writeLine)(const char* line));
+
+/**
+ * @brief write records out in the same format as traceDump(), for records that have been copied somewhere else
+ *
+ * @param records oldest first
+ * @param n
+ * @param dropped
+ * @param writeLine gets called once per line, without a newline
+ */
+void traceWriteRecords(const TraceRecord* records, uint16_t n, uint32_t dropped, void (*writeLine)(const char* line));
+
+/**
+ * @brief records the beginning of a span when it's constructed, and the end when it goes out of scope
+ */
+class TraceSpan {
+  private:
+    const TraceEvents _event;
+    const uint16_t _arg;
+
+  public:
+    TraceSpan(const TraceEvents event, const uint16_t arg = 0) : _event(event), _arg(arg){
+      traceRecord(_event, TracePhases::begin, _arg);
+    }
+
+    ~TraceSpan(){
+      traceRecord(_event, TracePhases::end, _arg);
+    }
+};
+
+#ifdef esp32_lights_trace
+  #define _TRACE_CONCAT(a, b) a##b
+  #define _TRACE_SPAN_NAME(line) _TRACE_CONCAT(_traceSpan_, line)
+
+  // trace the rest of the current scope
+  #define TRACE_SPAN(event) TraceSpan _TRACE_SPAN_NAME(__LINE__)(TraceEvents::event)
+  #define TRACE_SPAN_ARG(event, arg) TraceSpan _TRACE_SPAN_NAME(__LINE__)(TraceEvents::event, static_cast<uint16_t>(arg))
+  #define TRACE_INSTANT(event, arg) traceRecord(TraceEvents::event, TracePhases::instant, static_cast<uint16_t>(arg))
+#else
+  #define TRACE_SPAN(event)
+  #define TRACE_SPAN_ARG(event, arg)
+  #define TRACE_INSTANT(event, arg)
+#endif
+
+#endif
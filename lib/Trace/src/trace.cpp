@@ -0,0 +1,42 @@
+#include "trace.h"
+#include "DeviceTime.h"
+
+#include <stdio.h>
+
+namespace {
+  TraceRingBuffer<TRACE_BUFFER_SIZE> _traceBuffer;
+  std::shared_ptr<DeviceTimeClass> _traceClock;
+}
+
+void traceSetClock(std::shared_ptr<DeviceTimeClass> deviceTime){
+  _traceClock = deviceTime;
+}
+
+void traceRecord(TraceEvents event, TracePhases phase, uint16_t arg){
+  const uint32_t time_uS = _traceClock ? static_cast<uint32_t>(_traceClock->getUTCTimestampMicros()) : 0;
+  _traceBuffer.record(time_uS, event, phase, arg);
+}
+
+TraceRingBuffer<TRACE_BUFFER_SIZE>& getTraceBuffer(){
+  return _traceBuffer;
+}
+
+void traceDump(void (*writeLine)(const char* line)){
+  static TraceRecord records[TRACE_BUFFER_SIZE];  // too big for the loop task's stack
+  const uint32_t dropped = _traceBuffer.getDropped();
+  const uint16_t n = _traceBuffer.snapshot(records, TRACE_BUFFER_SIZE);
+  _traceBuffer.clear();
+  traceWriteRecords(records, n, dropped, writeLine);
+}
+
+void traceWriteRecords(const TraceRecord* records, uint16_t n, uint32_t dropped, void (*writeLine)(const char* line)){
+  char line[32];
+  snprintf(line, sizeof(line), "trace begin %u %lu", n, static_cast<unsigned long>(dropped));
+  writeLine(line);
+  for(uint16_t i = 0; i < n; i++){
+    const TraceRecord& r = records[i];
+    snprintf(line, sizeof(line), "%08lx%02x%02x%04x", static_cast<unsigned long>(r.time_uS), r.event, r.phase, r.arg);
+    writeLine(line);
+  }
+  writeLine("trace end");
+}
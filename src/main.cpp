@@ -5,27 +5,100 @@
 #include "DeviceTime.h"
 #include <touchSwitch.hpp>
 #include <ModalLights.h>
+#include <lightsOutputTask.h>
+#include <modalLightsProxy.h>
+#include <EventManager.h>
 #include <complimentaryPWM.hpp>
+#include "trace.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "loopDeadlineMonitor.h"
+#include "preferencesConfigSlots.h"
+#include "spscQueue.h"
 
 const uint8_t pollPin = D6;
+const uint32_t loopBudget_uS = 10000;   // half of the loop period
+const uint32_t loopWatchdogTimeout_S = 5;
+
+// the output loop runs in setup() on the Arduino loop task, which is already on core 1. the control loop gets core 0
+const BaseType_t controlTaskCore = 0;
+const uint32_t controlTaskStackSize = 8192;
+const uint32_t controlLoopPeriod_mS = 20;
+const uint32_t controlLoopBudget_uS = 100000;   // the control loop is allowed to be slow (flash writes, serial), so this only catches the really slow iterations
+
+// serial commands get read by the control task, but the metrics, trace and profile mostly belong to the output task, so that's where they're run
+typedef SPSCQueue<char, 4> SerialRequestQueue;
+
+/**
+ * @brief run a serial command: m prints the metrics, r resets them, t dumps the trace and p prints and resets the profile (if they're compiled in). only call from the output task
+ * 
+ * @param request 
+ */
+void runSerialRequest(char request){
+  switch(request){
+    case 'm':
+      getMetrics().report([](const char* line){Serial.println(line);});
+      break;
+    case 'r':
+      getMetrics().reset();
+      break;
+#ifdef esp32_lights_trace
+    case 't':
+      traceDump([](const char* line){Serial.println(line);});
+      break;
+#endif
+#ifdef esp32_lights_profile
+    case 'p':
+      profileReport([](const char* line){Serial.println(line);});
+      profileReset();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief everything that belongs to the control task
+ */
+struct ControlTaskObjects {
+  std::shared_ptr<DeviceTimeClass> deviceTime;
+  std::shared_ptr<ConfigManagerClass> configManager;
+  std::shared_ptr<ModalLightsProxy> lights;
+  std::shared_ptr<EventManager> eventManager;
+  std::shared_ptr<LoopDeadlineMonitor> loopMonitor;
+  std::shared_ptr<SerialRequestQueue> serialRequests;   // control task -> output task
+};
 
-class HardcodedConfigs : public ConfigAbstractHAL{
-  private:
-    ConfigsStruct _configs;
-  
-  public:
-    ConfigsStruct getAllConfigs(){
-      return _configs;
-    }
-
-    bool setConfigs(ConfigsStruct configs){
-      return false;
-    }
-
-    bool reloadConfigs(){
-      return true;
+/**
+ * @brief storage, events, config, time updates and serial. anything slow happens here, so that it can't hold up the lights
+ * 
+ * @param parameters ControlTaskObjects*
+ */
+void controlTask(void* parameters){
+  ControlTaskObjects* objects = static_cast<ControlTaskObjects*>(parameters);
+  LoopDeadlineMonitor& loopMonitor = *objects->loopMonitor;
+  loopWatchdogAddTask();  // setup() has already started the watchdog
+  while(true){
+    loopMonitor.beginIteration(metricsClock_uS());
+    loopMonitor.setStage(LoopStages::time, metricsClock_uS());
+    objects->deviceTime->flushTimeUpdates();
+    loopMonitor.setStage(LoopStages::events, metricsClock_uS());
+    objects->eventManager->check();
+    loopMonitor.setStage(LoopStages::proxy, metricsClock_uS());
+    objects->lights->updateLights();
+    loopMonitor.setStage(LoopStages::config, metricsClock_uS());
+    objects->configManager->update(metricsClock_uS());  // config changes get written once they've settled
+
+    loopMonitor.setStage(LoopStages::serial, metricsClock_uS());
+    // the output task runs the serial commands. if it's got too many already, they're dropped
+    while(Serial.available()){
+      objects->serialRequests->push(Serial.read());
     }
-};
+    loopMonitor.endIteration(metricsClock_uS());
+    vTaskDelay(pdMS_TO_TICKS(controlLoopPeriod_mS));
+  }
+}
 
 class HardcodedStorage : public StorageHALInterface{
   public:
@@ -75,7 +148,7 @@ void setup(){
   digitalWrite(pollPin, false);
 
   // Serial.println("constructing config manager");
-  auto configHAL = makeConcreteConfigHal<HardcodedConfigs>();
+  std::unique_ptr<ConfigAbstractHAL> configHAL = std::make_unique<DoubleBufferedConfigHAL>(std::make_unique<PreferencesConfigSlots>());
   std::shared_ptr<ConfigManagerClass> configManager = std::make_shared<ConfigManagerClass>(std::move(configHAL));
 
   OnboardTimestamp onboardTime;
@@ -84,6 +157,18 @@ void setup(){
 
   // Serial.println("constructing device time");
   auto deviceTime = std::make_shared<DeviceTimeClass>(configManager);
+  deviceTime->deferTimeUpdates(true); // time updates get flushed once per loop
+
+  Serial.begin(115200);  // for the metrics and overrun reports
+
+  // report whatever made the last loop overrun, or stopped it
+  LoopDeadlineMonitor loopMonitor(loopBudget_uS, getOverrunSnapshot());
+  loopMonitor.reportPrevious([](const char* line){Serial.println(line);});
+  auto controlLoopMonitor = std::make_shared<LoopDeadlineMonitor>(controlLoopBudget_uS, getControlOverrunSnapshot());
+  controlLoopMonitor->reportPrevious([](const char* line){Serial.print("control "); Serial.println(line);});
+#ifdef esp32_lights_trace
+  traceSetClock(deviceTime);
+#endif
 
   // Serial.println("constructing data storage");
   auto storageHAL = std::make_shared<HardcodedStorage>();
@@ -103,6 +188,26 @@ void setup(){
   );
 
   modalLights->setBrightnessLevel(255);
+
+  // the output task gets its time updates from the control task, through the channel
+  deviceTime->remove_observer(*modalLights);
+  auto lightsChannel = std::make_shared<LightsTaskChannel>();
+  LightsOutputTask lightsOutput(modalLights, lightsChannel);
+
+  // Serial.println("constructing control task");
+  ControlTaskObjects* controlObjects = new ControlTaskObjects;  // lives forever
+  controlObjects->deviceTime = deviceTime;
+  controlObjects->configManager = configManager;
+  auto asyncStorage = std::make_shared<AsyncDataStorage>(dataStorage);
+  controlObjects->lights = std::make_shared<ModalLightsProxy>(lightsChannel, asyncStorage, deviceTime);
+  controlObjects->eventManager = std::make_shared<EventManager>(controlObjects->lights, configManager, deviceTime, dataStorage);
+  controlObjects->loopMonitor = controlLoopMonitor;
+  auto serialRequests = std::make_shared<SerialRequestQueue>();
+  controlObjects->serialRequests = serialRequests;
+  // EventManager reads its events while it's being constructed. after that, only the storage worker touches storage
+  asyncStorage->startWorker(controlTaskCore);
+  loopWatchdogBegin(loopWatchdogTimeout_S);  // before the control task starts, so that it can add itself
+  xTaskCreatePinnedToCore(controlTask, "control", controlTaskStackSize, controlObjects, 1, NULL, controlTaskCore);
   
   // Serial.println("constructing touch button");
   S3TouchButton touchSwitch(deviceTime, modalLights);
@@ -110,10 +215,24 @@ void setup(){
   // Serial.println("Setup complete");
 
   while(true){
+    const uint64_t iterationStart_uS = metricsClock_uS();
+    loopMonitor.beginIteration(iterationStart_uS);
     // digitalWrite(pollPin, HIGH);
+    loopMonitor.setStage(LoopStages::button, iterationStart_uS);
     touchSwitch.update();
-    modalLights->updateLights();
+    loopMonitor.setStage(LoopStages::lights, metricsClock_uS());
+    lightsOutput.update();
     // digitalWrite(pollPin, LOW);
+
+    const uint64_t iterationEnd_uS = metricsClock_uS();
+    getMetrics().recordLatency(MetricHistograms::mainLoop, iterationEnd_uS - iterationStart_uS);
+    loopMonitor.endIteration(iterationEnd_uS);
+
+    // after the iteration, so that printing doesn't count as an overrun
+    char serialRequest;
+    while(serialRequests->pop(serialRequest)){
+      runSerialRequest(serialRequest);
+    }
     
     // touchSwitch.printValues();
     // // Serial.println();
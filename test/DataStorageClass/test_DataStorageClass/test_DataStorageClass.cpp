@@ -1,8 +1,11 @@
 #include <unity.h>
 
 #include "DataStorageClass.h"
+#include "AsyncDataStorage.h"
 #include "../../nativeMocksAndHelpers/mockStorageHAL.hpp"
+#include "../../nativeMocksAndHelpers/flashStorageHAL.hpp"
 #include "../../EventManager/test_EventManager/testEvents.h"
+#include "timeSource.h"
 
 void setUp(void){}
 void tearDown(void){}
@@ -169,7 +172,9 @@ void testModeGetters(void){
 
       TEST_ASSERT_TRUE(testClass->getMode(mode.ID, testBuffer));
       TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBuffer, testBuffer, getModeDataSize(mode.type));
-      TEST_ASSERT_EQUAL(mode.minBrightness, testBuffer[getModeDataSize(ModeTypes::constantBrightness) - 1]);
+      if(mode.type == ModeTypes::constantBrightness){
+        TEST_ASSERT_EQUAL(mode.minBrightness, testBuffer[getModeDataSize(ModeTypes::constantBrightness) - 1]);
+      }
     }
   }
 
@@ -237,6 +242,317 @@ void testStorageValidation(void){
   TEST_IGNORE_MESSAGE("not yet implemented (post MVP)");
 }
 
+namespace AsyncStorageTests{
+  std::vector<StorageResultStruct> results;
+
+  void collectResult(const StorageResultStruct& result, void* context){
+    results.push_back(result);
+    (*static_cast<uint8_t*>(context))++;
+  }
+}
+
+void testAsyncStorage(void){
+  using namespace AsyncStorageTests;
+  TestChannels channel = TestChannels::RGB;
+  auto testModes = makeModeDataStructArray(getAllTestingModes(), channel);
+  std::vector<EventDataPacket> storedEvents = {testEvent1, testEvent2, testEvent3};
+  auto mockStorageHAL = std::make_shared<MockStorageHAL>(testModes, storedEvents);
+  auto dataStorage = std::make_shared<DataStorageClass>(mockStorageHAL);
+  dataStorage->loadIDs();
+  AsyncDataStorage asyncStorage(dataStorage);
+  uint8_t nCallbacks = 0;
+
+  // without a worker, dispatching does the reads. results come back in the order they were asked for
+  results.clear();
+  TEST_ASSERT_TRUE(asyncStorage.requestMode(testModes.at(0).ID, collectResult, &nCallbacks, 7));
+  TEST_ASSERT_TRUE(asyncStorage.requestEvent(testEvent2.eventID, collectResult, &nCallbacks));
+  TEST_ASSERT_TRUE(asyncStorage.requestMode(105, collectResult, &nCallbacks));
+  TEST_ASSERT_EQUAL(0, mockStorageHAL->getModeCount);
+  TEST_ASSERT_FALSE(asyncStorage.isIdle());
+
+  TEST_ASSERT_EQUAL(3, asyncStorage.dispatchCompletions());
+  TEST_ASSERT_EQUAL(3, nCallbacks);
+  TEST_ASSERT_TRUE(asyncStorage.isIdle());
+
+  TEST_ASSERT_TRUE(results.at(0).type == StorageRequestTypes::mode);
+  TEST_ASSERT_TRUE(results.at(0).success);
+  TEST_ASSERT_EQUAL(7, results.at(0).tag);
+  TEST_ASSERT_EQUAL(testModes.at(0).ID, results.at(0).modeData.ID);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(testModes.at(0).endColourRatios, results.at(0).modeData.endColourRatios, nChannels);
+
+  TEST_ASSERT_TRUE(results.at(1).type == StorageRequestTypes::event);
+  TEST_ASSERT_TRUE(results.at(1).success);
+  ASSERT_EQUAL_EVENT_STRUCTS(testEvent2, results.at(1).eventData);
+
+  TEST_ASSERT_FALSE(results.at(2).success);
+
+  // with a worker, dispatching only runs callbacks
+  asyncStorage.useExternalWorker();
+  results.clear();
+  nCallbacks = 0;
+  mockStorageHAL->getModeCount = 0;
+  for(uint8_t i = 0; i < ASYNC_STORAGE_QUEUE_SIZE; i++){
+    TEST_ASSERT_TRUE(asyncStorage.requestMode(testModes.at(0).ID, collectResult, &nCallbacks, i));
+  }
+  TEST_ASSERT_FALSE(asyncStorage.requestMode(testModes.at(0).ID, collectResult, &nCallbacks));
+  TEST_ASSERT_EQUAL(0, asyncStorage.dispatchCompletions());
+  TEST_ASSERT_EQUAL(0, mockStorageHAL->getModeCount);
+
+  // a full results queue holds the worker up, but nothing gets lost
+  TEST_ASSERT_EQUAL(ASYNC_STORAGE_QUEUE_SIZE, asyncStorage.serviceRequests());
+  TEST_ASSERT_TRUE(asyncStorage.requestMode(testModes.at(1).ID, collectResult, &nCallbacks, 100));
+  TEST_ASSERT_EQUAL(1, asyncStorage.serviceRequests());
+  TEST_ASSERT_EQUAL(0, asyncStorage.serviceRequests());
+  TEST_ASSERT_EQUAL(ASYNC_STORAGE_QUEUE_SIZE, asyncStorage.dispatchCompletions());
+  TEST_ASSERT_EQUAL(0, asyncStorage.serviceRequests());
+  TEST_ASSERT_EQUAL(1, asyncStorage.dispatchCompletions());
+  TEST_ASSERT_EQUAL(ASYNC_STORAGE_QUEUE_SIZE + 1, nCallbacks);
+  for(uint8_t i = 0; i < ASYNC_STORAGE_QUEUE_SIZE; i++){
+    TEST_ASSERT_EQUAL(i, results.at(i).tag);
+  }
+  TEST_ASSERT_EQUAL(100, results.back().tag);
+  TEST_ASSERT_EQUAL(testModes.at(1).ID, results.back().modeData.ID);
+  TEST_ASSERT_TRUE(asyncStorage.isIdle());
+}
+
+void testFlashStorageHAL(void){
+  TestChannels channel = TestChannels::RGB;
+  auto testModes = makeModeDataStructArray(getAllTestingModes(), channel);
+  std::vector<EventDataPacket> storedEvents = {testEvent1, testEvent2, testEvent3, testEvent4, testEvent5, testEvent6, testEvent7, testEvent8};
+  auto flash = std::make_shared<FlashSimulator>();
+
+  // blank flash is empty storage
+  {
+    auto flashHAL = std::make_shared<FlashStorageHAL>(flash);
+    TEST_ASSERT_FALSE(flashHAL->reloadHeader());
+    TEST_ASSERT_EQUAL(0, flashHAL->getNumberOfStoredModes());
+    TEST_ASSERT_EQUAL(0, flashHAL->getNumberOfStoredEvents());
+    TEST_ASSERT_TRUE(flashHAL->ingest(testModes, storedEvents));
+    // header, modes, and events each get a sector
+    TEST_ASSERT_EQUAL(3, flash->stats.erases);
+  }
+
+  // everything can be read back after a "reboot", and costs what it should
+  flash->resetStats();
+  auto flashHAL = std::make_shared<FlashStorageHAL>(flash);
+  TEST_ASSERT_EQUAL(testModes.size(), flashHAL->getNumberOfStoredModes());
+  TEST_ASSERT_EQUAL(storedEvents.size(), flashHAL->getNumberOfStoredEvents());
+  DataStorageClass testClass(flashHAL);
+  testClass.loadIDs();
+  TEST_ASSERT_EQUAL(1 + testModes.size() + storedEvents.size(), flash->stats.reads);
+
+  for(auto mode : testModes){
+    uint8_t expectedPacket[modePacketSize];
+    uint8_t actualPacket[modePacketSize];
+    serializeModeDataStruct(mode, expectedPacket);
+    TEST_ASSERT_TRUE(testClass.getMode(mode.ID, actualPacket));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedPacket, actualPacket, modePacketSize);
+  }
+  for(auto event : storedEvents){
+    EventDataPacket actualEvent = testClass.getEvent(event.eventID);
+    ASSERT_EQUAL_EVENT_STRUCTS(event, actualEvent);
+  }
+
+  // the iterator reads a page at a time, and 8 events fit in one
+  flash->resetStats();
+  EventStorageIterator testIterator = testClass.getAllEvents();
+  int count = 0;
+  while(testIterator.hasMore()){
+    EventDataPacket actualEvent = testIterator.getNext();
+    ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(count), actualEvent);
+    count++;
+  }
+  TEST_ASSERT_EQUAL(storedEvents.size(), count);
+  TEST_ASSERT_EQUAL(1, flash->stats.reads);
+  TEST_ASSERT_EQUAL(0, flash->stats.erases);
+  TEST_ASSERT_EQUAL(0, flash->stats.programs);
+}
+
+void benchmarkFlashStorage(void){
+  TestChannels channel = TestChannels::RGB;
+  auto testModes = makeModeDataStructArray(getAllTestingModes(), channel);
+  std::vector<EventDataPacket> storedEvents;
+  const uint8_t nEvents = 200;
+  for(uint8_t i = 0; i < nEvents; i++){
+    EventDataPacket event = testEvent1;
+    event.eventID = i + 1;
+    event.timeOfDay = i * 60;
+    storedEvents.push_back(event);
+  }
+  auto flash = std::make_shared<FlashSimulator>();
+  SteadyClockTimeSource stopwatch;
+
+  // bulk ingest, i.e. a new set of modes and events from the app
+  {
+    auto flashHAL = std::make_shared<FlashStorageHAL>(flash);
+    flash->resetStats();
+    stopwatch.setTimestamp_uS(0);
+    TEST_ASSERT_TRUE(flashHAL->ingest(testModes, storedEvents));
+    const uint64_t ingest_uS = stopwatch.getTimestamp_uS();
+    printf("storage ingest (%u modes, %u events): cpu %llu uS, simulated flash %.1f mS, %lu erases, %lu page programs\n",
+      (unsigned)testModes.size(), (unsigned)nEvents, (unsigned long long)ingest_uS,
+      flash->stats.simulatedTime_nS / 1000000.0, (unsigned long)flash->stats.erases, (unsigned long)flash->stats.programs
+    );
+  }
+
+  // boot: find the IDs, then go through every event like EventManager does
+  flash->resetStats();
+  stopwatch.setTimestamp_uS(0);
+  auto flashHAL = std::make_shared<FlashStorageHAL>(flash);
+  DataStorageClass dataStorage(flashHAL);
+  dataStorage.loadIDs();
+  EventStorageIterator eventIterator = dataStorage.getAllEvents();
+  uint16_t nIterated = 0;
+  while(eventIterator.hasMore()){
+    eventIterator.getNext();
+    nIterated++;
+  }
+  const uint64_t boot_uS = stopwatch.getTimestamp_uS();
+  TEST_ASSERT_EQUAL(nEvents, nIterated);
+  printf("storage boot: cpu %llu uS, simulated flash %.1f uS over %lu reads (%llu bytes)\n",
+    (unsigned long long)boot_uS, flash->stats.simulatedTime_nS / 1000.0,
+    (unsigned long)flash->stats.reads, (unsigned long long)flash->stats.bytesRead
+  );
+
+  // mode switching
+  const uint16_t nSwitches = 1000;
+  flash->resetStats();
+  stopwatch.setTimestamp_uS(0);
+  for(uint16_t i = 0; i < nSwitches; i++){
+    uint8_t modePacket[modePacketSize];
+    TEST_ASSERT_TRUE(dataStorage.getMode(testModes.at(i % testModes.size()).ID, modePacket));
+  }
+  const uint64_t switch_uS = stopwatch.getTimestamp_uS();
+  printf("storage mode switch: cpu mean %.3f uS, simulated flash %.1f uS per switch\n",
+    (double)switch_uS / nSwitches, flash->stats.simulatedTime_nS / 1000.0 / nSwitches
+  );
+  TEST_ASSERT_EQUAL(nSwitches, flash->stats.reads);
+  TEST_ASSERT_EQUAL(0, flash->stats.erases);
+  TEST_ASSERT_EQUAL(1, flash->getMaxSectorErases());
+}
+
+void testIteratorPrefetch(void){
+  std::vector<EventDataPacket> storedEvents;
+  for(uint8_t i = 0; i < 20; i++){
+    EventDataPacket event = testEvent1;
+    event.eventID = i + 1;
+    storedEvents.push_back(event);
+  }
+  auto flash = std::make_shared<FlashSimulator>();
+  TEST_ASSERT_TRUE(FlashStorageHAL(flash).ingest({}, storedEvents));
+
+  // the chunk size comes from the HAL, but can't be more than the buffers hold
+  {
+    auto flashHAL = std::make_shared<FlashStorageHAL>(flash, 100);
+    IterableCollection<nEvents_t, EventDataPacket> testCollection(flashHAL, 20);
+    TEST_ASSERT_EQUAL(DataPreloadMaxChunkSize, testCollection.getChunkSize());
+  }
+
+  auto flashHAL = std::make_shared<FlashStorageHAL>(flash, 4);
+
+  // reading straight through loads two chunks at a time
+  {
+    flash->resetStats();
+    IterableCollection<nEvents_t, EventDataPacket> testCollection(flashHAL, 20);
+    TEST_ASSERT_EQUAL(4, testCollection.getChunkSize());
+    TEST_ASSERT_EQUAL(1, flash->stats.reads);
+    const uint8_t expectedReads[20] = {1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3};
+    for(uint8_t i = 0; i < 20; i++){
+      EventDataPacket actualEvent = testCollection.getObjectAt(i);
+      ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(i), actualEvent);
+      TEST_ASSERT_EQUAL(expectedReads[i], flash->stats.reads);
+    }
+  }
+
+  // jumping between two chunks doesn't re-read them
+  {
+    IterableCollection<nEvents_t, EventDataPacket> testCollection(flashHAL, 20);
+    flash->resetStats();
+    const uint8_t order[] = {13, 2, 14, 1, 15, 3, 12, 0};
+    for(uint8_t objectNumber : order){
+      EventDataPacket actualEvent = testCollection.getObjectAt(objectNumber);
+      ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(objectNumber), actualEvent);
+    }
+    TEST_ASSERT_EQUAL(1, flash->stats.reads);
+
+    // a third chunk replaces the one that was used longest ago
+    EventDataPacket actualEvent = testCollection.getObjectAt(6);
+    ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(6), actualEvent);
+    TEST_ASSERT_EQUAL(2, flash->stats.reads);
+    actualEvent = testCollection.getObjectAt(1);
+    ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(1), actualEvent);
+    TEST_ASSERT_EQUAL(2, flash->stats.reads);
+    actualEvent = testCollection.getObjectAt(13);
+    ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(13), actualEvent);
+    TEST_ASSERT_EQUAL(3, flash->stats.reads);
+  }
+
+  // a HAL that only has fillChunk() still works
+  {
+    auto mockStorageHAL = std::make_shared<MockStorageHAL>(std::vector<ModeDataStruct>{}, storedEvents);
+    IterableCollection<nEvents_t, EventDataPacket> testCollection(mockStorageHAL, 20);
+    TEST_ASSERT_EQUAL(DataPreloadChunkSize, testCollection.getChunkSize());
+    for(uint8_t i = 0; i < 20; i++){
+      EventDataPacket actualEvent = testCollection.getObjectAt(i);
+      ASSERT_EQUAL_EVENT_STRUCTS(storedEvents.at(i), actualEvent);
+    }
+    TEST_ASSERT_EQUAL(4, mockStorageHAL->fillEventChunkCallCount);
+  }
+}
+
+void benchmarkIteratorPrefetch(void){
+  std::vector<EventDataPacket> storedEvents;
+  const uint8_t nEvents = 200;
+  for(uint8_t i = 0; i < nEvents; i++){
+    EventDataPacket event = testEvent1;
+    event.eventID = i + 1;
+    storedEvents.push_back(event);
+  }
+  auto flash = std::make_shared<FlashSimulator>();
+  TEST_ASSERT_TRUE(FlashStorageHAL(flash).ingest({}, storedEvents));
+  SteadyClockTimeSource stopwatch;
+
+  const nEvents_t chunkSizes[] = {1, DataPreloadChunkSize, 0};  // 0 = page sized
+  uint32_t previousReads = UINT32_MAX;
+  for(nEvents_t preferredSize : chunkSizes){
+    auto flashHAL = std::make_shared<FlashStorageHAL>(flash, preferredSize);
+
+    // boot scan
+    flash->resetStats();
+    stopwatch.setTimestamp_uS(0);
+    EventStorageIterator iterator(flashHAL, nEvents);
+    while(iterator.hasMore()){
+      iterator.getNext();
+    }
+    const uint64_t scan_uS = stopwatch.getTimestamp_uS();
+    const uint32_t scanReads = flash->stats.reads;
+    const uint64_t scan_nS = flash->stats.simulatedTime_nS;
+    TEST_ASSERT_TRUE(scanReads < previousReads);
+    previousReads = scanReads;
+
+    // random access between two places, i.e. looking up a few events either side of two times of day
+    flash->resetStats();
+    stopwatch.setTimestamp_uS(0);
+    uint32_t seed = 1;
+    for(uint16_t i = 0; i < 1000; i++){
+      seed = seed * 1103515245 + 12345;
+      const nEvents_t objectNumber = (i % 2 == 0 ? 60 : 120) + (seed >> 16) % 4;
+      EventDataPacket event = iterator.getObjectAt(objectNumber);
+      TEST_ASSERT_EQUAL(objectNumber + 1, event.eventID);
+    }
+    const uint64_t random_uS = stopwatch.getTimestamp_uS();
+    if(iterator.getChunkSize() >= 4){
+      // both places fit in the buffers
+      TEST_ASSERT_EQUAL(2, flash->stats.reads);
+    }
+
+    printf("iterator, chunk size %u: scan of %u events cpu %llu uS, simulated flash %.1f uS over %lu reads. 1000 random reads cpu %llu uS, simulated flash %.1f uS over %lu reads\n",
+      (unsigned)iterator.getChunkSize(), (unsigned)nEvents, (unsigned long long)scan_uS, scan_nS / 1000.0, (unsigned long)scanReads,
+      (unsigned long long)random_uS, flash->stats.simulatedTime_nS / 1000.0, (unsigned long)flash->stats.reads
+    );
+  }
+}
+
 void noEmbeddedUnfriendlyLibraries(){
   #ifdef __PRINT_DEBUG_H__
     TEST_ASSERT_MESSAGE(false, "did you forget to remove the print debugs?");
@@ -259,6 +575,11 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(testModeGetters);
   RUN_TEST(testCRUDOperations);
   RUN_TEST(testStorageValidation);
+  RUN_TEST(testAsyncStorage);
+  RUN_TEST(testFlashStorageHAL);
+  RUN_TEST(benchmarkFlashStorage);
+  RUN_TEST(testIteratorPrefetch);
+  RUN_TEST(benchmarkIteratorPrefetch);
   UNITY_END();
 }
 
@@ -144,18 +144,23 @@ class TimeChangeFinder{
 }
 
 /**
- * @brief tests that the observer has been called once, updates updateCheck with expected times from testParams, and the expected TimeUpdateStruct from updateCheck matches the TimeUpdateStruct notified to the observer
+ * @brief tests that the observer has been called once, updates updateCheck with expected times from testParams, and the expected TimeUpdateStruct from updateCheck matches the TimeUpdateStruct notified to the observer. if the times haven't changed, tests that the observer wasn't called
  * @param observer TestObserver instance
  * @param updateCheck TimeChangeFinder instance
  * @param testParams TestTimeParamsStruct
  */
 #define TEST_TIME_UPDATE_OBSERVER(observer, updateCheck, testParams){\
   TimeUpdateStruct expUpdates = updateCheck.setTimes(testParams);\
-  TimeUpdateStruct actUpdates = observer.getUpdates();\
-  TEST_ASSERT_EQUAL(1, observer.getCallCountAndReset());\
-  std::string localTimestampMatchMessage = "local timestamp doesn't match testParams";\
-  TEST_ASSERT_EQUAL_MESSAGE(testParams.localTimestamp*secondsToMicros, actUpdates.currentLocalTime_uS, localTimestampMatchMessage.c_str());\
-  TEST_ASSERT_EQUAL_TimeUpdateStruct(expUpdates, actUpdates);\
+  if(expUpdates.utcTimeChange_uS == 0 && expUpdates.localTimeChange_uS == 0){\
+    TEST_ASSERT_EQUAL(0, observer.getCallCountAndReset());\
+  }\
+  else{\
+    TimeUpdateStruct actUpdates = observer.getUpdates();\
+    TEST_ASSERT_EQUAL(1, observer.getCallCountAndReset());\
+    std::string localTimestampMatchMessage = "local timestamp doesn't match testParams";\
+    TEST_ASSERT_EQUAL_MESSAGE(testParams.localTimestamp*secondsToMicros, actUpdates.currentLocalTime_uS, localTimestampMatchMessage.c_str());\
+    TEST_ASSERT_EQUAL_TimeUpdateStruct(expUpdates, actUpdates);\
+  }\
 }
 
 /**
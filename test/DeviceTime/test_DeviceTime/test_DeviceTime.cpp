@@ -508,17 +508,352 @@ void moreObserverTests(){
   const uint64_t expUTCTime_uS = expLocalTime_uS - ((newDST + newTimezone)*secondsToMicros);
   const TimeUpdateStruct localUpdate = updateCheck.setTimes_uS(expUTCTime_uS, expLocalTime_uS);
   TEST_ASSERT_EQUAL(2, observer.getCallCount());
-  TEST_ASSERT_EQUAL_TimeUpdateStruct(dstUpdate, observer.getUpdates());
+  TEST_ASSERT_EQUAL_TimeUpdateStruct(localUpdate, observer.getUpdates());
 
   // TODO: test updates to just DST and timezone, without timestamp changes (not implemented yet)
 }
 
+void filteredObserverTests(){
+  OnboardTimestamp testingTimer;
+  DeviceTimeClass deviceTime = deviceTimeFactory();
+  const uint64_t utcTimestamp_S = deviceTime.getUTCTimestampSeconds();
+
+  TestObserver utcObserver;
+  TestObserver localObserver;
+  TestObserver anyObserver;
+  TestObserver thresholdObserver;
+  const uint64_t threshold_S = 2;
+  TEST_ASSERT_TRUE(deviceTime.add_observer(utcObserver, TimeObserverFilter{.changes = TimeUpdateFlags::utc}));
+  TEST_ASSERT_TRUE(deviceTime.add_observer(localObserver, TimeObserverFilter{.changes = TimeUpdateFlags::local}));
+  TEST_ASSERT_TRUE(deviceTime.add_observer(anyObserver));
+  TEST_ASSERT_TRUE(deviceTime.add_observer(thresholdObserver, TimeObserverFilter{.threshold_uS = threshold_S*secondsToMicros}));
+  TEST_ASSERT_EQUAL(MAX_TIME_OBSERVERS, deviceTime.number_of_observers());
+
+  // the bus is full
+  {
+    TestObserver extraObserver;
+    TEST_ASSERT_FALSE(deviceTime.add_observer(extraObserver));
+    TEST_ASSERT_EQUAL(MAX_TIME_OBSERVERS, deviceTime.number_of_observers());
+  }
+
+  // zero change shouldn't notify anyone
+  {
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S, 0, 0));
+    TEST_ASSERT_EQUAL(0, utcObserver.getCallCount());
+    TEST_ASSERT_EQUAL(0, localObserver.getCallCount());
+    TEST_ASSERT_EQUAL(0, anyObserver.getCallCount());
+    TEST_ASSERT_EQUAL(0, thresholdObserver.getCallCount());
+  }
+
+  // DST change should only notify local observers
+  {
+    const uint16_t newDST = 60*60;
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S, 0, newDST));
+    TEST_ASSERT_EQUAL(0, utcObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, localObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(newDST*secondsToMicros, localObserver.getUpdates().localTimeChange_uS);
+    TEST_ASSERT_EQUAL(1, anyObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, thresholdObserver.getCallCountAndReset());
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S, 0, 0));
+    utcObserver.resetParams();
+    localObserver.resetParams();
+    anyObserver.resetParams();
+    thresholdObserver.resetParams();
+  }
+
+  // changes under the threshold should accumulate until they pass it
+  {
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S + 1, 0, 0));
+    TEST_ASSERT_EQUAL(1, utcObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, localObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(0, thresholdObserver.getCallCount());
+
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S + 2, 0, 0));
+    TEST_ASSERT_EQUAL(1, thresholdObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(threshold_S*secondsToMicros, thresholdObserver.getUpdates().utcTimeChange_uS);
+    TEST_ASSERT_EQUAL(threshold_S*secondsToMicros, thresholdObserver.getUpdates().localTimeChange_uS);
+    utcObserver.resetParams();
+    localObserver.resetParams();
+    anyObserver.resetParams();
+  }
+
+  // deferred updates should be coalesced into one notification
+  {
+    deviceTime.deferTimeUpdates(true);
+    const uint64_t startTime_S = deviceTime.getUTCTimestampSeconds();
+    for(uint64_t i = 1; i <= 5; i++){
+      TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(startTime_S + i*10, 0, 0));
+    }
+    TEST_ASSERT_EQUAL(0, utcObserver.getCallCount());
+    TEST_ASSERT_EQUAL(0, anyObserver.getCallCount());
+
+    deviceTime.flushTimeUpdates();
+    TEST_ASSERT_EQUAL(1, utcObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, localObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, anyObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(1, thresholdObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(50*secondsToMicros, anyObserver.getUpdates().utcTimeChange_uS);
+    TEST_ASSERT_EQUAL(50*secondsToMicros, anyObserver.getUpdates().localTimeChange_uS);
+    TEST_ASSERT_EQUAL((startTime_S + 50)*secondsToMicros, anyObserver.getUpdates().currentLocalTime_uS);
+
+    // flushing again shouldn't re-notify
+    deviceTime.flushTimeUpdates();
+    TEST_ASSERT_EQUAL(0, anyObserver.getCallCount());
+
+    // un-deferring should flush any pending updates
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(startTime_S + 60, 0, 0));
+    TEST_ASSERT_EQUAL(0, anyObserver.getCallCount());
+    deviceTime.deferTimeUpdates(false);
+    TEST_ASSERT_EQUAL(1, anyObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(10*secondsToMicros, anyObserver.getUpdates().utcTimeChange_uS);
+  }
+
+  // removed observers shouldn't be notified
+  {
+    TEST_ASSERT_TRUE(deviceTime.remove_observer(utcObserver));
+    TEST_ASSERT_FALSE(deviceTime.remove_observer(utcObserver));
+    TEST_ASSERT_EQUAL(MAX_TIME_OBSERVERS - 1, deviceTime.number_of_observers());
+    utcObserver.resetParams();
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(utcTimestamp_S, 0, 0));
+    TEST_ASSERT_EQUAL(0, utcObserver.getCallCount());
+    TEST_ASSERT_EQUAL(1, anyObserver.getCallCountAndReset());
+  }
+}
+
 struct FakeUsefulTimeStruct{
   uint32_t timeInDay = 0;   // seconds since midnight
   uint64_t startOfDay = 0;  // timestamp of midnight
   uint8_t dayOfWeek = 0;
 };
 
+void DSTScheduleTests(){
+  OnboardTimestamp testingTimer;
+  DeviceTimeClass deviceTime = deviceTimeFactory();
+
+  // UK: starts 1am GMT on the last Sunday of March, ends 2am BST on the last Sunday of October
+  DSTRulesStruct ukRules;
+  ukRules.start = {3, 5, 7, 1*60*60};
+  ukRules.end = {10, 5, 7, 2*60*60};
+  ukRules.DST = 60*60;
+
+  const uint64_t ukStart2025_S = 796611600;  // 30/3/25 01:00 UTC
+  const uint64_t ukEnd2025_S = 814755600;    // 26/10/25 01:00 UTC
+  const uint64_t ukStart2026_S = 828061200;  // 29/3/26 01:00 UTC
+  const uint64_t midSummer2025_S = 802094400; // 1/6/25 12:00 UTC
+
+  TestObserver utcObserver;
+  TestObserver localObserver;
+  deviceTime.add_observer(utcObserver, TimeObserverFilter{.changes = TimeUpdateFlags::utc});
+  deviceTime.add_observer(localObserver, TimeObserverFilter{.changes = TimeUpdateFlags::local});
+
+  // no rules means no transitions
+  TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(ukStart2025_S - 60, 0, 0));
+  TEST_ASSERT_EQUAL(0, deviceTime.getNextDSTTransition());
+  TEST_ASSERT_FALSE(deviceTime.checkDSTTransition());
+  utcObserver.resetParams();
+  localObserver.resetParams();
+
+  // invalid rules get rejected
+  {
+    DSTRulesStruct badRules = ukRules;
+    badRules.start.month = 13;
+    TEST_ASSERT_FALSE(deviceTime.setDSTRules(badRules));
+    badRules = ukRules;
+    badRules.end.week = 0;
+    TEST_ASSERT_FALSE(deviceTime.setDSTRules(badRules));
+    badRules = ukRules;
+    badRules.end.dayOfWeek = 8;
+    TEST_ASSERT_FALSE(deviceTime.setDSTRules(badRules));
+    badRules = ukRules;
+    badRules.DST = 45*60;
+    TEST_ASSERT_FALSE(deviceTime.setDSTRules(badRules));
+    TEST_ASSERT_EQUAL(0, deviceTime.getNextDSTTransition());
+  }
+
+  // setting the rules before the transition doesn't change the time
+  {
+    TEST_ASSERT_TRUE(deviceTime.setDSTRules(ukRules));
+    TEST_ASSERT_EQUAL(ukRules.DST, globalConfigs->getDSTRules().DST);
+    TEST_ASSERT_EQUAL(0, localObserver.getCallCount());
+    TEST_ASSERT_EQUAL(ukStart2025_S*secondsToMicros, deviceTime.getNextDSTTransition());
+    TEST_ASSERT_EQUAL(ukStart2025_S - 60, deviceTime.getLocalTimestampSeconds());
+    TEST_ASSERT_FALSE(deviceTime.checkDSTTransition());
+  }
+
+  // the local time follows the schedule, and observers get told when the transition is checked
+  {
+    testingTimer.setTimestamp_S(ukStart2025_S + 1);
+    TEST_ASSERT_EQUAL(ukStart2025_S + 1 + ukRules.DST, deviceTime.getLocalTimestampSeconds());
+
+    TEST_ASSERT_TRUE(deviceTime.checkDSTTransition());
+    TEST_ASSERT_EQUAL(0, utcObserver.getCallCount());
+    TEST_ASSERT_EQUAL(1, localObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL(ukRules.DST*secondsToMicros, localObserver.getUpdates().localTimeChange_uS);
+    TEST_ASSERT_EQUAL((ukStart2025_S + 1 + ukRules.DST)*secondsToMicros, localObserver.getUpdates().currentLocalTime_uS);
+    TEST_ASSERT_EQUAL(ukRules.DST, deviceTime.getConfigs().DST);
+    TEST_ASSERT_EQUAL(ukEnd2025_S*secondsToMicros, deviceTime.getNextDSTTransition());
+
+    // only happens once
+    TEST_ASSERT_FALSE(deviceTime.checkDSTTransition());
+    TEST_ASSERT_EQUAL(0, localObserver.getCallCount());
+  }
+
+  // conversions use the schedule
+  {
+    TEST_ASSERT_EQUAL((midSummer2025_S + ukRules.DST)*secondsToMicros, deviceTime.convertUTCToLocalMicros(midSummer2025_S*secondsToMicros));
+    TEST_ASSERT_EQUAL(midSummer2025_S*secondsToMicros, deviceTime.convertLocalToUTCMicros((midSummer2025_S + ukRules.DST)*secondsToMicros));
+    TEST_ASSERT_EQUAL(ukEnd2025_S*secondsToMicros, deviceTime.convertUTCToLocalMicros(ukEnd2025_S*secondsToMicros));
+    TEST_ASSERT_EQUAL((ukEnd2025_S - 1 + ukRules.DST)*secondsToMicros, deviceTime.convertUTCToLocalMicros((ukEnd2025_S - 1)*secondsToMicros));
+  }
+
+  // setting the time ignores the given DST
+  {
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(ukEnd2025_S + 10, 0, 60*60));
+    TEST_ASSERT_EQUAL(0, deviceTime.getConfigs().DST);
+    TEST_ASSERT_EQUAL(ukEnd2025_S + 10, deviceTime.getLocalTimestampSeconds());
+    TEST_ASSERT_EQUAL(ukStart2026_S*secondsToMicros, deviceTime.getNextDSTTransition());
+    TEST_ASSERT_EQUAL(1, localObserver.getCallCountAndReset());
+    TEST_ASSERT_EQUAL((ukEnd2025_S + 10)*secondsToMicros, localObserver.getUpdates().currentLocalTime_uS);
+  }
+
+  // removing the rules goes back to the static DST
+  {
+    TEST_ASSERT_TRUE(deviceTime.setDSTRules(DSTRulesStruct{}));
+    TEST_ASSERT_EQUAL(0, deviceTime.getNextDSTTransition());
+    TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(midSummer2025_S, 0, 60*60));
+    TEST_ASSERT_EQUAL(60*60, deviceTime.getConfigs().DST);
+    TEST_ASSERT_EQUAL(midSummer2025_S + 60*60, deviceTime.getLocalTimestampSeconds());
+  }
+}
+
+void DSTScheduleFromInitialTimeTests(){
+  // a device that runs from the time it already has (i.e. from the RTC chip), without it being set
+  DSTRulesStruct ukRules;
+  ukRules.start = {3, 5, 7, 1*60*60};
+  ukRules.end = {10, 5, 7, 2*60*60};
+  ukRules.DST = 60*60;
+  globalConfigs->setDSTRules(ukRules);
+
+  const uint64_t ukStart2025_S = 796611600;  // 30/3/25 01:00 UTC
+  const uint64_t ukEnd2025_S = 814755600;    // 26/10/25 01:00 UTC
+  const uint64_t midSummer2025_S = 802094400; // 1/6/25 12:00 UTC
+
+  // before the transition, the transition is already known
+  {
+    auto virtualClock = std::make_shared<VirtualClock>();
+    virtualClock->setTimestamp_S(ukStart2025_S - 60);
+    DeviceTimeClass deviceTime(globalConfigs, virtualClock);
+    TEST_ASSERT_EQUAL(ukStart2025_S*secondsToMicros, deviceTime.getNextDSTTransition());
+    TEST_ASSERT_EQUAL(0, deviceTime.getConfigs().DST);
+
+    virtualClock->advance_S(61);
+    TEST_ASSERT_TRUE(deviceTime.checkDSTTransition());
+    TEST_ASSERT_EQUAL(ukRules.DST, deviceTime.getConfigs().DST);
+    TEST_ASSERT_EQUAL(ukStart2025_S + 1 + ukRules.DST, deviceTime.getLocalTimestampSeconds());
+    TEST_ASSERT_EQUAL(ukEnd2025_S*secondsToMicros, deviceTime.getNextDSTTransition());
+  }
+
+  // starting in the middle of DST applies it straight away
+  {
+    RTCConfigsStruct configs = globalConfigs->getRTCConfigs();
+    configs.DST = 0;
+    globalConfigs->setRTCConfigs(configs);
+    auto virtualClock = std::make_shared<VirtualClock>();
+    virtualClock->setTimestamp_S(midSummer2025_S);
+    DeviceTimeClass deviceTime(globalConfigs, virtualClock);
+    TEST_ASSERT_EQUAL(ukRules.DST, deviceTime.getConfigs().DST);
+    TEST_ASSERT_EQUAL(midSummer2025_S + ukRules.DST, deviceTime.getLocalTimestampSeconds());
+    TEST_ASSERT_EQUAL(ukEnd2025_S*secondsToMicros, deviceTime.getNextDSTTransition());
+  }
+}
+
+void DSTScheduleTableTests(){
+  // Sydney: starts 2am AEST on the first Sunday of October, ends 3am AEDT on the first Sunday of April
+  DSTRulesStruct sydneyRules;
+  sydneyRules.start = {10, 1, 7, 2*60*60};
+  sydneyRules.end = {4, 1, 7, 3*60*60};
+  sydneyRules.DST = 60*60;
+  const int32_t sydneyTimezone = 10*60*60;
+
+  const uint64_t end2025_S = 797184000;     // 5/4/25 16:00 UTC
+  const uint64_t start2025_S = 812908800;   // 4/10/25 16:00 UTC
+  const uint64_t end2026_S = 828633600;     // 4/4/26 16:00 UTC
+
+  DSTSchedule schedule;
+  TEST_ASSERT_FALSE(schedule.isEnabled());
+  TEST_ASSERT_EQUAL(0, schedule.getDSTOffset_S(end2025_S));
+  TEST_ASSERT_EQUAL(0, schedule.getNextTransition_S(end2025_S));
+
+  schedule.setRules(sydneyRules, sydneyTimezone, 25);
+  TEST_ASSERT_TRUE(schedule.isEnabled());
+
+  // DST ends before it starts in the southern hemisphere
+  TEST_ASSERT_EQUAL(60*60, schedule.getDSTOffset_S(end2025_S - 1));
+  TEST_ASSERT_EQUAL(0, schedule.getDSTOffset_S(end2025_S));
+  TEST_ASSERT_EQUAL(0, schedule.getDSTOffset_S(start2025_S - 1));
+  TEST_ASSERT_EQUAL(60*60, schedule.getDSTOffset_S(start2025_S));
+  TEST_ASSERT_EQUAL(60*60, schedule.getDSTOffset_S(end2026_S - 1));
+  TEST_ASSERT_EQUAL(0, schedule.getDSTOffset_S(end2026_S));
+
+  TEST_ASSERT_EQUAL(end2025_S, schedule.getNextTransition_S(end2025_S - 1));
+  TEST_ASSERT_EQUAL(start2025_S, schedule.getNextTransition_S(end2025_S));
+  TEST_ASSERT_EQUAL(end2026_S, schedule.getNextTransition_S(start2025_S));
+
+  // years outside of the table give the same results
+  for(uint64_t time_S = end2025_S - secondsInDay; time_S < end2026_S + secondsInDay; time_S += 60*60){
+    DSTSchedule laterSchedule;
+    laterSchedule.setRules(sydneyRules, sydneyTimezone, 50);
+    TEST_ASSERT_FALSE(laterSchedule.isInTable(time_S));
+    TEST_ASSERT_TRUE(schedule.isInTable(time_S));
+    TEST_ASSERT_EQUAL(schedule.getDSTOffset_S(time_S), laterSchedule.getDSTOffset_S(time_S));
+    TEST_ASSERT_EQUAL(schedule.getNextTransition_S(time_S), laterSchedule.getNextTransition_S(time_S));
+  }
+
+  // year boundaries
+  TEST_ASSERT_EQUAL(0, yearsSince2000(0));
+  TEST_ASSERT_EQUAL(0, yearsSince2000(366*secondsInDay - 1));
+  TEST_ASSERT_EQUAL(1, yearsSince2000(366*secondsInDay));
+  TEST_ASSERT_EQUAL(23, yearsSince2000(757382400 - 1)); // 1/1/24 00:00 - 1 second
+  TEST_ASSERT_EQUAL(24, yearsSince2000(757382400 + 365*secondsInDay)); // 31/12/24
+  TEST_ASSERT_EQUAL(25, yearsSince2000(757382400 + 366*secondsInDay));
+}
+
+void injectedTimeSourceTests(){
+  OnboardTimestamp testingTimer;
+  auto virtualClock = std::make_shared<VirtualClock>();
+  DeviceTimeClass deviceTime(globalConfigs, virtualClock);
+
+  // starts at build time
+  TEST_ASSERT_EQUAL(BUILD_TIMESTAMP, deviceTime.getUTCTimestampMicros());
+  TEST_ASSERT_EQUAL(BUILD_TIMESTAMP, virtualClock->getTimestamp_uS());
+
+  // the virtual clock holds the time, not the onboard timestamp
+  const uint64_t startTime_S = 802094400;
+  TEST_ASSERT_TRUE(deviceTime.setUTCTimestamp2000(startTime_S, 0, 0));
+  TEST_ASSERT_EQUAL(startTime_S*secondsToMicros, virtualClock->getTimestamp_uS());
+  TEST_ASSERT_NOT_EQUAL(startTime_S*secondsToMicros, testingTimer.getTimestamp_uS());
+
+  // time only moves when the clock is advanced
+  TEST_ASSERT_EQUAL(startTime_S, deviceTime.getUTCTimestampSeconds());
+  virtualClock->advance_uS(1500);
+  TEST_ASSERT_EQUAL(startTime_S*secondsToMicros + 1500, deviceTime.getLocalTimestampMicros());
+  const uint64_t aYear_S = 365*secondsInDay;
+  virtualClock->advance_S(aYear_S);
+  TEST_ASSERT_EQUAL(startTime_S + aYear_S, deviceTime.getUTCTimestampSeconds());
+  TEST_ASSERT_TRUE(deviceTime.hasTimeFault()); // it's been too long since the last sync
+
+  // steady clock is monotonic and settable
+  {
+    SteadyClockTimeSource steadyClock;
+    steadyClock.setTimestamp_S(startTime_S);
+    const uint64_t time1 = steadyClock.getTimestamp_uS();
+    TEST_ASSERT_GREATER_OR_EQUAL(startTime_S*secondsToMicros, time1);
+    TEST_ASSERT_LESS_THAN(startTime_S*secondsToMicros + secondsToMicros, time1);
+    const uint64_t time2 = steadyClock.getTimestamp_uS();
+    TEST_ASSERT_GREATER_OR_EQUAL(time1, time2);
+  }
+}
+
 void test_UsefulTimeStruct(){
   for(int t = 0; t < testArray.size(); t++){
     const TestTimeParamsStruct testTime = testArray.at(t);
@@ -569,6 +904,11 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(setUTCTimestamp1970);
   RUN_TEST(testTimeFault);
   RUN_TEST(testErrorsCatching);
+  RUN_TEST(filteredObserverTests);
+  RUN_TEST(DSTScheduleTests);
+  RUN_TEST(DSTScheduleFromInitialTimeTests);
+  RUN_TEST(DSTScheduleTableTests);
+  RUN_TEST(injectedTimeSourceTests);
   RUN_TEST(test_UsefulTimeStruct);
   UNITY_END();
 };
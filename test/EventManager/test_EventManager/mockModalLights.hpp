@@ -107,6 +107,29 @@ class MockModalLights : public ModalLightsInterface{
       _lightVals.values[0] = newBrightness;
       return newBrightness;
     }
+
+    // the ramp gets applied as one adjustment when it's stopped, so previousAdjustment is the whole ramp
+    bool isRamping = false;
+    bool rampIncreasing = false;
+    uint16_t rampWindow_mS = 0;
+    uint64_t rampStartTimeUTC_uS = 0;
+
+    void startBrightnessRamp(bool increasing, uint16_t window_mS, uint64_t startTimeUTC_uS) override {
+      isRamping = true;
+      rampIncreasing = increasing;
+      rampWindow_mS = window_mS;
+      rampStartTimeUTC_uS = startTimeUTC_uS;
+    }
+
+    duty_t stopBrightnessRamp(uint64_t stopTimeUTC_uS) override {
+      if(!isRamping){return getBrightnessLevel();}
+      isRamping = false;
+      // the ramp always adjusts by at least 1
+      Interpolator<1> ramp;
+      ramp.newWindowInterpolation(rampStartTimeUTC_uS, rampWindow_mS*1000, 1, 255);
+      adjustBrightness(ramp.interpolateValue(stopTimeUTC_uS, 0), rampIncreasing);
+      return getBrightnessLevel();
+    }
 };
 
 #endif
\ No newline at end of file
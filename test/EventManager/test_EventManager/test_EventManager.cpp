@@ -34,9 +34,9 @@ auto EventManagerFactory(
   std::shared_ptr<MockModalLights> modalLights,
   std::shared_ptr<ConfigManagerClass> configs,
   std::shared_ptr<DeviceTimeClass> deviceTime,
-  std::vector<EventDataPacket> testEvents
+  std::vector<EventDataPacket> testEvents,
+  std::vector<ModeDataStruct> modeDataPackets = {}
 ){
-  std::vector<ModeDataStruct> modeDataPackets = {};
   auto mockStorageHAL = std::make_shared<MockStorageHAL>(modeDataPackets, testEvents);
   std::vector<TestModeDataStruct> testModes = {testModesMap["warmConstBrightness"]};
   auto dataStorage = std::make_shared<DataStorageClass>(std::move(mockStorageHAL));
@@ -1301,6 +1301,59 @@ void testTimeUpdates(void){
 
 }
 
+void sunriseEventsTriggerAWindowEarly(){
+  // a sunrise finishes at its event time, so it has to trigger a window early. the mode still gets the event time
+  ModeDataStruct sunriseMode;
+  sunriseMode.ID = 3;
+  sunriseMode.type = ModeTypes::sunrise;
+  sunriseMode.time[0] = 30;
+  const uint32_t window_S = 30*60;
+
+  std::shared_ptr<ConfigManagerClass> configs = makeTestConfigManager();
+  std::shared_ptr<DeviceTimeClass> deviceTime = std::make_shared<DeviceTimeClass>(configs);
+  std::shared_ptr<MockModalLights> modalLights = std::make_shared<MockModalLights>();
+
+  // tuesday at 00:10 triggers on monday night
+  const EventDataPacket sunriseEvent = {1, sunriseMode.ID, timeToSeconds(0, 10, 0), 0b00000010 /*tuesday*/, oneHour, false};
+  const uint64_t eventTime = mondayAtMidnight + secondsInDay + sunriseEvent.timeOfDay;
+  deviceTime->setLocalTimestamp2000(mondayAtMidnight + timeToSeconds(23, 0, 0), 0, 0);
+  EventManager testClass = EventManagerFactory(modalLights, configs, deviceTime, {sunriseEvent}, {sunriseMode});
+  TEST_ASSERT_EQUAL(eventTime - window_S, testClass.getNextEvent().triggerTime);
+
+  modalLights->resetInstance();
+  deviceTime->setLocalTimestamp2000(eventTime - window_S - 1, 0, 0);
+  testClass.check();
+  TEST_ASSERT_EQUAL(0, modalLights->getModeCallCount(sunriseMode.ID));
+
+  deviceTime->setLocalTimestamp2000(eventTime - window_S, 0, 0);
+  testClass.check();
+  TEST_ASSERT_EQUAL(1, modalLights->getModeCallCount(sunriseMode.ID));
+  TEST_ASSERT_EQUAL(sunriseMode.ID, modalLights->getBackgroundMode());
+  TEST_ASSERT_EQUAL(eventTime, modalLights->getMostRecentTriggerTime());
+
+  // and next week, still on monday night
+  TEST_ASSERT_EQUAL(eventTime - window_S + 7*secondsInDay, testClass.getNextEvent().triggerTime);
+
+  // updating it to an active event keeps the lead time
+  EventDataPacket activeSunrise = sunriseEvent;
+  activeSunrise.isActive = true;
+  TEST_ASSERT_EQUAL(EventManagerErrors::success, testClass.updateEvent(activeSunrise));
+  TEST_ASSERT_EQUAL(eventTime - window_S + 7*secondsInDay, testClass.getNextActiveEvent().triggerTime);
+
+  // other modes trigger on time
+  const EventDataPacket otherEvent = {2, 2, sunriseEvent.timeOfDay, sunriseEvent.daysOfWeek, oneHour, true};
+  TEST_ASSERT_EQUAL(EventManagerErrors::success, testClass.addEvent(otherEvent));
+  deviceTime->setLocalTimestamp2000(eventTime - 1, 0, 0);
+  testClass.check();
+  TEST_ASSERT_EQUAL(0, modalLights->getModeCallCount(otherEvent.modeID));
+  deviceTime->setLocalTimestamp2000(eventTime, 0, 0);
+  testClass.check();
+  TEST_ASSERT_EQUAL(1, modalLights->getModeCallCount(otherEvent.modeID));
+  TEST_ASSERT_EQUAL(otherEvent.modeID, modalLights->getActiveMode());
+
+  deviceTime->remove_observer(testClass);
+}
+
 void testEventLimit(){
   // test that the number of stored events cannot exceed a pre-defined limit
 
@@ -1485,6 +1538,7 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(testUpdateEvent);
   RUN_TEST(eventSkipping);
   RUN_TEST(testTimeUpdates);
+  RUN_TEST(sunriseEventsTriggerAWindowEarly);
   RUN_TEST(testEventLimit);
   UNITY_END();
 }
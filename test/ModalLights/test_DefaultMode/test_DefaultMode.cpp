@@ -0,0 +1,52 @@
+// this gets built with its own default mode ID (env:native_default_mode in platformio.ini)
+#include <unity.h>
+
+#include "../test_ModalLights/testHelpers.h"
+#include "AsyncDataStorage.h"
+
+static_assert(defaultModeID != 1, "build with -D DEFAULT_MODE_ID, so that the default mode isn't 1");
+
+void setUp(void){}
+void tearDown(void){}
+
+void testDefaultModeExists(){
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, defaultConfigs);
+  TEST_ASSERT_TRUE(testObjects.storage->doesModeExist(defaultModeID));
+
+  // nothing has been requested, so the default mode runs
+  testObjects.modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(defaultModeID, 0, testObjects.modalLights);
+}
+
+void testDefaultModeFillsInForAsyncLoad(){
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, defaultConfigs);
+  auto modalLights = testObjects.modalLights;
+  auto asyncStorage = std::make_shared<AsyncDataStorage>(testObjects.storage);
+  asyncStorage->useExternalWorker();
+  modalLights->useAsyncStorage(asyncStorage);
+
+  // the default mode runs until the background mode has been read, without waiting for storage
+  const modeUUID backgroundID = testModesMap["purpleConstBrightness"].ID;
+  modalLights->setModeByUUID(backgroundID, testObjects.deviceTime->getLocalTimestampSeconds(), false);
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(defaultModeID, 0, modalLights);
+  TEST_ASSERT_TRUE(modalLights->isModeLoadPending());
+  TEST_ASSERT_EQUAL(0, testObjects.mockStorageHAL->getModeCount);
+
+  TEST_ASSERT_EQUAL(1, asyncStorage->serviceRequests());
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, 0, modalLights);
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testDefaultModeExists);
+  RUN_TEST(testDefaultModeFillsInForAsyncLoad);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
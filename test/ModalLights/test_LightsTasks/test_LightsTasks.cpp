@@ -0,0 +1,300 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../test_ModalLights/testHelpers.h"
+#include "lightsOutputTask.h"
+#include "modalLightsProxy.h"
+
+void setUp(void){}
+void tearDown(void){}
+
+namespace LightsTasksTests{
+  using namespace std::chrono;
+
+  /**
+   * @brief records the longest gap between PWM writes
+   */
+  class JitterLightsClass : public VirtualLightsClass {
+    public:
+      static std::atomic<int64_t> maxGap_uS;
+      static std::atomic<int64_t> lastWrite_uS;
+
+      static int64_t now_uS(){
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+      }
+
+      static void reset(){
+        maxGap_uS = 0;
+        lastWrite_uS = 0;
+      }
+
+      void setChannelValues(duty_t newValues[nChannels]) override {
+        const int64_t now = now_uS();
+        const int64_t last = lastWrite_uS.exchange(now);
+        if(last != 0 && now - last > maxGap_uS){maxGap_uS = now - last;}
+      }
+  };
+  std::atomic<int64_t> JitterLightsClass::maxGap_uS{0};
+  std::atomic<int64_t> JitterLightsClass::lastWrite_uS{0};
+
+  /**
+   * @brief storage that takes a while to read a mode, like flash with a cache miss
+   */
+  class SlowStorageHAL : public MockStorageHAL {
+    public:
+      uint32_t readTime_uS = 0;
+
+      SlowStorageHAL(const std::vector<ModeDataStruct> modes) : MockStorageHAL(modes, {}){}
+
+      bool getModeAt(nModes_t position, uint8_t buffer[modePacketSize]){
+        std::this_thread::sleep_for(microseconds(readTime_uS));
+        return MockStorageHAL::getModeAt(position, buffer);
+      }
+  };
+
+  struct SplitObjectsStruct {
+    std::shared_ptr<DeviceTimeClass> deviceTime;
+    std::shared_ptr<SlowStorageHAL> storageHAL;
+    std::shared_ptr<DataStorageClass> storage;
+    std::shared_ptr<AsyncDataStorage> asyncStorage;
+    std::shared_ptr<ModalLightsController> modalLights;
+    std::shared_ptr<LightsTaskChannel> channel;
+    std::shared_ptr<ModalLightsProxy> proxy;
+    std::unique_ptr<LightsOutputTask> outputTask;
+  };
+
+  template <class LightsClass>
+  SplitObjectsStruct makeSplitObjects(){
+    SplitObjectsStruct objects;
+    auto configManager = std::make_shared<ConfigManagerClass>(makeConcreteConfigHal<MockConfigHal>());
+    configManager->setModalConfigs(defaultConfigs);
+    objects.deviceTime = std::make_shared<DeviceTimeClass>(configManager);
+    objects.deviceTime->setLocalTimestamp2000(800000000, 0, 0);
+
+    objects.storageHAL = std::make_shared<SlowStorageHAL>(makeModeDataStructArray(getAllTestingModes(), TestChannels::white));
+    objects.storage = std::make_shared<DataStorageClass>(objects.storageHAL);
+    objects.storage->loadIDs();
+
+    objects.modalLights = std::make_shared<ModalLightsController>(
+      concreteLightsClassFactory<LightsClass>(),
+      objects.deviceTime,
+      objects.storage,
+      configManager
+    );
+    // time updates come through the channel instead
+    objects.deviceTime->remove_observer(*objects.modalLights);
+
+    objects.channel = std::make_shared<LightsTaskChannel>();
+    objects.asyncStorage = std::make_shared<AsyncDataStorage>(objects.storage);
+    objects.proxy = std::make_shared<ModalLightsProxy>(objects.channel, objects.asyncStorage, objects.deviceTime);
+    objects.outputTask = std::make_unique<LightsOutputTask>(objects.modalLights, objects.channel);
+    return objects;
+  }
+
+  const uint32_t slowRead_uS = 20000;
+  const uint32_t outputPeriod_uS = 1000;
+  const uint32_t modeChangePeriod_uS = 50000;
+  const uint32_t runTime_uS = 500000;
+}
+
+void testCommandsAndReports(){
+  using namespace LightsTasksTests;
+  SplitObjectsStruct objects = makeSplitObjects<TestLEDClass>();
+  objects.outputTask->update();
+  objects.proxy->updateLights();
+  TEST_ASSERT_EQUAL(1, objects.proxy->getCurrentModes().backgroundMode);
+
+  // the storage read happens on the control side, when the proxy collects the async reads
+  const uint16_t readsBefore = objects.storageHAL->getModeCount;
+  objects.proxy->setModeByUUID(5, objects.deviceTime->getLocalTimestampSeconds(), true);
+  TEST_ASSERT_EQUAL(readsBefore, objects.storageHAL->getModeCount);
+  objects.proxy->updateLights();
+  TEST_ASSERT_EQUAL(readsBefore + 1, objects.storageHAL->getModeCount);
+  TEST_ASSERT_EQUAL(0, objects.modalLights->getCurrentModes().activeMode);
+  objects.outputTask->update();
+  TEST_ASSERT_EQUAL(readsBefore + 1, objects.storageHAL->getModeCount);
+  TEST_ASSERT_EQUAL(5, objects.modalLights->getCurrentModes().activeMode);
+
+  // the proxy only finds out when it reads the reports
+  TEST_ASSERT_EQUAL(0, objects.proxy->getCurrentModes().activeMode);
+  objects.proxy->updateLights();
+  TEST_ASSERT_EQUAL(5, objects.proxy->getCurrentModes().activeMode);
+
+  // user actions
+  objects.proxy->cancelActiveMode();
+  objects.proxy->setBrightnessLevel(123);
+  objects.outputTask->update();
+  objects.proxy->updateLights();
+  TEST_ASSERT_EQUAL(0, objects.proxy->getCurrentModes().activeMode);
+  TEST_ASSERT_EQUAL(123, objects.modalLights->getSetBrightness());
+  TEST_ASSERT_EQUAL(123, objects.proxy->getSetBrightness());
+
+  objects.proxy->setState(false);
+  objects.outputTask->update();
+  objects.proxy->updateLights();
+  TEST_ASSERT_FALSE(objects.modalLights->getState());
+  TEST_ASSERT_FALSE(objects.proxy->getState());
+  TEST_ASSERT_EQUAL(0, objects.proxy->getBrightnessLevel());
+}
+
+void testFullQueue(){
+  using namespace LightsTasksTests;
+  SplitObjectsStruct objects = makeSplitObjects<TestLEDClass>();
+  objects.outputTask->update();
+
+  // fill the queue, then change mode and time
+  for(uint8_t i = 0; i < LIGHT_COMMAND_QUEUE_SIZE; i++){
+    objects.proxy->setBrightnessLevel(100 + i);
+  }
+  // anything else gets dropped, and counted
+  const uint32_t dropsBefore = getMetrics().getCount(MetricCounters::lightCommandDrops);
+  objects.proxy->setState(false);
+  objects.proxy->adjustBrightness(10, true);
+  TEST_ASSERT_EQUAL(dropsBefore + 2, getMetrics().getCount(MetricCounters::lightCommandDrops));
+
+  objects.proxy->setModeByUUID(5, objects.deviceTime->getLocalTimestampSeconds(), true);
+  objects.proxy->setModeByUUID(6, objects.deviceTime->getLocalTimestampSeconds(), true);  // only the newest mode matters
+  objects.deviceTime->setUTCTimestamp2000(objects.deviceTime->getUTCTimestampSeconds() + 60, 0, 0);
+  objects.deviceTime->flushTimeUpdates();
+
+  objects.outputTask->update();
+  TEST_ASSERT_EQUAL(0, objects.modalLights->getCurrentModes().activeMode);
+
+  // the mode change gets retried, and isn't lost
+  objects.proxy->updateLights();
+  objects.outputTask->update();
+  TEST_ASSERT_EQUAL(6, objects.modalLights->getCurrentModes().activeMode);
+
+  // nothing left over
+  objects.proxy->updateLights();
+  TEST_ASSERT_TRUE(objects.channel->commands.isEmpty());
+  TEST_ASSERT_EQUAL(dropsBefore + 2, getMetrics().getCount(MetricCounters::lightCommandDrops));
+  TEST_ASSERT_TRUE(objects.modalLights->getState());
+}
+
+void testClockJumpDuringPulse(){
+  // the output task hears about time changes through the channel. its clock shouldn't jump until then, otherwise the pulse runs through the jump and then the time adjustment holds it still for just as long
+  using namespace LightsTasksTests;
+  SplitObjectsStruct objects = makeSplitObjects<TestLEDClass>();
+  OnboardTimestamp timestamp;
+  const auto incrementTimeAndUpdate_uS = [&](uint64_t increment_uS){
+    timestamp.setTimestamp_uS(timestamp.getTimestamp_uS() + increment_uS);
+    objects.outputTask->update();
+    return objects.modalLights->getBrightnessLevel();
+  };
+  // like the control loop, which flushes once per iteration
+  objects.deviceTime->deferTimeUpdates(true);
+
+  const modeUUID pulseID = testModesMap["pulse"].ID;
+  objects.proxy->setModeByUUID(pulseID, objects.deviceTime->getLocalTimestampSeconds(), false);
+  objects.proxy->updateLights();
+  objects.outputTask->update();
+  TEST_ASSERT_EQUAL(pulseID, objects.modalLights->getCurrentModes().backgroundMode);
+
+  // get past the soft change, then record a period a quarter at a time
+  const uint64_t period_uS = testModesMap["pulse"].time[0] * 100000;
+  incrementTimeAndUpdate_uS(2*period_uS);
+  duty_t expectedB[4];
+  for(uint8_t i = 0; i < 4; i++){
+    expectedB[i] = incrementTimeAndUpdate_uS(period_uS/4);
+  }
+  TEST_ASSERT_NOT_EQUAL(expectedB[0], expectedB[1]);
+
+  // jump forwards by half a period more than a whole number of them. the output task runs before the time update reaches it
+  const uint64_t jump_uS = 3*period_uS + period_uS/2;
+  TEST_ASSERT_TRUE(objects.deviceTime->setUTCTimestamp2000((timestamp.getTimestamp_uS() + jump_uS)/secondsToMicros, 0, 0));
+  TEST_ASSERT_EQUAL(expectedB[3], incrementTimeAndUpdate_uS(0));
+
+  objects.deviceTime->flushTimeUpdates();
+  TEST_ASSERT_EQUAL(expectedB[3], incrementTimeAndUpdate_uS(0));
+
+  // and the pulse carries on from where it was
+  for(uint8_t i = 0; i < 4; i++){
+    TEST_ASSERT_UINT8_WITHIN(1, expectedB[i], incrementTimeAndUpdate_uS(period_uS/4));
+  }
+}
+
+void benchmarkOutputJitter(){
+  using namespace LightsTasksTests;
+  using namespace std::chrono;
+
+  // before: storage reads happen in the same loop as the PWM writes
+  int64_t singleLoopGap_uS;
+  {
+    SplitObjectsStruct objects = makeSplitObjects<JitterLightsClass>();
+    // start from a mode that's always writing, because the default mode goes idle
+    objects.modalLights->setModeByUUID(6, objects.deviceTime->getLocalTimestampSeconds(), true);
+    objects.modalLights->updateLights();
+    objects.storageHAL->readTime_uS = slowRead_uS;
+    JitterLightsClass::reset();
+    const auto start = steady_clock::now();
+    auto nextTick = start;
+    uint32_t tick = 0;
+    while(steady_clock::now() - start < microseconds(runTime_uS)){
+      if(tick % (modeChangePeriod_uS / outputPeriod_uS) == 0){
+        objects.modalLights->setModeByUUID((tick / (modeChangePeriod_uS / outputPeriod_uS)) % 2 ? 6 : 5, objects.deviceTime->getLocalTimestampSeconds(), true);
+      }
+      objects.modalLights->updateLights();
+      tick++;
+      nextTick += microseconds(outputPeriod_uS);
+      std::this_thread::sleep_until(nextTick);
+    }
+    singleLoopGap_uS = JitterLightsClass::maxGap_uS;
+  }
+
+  // after: the control thread does the storage reads (cooperatively, since there isn't a storage worker natively)
+  int64_t splitGap_uS;
+  {
+    SplitObjectsStruct objects = makeSplitObjects<JitterLightsClass>();
+    const uint64_t triggerTime_S = objects.deviceTime->getLocalTimestampSeconds();
+    objects.proxy->setModeByUUID(6, triggerTime_S, true);
+    objects.proxy->updateLights();
+    objects.outputTask->update();
+    objects.storageHAL->readTime_uS = slowRead_uS;
+    JitterLightsClass::reset();
+    std::atomic<bool> isRunning{true};
+
+    std::thread control([&](){
+      uint32_t change = 0;
+      while(isRunning){
+        objects.proxy->setModeByUUID(change++ % 2 ? 6 : 5, triggerTime_S, true);
+        objects.proxy->updateLights();
+        std::this_thread::sleep_for(microseconds(modeChangePeriod_uS));
+      }
+    });
+
+    const auto start = steady_clock::now();
+    auto nextTick = start;
+    while(steady_clock::now() - start < microseconds(runTime_uS)){
+      objects.outputTask->update();
+      nextTick += microseconds(outputPeriod_uS);
+      std::this_thread::sleep_until(nextTick);
+    }
+    isRunning = false;
+    control.join();
+    splitGap_uS = JitterLightsClass::maxGap_uS;
+  }
+
+  printf("worst gap between PWM writes, with a %lu uS storage read every %lu uS: single loop %lld uS, split %lld uS\n",
+    (unsigned long)slowRead_uS, (unsigned long)modeChangePeriod_uS, (long long)singleLoopGap_uS, (long long)splitGap_uS
+  );
+  TEST_ASSERT_TRUE(singleLoopGap_uS >= slowRead_uS);
+  TEST_ASSERT_TRUE_MESSAGE(splitGap_uS < singleLoopGap_uS, "splitting the tasks should stop storage reads from delaying the output");
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testCommandsAndReports);
+  RUN_TEST(testFullQueue);
+  RUN_TEST(testClockJumpDuringPulse);
+  RUN_TEST(benchmarkOutputJitter);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
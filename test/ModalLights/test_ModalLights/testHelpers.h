@@ -38,6 +38,7 @@ struct TestObjectsStruct {
 
   // this is to test ModalLights getting a mode from storage
   std::shared_ptr<MockStorageHAL> mockStorageHAL;
+  std::shared_ptr<DataStorageClass> storage;
 
   const std::vector<ModeDataStruct> initialModes;
   std::shared_ptr<ModalLightsController> modalLights;
@@ -58,6 +59,7 @@ TestObjectsStruct modalLightsFactory(TestChannels channel, const std::vector<Tes
   testObjects.mockStorageHAL = std::make_shared<MockStorageHAL>(testObjects.initialModes, getAllTestEvents());
   auto storage = std::make_shared<DataStorageClass>(testObjects.mockStorageHAL);
   storage->loadIDs();
+  testObjects.storage = storage;
   
   auto lightsClass = concreteLightsClassFactory<TestLEDClass>();
   testObjects.modalLights = std::make_shared<ModalLightsController>(
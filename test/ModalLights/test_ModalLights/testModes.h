@@ -143,6 +143,101 @@ static etl::flat_map<std::string, TestModeDataStruct, 255> testModesMap = {
     .whiteAndWarm = {0, 255},
     .RGB = {255, 192, 111}
   }, 100, 2)},
+  {"sunrise", TestModeDataStruct{
+    .ID = 3,
+    .type = ModeTypes::sunrise,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 200},
+      .RGB = {255, 230, 180}
+    },
+    .startColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {0, 255},
+      .RGB = {255, 64, 0}
+    },
+    .brightness1 = 255,
+    .time = {30, 0, 0}  // 30 minute window
+  }},
+  {"sunset", TestModeDataStruct{
+    .ID = 4,
+    .type = ModeTypes::sunset,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {100, 255},
+      .RGB = {255, 140, 40}
+    },
+    .brightness1 = 40,
+    .time = {10, 0, 0}  // 10 seconds per step
+  }},
+  {"pulse", TestModeDataStruct{
+    .ID = 5,
+    .type = ModeTypes::pulse,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 255},
+      .RGB = {255, 0, 0}
+    },
+    .startColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {0, 255},
+      .RGB = {0, 0, 255}
+    },
+    .brightness1 = 200,
+    .brightness0 = 20,
+    .time = {20, 0, 0}  // 2 second period
+  }},
+  {"chirp", TestModeDataStruct{
+    .ID = 6,
+    .type = ModeTypes::chirp,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 255},
+      .RGB = {255, 255, 255}
+    },
+    .startColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 255},
+      .RGB = {255, 255, 255}
+    },
+    .brightness1 = 100,
+    .brightness0 = 10,
+    .finalBrightness1 = 255,
+    .finalBrightness0 = 50,
+    .time = {40, 5, 2}  // 4 seconds down to half a second over 2 minutes
+  }},
+  {"changing", TestModeDataStruct{
+    .ID = 7,
+    .type = ModeTypes::changing,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {0, 255},
+      .RGB = {255, 0, 0}
+    },
+    .startColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 0},
+      .RGB = {0, 255, 0}
+    },
+    .time = {0x01, 0x0E, 0}  // 270 minutes, colours only
+  }},
+  {"changingBrightness", TestModeDataStruct{
+    .ID = 8,
+    .type = ModeTypes::changing,
+    .endColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {255, 255},
+      .RGB = {255, 255, 255}
+    },
+    .startColourRatios = ColourRatiosStruct{
+      .white = {255},
+      .whiteAndWarm = {0, 255},
+      .RGB = {0, 0, 255}
+    },
+    .brightness1 = 220,
+    .brightness0 = 20,
+    .time = {0, 10, 0}  // 10 minutes
+  }},
 
   // These modes are for testing only, so have auto-generated IDs starting from 255 downwards
   {"purpleConstBrightness", makeConstBrightnessTestStruct(ColourRatiosStruct{
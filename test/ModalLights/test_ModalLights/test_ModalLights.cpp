@@ -1,6 +1,11 @@
 #include <unity.h>
 #include <ModalLights.h>
 #include "test_constBrightness.h"
+#include "test_sunrise.h"
+#include "test_sunset.h"
+#include "test_pulse.h"
+#include "test_changing.h"
+#include "test_layers.h"
 
 void setUp(void) {
   // set stuff up here
@@ -73,9 +78,244 @@ void SerializeAndDeserializeModeData(){
     TEST_ASSERT_EQUAL(testMode.minBrightness, actualStruct.minBrightness);
   }
 
-  // TODO: test the other modes
+  // test sunrise
+  {
+    const uint8_t modeDataSize = sizeof(ModeDataStruct::ID) + sizeof(ModeDataStruct::type) + sizeof(ModeDataStruct::endColourRatios) + sizeof(ModeDataStruct::startColourRatios) + sizeof(ModeDataStruct::maxBrightness) + sizeof(ModeDataStruct::time[0]);
+    TEST_ASSERT_EQUAL(modeDataSize, getModeDataSize(ModeTypes::sunrise));
+
+    ModeDataStruct tempMode = ModeDataStruct{
+      .ID = 6,
+      .type = ModeTypes::sunrise,
+      .maxBrightness = 200,
+      .minBrightness = 20,
+      .time = {30, 4, 5}
+    };
+    const duty_t endColours[8] = {255, 163, 247, 209, 69, 42, 0, 8};
+    const duty_t startColours[8] = {10, 20, 30, 40, 50, 60, 70, 80};
+    memcpy(tempMode.endColourRatios, endColours, nChannels);
+    memcpy(tempMode.startColourRatios, startColours, nChannels);
+    const ModeDataStruct testMode = tempMode;
+
+    uint8_t expectedBuffer[modePacketSize];
+    {
+      expectedBuffer[0] = testMode.ID;
+      expectedBuffer[1] = static_cast<uint8_t>(testMode.type);
+      int i = 2;
+      for(int c = 0; c<nChannels; c++){
+        expectedBuffer[i] = endColours[c];
+        i++;
+      }
+      for(int c = 0; c<nChannels; c++){
+        expectedBuffer[i] = startColours[c];
+        i++;
+      }
+      expectedBuffer[i] = testMode.maxBrightness;
+      i++;
+      expectedBuffer[i] = testMode.time[0];
+      i++;
+      for(i; i < modePacketSize; i++){
+        expectedBuffer[i] = 0;
+      }
+    }
+
+    uint8_t buffer[modePacketSize];
+    serializeModeDataStruct(testMode, buffer);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBuffer, buffer, modePacketSize);
+
+    // min brightness and the other times aren't used, so they aren't stored
+    ModeDataStruct actualStruct;
+    deserializeModeData(buffer, &actualStruct);
+    TEST_ASSERT_EQUAL(testMode.ID, actualStruct.ID);
+    TEST_ASSERT_EQUAL(testMode.type, actualStruct.type);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(endColours, actualStruct.endColourRatios, nChannels);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(startColours, actualStruct.startColourRatios, nChannels);
+    TEST_ASSERT_EQUAL(testMode.maxBrightness, actualStruct.maxBrightness);
+    TEST_ASSERT_EQUAL(0, actualStruct.minBrightness);
+    TEST_ASSERT_EQUAL(testMode.time[0], actualStruct.time[0]);
+    TEST_ASSERT_EQUAL(0, actualStruct.time[1]);
+  }
+
+  // test sunset
+  {
+    const uint8_t modeDataSize = sizeof(ModeDataStruct::ID) + sizeof(ModeDataStruct::type) + sizeof(ModeDataStruct::endColourRatios) + sizeof(ModeDataStruct::maxBrightness) + sizeof(ModeDataStruct::time[0]);
+    TEST_ASSERT_EQUAL(modeDataSize, getModeDataSize(ModeTypes::sunset));
+
+    ModeDataStruct tempMode = ModeDataStruct{
+      .ID = 7,
+      .type = ModeTypes::sunset,
+      .maxBrightness = 40,
+      .time = {12, 0, 0}
+    };
+    const duty_t endColours[8] = {255, 163, 247, 209, 69, 42, 0, 8};
+    memcpy(tempMode.endColourRatios, endColours, nChannels);
+    const ModeDataStruct testMode = tempMode;
+
+    uint8_t expectedBuffer[modePacketSize];
+    {
+      expectedBuffer[0] = testMode.ID;
+      expectedBuffer[1] = static_cast<uint8_t>(testMode.type);
+      int i = 2;
+      for(int c = 0; c<nChannels; c++){
+        expectedBuffer[i] = endColours[c];
+        i++;
+      }
+      expectedBuffer[i] = testMode.maxBrightness;
+      i++;
+      expectedBuffer[i] = testMode.time[0];
+      i++;
+      for(i; i < modePacketSize; i++){
+        expectedBuffer[i] = 0;
+      }
+    }
+
+    uint8_t buffer[modePacketSize];
+    serializeModeDataStruct(testMode, buffer);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBuffer, buffer, modePacketSize);
+
+    ModeDataStruct actualStruct;
+    deserializeModeData(buffer, &actualStruct);
+    TEST_ASSERT_EQUAL(testMode.ID, actualStruct.ID);
+    TEST_ASSERT_EQUAL(testMode.type, actualStruct.type);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(endColours, actualStruct.endColourRatios, nChannels);
+    TEST_ASSERT_EQUAL(testMode.maxBrightness, actualStruct.maxBrightness);
+    TEST_ASSERT_EQUAL(testMode.time[0], actualStruct.time[0]);
+  }
+
+  // test pulse and chirp
+  {
+    const uint8_t pulseDataSize = sizeof(ModeDataStruct::ID) + sizeof(ModeDataStruct::type) + sizeof(ModeDataStruct::endColourRatios) + sizeof(ModeDataStruct::startColourRatios) + sizeof(ModeDataStruct::maxBrightness) + sizeof(ModeDataStruct::minBrightness) + sizeof(ModeDataStruct::time[0]);
+    TEST_ASSERT_EQUAL(pulseDataSize, getModeDataSize(ModeTypes::pulse));
+    const uint8_t chirpDataSize = pulseDataSize + sizeof(ModeDataStruct::finalMaxBrightness) + sizeof(ModeDataStruct::finalMinBrightness) + 2*sizeof(ModeDataStruct::time[0]);
+    TEST_ASSERT_EQUAL(chirpDataSize, getModeDataSize(ModeTypes::chirp));
+
+    const duty_t endColours[8] = {255, 163, 247, 209, 69, 42, 0, 8};
+    const duty_t startColours[8] = {12, 0, 255, 93, 111, 4, 62, 200};
+    for(ModeTypes type : {ModeTypes::pulse, ModeTypes::chirp}){
+      const bool isChirp = type == ModeTypes::chirp;
+      ModeDataStruct tempMode = ModeDataStruct{
+        .ID = 8,
+        .type = type,
+        .maxBrightness = 200,
+        .minBrightness = 30,
+        .finalMaxBrightness = 255,
+        .finalMinBrightness = 100,
+        .time = {20, 5, 3}
+      };
+      memcpy(tempMode.endColourRatios, endColours, nChannels);
+      memcpy(tempMode.startColourRatios, startColours, nChannels);
+      const ModeDataStruct testMode = tempMode;
+
+      uint8_t expectedBuffer[modePacketSize];
+      {
+        expectedBuffer[0] = testMode.ID;
+        expectedBuffer[1] = static_cast<uint8_t>(testMode.type);
+        int i = 2;
+        for(int c = 0; c<nChannels; c++){
+          expectedBuffer[i] = endColours[c];
+          i++;
+        }
+        for(int c = 0; c<nChannels; c++){
+          expectedBuffer[i] = startColours[c];
+          i++;
+        }
+        expectedBuffer[i] = testMode.maxBrightness;
+        i++;
+        expectedBuffer[i] = testMode.minBrightness;
+        i++;
+        if(isChirp){
+          expectedBuffer[i] = testMode.finalMaxBrightness;
+          i++;
+          expectedBuffer[i] = testMode.finalMinBrightness;
+          i++;
+        }
+        for(int t = 0; t < (isChirp ? 3 : 1); t++){
+          expectedBuffer[i] = testMode.time[t];
+          i++;
+        }
+        TEST_ASSERT_EQUAL(getModeDataSize(type), i);
+        for(i; i < modePacketSize; i++){
+          expectedBuffer[i] = 0;
+        }
+      }
+
+      uint8_t buffer[modePacketSize];
+      serializeModeDataStruct(testMode, buffer);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBuffer, buffer, modePacketSize);
+
+      ModeDataStruct actualStruct;
+      deserializeModeData(buffer, &actualStruct);
+      TEST_ASSERT_EQUAL(testMode.ID, actualStruct.ID);
+      TEST_ASSERT_EQUAL(testMode.type, actualStruct.type);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(endColours, actualStruct.endColourRatios, nChannels);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(startColours, actualStruct.startColourRatios, nChannels);
+      TEST_ASSERT_EQUAL(testMode.maxBrightness, actualStruct.maxBrightness);
+      TEST_ASSERT_EQUAL(testMode.minBrightness, actualStruct.minBrightness);
+      TEST_ASSERT_EQUAL(isChirp ? testMode.finalMaxBrightness : 0, actualStruct.finalMaxBrightness);
+      TEST_ASSERT_EQUAL(isChirp ? testMode.finalMinBrightness : 0, actualStruct.finalMinBrightness);
+      TEST_ASSERT_EQUAL(testMode.time[0], actualStruct.time[0]);
+      TEST_ASSERT_EQUAL(isChirp ? testMode.time[1] : 0, actualStruct.time[1]);
+      TEST_ASSERT_EQUAL(isChirp ? testMode.time[2] : 0, actualStruct.time[2]);
+    }
+  }
+
+  // test changing
+  {
+    const uint8_t modeDataSize = sizeof(ModeDataStruct::ID) + sizeof(ModeDataStruct::type) + sizeof(ModeDataStruct::endColourRatios) + sizeof(ModeDataStruct::startColourRatios) + sizeof(ModeDataStruct::maxBrightness) + sizeof(ModeDataStruct::minBrightness) + 2*sizeof(ModeDataStruct::time[0]);
+    TEST_ASSERT_EQUAL(modeDataSize, getModeDataSize(ModeTypes::changing));
+
+    ModeDataStruct tempMode = ModeDataStruct{
+      .ID = 9,
+      .type = ModeTypes::changing,
+      .maxBrightness = 180,
+      .minBrightness = 3,
+      .time = {0x27, 0x10, 0}  // 10000 minutes
+    };
+    const duty_t endColours[8] = {255, 163, 247, 209, 69, 42, 0, 8};
+    const duty_t startColours[8] = {12, 0, 255, 93, 111, 4, 62, 200};
+    memcpy(tempMode.endColourRatios, endColours, nChannels);
+    memcpy(tempMode.startColourRatios, startColours, nChannels);
+    const ModeDataStruct testMode = tempMode;
+
+    uint8_t expectedBuffer[modePacketSize];
+    {
+      expectedBuffer[0] = testMode.ID;
+      expectedBuffer[1] = static_cast<uint8_t>(testMode.type);
+      int i = 2;
+      for(int c = 0; c<nChannels; c++){
+        expectedBuffer[i] = endColours[c];
+        i++;
+      }
+      for(int c = 0; c<nChannels; c++){
+        expectedBuffer[i] = startColours[c];
+        i++;
+      }
+      expectedBuffer[i] = testMode.maxBrightness;
+      i++;
+      expectedBuffer[i] = testMode.minBrightness;
+      i++;
+      expectedBuffer[i] = testMode.time[0];
+      i++;
+      expectedBuffer[i] = testMode.time[1];
+      i++;
+      for(i; i < modePacketSize; i++){
+        expectedBuffer[i] = 0;
+      }
+    }
+
+    uint8_t buffer[modePacketSize];
+    serializeModeDataStruct(testMode, buffer);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedBuffer, buffer, modePacketSize);
 
-  TEST_IGNORE_MESSAGE("need to do the other modes; constant brightness mode passed");
+    ModeDataStruct actualStruct;
+    deserializeModeData(buffer, &actualStruct);
+    TEST_ASSERT_EQUAL(testMode.ID, actualStruct.ID);
+    TEST_ASSERT_EQUAL(testMode.type, actualStruct.type);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(endColours, actualStruct.endColourRatios, nChannels);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(startColours, actualStruct.startColourRatios, nChannels);
+    TEST_ASSERT_EQUAL(testMode.maxBrightness, actualStruct.maxBrightness);
+    TEST_ASSERT_EQUAL(testMode.minBrightness, actualStruct.minBrightness);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testMode.time, actualStruct.time, 3);
+  }
 }
 
 void testConfigGuards(){
@@ -599,6 +839,123 @@ void testModeSwitching(){
   TEST_IGNORE_MESSAGE("TODO");
 }
 
+void testModeCrossfade(){
+  // modes that don't start from the current values get crossfaded into over the soft change window
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 4
+  };
+  const TestModeDataStruct changingMode = testModesMap["changing"];
+  const duty_t brightness = 150;
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->setBrightnessLevel(brightness);
+  const uint64_t triggerTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  duty_t outgoingChannels[nChannels];
+  fillChannelBrightness(outgoingChannels, defaultConstantBrightness.endColourRatios.RGB, brightness);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(outgoingChannels, currentChannelValues, nChannels);
+
+  testClass->setModeByUUID(changingMode.ID, triggerTime_S, false);
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(changingMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(outgoingChannels, currentChannelValues, nChannels);
+  TEST_ASSERT_FALSE(testClass->isIdle());
+
+  // the timeline is so long that the incoming colours are still at the start
+  duty_t incomingChannels[nChannels];
+  fillChannelBrightness(incomingChannels, changingMode.startColourRatios.RGB, brightness);
+  for(uint8_t step = 1; step < 4; step++){
+    incrementTimeAndUpdate_S(1, testObjects);
+    const float ratio = step/4.;
+    std::string message = "failed at step " + std::to_string(step);
+    for(uint8_t c = 0; c < nChannels; c++){
+      TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, interpolate(outgoingChannels[c], incomingChannels[c], ratio), currentChannelValues[c], message.c_str());
+    }
+    TEST_ASSERT_FALSE_MESSAGE(testClass->isIdle(), message.c_str());
+  }
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(incomingChannels, currentChannelValues, nChannels);
+
+  // touching the lights during a crossfade ends it straight away
+  testClass->setModeByUUID(1, incrementTimeAndUpdate_S(1, testObjects), false);
+  testClass->updateLights();
+  testClass->setModeByUUID(changingMode.ID, incrementTimeAndUpdate_S(1, testObjects), false);
+  testClass->updateLights();
+  incrementTimeAndUpdate_S(1, testObjects);
+  testClass->adjustBrightness(10, false);
+  fillChannelBrightness(incomingChannels, changingMode.startColourRatios.RGB, brightness - 10);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(incomingChannels, currentChannelValues, nChannels);
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(incomingChannels, currentChannelValues, nChannels);
+}
+
+void testUnknownModeType(){
+  // mode data with a type that isn't recognised (i.e. corrupt, or from newer firmware) is ignored, and whatever was running carries on
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 1
+  };
+  const TestModeDataStruct warmMode = testModesMap["warmConstBrightness"];
+  const TestModeDataStruct purpleMode = testModesMap["purpleConstBrightness"];
+  const duty_t brightness = 150;
+
+  ModeDataStruct badMode;
+  {
+    const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+    badMode = testObjects.initialModes.at(0);
+    badMode.ID = 250;
+    badMode.type = static_cast<ModeTypes>(0xEE);
+
+    // nothing running yet falls back to the default mode
+    testObjects.modalLights->setModeData(badMode, mondayAtMidnight, false);
+    testObjects.modalLights->updateLights();
+    TEST_ASSERT_CURRENT_MODES(1, 0, testObjects.modalLights);
+    TEST_ASSERT_TRUE(testObjects.modalLights->getState());
+  }
+
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->setModeByUUID(purpleMode.ID, incrementTimeAndUpdate_S(1, testObjects), false);
+  testClass->updateLights();
+  testClass->setBrightnessLevel(brightness);
+  incrementTimeAndUpdate_S(5, testObjects);
+  duty_t expectedChannels[nChannels];
+  fillChannelBrightness(expectedChannels, purpleMode.endColourRatios.RGB, brightness);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedChannels, currentChannelValues, nChannels);
+
+  // as a background mode
+  testClass->setModeData(badMode, incrementTimeAndUpdate_S(1, testObjects), false);
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_CURRENT_MODES(purpleMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedChannels, currentChannelValues, nChannels);
+
+  // as an active mode
+  testClass->setModeData(badMode, incrementTimeAndUpdate_S(1, testObjects), true);
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_CURRENT_MODES(purpleMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedChannels, currentChannelValues, nChannels);
+
+  // underneath a good active mode
+  testClass->setModeByUUID(warmMode.ID, incrementTimeAndUpdate_S(1, testObjects), true);
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_CURRENT_MODES(purpleMode.ID, warmMode.ID, testClass);
+  testClass->setModeData(badMode, incrementTimeAndUpdate_S(1, testObjects), false);
+  testClass->setModeData(badMode, incrementTimeAndUpdate_S(1, testObjects), true);
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_CURRENT_MODES(purpleMode.ID, warmMode.ID, testClass);
+
+  // and the lights still work
+  TEST_ASSERT_TRUE(testClass->cancelActiveMode());
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_CURRENT_MODES(purpleMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedChannels, currentChannelValues, nChannels);
+  testClass->setState(false);
+  incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_FALSE(testClass->getState());
+}
+
 #define TEST_interpolateValue(expectedVals, interpClass, currentTimestamp, stringMessage) {\
   std::string _brightnessMessage_T_iV = stringMessage + "; b";\
   TEST_ASSERT_EQUAL_MESSAGE(expectedVals[0], interpClass.brightness.interpolateValue(currentTimestamp, 0), _brightnessMessage_T_iV.c_str());\
@@ -835,11 +1192,119 @@ void testInterpolationClass(){
 
   // TODO: test adjusting the window mid-interpolation
 
-  // TODO: test rate interpolation
+  // rate interpolation should end when the largest change finishes
+  {
+    Interpolator<numberOfColours> rateInterp;
+    const duty_t initialVals[numberOfColours] = {200, 10, 100};
+    const duty_t targetVals[numberOfColours] = {50, 10, 120};
+    memcpy(rateInterp.initialVals, initialVals, numberOfColours);
+    memcpy(rateInterp.targetVals, targetVals, numberOfColours);
+    const uint64_t rate_uS = secondsToMicros;
+    const uint64_t timestamp_uS = mondayAtMidnight * secondsToMicros;
+    TEST_ASSERT_EQUAL(0, rateInterp.newRateInterpolation(timestamp_uS, rate_uS));
+    TEST_ASSERT_EQUAL(timestamp_uS + 150*rate_uS, rateInterp.t1_uS);
+
+    for(int k = 0; k <= 160; k += 10){
+      std::string message = "k = " + std::to_string(k);
+      const duty_t expectedVals[numberOfColours] = {
+        static_cast<duty_t>(k < 150 ? 200 - k : 50),
+        10,
+        static_cast<duty_t>(k < 20 ? 100 + k : 120)
+      };
+      duty_t actualVals[numberOfColours];
+      const isDone_t isDone = rateInterp.findNextValues(actualVals, timestamp_uS + k*rate_uS);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(expectedVals, actualVals, numberOfColours, message.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(k >= 150, isDone, message.c_str());
+    }
+  }
 
   TEST_IGNORE_MESSAGE("some tests pass, but there's more to do");
 }
 
+void testAsyncModeLoading(){
+  const ModalConfigsStruct initialConfigs{
+    .softChangeWindow = 2
+  };
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(
+    TestChannels::RGB,
+    mondayAtMidnight,
+    initialConfigs
+  );
+  auto modalLights = testObjects.modalLights;
+  auto mockStorageHAL = testObjects.mockStorageHAL;
+
+  // the test does the worker's reads, so that it can check what happens in between
+  auto asyncStorage = std::make_shared<AsyncDataStorage>(testObjects.storage);
+  asyncStorage->useExternalWorker();
+  modalLights->useAsyncStorage(asyncStorage);
+
+  const modeUUID backgroundID = testModesMap["purpleConstBrightness"].ID;
+  const modeUUID activeID = testModesMap["warmConstBrightness"].ID;
+  const modeUUID otherActiveID = testModesMap["sunset"].ID;
+
+  // a background mode set before the first update. the default mode runs until it's been read
+  uint64_t currentTime = testObjects.deviceTime->getLocalTimestampSeconds();
+  modalLights->setModeByUUID(backgroundID, currentTime, false);
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(1, 0, modalLights);
+  TEST_ASSERT_TRUE(modalLights->isModeLoadPending());
+  TEST_ASSERT_EQUAL(0, mockStorageHAL->getModeCount);
+
+  TEST_ASSERT_EQUAL(1, asyncStorage->serviceRequests());
+  TEST_ASSERT_EQUAL(1, mockStorageHAL->getModeCount);
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, 0, modalLights);
+  TEST_ASSERT_FALSE(modalLights->isModeLoadPending());
+  currentTime = incrementTimeAndUpdate_S(60, testObjects);
+
+  // an active mode. the background mode keeps writing the lights while the read is pending
+  mockStorageHAL->getModeCount = 0;
+  duty_t backgroundVals[nChannels];
+  memcpy(backgroundVals, currentChannelValues, nChannels);
+  modalLights->setModeByUUID(activeID, currentTime, true);
+  for(uint8_t i = 0; i < 5; i++){
+    currentTime = incrementTimeAndUpdate_S(1, testObjects);
+    TEST_ASSERT_CURRENT_MODES(backgroundID, 0, modalLights);
+  }
+  TEST_ASSERT_EQUAL(0, mockStorageHAL->getModeCount);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(backgroundVals, currentChannelValues, nChannels);
+
+  asyncStorage->serviceRequests();
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, activeID, modalLights);
+  TEST_ASSERT_EQUAL(1, mockStorageHAL->getModeCount);
+
+  // only the most recent request gets loaded, even if an older one finishes afterwards
+  currentTime = incrementTimeAndUpdate_S(60, testObjects);
+  modalLights->cancelActiveMode();
+  modalLights->setModeByUUID(otherActiveID, currentTime, true);
+  modalLights->updateLights();
+  modalLights->setModeByUUID(activeID, currentTime, true);
+  modalLights->updateLights();
+  TEST_ASSERT_EQUAL(2, asyncStorage->serviceRequests());
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, activeID, modalLights);
+  TEST_ASSERT_FALSE(modalLights->isModeLoadPending());
+
+  // cancelling the active mode drops a pending request
+  currentTime = incrementTimeAndUpdate_S(60, testObjects);
+  modalLights->cancelActiveMode();
+  modalLights->setModeByUUID(otherActiveID, currentTime, true);
+  modalLights->updateLights();
+  modalLights->cancelActiveMode();
+  asyncStorage->serviceRequests();
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, 0, modalLights);
+
+  // modes that are already loaded don't need waiting for
+  mockStorageHAL->getModeCount = 0;
+  modalLights->setModeByUUID(backgroundID, currentTime, true);
+  modalLights->updateLights();
+  TEST_ASSERT_CURRENT_MODES(backgroundID, backgroundID, modalLights);
+  TEST_ASSERT_TRUE(asyncStorage->isIdle());
+  TEST_ASSERT_EQUAL(0, mockStorageHAL->getModeCount);
+}
+
 void noEmbeddedUnfriendlyLibraries(){
   #ifdef __PRINT_DEBUG_H__
     TEST_ASSERT_MESSAGE(false, "did you forget to remove the print debugs?");
@@ -866,9 +1331,17 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(testDeleteMode);
   RUN_TEST(testUpdateMode);
   RUN_TEST(testModeSwitching);
+  RUN_TEST(testModeCrossfade);
+  RUN_TEST(testUnknownModeType);
   RUN_TEST(testSetModeIgnoring);
+  RUN_TEST(testAsyncModeLoading);
   
   ConstantBrightnessModeTests::constBrightness_tests();
+  SunriseModeTests::sunrise_tests();
+  SunsetModeTests::sunset_tests();
+  PulseModeTests::pulse_tests();
+  ChangingModeTests::changing_tests();
+  LayerTests::layer_tests();
   UNITY_END();
 }
 
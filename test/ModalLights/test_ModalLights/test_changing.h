@@ -0,0 +1,135 @@
+#include <unity.h>
+#include <ModalLights.h>
+
+#include "testHelpers.h"
+
+
+namespace ChangingModeTests
+{
+const TestModeDataStruct changingMode = testModesMap["changing"];
+const TestModeDataStruct changingBrightnessMode = testModesMap["changingBrightness"];
+
+uint64_t getWindow_S(const TestModeDataStruct& mode){
+  return ((mode.time[0] << 8) + mode.time[1]) * 60;
+}
+
+/**
+ * @brief makes the test objects, sets the brightness, and triggers the mode
+ */
+TestObjectsStruct changingFactory(modeUUID modeID, duty_t initialB, bool isActive, const ModalConfigsStruct& testConfigs, uint64_t& triggerTime_S){
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  testObjects.modalLights->updateLights();
+  testObjects.modalLights->setBrightnessLevel(initialB);
+  triggerTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  testObjects.modalLights->setModeByUUID(modeID, triggerTime_S, isActive);
+  testObjects.modalLights->updateLights();
+  return testObjects;
+}
+
+void testChangingColours(){
+  // the colours go from start to end over the window, and the brightness is left alone
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t brightness = 150;
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = changingFactory(changingMode.ID, brightness, false, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(changingMode.ID, 0, testClass);
+  const uint64_t window_S = getWindow_S(changingMode);
+
+  for(uint64_t elapsed_S = 0; elapsed_S < window_S; elapsed_S += 611){
+    testObjects.timestamp->setTimestamp_S(triggerTime_S + elapsed_S);
+    testClass->updateLights();
+    std::string message = "failed at " + std::to_string(elapsed_S) + " seconds";
+    TEST_ASSERT_EQUAL_MESSAGE(brightness, testClass->getBrightnessLevel(), message.c_str());
+    TEST_ASSERT_FALSE_MESSAGE(testClass->isIdle(), message.c_str());
+    if(elapsed_S < testConfigs.softChangeWindow){continue;}  // still crossfading
+    duty_t expectedRatios[nChannels];
+    interpolateArrays(expectedRatios, changingMode.startColourRatios.RGB, changingMode.endColourRatios.RGB, static_cast<float>(elapsed_S)/window_S, nChannels);
+    TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, brightness, currentChannelValues, nChannels);
+  }
+  incrementTimeAndUpdate_S(window_S, testObjects);
+  TEST_ASSERT_EQUAL_COLOURS(changingMode.endColourRatios.RGB, brightness, currentChannelValues, nChannels);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  // the brightness can still be changed
+  testClass->setBrightnessLevel(50);
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_EQUAL(50, testClass->getBrightnessLevel());
+  TEST_ASSERT_EQUAL_COLOURS(changingMode.endColourRatios.RGB, 50, currentChannelValues, nChannels);
+}
+
+void testChangingBrightness(){
+  // an active timeline with brightness can't be adjusted
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = changingFactory(changingBrightnessMode.ID, 100, true, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(1, changingBrightnessMode.ID, testClass);
+  const uint64_t window_S = getWindow_S(changingBrightnessMode);
+  const duty_t b0 = changingBrightnessMode.brightness0;
+  const duty_t b1 = changingBrightnessMode.brightness1;
+  TEST_ASSERT_EQUAL(b0, testClass->getBrightnessLevel());
+
+  uint64_t currentTime = incrementTimeAndUpdate_S(window_S/4, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, interpolate(b0, b1, 0.25), testClass->getBrightnessLevel());
+  testClass->setBrightnessLevel(255);
+  testClass->startBrightnessRamp(true, 1000, testObjects.timestamp->getTimestamp_uS());
+  currentTime = incrementTimeAndUpdate_S(window_S/4, testObjects);
+  TEST_ASSERT_EQUAL(triggerTime_S + 2*(window_S/4), currentTime);
+  testClass->stopBrightnessRamp(testObjects.timestamp->getTimestamp_uS());
+  TEST_ASSERT_UINT8_WITHIN(1, interpolate(b0, b1, 0.5), testClass->getBrightnessLevel());
+  duty_t expectedRatios[nChannels];
+  interpolateArrays(expectedRatios, changingBrightnessMode.startColourRatios.RGB, changingBrightnessMode.endColourRatios.RGB, 0.5, nChannels);
+  TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, testClass->getBrightnessLevel(), currentChannelValues, nChannels);
+
+  incrementTimeAndUpdate_S(window_S, testObjects);
+  TEST_ASSERT_EQUAL(b1, testClass->getBrightnessLevel());
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  testClass->setState(false);
+  TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+}
+
+void testBackgroundChangingBrightness(){
+  // a background timeline hands the brightness over to the user, but keeps changing the colours
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = changingFactory(changingBrightnessMode.ID, 100, false, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  const uint64_t window_S = getWindow_S(changingBrightnessMode);
+
+  incrementTimeAndUpdate_S(window_S/4, testObjects);
+  testClass->setBrightnessLevel(80);
+  incrementTimeAndUpdate_S(window_S/4, testObjects);
+  TEST_ASSERT_EQUAL(80, testClass->getBrightnessLevel());
+  duty_t expectedRatios[nChannels];
+  interpolateArrays(expectedRatios, changingBrightnessMode.startColourRatios.RGB, changingBrightnessMode.endColourRatios.RGB, 0.5, nChannels);
+  TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, 80, currentChannelValues, nChannels);
+
+  // time changes don't move the timeline
+  const uint64_t currentTime = testObjects.timestamp->getTimestamp_uS()/secondsToMicros;
+  testObjects.deviceTime->setLocalTimestamp2000(currentTime + 60*60, 0, 0);
+  testClass->updateLights();
+  TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, 80, currentChannelValues, nChannels);
+
+  incrementTimeAndUpdate_S(window_S, testObjects);
+  TEST_ASSERT_EQUAL(80, testClass->getBrightnessLevel());
+  TEST_ASSERT_EQUAL_COLOURS(changingBrightnessMode.endColourRatios.RGB, 80, currentChannelValues, nChannels);
+}
+
+void changing_tests(){
+  RUN_TEST(testChangingColours);
+  RUN_TEST(testChangingBrightness);
+  RUN_TEST(testBackgroundChangingBrightness);
+}
+
+} // end namespace
@@ -344,6 +344,98 @@ void testBrightnessAdjustment(){
   }
 }
 
+void testBrightnessRamp(){
+  // a ramp should be an interpolation across the whole brightness range, that holds wherever it gets stopped
+  const TestChannels channel = TestChannels::RGB;
+
+  const uint64_t testStartTime = mondayAtMidnight;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, testStartTime, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->adjustBrightness(255, false);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+
+  const uint16_t rampWindow_mS = 2000;
+  uint64_t currentTime_uS = testObjects.timestamp->getTimestamp_uS();
+  auto advance_mS = [&](uint32_t time_mS){
+    currentTime_uS += time_mS*1000;
+    testObjects.timestamp->setTimestamp_uS(currentTime_uS);
+    testClass->updateLights();
+  };
+
+  // ramp up from off starts at the minimum
+  {
+    testClass->startBrightnessRamp(true, rampWindow_mS, currentTime_uS);
+    TEST_ASSERT_EQUAL(true, testClass->getState());
+    TEST_ASSERT_EQUAL(testConfigs.minOnBrightness, testClass->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(testConfigs.minOnBrightness, currentChannelValues[0]);
+
+    // the brightness keeps changing with just updateLights()
+    advance_mS(rampWindow_mS/4);
+    TEST_ASSERT_UINT8_WITHIN(1, 1 + 255/4, testClass->getBrightnessLevel());
+    advance_mS(rampWindow_mS/4);
+    TEST_ASSERT_UINT8_WITHIN(1, 1 + 255/2, testClass->getBrightnessLevel());
+  }
+
+  // stopping holds the brightness
+  const duty_t stoppedBrightness = testClass->stopBrightnessRamp(currentTime_uS);
+  {
+    TEST_ASSERT_EQUAL(testClass->getBrightnessLevel(), stoppedBrightness);
+    TEST_ASSERT_EQUAL(stoppedBrightness, testClass->getSetBrightness());
+    advance_mS(rampWindow_mS*2);
+    TEST_ASSERT_EQUAL(stoppedBrightness, testClass->getBrightnessLevel());
+
+    // stopping again doesn't do anything
+    TEST_ASSERT_EQUAL(stoppedBrightness, testClass->stopBrightnessRamp(currentTime_uS));
+    advance_mS(rampWindow_mS);
+    TEST_ASSERT_EQUAL(stoppedBrightness, testClass->getBrightnessLevel());
+  }
+
+  // the start and stop times can be in the past
+  {
+    testClass->startBrightnessRamp(false, rampWindow_mS, currentTime_uS - (rampWindow_mS/4)*1000);
+    TEST_ASSERT_UINT8_WITHIN(1, stoppedBrightness - 255/4, testClass->getBrightnessLevel());
+    advance_mS(rampWindow_mS/4);
+    const duty_t stoppedBrightness2 = testClass->stopBrightnessRamp(currentTime_uS - (rampWindow_mS/4)*1000);
+    TEST_ASSERT_UINT8_WITHIN(1, stoppedBrightness - 255/4, stoppedBrightness2);
+    advance_mS(rampWindow_mS);
+    TEST_ASSERT_EQUAL(stoppedBrightness2, testClass->getBrightnessLevel());
+  }
+
+  // ramping down turns the lights off
+  {
+    testClass->startBrightnessRamp(false, rampWindow_mS, currentTime_uS);
+    advance_mS(rampWindow_mS);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+    TEST_ASSERT_EQUAL(0, testClass->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(0, currentChannelValues[0]);
+    testClass->stopBrightnessRamp(currentTime_uS);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+
+    // and ramping down when the lights are off doesn't do anything
+    testClass->startBrightnessRamp(false, rampWindow_mS, currentTime_uS);
+    advance_mS(rampWindow_mS/2);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+    testClass->stopBrightnessRamp(currentTime_uS);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+  }
+
+  // anything else that sets the brightness ends the ramp
+  {
+    testClass->startBrightnessRamp(true, rampWindow_mS, currentTime_uS);
+    advance_mS(rampWindow_mS/4);
+    TEST_ASSERT_EQUAL(100, testClass->adjustBrightness(100 - testClass->getBrightnessLevel(), true));
+    advance_mS(rampWindow_mS/4);
+    TEST_ASSERT_EQUAL(100, testClass->stopBrightnessRamp(currentTime_uS));
+    advance_mS(rampWindow_mS);
+    TEST_ASSERT_EQUAL(100, testClass->getBrightnessLevel());
+  }
+}
+
 void testSetBrightness(){
   // test behaviour when the brightness is set to a value (should be soft change)
   const TestChannels channel = TestChannels::RGB; // TODO: iterate over all channels
@@ -2097,6 +2189,7 @@ void constBrightness_tests(){
   UNITY_BEGIN();
   RUN_TEST(testUpdateLights);
   RUN_TEST(testBrightnessAdjustment);
+  RUN_TEST(testBrightnessRamp);
   RUN_TEST(testSetBrightness);
   RUN_TEST(testSetState);
   RUN_TEST(testActiveBehaviour);
@@ -0,0 +1,199 @@
+#include <unity.h>
+#include <ModalLights.h>
+
+#include "testHelpers.h"
+#include "timeSource.h"
+
+
+namespace LayerTests
+{
+const TestModeDataStruct changingBrightnessMode = testModesMap["changingBrightness"];
+const TestModeDataStruct purpleMode = testModesMap["purpleConstBrightness"];
+const TestModeDataStruct pulseMode = testModesMap["pulse"];
+
+// the lights task currently runs every 20 mS
+const uint64_t loopPeriod_uS = 20000;
+
+void testLayerCompositor(){
+  const duty_t background[3] = {0, 100, 255};
+  const duty_t active[3] = {50, 200, 128};
+
+  duty_t out[3];
+  LayerCompositor::compose(out, background, active, LayerBlendRules::replace, 3);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(active, out, 3);
+
+  LayerCompositor::compose(out, background, active, LayerBlendRules::max, 3);
+  const duty_t expectedMax[3] = {50, 200, 255};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expectedMax, out, 3);
+
+  // every possible pair, against a rounded divide
+  for(uint16_t b = 0; b <= 255; b++){
+    for(uint16_t a = 0; a <= 255; a++){
+      const duty_t bg = b;
+      duty_t actual = a;
+      LayerCompositor::compose(&actual, &bg, &actual, LayerBlendRules::multiply, 1);
+      TEST_ASSERT_EQUAL(round(a*b/255.), actual);
+    }
+  }
+}
+
+void testCancelRevealsBackground(){
+  // the background keeps running under the active mode, so cancelling picks up where the background actually is instead of restarting it
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  const uint64_t triggerTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(changingBrightnessMode.ID, triggerTime_S, false);
+  testClass->updateLights();
+  const uint64_t window_S = ((changingBrightnessMode.time[0] << 8) + changingBrightnessMode.time[1]) * 60;
+
+  // the user takes over the background brightness
+  incrementTimeAndUpdate_S(window_S/4, testObjects);
+  const duty_t backgroundB = 80;
+  testClass->setBrightnessLevel(backgroundB);
+  uint64_t currentTime_S = incrementTimeAndUpdate_S(window_S/4, testObjects);
+
+  // an active mode goes on top
+  testClass->setModeByUUID(purpleMode.ID, currentTime_S, true);
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(changingBrightnessMode.ID, purpleMode.ID, testClass);
+  const duty_t activeB = 200;
+  testClass->setBrightnessLevel(activeB);
+  currentTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  TEST_ASSERT_EQUAL(activeB, testClass->getBrightnessLevel());
+  TEST_ASSERT_COLOURS_WITHIN_1(purpleMode.endColourRatios.RGB, activeB, currentChannelValues, nChannels);
+
+  // the background comes straight back with the user's brightness, and the lights crossfade into it
+  testClass->cancelActiveMode();
+  TEST_ASSERT_CURRENT_MODES(changingBrightnessMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL(backgroundB, testClass->getSetBrightness());
+  TEST_ASSERT_EQUAL(backgroundB, testClass->getBrightnessLevel());
+  TEST_ASSERT_COLOURS_WITHIN_1(purpleMode.endColourRatios.RGB, activeB, currentChannelValues, nChannels);
+
+  currentTime_S = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  duty_t expectedRatios[nChannels];
+  interpolateArrays(
+    expectedRatios,
+    changingBrightnessMode.startColourRatios.RGB,
+    changingBrightnessMode.endColourRatios.RGB,
+    static_cast<float>(currentTime_S - triggerTime_S)/window_S,
+    nChannels
+  );
+  TEST_ASSERT_EQUAL(backgroundB, testClass->getBrightnessLevel());
+  TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, backgroundB, currentChannelValues, nChannels);
+}
+
+void testBlendRules(){
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_TRUE(testClass->getLayerBlendRule() == LayerBlendRules::replace);
+  testClass->updateLights();
+  const duty_t backgroundB = 100;
+  testClass->setBrightnessLevel(backgroundB);
+  uint64_t currentTime_S = incrementTimeAndUpdate_S(60, testObjects);
+
+  testClass->setModeByUUID(purpleMode.ID, currentTime_S, true);
+  testClass->updateLights();
+  const duty_t activeB = 200;
+  testClass->setBrightnessLevel(activeB);
+  incrementTimeAndUpdate_S(60, testObjects);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  duty_t activeVals[nChannels];
+  duty_t backgroundVals[nChannels];
+  fillChannelBrightness(activeVals, purpleMode.endColourRatios.RGB, activeB);
+  fillChannelBrightness(backgroundVals, defaultConstantBrightness.endColourRatios.RGB, backgroundB);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(activeVals, currentChannelValues, nChannels);
+
+  testClass->setLayerBlendRule(LayerBlendRules::max);
+  testClass->updateLights();
+  for(uint8_t c = 0; c < nChannels; c++){
+    const duty_t expected = activeVals[c] > backgroundVals[c] ? activeVals[c] : backgroundVals[c];
+    TEST_ASSERT_EQUAL(expected, currentChannelValues[c]);
+  }
+  // both layers have finished changing
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  testClass->setLayerBlendRule(LayerBlendRules::multiply);
+  testClass->updateLights();
+  for(uint8_t c = 0; c < nChannels; c++){
+    TEST_ASSERT_EQUAL(round(activeVals[c]*backgroundVals[c]/255.), currentChannelValues[c]);
+  }
+
+  // user changes go through the compositor too
+  const duty_t newActiveB = 150;
+  testClass->setBrightnessLevel(newActiveB);
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  fillChannelBrightness(activeVals, purpleMode.endColourRatios.RGB, newActiveB);
+  for(uint8_t c = 0; c < nChannels; c++){
+    TEST_ASSERT_EQUAL(round(activeVals[c]*backgroundVals[c]/255.), currentChannelValues[c]);
+  }
+
+  testClass->setLayerBlendRule(LayerBlendRules::replace);
+  testClass->updateLights();
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(activeVals, currentChannelValues, nChannels);
+}
+
+/**
+ * @brief time a number of updateLights() calls, one loop period apart
+ *
+ * @return double nS per tick
+ */
+double timeUpdateLights(const TestObjectsStruct& testObjects, const uint32_t ticks){
+  uint64_t time_uS = testObjects.timestamp->getTimestamp_uS();
+  SteadyClockTimeSource stopwatch;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t tick = 0; tick < ticks; tick++){
+    time_uS += loopPeriod_uS;
+    testObjects.timestamp->setTimestamp_uS(time_uS);
+    testObjects.modalLights->updateLights();
+  }
+  return stopwatch.getTimestamp_uS() * 1000. / ticks;
+}
+
+void benchmarkLayers(){
+  // how much it costs to keep the background warm underneath a pulsing active mode
+  const uint32_t ticks = 100000;
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, defaultConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  uint64_t currentTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(pulseMode.ID, currentTime_S, false);
+  testClass->updateLights();
+  const double singleLayer_nS = timeUpdateLights(testObjects, ticks);
+
+  currentTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(pulseMode.ID, currentTime_S, true);
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(pulseMode.ID, pulseMode.ID, testClass);
+  incrementTimeAndUpdate_S(60, testObjects);
+  const double hiddenBackground_nS = timeUpdateLights(testObjects, ticks);
+
+  testClass->setLayerBlendRule(LayerBlendRules::max);
+  const double warmBackground_nS = timeUpdateLights(testObjects, ticks);
+
+  printf("single layer: %.1f nS per tick\n", singleLayer_nS);
+  printf("active over hidden background: %.1f nS per tick\n", hiddenBackground_nS);
+  printf("active over warm background: %.1f nS per tick\n", warmBackground_nS);
+
+  // composing both layers should be nowhere near the loop period
+  TEST_ASSERT_LESS_THAN(loopPeriod_uS * 1000 / 100, warmBackground_nS);
+}
+
+void layer_tests(){
+  RUN_TEST(testLayerCompositor);
+  RUN_TEST(testCancelRevealsBackground);
+  RUN_TEST(testBlendRules);
+  RUN_TEST(benchmarkLayers);
+}
+
+} // end namespace
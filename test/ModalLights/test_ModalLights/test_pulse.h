@@ -0,0 +1,211 @@
+#include <unity.h>
+#include <ModalLights.h>
+
+#include "testHelpers.h"
+
+
+namespace PulseModeTests
+{
+const TestModeDataStruct pulseMode = testModesMap["pulse"];
+const TestModeDataStruct chirpMode = testModesMap["chirp"];
+
+/**
+ * @brief the analytic brightness of a raised cosine between b0 and b1
+ *
+ * @param cycles how many periods since the trigger time
+ * @param b0 min
+ * @param b1 max
+ * @return float
+ */
+float expectedWaveBrightness(double cycles, float b0, float b1){
+  return b0 + (b1 - b0)*(1 - cos(2*M_PI*cycles))/2;
+}
+
+/**
+ * @brief the number of periods a chirp has gone through, i.e. the integral of the linearly swept frequency
+ *
+ * @param elapsed_S
+ * @return double
+ */
+double expectedChirpCycles(double elapsed_S){
+  const double P0 = chirpMode.time[0]/10.;
+  const double P1 = chirpMode.time[1]/10.;
+  const double T = chirpMode.time[2]*60.;
+  const double t = elapsed_S < T ? elapsed_S : T;
+  double cycles = t/P0 + (1/P1 - 1/P0)*t*t/(2*T);
+  if(elapsed_S > T){cycles += (elapsed_S - T)/P1;}
+  return cycles;
+}
+
+/**
+ * @brief makes the test objects, sets the brightness, and triggers the mode
+ *
+ * @param modeID
+ * @param initialB 0 for off
+ * @param isActive
+ * @param testConfigs
+ * @return TestObjectsStruct
+ */
+TestObjectsStruct pulseFactory(modeUUID modeID, duty_t initialB, bool isActive, const ModalConfigsStruct& testConfigs, uint64_t& triggerTime_S){
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  testObjects.modalLights->updateLights();
+  if(initialB == 0){
+    testObjects.modalLights->adjustBrightness(255, false);
+  }
+  else{
+    testObjects.modalLights->setBrightnessLevel(initialB);
+  }
+  triggerTime_S = incrementTimeAndUpdate_S(60, testObjects);
+  testObjects.modalLights->setModeByUUID(modeID, triggerTime_S, isActive);
+  testObjects.modalLights->updateLights();
+  return testObjects;
+}
+
+void testPulseWave(){
+  // the brightness and colours should follow a raised cosine, starting at min on the trigger time
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = pulseFactory(pulseMode.ID, 0, false, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(pulseMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  TEST_ASSERT_EQUAL(pulseMode.brightness1, testClass->getSetBrightness());
+
+  const uint64_t period_uS = pulseMode.time[0] * 100000;
+  const uint64_t step_uS = 30011;  // doesn't line up with the period
+  for(uint64_t elapsed_uS = 0; elapsed_uS < 3*period_uS; elapsed_uS += step_uS){
+    const uint64_t time_uS = triggerTime_S*secondsToMicros + elapsed_uS;
+    testObjects.timestamp->setTimestamp_uS(time_uS);
+    testClass->updateLights();
+    const double cycles = static_cast<double>(elapsed_uS)/period_uS;
+    const float expectedB = expectedWaveBrightness(cycles, pulseMode.brightness0, pulseMode.brightness1);
+    std::string message = "failed at " + std::to_string(elapsed_uS) + " uS";
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(2, round(expectedB), testClass->getBrightnessLevel(), message.c_str());
+    TEST_ASSERT_FALSE_MESSAGE(testClass->isIdle(), message.c_str());
+
+    // red follows the wave, blue does the opposite
+    const float ratio = (1 - cos(2*M_PI*cycles))/2;
+    const duty_t brightness = testClass->getBrightnessLevel();
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(3, round(255*ratio*brightness/255.), currentChannelValues[0], message.c_str());
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(3, round(255*(1-ratio)*brightness/255.), currentChannelValues[2], message.c_str());
+  }
+}
+
+void testActivePulse(){
+  // an active pulse can't be adjusted, and any state change cancels it
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = pulseFactory(pulseMode.ID, 0, true, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(1, pulseMode.ID, testClass);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+
+  // half way through a period is the max
+  const uint64_t period_uS = pulseMode.time[0] * 100000;
+  incrementTimeAndUpdate_uS(period_uS/2, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, pulseMode.brightness1, testClass->getBrightnessLevel());
+
+  testClass->setBrightnessLevel(50);
+  TEST_ASSERT_EQUAL(pulseMode.brightness1, testClass->getSetBrightness());
+  incrementTimeAndUpdate_uS(period_uS, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, pulseMode.brightness1, testClass->getBrightnessLevel());
+
+  testClass->startBrightnessRamp(false, 1000, testObjects.timestamp->getTimestamp_uS());
+  incrementTimeAndUpdate_uS(period_uS, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, pulseMode.brightness1, testClass->getBrightnessLevel());
+
+  testClass->setState(false);
+  TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+}
+
+void testBackgroundPulse(){
+  // setting the brightness shifts the wave, and turning it off and on again doesn't lose the phase
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = pulseFactory(pulseMode.ID, 100, false, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  const uint64_t period_uS = pulseMode.time[0] * 100000;
+  const duty_t range = pulseMode.brightness1 - pulseMode.brightness0;
+
+  // max becomes the new brightness
+  const duty_t newMax = 230;
+  testClass->setBrightnessLevel(newMax);
+  TEST_ASSERT_EQUAL(newMax, testClass->getSetBrightness());
+  incrementTimeAndUpdate_uS(period_uS/2, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, newMax, testClass->getBrightnessLevel());
+  incrementTimeAndUpdate_uS(period_uS/2, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, newMax - range, testClass->getBrightnessLevel());
+
+  // off is off, and idle
+  testClass->setState(false);
+  incrementTimeAndUpdate_uS(period_uS/2, testObjects);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  // turning on again picks up where the wave is
+  incrementTimeAndUpdate_uS(3*period_uS, testObjects);
+  testClass->setState(true);
+  TEST_ASSERT_FALSE(testClass->isIdle());
+  incrementTimeAndUpdate_uS(0, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, newMax, testClass->getBrightnessLevel());
+
+  // a ramp stops the flashing
+  testClass->startBrightnessRamp(false, 1000, testObjects.timestamp->getTimestamp_uS());
+  incrementTimeAndUpdate_uS(100000, testObjects);
+  testClass->stopBrightnessRamp(testObjects.timestamp->getTimestamp_uS());
+  const duty_t heldB = testClass->getBrightnessLevel();
+  TEST_ASSERT_UINT8_WITHIN(2, newMax - 255/10, heldB);
+  for(uint8_t i = 0; i < 5; i++){
+    incrementTimeAndUpdate_uS(period_uS/4, testObjects);
+    TEST_ASSERT_EQUAL(heldB, testClass->getBrightnessLevel());
+  }
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_COLOURS_WITHIN_1(pulseMode.endColourRatios.RGB, heldB, currentChannelValues, nChannels);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+}
+
+void testChirp(){
+  // the period and brightness limits should sweep to their final values, then stay there
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  uint64_t triggerTime_S;
+  const TestObjectsStruct testObjects = pulseFactory(chirpMode.ID, 0, true, testConfigs, triggerTime_S);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(1, chirpMode.ID, testClass);
+
+  const uint64_t chirpDuration_uS = chirpMode.time[2]*60*secondsToMicros;
+  const uint64_t step_uS = 7919;
+  for(uint64_t elapsed_uS = 0; elapsed_uS < chirpDuration_uS + 5*secondsToMicros; elapsed_uS += step_uS){
+    testObjects.timestamp->setTimestamp_uS(triggerTime_S*secondsToMicros + elapsed_uS);
+    testClass->updateLights();
+    const double elapsed_S = static_cast<double>(elapsed_uS)/secondsToMicros;
+    const double progress = elapsed_uS < chirpDuration_uS ? static_cast<double>(elapsed_uS)/chirpDuration_uS : 1;
+    const float maxB = chirpMode.brightness1 + (chirpMode.finalBrightness1 - chirpMode.brightness1)*progress;
+    const float minB = chirpMode.brightness0 + (chirpMode.finalBrightness0 - chirpMode.brightness0)*progress;
+    const float expectedB = expectedWaveBrightness(expectedChirpCycles(elapsed_S), minB, maxB);
+    std::string message = "failed at " + std::to_string(elapsed_uS) + " uS";
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(3, round(expectedB), testClass->getBrightnessLevel(), message.c_str());
+  }
+  TEST_ASSERT_EQUAL(chirpMode.finalBrightness1, testClass->getSetBrightness());
+}
+
+void pulse_tests(){
+  RUN_TEST(testPulseWave);
+  RUN_TEST(testActivePulse);
+  RUN_TEST(testBackgroundPulse);
+  RUN_TEST(testChirp);
+}
+
+} // end namespace
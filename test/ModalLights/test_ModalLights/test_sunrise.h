@@ -0,0 +1,334 @@
+#include <unity.h>
+#include <ModalLights.h>
+#include <EventManager.h>
+
+#include "testHelpers.h"
+
+
+namespace SunriseModeTests
+{
+const TestModeDataStruct sunriseMode = testModesMap["sunrise"];
+const uint64_t window_S = sunriseMode.time[0] * 60;
+
+/**
+ * @brief the brightness of the sunrise curve, interpolated between the same points that SunriseMode builds
+ *
+ * @param elapsed_S time since the start of the sunrise, i.e. a window before the trigger time
+ * @param b0 brightness at the start, i.e. minOnBrightness
+ * @return duty_t
+ */
+duty_t expectedCurveBrightness(uint64_t elapsed_S, duty_t b0){
+  const duty_t b1 = sunriseMode.brightness1;
+  const uint8_t n = SunriseMode::curveSegments;
+  if(elapsed_S >= window_S){return b1;}
+  const uint8_t k = (elapsed_S * n) / window_S;
+  const duty_t p0 = b0 + ((b1 - b0)*k*k + (n*n)/2)/(n*n);
+  const duty_t p1 = b0 + ((b1 - b0)*(k+1)*(k+1) + (n*n)/2)/(n*n);
+  const float segmentRatio = (elapsed_S - (window_S*k)/n)/(window_S/static_cast<float>(n));
+  return interpolate(p0, p1, segmentRatio);
+}
+
+/**
+ * @brief checks the brightness against the curve, and the colours against the colour interpolation
+ *
+ */
+#define TEST_ASSERT_SUNRISE_VALUES(elapsed_S, minB, testClass) { \
+  const duty_t expectedB = expectedCurveBrightness(elapsed_S, minB); \
+  std::string elapsedMessage = "failed at " + std::to_string(elapsed_S) + " seconds"; \
+  TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, expectedB, testClass->getBrightnessLevel(), elapsedMessage.c_str()); \
+  duty_t expectedRatios[nChannels]; \
+  interpolateArrays(expectedRatios, sunriseMode.startColourRatios.RGB, sunriseMode.endColourRatios.RGB, elapsed_S >= window_S ? 1 : static_cast<float>(elapsed_S)/window_S, nChannels); \
+  TEST_ASSERT_COLOURS_WITHIN_1(expectedRatios, testClass->getBrightnessLevel(), currentChannelValues, nChannels); \
+}
+
+void testSunriseCurve(){
+  // the brightness should follow the curve from minOnBrightness to maxBrightness, and the colours should go from start to end
+  const TestChannels channel = TestChannels::RGB;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->adjustBrightness(255, false);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+
+  const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, false);
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(sunriseMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  TEST_ASSERT_EQUAL(testConfigs.minOnBrightness, testClass->getBrightnessLevel());
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getSetBrightness());
+
+  for(uint64_t elapsed_S = 30; elapsed_S <= window_S + 5*60; elapsed_S += 30){
+    incrementTimeAndUpdate_S(30, testObjects);
+    TEST_ASSERT_SUNRISE_VALUES(elapsed_S, testConfigs.minOnBrightness, testClass);
+
+    // perceived brightness isn't linear, so the curve should be slow to start
+    if(elapsed_S == window_S/2){
+      TEST_ASSERT_LESS_THAN(sunriseMode.brightness1/2, testClass->getBrightnessLevel());
+    }
+  }
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getBrightnessLevel());
+}
+
+void testActiveSunrise(){
+  // an active sunrise can be made brighter, but can't be dimmed below the curve. turning it off cancels it
+  const TestChannels channel = TestChannels::RGB;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->adjustBrightness(255, false);
+
+  const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, true);
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(1, sunriseMode.ID, testClass);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  const duty_t minB = testConfigs.minOnBrightness;
+
+  // can't be dimmed below the curve
+  uint64_t currentTime = incrementTimeAndUpdate_S(5*60, testObjects);
+  testClass->setBrightnessLevel(0);
+  currentTime = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_SUNRISE_VALUES(currentTime - startTime, minB, testClass);
+  testClass->adjustBrightness(255, false);
+  currentTime = incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_SUNRISE_VALUES(currentTime - startTime, minB, testClass);
+
+  // can be made brighter, and stays there until the curve catches up
+  const duty_t heldB = 200;
+  testClass->setBrightnessLevel(heldB);
+  currentTime = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_EQUAL(heldB, testClass->getBrightnessLevel());
+  while(expectedCurveBrightness(currentTime + 60 - startTime, minB) < heldB){
+    currentTime = incrementTimeAndUpdate_S(60, testObjects);
+    TEST_ASSERT_EQUAL(heldB, testClass->getBrightnessLevel());
+  }
+  while(currentTime - startTime < window_S){
+    currentTime = incrementTimeAndUpdate_S(60, testObjects);
+    TEST_ASSERT_SUNRISE_VALUES(currentTime - startTime, minB, testClass);
+  }
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getBrightnessLevel());
+
+  // ramping down stops at the curve
+  testClass->startBrightnessRamp(false, 2000, testObjects.timestamp->getTimestamp_uS());
+  currentTime = incrementTimeAndUpdate_S(5, testObjects);
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getBrightnessLevel());
+  testClass->stopBrightnessRamp(testObjects.timestamp->getTimestamp_uS());
+
+  // once it's finished, turning off cancels it
+  testClass->setState(false);
+  TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+
+  // and so does turning it off part way through
+  {
+    const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+    const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+    testClass->updateLights();
+    const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+    testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, true);
+    testClass->updateLights();
+    incrementTimeAndUpdate_S(window_S/4, testObjects);
+    TEST_ASSERT_CURRENT_MODES(1, sunriseMode.ID, testClass);
+
+    testClass->setState(false);
+    TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+    incrementTimeAndUpdate_S(window_S, testObjects);
+    const duty_t brightness = testClass->getBrightnessLevel();
+    incrementTimeAndUpdate_S(60, testObjects);
+    TEST_ASSERT_EQUAL(brightness, testClass->getBrightnessLevel());
+  }
+}
+
+void testBackgroundSunrise(){
+  // a background sunrise behaves like constant brightness once the user takes over
+  const TestChannels channel = TestChannels::RGB;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t minB = testConfigs.minOnBrightness;
+
+  // setting the brightness leaves the curve
+  {
+    const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+    const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+    testClass->updateLights();
+    testClass->adjustBrightness(255, false);
+
+    const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+    testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, false);
+    testClass->updateLights();
+
+    uint64_t currentTime = incrementTimeAndUpdate_S(window_S/2, testObjects);
+    TEST_ASSERT_SUNRISE_VALUES(currentTime - startTime, minB, testClass);
+
+    const duty_t userB = 30;
+    testClass->setBrightnessLevel(userB);
+    currentTime = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+    TEST_ASSERT_EQUAL(userB, testClass->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(userB, testClass->getSetBrightness());
+
+    // the colours keep going
+    currentTime = incrementTimeAndUpdate_S(window_S, testObjects);
+    TEST_ASSERT_EQUAL(userB, testClass->getBrightnessLevel());
+    TEST_ASSERT_COLOURS_WITHIN_1(sunriseMode.endColourRatios.RGB, userB, currentChannelValues, nChannels);
+
+    // and it can be turned off and on again
+    testClass->setState(false);
+    incrementTimeAndUpdate_S(60, testObjects);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+    testClass->setState(true);
+    incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+    TEST_ASSERT_EQUAL(true, testClass->getState());
+  }
+
+  // turning off leaves the curve
+  {
+    const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+    const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+    testClass->updateLights();
+    testClass->adjustBrightness(255, false);
+
+    const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+    testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, false);
+    testClass->updateLights();
+    incrementTimeAndUpdate_S(window_S/4, testObjects);
+    testClass->setState(false);
+    incrementTimeAndUpdate_S(window_S, testObjects);
+    TEST_ASSERT_EQUAL(false, testClass->getState());
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+  }
+
+  // lights that are already brighter than the curve stay where they are until the curve catches up
+  {
+    const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+    const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+    testClass->updateLights();
+    const duty_t initialB = 150;
+    testClass->setBrightnessLevel(initialB);
+
+    const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+    TEST_ASSERT_EQUAL(initialB, testClass->getBrightnessLevel());
+    testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, false);
+    testClass->updateLights();
+    TEST_ASSERT_EQUAL(initialB, testClass->getBrightnessLevel());
+
+    uint64_t currentTime = startTime;
+    while(expectedCurveBrightness(currentTime + 60 - startTime, minB) < initialB){
+      currentTime = incrementTimeAndUpdate_S(60, testObjects);
+      TEST_ASSERT_EQUAL(initialB, testClass->getBrightnessLevel());
+    }
+    while(currentTime - startTime < window_S){
+      currentTime = incrementTimeAndUpdate_S(60, testObjects);
+      TEST_ASSERT_SUNRISE_VALUES(currentTime - startTime, minB, testClass);
+    }
+  }
+}
+
+void testSunriseTimeChanges(){
+  // changing the time shouldn't change where the sunrise is up to
+  const TestChannels channel = TestChannels::RGB;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t minB = testConfigs.minOnBrightness;
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->adjustBrightness(255, false);
+
+  const uint64_t startTime = incrementTimeAndUpdate_S(60, testObjects);
+  testClass->setModeByUUID(sunriseMode.ID, startTime + window_S, true);
+  testClass->updateLights();
+
+  // forwards
+  uint64_t currentTime = incrementTimeAndUpdate_S(window_S/2, testObjects);
+  const duty_t halfwayB = testClass->getBrightnessLevel();
+  TEST_ASSERT_SUNRISE_VALUES(window_S/2, minB, testClass);
+  testObjects.deviceTime->setLocalTimestamp2000(currentTime + 60*60, 0, 0);
+  testClass->updateLights();
+  TEST_ASSERT_EQUAL(halfwayB, testClass->getBrightnessLevel());
+
+  // backwards, past the start of the current segment
+  currentTime = incrementTimeAndUpdate_S(60, testObjects);
+  testObjects.deviceTime->setLocalTimestamp2000(currentTime - 2*60*60, 0, 0);
+  testClass->updateLights();
+  TEST_ASSERT_SUNRISE_VALUES(window_S/2 + 60, minB, testClass);
+
+  // and it still finishes on time
+  incrementTimeAndUpdate_S(window_S/2 - 60, testObjects);
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getBrightnessLevel());
+}
+
+void testSunriseFromEventManager(){
+  // EventManager triggers a sunrise a window before its event, so that it finishes at the event time
+  const TestChannels channel = TestChannels::RGB;
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t minB = testConfigs.minOnBrightness;
+  const TestObjectsStruct testObjects = modalLightsFactoryAllModes(channel, mondayAtMidnight, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  testClass->updateLights();
+  testClass->adjustBrightness(255, false);
+
+  // the event manager gets its own storage, so that it doesn't load the test events
+  auto eventStorage = std::make_shared<DataStorageClass>(
+    std::make_shared<MockStorageHAL>(testObjects.initialModes, std::vector<EventDataPacket>{})
+  );
+  eventStorage->loadIDs();
+  auto configManager = std::make_shared<ConfigManagerClass>(std::make_unique<MockConfigHal>());
+  EventManager eventManager(testClass, configManager, testObjects.deviceTime, eventStorage);
+
+  const uint32_t eventTime = timeToSeconds(7, 0, 0);
+  const EventDataPacket sunriseEvent = {1, sunriseMode.ID, eventTime, 0b01111111 /*everyday*/, oneHour, true};
+  TEST_ASSERT_EQUAL(EventManagerErrors::success, eventManager.addEvent(sunriseEvent));
+  const uint64_t startTime = mondayAtMidnight + eventTime - window_S;
+  TEST_ASSERT_EQUAL(startTime, eventManager.getNextEvent().triggerTime);
+
+  // nothing happens until a window before the event
+  incrementTimeAndUpdate_S(startTime - 1 - mondayAtMidnight, testObjects);
+  eventManager.check();
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+
+  incrementTimeAndUpdate_S(1, testObjects);
+  eventManager.check();
+  testClass->updateLights();
+  TEST_ASSERT_CURRENT_MODES(1, sunriseMode.ID, testClass);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  TEST_ASSERT_EQUAL(minB, testClass->getBrightnessLevel());
+
+  for(uint64_t elapsed_S = 30; elapsed_S <= window_S; elapsed_S += 30){
+    incrementTimeAndUpdate_S(30, testObjects);
+    eventManager.check();
+    TEST_ASSERT_SUNRISE_VALUES(elapsed_S, minB, testClass);
+  }
+  // and it reaches the top at the event time
+  TEST_ASSERT_EQUAL(sunriseMode.brightness1, testClass->getBrightnessLevel());
+  TEST_ASSERT_EQUAL(startTime + secondsInDay, eventManager.getNextEvent().triggerTime);
+
+  testObjects.deviceTime->remove_observer(eventManager);
+}
+
+void sunrise_tests(){
+  RUN_TEST(testSunriseCurve);
+  RUN_TEST(testActiveSunrise);
+  RUN_TEST(testBackgroundSunrise);
+  RUN_TEST(testSunriseTimeChanges);
+  RUN_TEST(testSunriseFromEventManager);
+}
+
+} // end namespace
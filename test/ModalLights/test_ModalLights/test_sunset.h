@@ -0,0 +1,225 @@
+#include <unity.h>
+#include <ModalLights.h>
+
+#include "testHelpers.h"
+
+
+namespace SunsetModeTests
+{
+const TestModeDataStruct sunsetMode = testModesMap["sunset"];
+const uint64_t rate_S = sunsetMode.time[0];
+
+/**
+ * @brief the brightness of the slope
+ *
+ * @param elapsed_S time since the sunset started
+ * @param b0 brightness when the sunset started
+ * @return duty_t
+ */
+duty_t expectedSlopeBrightness(uint64_t elapsed_S, duty_t b0){
+  const uint64_t steps = (elapsed_S + rate_S/2) / rate_S;
+  const uint64_t maxSteps = b0 - sunsetMode.brightness1;
+  if(steps >= maxSteps){return sunsetMode.brightness1;}
+  return b0 - steps;
+}
+
+/**
+ * @brief makes the test objects, sets the brightness, and triggers the sunset
+ *
+ * @param initialB 0 for off
+ * @param isActive
+ * @return TestObjectsStruct
+ */
+TestObjectsStruct sunsetFactory(duty_t initialB, bool isActive, const ModalConfigsStruct& testConfigs){
+  TestObjectsStruct testObjects = modalLightsFactoryAllModes(TestChannels::RGB, mondayAtMidnight, testConfigs);
+  testObjects.modalLights->updateLights();
+  if(initialB == 0){
+    testObjects.modalLights->adjustBrightness(255, false);
+  }
+  else{
+    testObjects.modalLights->setBrightnessLevel(initialB);
+  }
+  const uint64_t triggerTime = incrementTimeAndUpdate_S(60, testObjects);
+  testObjects.modalLights->setModeByUUID(sunsetMode.ID, triggerTime, isActive);
+  testObjects.modalLights->updateLights();
+  return testObjects;
+}
+
+void testSunsetDimming(){
+  // the brightness should dim at a constant rate until it reaches the target, then go idle
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t initialB = 200;
+  const TestObjectsStruct testObjects = sunsetFactory(initialB, false, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(sunsetMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL(initialB, testClass->getBrightnessLevel());
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getSetBrightness());
+
+  // the colours change quickly
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_COLOURS_WITHIN_1(sunsetMode.endColourRatios.RGB, testClass->getBrightnessLevel(), currentChannelValues, nChannels);
+
+  const uint64_t dimmingTime_S = (initialB - sunsetMode.brightness1) * rate_S;
+  for(uint64_t elapsed_S = testConfigs.softChangeWindow; elapsed_S < dimmingTime_S; elapsed_S += 50){
+    std::string message = "failed at " + std::to_string(elapsed_S) + " seconds";
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, expectedSlopeBrightness(elapsed_S, initialB), testClass->getBrightnessLevel(), message.c_str());
+    TEST_ASSERT_FALSE_MESSAGE(testClass->isIdle(), message.c_str());
+    incrementTimeAndUpdate_S(50, testObjects);
+  }
+
+  incrementTimeAndUpdate_S(rate_S, testObjects);
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getBrightnessLevel());
+  TEST_ASSERT_TRUE(testClass->isIdle());
+  incrementTimeAndUpdate_S(60*60, testObjects);
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getBrightnessLevel());
+
+  // lights that are already dimmer than the target don't get brighter
+  {
+    const TestObjectsStruct testObjects = sunsetFactory(20, false, testConfigs);
+    const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+    TEST_ASSERT_EQUAL(20, testClass->getBrightnessLevel());
+    incrementTimeAndUpdate_S(60*60, testObjects);
+    TEST_ASSERT_EQUAL(20, testClass->getBrightnessLevel());
+    TEST_ASSERT_TRUE(testClass->isIdle());
+  }
+}
+
+void testIdleSkip(){
+  // once nothing is changing, updateLights() shouldn't touch the lights until something wakes it up
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = sunsetFactory(50, false, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  incrementTimeAndUpdate_S(60*60, testObjects);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  // scribble over the channels; an idle update shouldn't write them
+  duty_t expectedVals[nChannels];
+  memcpy(expectedVals, currentChannelValues, nChannels);
+  memset(currentChannelValues, 0, nChannels);
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+
+  // anything that changes the lights wakes it up
+  testClass->setBrightnessLevel(100);
+  TEST_ASSERT_FALSE(testClass->isIdle());
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow/2, testObjects);
+  TEST_ASSERT_FALSE(testClass->isIdle());
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_EQUAL(100, testClass->getBrightnessLevel());
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  testClass->adjustBrightness(10, false);
+  TEST_ASSERT_FALSE(testClass->isIdle());
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EQUAL(90, testClass->getBrightnessLevel());
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  testClass->setState(false);
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+  TEST_ASSERT_TRUE(testClass->isIdle());
+
+  // and so does a new mode
+  testClass->setModeByUUID(sunsetMode.ID, incrementTimeAndUpdate_S(1, testObjects) + 1, true);
+  incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  TEST_ASSERT_FALSE(testClass->isIdle());
+}
+
+void testActiveSunset(){
+  // an active sunset can be dimmed below the slope, but can't go above it
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t initialB = 200;
+  const TestObjectsStruct testObjects = sunsetFactory(initialB, true, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(1, sunsetMode.ID, testClass);
+  const uint64_t startTime = testObjects.timestamp->getTimestamp_uS()/secondsToMicros;
+
+  // can't be made brighter
+  uint64_t currentTime = incrementTimeAndUpdate_S(100, testObjects);
+  testClass->setBrightnessLevel(255);
+  currentTime = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, expectedSlopeBrightness(currentTime - startTime, initialB), testClass->getBrightnessLevel());
+  testClass->adjustBrightness(50, true);
+  currentTime = incrementTimeAndUpdate_S(1, testObjects);
+  TEST_ASSERT_UINT8_WITHIN(1, expectedSlopeBrightness(currentTime - startTime, initialB), testClass->getBrightnessLevel());
+
+  // can be dimmed, and stays there until the slope catches up
+  const duty_t heldB = 60;
+  testClass->setBrightnessLevel(heldB);
+  currentTime = incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_EQUAL(heldB, testClass->getBrightnessLevel());
+  while(expectedSlopeBrightness(currentTime + 50 - startTime, initialB) > heldB){
+    currentTime = incrementTimeAndUpdate_S(50, testObjects);
+    TEST_ASSERT_EQUAL(heldB, testClass->getBrightnessLevel());
+  }
+  currentTime = incrementTimeAndUpdate_S(60*60, testObjects);
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getBrightnessLevel());
+
+  // turning off cancels it
+  testClass->setState(false);
+  TEST_ASSERT_CURRENT_MODES(1, 0, testClass);
+}
+
+void testSunsetWhenOff(){
+  // lights that are off stay off, and turning them on goes to the target brightness
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const TestObjectsStruct testObjects = sunsetFactory(0, false, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+  TEST_ASSERT_CURRENT_MODES(sunsetMode.ID, 0, testClass);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+  incrementTimeAndUpdate_S(60, testObjects);
+  TEST_ASSERT_EQUAL(false, testClass->getState());
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, currentChannelValues, nChannels);
+
+  testClass->setState(true);
+  incrementTimeAndUpdate_S(testConfigs.softChangeWindow, testObjects);
+  TEST_ASSERT_EQUAL(true, testClass->getState());
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getBrightnessLevel());
+}
+
+void testSunsetTimeChanges(){
+  // changing the time shouldn't change where the sunset is up to
+  const ModalConfigsStruct testConfigs = {
+    .minOnBrightness = 1,
+    .softChangeWindow = 2
+  };
+  const duty_t initialB = 200;
+  const TestObjectsStruct testObjects = sunsetFactory(initialB, false, testConfigs);
+  const std::shared_ptr<ModalLightsController> testClass = testObjects.modalLights;
+
+  const uint64_t currentTime = incrementTimeAndUpdate_S(500, testObjects);
+  const duty_t brightness = testClass->getBrightnessLevel();
+  TEST_ASSERT_UINT8_WITHIN(1, expectedSlopeBrightness(500, initialB), brightness);
+  testObjects.deviceTime->setLocalTimestamp2000(currentTime + 60*60, 0, 0);
+  testClass->updateLights();
+  TEST_ASSERT_EQUAL(brightness, testClass->getBrightnessLevel());
+  testObjects.deviceTime->setLocalTimestamp2000(currentTime - 60*60, 0, 0);
+  testClass->updateLights();
+  TEST_ASSERT_EQUAL(brightness, testClass->getBrightnessLevel());
+
+  incrementTimeAndUpdate_S((initialB - sunsetMode.brightness1)*rate_S - 500, testObjects);
+  TEST_ASSERT_EQUAL(sunsetMode.brightness1, testClass->getBrightnessLevel());
+}
+
+void sunset_tests(){
+  RUN_TEST(testSunsetDimming);
+  RUN_TEST(testIdleSkip);
+  RUN_TEST(testActiveSunset);
+  RUN_TEST(testSunsetWhenOff);
+  RUN_TEST(testSunsetTimeChanges);
+}
+
+} // end namespace
@@ -0,0 +1,182 @@
+#include <unity.h>
+#include <math.h>
+
+#include "waveform.h"
+#include "pulseMode.h"
+#include "timeSource.h"
+
+void setUp(void){}
+void tearDown(void){}
+
+namespace WaveformTests{
+  const uint64_t startTime_uS = 123456789;
+
+  // the lights task currently runs every 20 mS
+  const uint64_t loopPeriod_uS = 20000;
+
+  double expectedSine(double cycles){
+    return 127.5*(1 - cos(2*M_PI*cycles));
+  }
+
+  double expectedTriangle(double cycles){
+    const double phase = cycles - floor(cycles);
+    return phase < 0.5 ? 510*phase : 510*(1 - phase);
+  }
+
+  /**
+   * @brief the number of periods for a linear frequency sweep, i.e. the integral of the frequency
+   */
+  double expectedSweepCycles(double t_uS, double P0_uS, double P1_uS, double T_uS){
+    const double t = t_uS < T_uS ? t_uS : T_uS;
+    double cycles = t/P0_uS + (1/P1_uS - 1/P0_uS)*t*t/(2*T_uS);
+    if(t_uS > T_uS){cycles += (t_uS - T_uS)/P1_uS;}
+    return cycles;
+  }
+}
+
+void testSineAgainstReference(){
+  using namespace WaveformTests;
+  for(uint64_t period_uS : {100000ULL, 2000000ULL, 25500000ULL}){
+    Waveform wave;
+    wave.start(startTime_uS, period_uS, WaveShapes::sine);
+    TEST_ASSERT_EQUAL(0, wave.update(startTime_uS));
+    TEST_ASSERT_EQUAL(255, wave.getSweepProgress());
+
+    // odd steps, so the samples land all over the period
+    const uint64_t step_uS = period_uS/97 + 13;
+    for(uint64_t t_uS = 0; t_uS < 5*period_uS; t_uS += step_uS){
+      const double expected = expectedSine(static_cast<double>(t_uS)/period_uS);
+      const uint8_t actual = wave.update(startTime_uS + t_uS);
+      std::string message = "period " + std::to_string(period_uS) + " failed at " + std::to_string(t_uS) + " uS";
+      TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, round(expected), actual, message.c_str());
+    }
+  }
+}
+
+void testTriangleAgainstReference(){
+  using namespace WaveformTests;
+  const uint64_t period_uS = 3000000;
+  Waveform wave;
+  wave.start(startTime_uS, period_uS, WaveShapes::triangle);
+  for(uint64_t t_uS = 0; t_uS < 5*period_uS; t_uS += 7919){
+    const double expected = expectedTriangle(static_cast<double>(t_uS)/period_uS);
+    std::string message = "failed at " + std::to_string(t_uS) + " uS";
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, round(expected), wave.update(startTime_uS + t_uS), message.c_str());
+  }
+}
+
+void testSweepAgainstReference(){
+  using namespace WaveformTests;
+  // speeding up and slowing down
+  const uint64_t periods[2][2] = {{4000000, 500000}, {500000, 4000000}};
+  const uint64_t sweepWindow_uS = 120*secondsToMicros;
+  for(auto& p : periods){
+    Waveform wave;
+    wave.startSweep(startTime_uS, p[0], p[1], sweepWindow_uS, WaveShapes::sine);
+    TEST_ASSERT_EQUAL(0, wave.getSweepProgress());
+
+    for(uint64_t t_uS = 0; t_uS < sweepWindow_uS + 10*secondsToMicros; t_uS += loopPeriod_uS + 7){
+      const double cycles = expectedSweepCycles(t_uS, p[0], p[1], sweepWindow_uS);
+      const uint8_t actual = wave.update(startTime_uS + t_uS);
+      std::string message = "sweep from " + std::to_string(p[0]) + " failed at " + std::to_string(t_uS) + " uS";
+      TEST_ASSERT_UINT8_WITHIN_MESSAGE(2, round(expectedSine(cycles)), actual, message.c_str());
+
+      const double progress = t_uS < sweepWindow_uS ? 256.*t_uS/sweepWindow_uS : 255;
+      TEST_ASSERT_UINT8_WITHIN_MESSAGE(1, floor(progress), wave.getSweepProgress(), message.c_str());
+    }
+    TEST_ASSERT_EQUAL(255, wave.getSweepProgress());
+  }
+
+  // big gaps between updates shouldn't matter, including one that jumps over the end of the sweep
+  Waveform wave;
+  wave.startSweep(startTime_uS, periods[0][0], periods[0][1], sweepWindow_uS, WaveShapes::sine);
+  for(uint64_t t_uS : {1234567ULL, 45678901ULL, 130000003ULL, 200000017ULL}){
+    const double cycles = expectedSweepCycles(t_uS, periods[0][0], periods[0][1], sweepWindow_uS);
+    std::string message = "failed at " + std::to_string(t_uS) + " uS";
+    TEST_ASSERT_UINT8_WITHIN_MESSAGE(2, round(expectedSine(cycles)), wave.update(startTime_uS + t_uS), message.c_str());
+  }
+}
+
+void testTimeAdjustments(){
+  using namespace WaveformTests;
+  const uint64_t period_uS = 2000000;
+  Waveform wave;
+  wave.start(startTime_uS, period_uS, WaveShapes::sine);
+  const uint8_t quarter = wave.update(startTime_uS + period_uS/4);
+  const uint32_t phase = wave.getPhase();
+
+  // time going backwards doesn't move the phase
+  TEST_ASSERT_EQUAL(quarter, wave.update(startTime_uS));
+  TEST_ASSERT_EQUAL(phase, wave.getPhase());
+
+  // a clock change doesn't either
+  const int64_t adjustment_uS = -60*60*secondsToMicros;
+  wave.adjustTime(adjustment_uS);
+  TEST_ASSERT_EQUAL(quarter, wave.update(startTime_uS + period_uS/4 + adjustment_uS));
+  TEST_ASSERT_EQUAL(phase, wave.getPhase());
+  TEST_ASSERT_UINT8_WITHIN(1, 255, wave.update(startTime_uS + period_uS/2 + adjustment_uS));
+}
+
+void benchmarkWaveform(){
+  using namespace WaveformTests;
+  const uint32_t ticks = 1000000;
+
+  Waveform wave;
+  wave.startSweep(0, 4000000, 500000, 120*secondsToMicros, WaveShapes::sine);
+  uint32_t total = 0;
+  SteadyClockTimeSource stopwatch;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t tick = 0; tick < ticks; tick++){
+    total += wave.update(static_cast<uint64_t>(tick)*loopPeriod_uS/100);
+  }
+  const double waveTime_nS = stopwatch.getTimestamp_uS() * 1000. / ticks;
+  TEST_ASSERT_GREATER_THAN(0, total);
+
+  ModeDataStruct modeData = {
+    .ID = 6,
+    .type = ModeTypes::chirp,
+    .maxBrightness = 100,
+    .minBrightness = 10,
+    .finalMaxBrightness = 255,
+    .finalMinBrightness = 50,
+    .time = {40, 5, 2}
+  };
+  memset(modeData.endColourRatios, 255, nChannels);
+  memset(modeData.startColourRatios, 20, nChannels);
+  const ModeInterpolationClass<nChannels> initialInterp;
+  LightStateStruct lightVals;
+  const ModalConfigsStruct configs;
+  PulseMode mode(0, 0, &modeData, initialInterp, lightVals, true, configs);
+  total = 0;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t tick = 0; tick < ticks; tick++){
+    mode.updateLightVals(static_cast<uint64_t>(tick)*loopPeriod_uS/100, lightVals);
+    total += lightVals.values[0];
+  }
+  const double modeTime_nS = stopwatch.getTimestamp_uS() * 1000. / ticks;
+  TEST_ASSERT_GREATER_THAN(0, total);
+
+  printf("waveform: %.1f nS per tick\n", waveTime_nS);
+  printf("chirp mode: %.1f nS per tick\n", modeTime_nS);
+
+  // a native build is a lot faster than the esp32, so each tick has to fit in 0.1% of the loop
+  const double budget_nS = loopPeriod_uS * 1000. / 1000;
+  TEST_ASSERT_LESS_THAN(budget_nS, waveTime_nS);
+  TEST_ASSERT_LESS_THAN(budget_nS, modeTime_nS);
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testSineAgainstReference);
+  RUN_TEST(testTriangleAgainstReference);
+  RUN_TEST(testSweepAgainstReference);
+  RUN_TEST(testTimeAdjustments);
+  RUN_TEST(benchmarkWaveform);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
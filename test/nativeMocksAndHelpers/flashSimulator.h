@@ -0,0 +1,188 @@
+#ifndef __FLASH_SIMULATOR_H__
+#define __FLASH_SIMULATOR_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "doubleBufferedConfigHAL.h"
+
+/**
+ * @brief how long flash operations take. the defaults are roughly a QSPI NOR chip like the esp32's
+ */
+struct FlashTimingsStruct {
+  uint32_t readSetup_nS = 1000;       // command and address, per read
+  uint32_t readPerByte_nS = 25;
+  uint32_t programPerPage_nS = 700000;  // per page that a program touches
+  uint32_t eraseSector_nS = 45000000;
+};
+
+struct FlashGeometryStruct {
+  uint32_t size = 64*4096;
+  uint16_t pageSize = 256;      // the most that one program can write
+  uint16_t sectorSize = 4096;   // the erase size
+};
+
+/**
+ * @brief what the flash has been through. simulated time is what the operations would have taken on the real thing
+ */
+struct FlashStatsStruct {
+  uint32_t reads = 0;
+  uint64_t bytesRead = 0;
+  uint32_t programs = 0;
+  uint64_t bytesProgrammed = 0;
+  uint32_t erases = 0;
+  uint64_t simulatedTime_nS = 0;
+};
+
+/**
+ * @brief NOR flash with configurable geometry and timings. erasing sets a whole sector to 0xFF, and programming can only clear bits. every operation is counted and adds its simulated time, and every sector counts its erases for the wear.
+ * if it's given a file it keeps the contents there, so that it survives being "rebooted" (i.e. reopened). a power cut can be scheduled to stop a program part way through
+ */
+class FlashSimulator {
+  private:
+    const FlashGeometryStruct _geometry;
+    const FlashTimingsStruct _timings;
+    std::vector<uint8_t> _memory;
+    std::vector<uint32_t> _sectorErases;
+    std::string _path;
+    FILE* _file = nullptr;
+
+    int32_t _bytesUntilPowerCut = -1;   // -1 means the power stays on
+
+    void _persist(uint32_t address, uint32_t size){
+      if(_file == nullptr){return;}
+      fseek(_file, address, SEEK_SET);
+      fwrite(_memory.data() + address, 1, size, _file);
+      fflush(_file);
+    }
+
+  public:
+    FlashStatsStruct stats;
+
+    /**
+     * @param geometry
+     * @param timings
+     * @param path keep the contents in this file. it's created (erased) if it doesn't exist. empty to keep them in memory
+     */
+    FlashSimulator(FlashGeometryStruct geometry = FlashGeometryStruct(), FlashTimingsStruct timings = FlashTimingsStruct(), const std::string& path = "")
+      : _geometry(geometry), _timings(timings), _memory(geometry.size, 0xFF), _sectorErases(geometry.size / geometry.sectorSize, 0), _path(path)
+    {
+      if(_path.empty()){return;}
+      _file = fopen(_path.c_str(), "r+b");
+      if(_file != nullptr){
+        fread(_memory.data(), 1, _geometry.size, _file);
+        return;
+      }
+      _file = fopen(_path.c_str(), "w+b");
+      _persist(0, _geometry.size);
+    }
+
+    ~FlashSimulator(){
+      if(_file != nullptr){fclose(_file);}
+    }
+
+    const FlashGeometryStruct& getGeometry(){return _geometry;}
+
+    /**
+     * @brief the most times any sector has been erased
+     */
+    uint32_t getMaxSectorErases(){
+      uint32_t maxErases = 0;
+      for(uint32_t erases : _sectorErases){
+        if(erases > maxErases){maxErases = erases;}
+      }
+      return maxErases;
+    }
+
+    uint32_t getSectorErases(uint32_t sector){
+      return sector < _sectorErases.size() ? _sectorErases[sector] : 0;
+    }
+
+    void resetStats(){stats = FlashStatsStruct();}
+
+    /**
+     * @brief the next program stops after this many bytes, and everything fails until powerOn()
+     *
+     * @param bytes
+     */
+    void schedulePowerCut(int32_t bytes){_bytesUntilPowerCut = bytes;}
+    void powerOn(){_bytesUntilPowerCut = -1;}
+    bool isPoweredOn(){return _bytesUntilPowerCut != 0;}
+
+    bool read(uint32_t address, uint8_t* buffer, uint32_t size){
+      if(address + size > _geometry.size){return false;}
+      memcpy(buffer, _memory.data() + address, size);
+      stats.reads++;
+      stats.bytesRead += size;
+      stats.simulatedTime_nS += _timings.readSetup_nS + static_cast<uint64_t>(_timings.readPerByte_nS) * size;
+      return true;
+    }
+
+    bool eraseSector(uint32_t address){
+      if(!isPoweredOn() || address % _geometry.sectorSize != 0 || address + _geometry.sectorSize > _geometry.size){return false;}
+      memset(_memory.data() + address, 0xFF, _geometry.sectorSize);
+      _persist(address, _geometry.sectorSize);
+      _sectorErases[address / _geometry.sectorSize]++;
+      stats.erases++;
+      stats.simulatedTime_nS += _timings.eraseSector_nS;
+      return true;
+    }
+
+    /**
+     * @brief program bytes. bits can only go from 1 to 0, so write to erased flash. writes that cross page boundaries are split up, like a driver would
+     *
+     * @return false if the address is out of range, or the power was cut
+     */
+    bool program(uint32_t address, const uint8_t* buffer, uint32_t size){
+      if(!isPoweredOn() || address + size > _geometry.size){return false;}
+      uint32_t nBytes = size;
+      if(_bytesUntilPowerCut >= 0 && static_cast<uint32_t>(_bytesUntilPowerCut) < size){
+        nBytes = _bytesUntilPowerCut;
+      }
+      for(uint32_t i = 0; i < nBytes; i++){
+        _memory[address + i] &= buffer[i];
+      }
+      _persist(address, nBytes);
+
+      const uint32_t firstPage = address / _geometry.pageSize;
+      const uint32_t lastPage = (address + (size == 0 ? 0 : size - 1)) / _geometry.pageSize;
+      stats.programs += lastPage - firstPage + 1;
+      stats.bytesProgrammed += nBytes;
+      stats.simulatedTime_nS += static_cast<uint64_t>(_timings.programPerPage_nS) * (lastPage - firstPage + 1);
+      if(_bytesUntilPowerCut >= 0){
+        _bytesUntilPowerCut -= nBytes;
+        if(_bytesUntilPowerCut == 0){return false;}
+      }
+      return true;
+    }
+};
+
+/**
+ * @brief the config slots on simulated flash, one sector each
+ */
+class FlashConfigSlots : public ConfigSlotStorageInterface {
+  private:
+    std::shared_ptr<FlashSimulator> _flash;
+    const uint32_t _startAddress;
+
+    uint32_t _slotAddress(uint8_t slot){
+      return _startAddress + slot * _flash->getGeometry().sectorSize;
+    }
+
+  public:
+    FlashConfigSlots(std::shared_ptr<FlashSimulator> flash, uint32_t startAddress = 0) : _flash(flash), _startAddress(startAddress){}
+
+    bool readSlot(uint8_t slot, uint16_t offset, uint8_t* buffer, uint16_t size) override {
+      if(slot >= nSlots || offset + size > _flash->getGeometry().sectorSize){return false;}
+      return _flash->read(_slotAddress(slot) + offset, buffer, size);
+    }
+
+    bool writeSlot(uint8_t slot, const uint8_t* buffer, uint16_t size) override {
+      if(slot >= nSlots || size > _flash->getGeometry().sectorSize){return false;}
+      return _flash->eraseSector(_slotAddress(slot)) && _flash->program(_slotAddress(slot), buffer, size);
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef __FLASH_STORAGE_HAL_HPP__
+#define __FLASH_STORAGE_HAL_HPP__
+
+#include <vector>
+
+#include "ProjectDefines.h"
+#include "DataStorageClass.h"
+#include "flashSimulator.h"
+
+/**
+ * @brief a StorageHALInterface on simulated flash, so that tests can see what the storage access patterns cost. unlike MockStorageHAL, every call reads the flash.
+ * the layout is a header in the first sector, then the mode packets, then the events (starting on a new sector). the header gets written last, so a half-finished ingest isn't found on boot
+ */
+class FlashStorageHAL : public StorageHALInterface {
+  public:
+    struct HeaderStruct {
+      uint32_t magic = 0;
+      uint16_t nModes = 0;
+      uint16_t nEvents = 0;
+      uint32_t modesAddress = 0;
+      uint32_t eventsAddress = 0;
+    };
+    static constexpr uint32_t expectedMagic = 0x53544f52;  // "STOR"
+
+  private:
+    std::shared_ptr<FlashSimulator> _flash;
+    HeaderStruct _header;
+    nEvents_t _preferredChunkSize;
+
+    uint32_t _alignToSector(uint32_t address){
+      const uint32_t sectorSize = _flash->getGeometry().sectorSize;
+      return ((address + sectorSize - 1) / sectorSize) * sectorSize;
+    }
+
+    uint32_t _modeAddress(nModes_t position){return _header.modesAddress + position * modePacketSize;}
+    uint32_t _eventAddress(nEvents_t position){return _header.eventsAddress + position * sizeof(EventDataPacket);}
+
+  public:
+    /**
+     * @brief reads the header, like on boot
+     *
+     * @param flash
+     * @param preferredChunkSize what getPreferredChunkSize() says. 0 means as many events as fit in a page
+     */
+    FlashStorageHAL(std::shared_ptr<FlashSimulator> flash, nEvents_t preferredChunkSize = 0) : _flash(flash){
+      _preferredChunkSize = preferredChunkSize != 0 ? preferredChunkSize : _flash->getGeometry().pageSize / sizeof(EventDataPacket);
+      reloadHeader();
+    }
+
+    /**
+     * @brief read the header again
+     *
+     * @return true if there's anything stored
+     */
+    bool reloadHeader(){
+      _flash->read(0, reinterpret_cast<uint8_t*>(&_header), sizeof(HeaderStruct));
+      if(_header.magic != expectedMagic){
+        _header = HeaderStruct();
+        return false;
+      }
+      return true;
+    }
+
+    /**
+     * @brief replace everything in storage. erases every sector it needs, then programs the modes and events, then the header
+     *
+     * @param modes
+     * @param events
+     * @return bool if operation was successful
+     */
+    bool ingest(const std::vector<ModeDataStruct>& modes, const std::vector<EventDataPacket>& events){
+      HeaderStruct header;
+      header.magic = expectedMagic;
+      header.nModes = modes.size();
+      header.nEvents = events.size();
+      header.modesAddress = _flash->getGeometry().sectorSize;
+      header.eventsAddress = _alignToSector(header.modesAddress + modes.size() * modePacketSize);
+      const uint32_t end = _alignToSector(header.eventsAddress + events.size() * sizeof(EventDataPacket));
+      if(end > _flash->getGeometry().size){return false;}
+
+      for(uint32_t address = 0; address < end; address += _flash->getGeometry().sectorSize){
+        if(!_flash->eraseSector(address)){return false;}
+      }
+
+      std::vector<uint8_t> modeBytes(modes.size() * modePacketSize, 0xFF);
+      for(size_t i = 0; i < modes.size(); i++){
+        serializeModeDataStruct(modes.at(i), &modeBytes[i * modePacketSize]);
+      }
+      std::vector<uint8_t> eventBytes(events.size() * sizeof(EventDataPacket));
+      if(!events.empty()){memcpy(eventBytes.data(), events.data(), eventBytes.size());}
+
+      if(!_flash->program(header.modesAddress, modeBytes.data(), modeBytes.size())){return false;}
+      if(!_flash->program(header.eventsAddress, eventBytes.data(), eventBytes.size())){return false;}
+      if(!_flash->program(0, reinterpret_cast<const uint8_t*>(&header), sizeof(HeaderStruct))){return false;}
+      _header = header;
+      return true;
+    }
+
+    void getModeIDs(storedModeIDsMap_t& storedIDs){
+      storedIDs.clear();
+      for(nModes_t i = 0; i < _header.nModes; i++){
+        modeUUID ID;
+        _flash->read(_modeAddress(i), &ID, sizeof(modeUUID));
+        storedIDs[ID] = i;
+      }
+    }
+
+    void getEventIDs(storedEventIDsMap_t& storedIDs){
+      storedIDs.clear();
+      for(nEvents_t i = 0; i < _header.nEvents; i++){
+        eventUUID ID;
+        _flash->read(_eventAddress(i) + offsetof(EventDataPacket, eventID), &ID, sizeof(eventUUID));
+        storedIDs[ID] = i;
+      }
+    }
+
+    bool getModeAt(nModes_t position, uint8_t buffer[modePacketSize]){
+      if(position >= _header.nModes){return false;}
+      return _flash->read(_modeAddress(position), buffer, modePacketSize);
+    }
+
+    nModes_t getNumberOfStoredModes(){return _header.nModes;}
+
+    EventDataPacket getEventAt(nEvents_t position){
+      EventDataPacket event;
+      if(position < _header.nEvents){
+        _flash->read(_eventAddress(position), reinterpret_cast<uint8_t*>(&event), sizeof(EventDataPacket));
+      }
+      return event;
+    }
+
+    nEvents_t getNumberOfStoredEvents(){return _header.nEvents;}
+
+    nEvents_t fillChunk(EventDataPacket (&buffer)[DataPreloadChunkSize], nEvents_t eventNumber){
+      const nEvents_t number = fillEvents(buffer, eventNumber, DataPreloadChunkSize);
+      for(nEvents_t i = number; i < DataPreloadChunkSize; i++){
+        buffer[i] = EventDataPacket();
+      }
+      return number;
+    }
+
+    nEvents_t getPreferredChunkSize(){return _preferredChunkSize;}
+
+    /**
+     * @brief one read, however many events are wanted
+     */
+    nEvents_t fillEvents(EventDataPacket* buffer, nEvents_t eventNumber, nEvents_t nEvents){
+      if(eventNumber >= _header.nEvents){return 0;}
+      const nEvents_t remaining = _header.nEvents - eventNumber;
+      const nEvents_t number = remaining < nEvents ? remaining : nEvents;
+      _flash->read(_eventAddress(eventNumber), reinterpret_cast<uint8_t*>(buffer), number * sizeof(EventDataPacket));
+      return number;
+    }
+};
+
+#endif
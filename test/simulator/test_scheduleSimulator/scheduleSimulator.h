@@ -0,0 +1,210 @@
+/**
+ * runs EventManager and ModalLights against a virtual clock, so a year of schedule can be checked in a few seconds.
+ *
+ * the virtual clock drifts, and gets corrected by a time sync every syncInterval_S. DST comes from the DSTRulesStruct.
+ * every setModeByUUID() call and every change in light output gets recorded, so the trace can be checked against the event list
+ */
+
+#ifndef __SCHEDULE_SIMULATOR_H__
+#define __SCHEDULE_SIMULATOR_H__
+
+#include <vector>
+#include <stdio.h>
+
+#include "EventManager.h"
+#include "ModalLights.h"
+#include "DataStorageClass.h"
+#include "timeSource.h"
+
+#include "../../ModalLights/test_ModalLights/testModes.h"
+#include "../../nativeMocksAndHelpers/mockConfig.h"
+#include "../../nativeMocksAndHelpers/mockStorageHAL.hpp"
+
+struct SimulatorConfigsStruct {
+  uint64_t startTimeUTC_S = 0;
+  uint32_t days = 365;
+  uint32_t step_S = 60;                   // how far the clock moves each loop
+  uint32_t syncInterval_S = secondsInDay; // how often the time gets synced
+  int32_t clockDrift_ppm = 50;            // how fast the onboard clock runs
+  int32_t timezone = 0;
+  DSTRulesStruct dstRules;
+};
+
+struct ModeCallRecord {
+  uint64_t localTime_S;         // local time of the call
+  uint64_t triggerTimeLocal_S;  // the time the event should have triggered at
+  modeUUID modeID;
+  bool isActive;
+};
+
+struct LightTraceStruct {
+  uint32_t changes = 0;
+  uint32_t checksum = 2166136261; // FNV-1a, so that two runs can be compared without storing every value
+  duty_t values[nChannels] = {0};
+};
+
+/**
+ * @brief records every change in the channel values
+ *
+ */
+class RecordingLightsClass : public VirtualLightsClass{
+  private:
+    LightTraceStruct* _trace;
+  public:
+    RecordingLightsClass(LightTraceStruct* trace) : _trace(trace){};
+
+    void setChannelValues(duty_t newValues[nChannels]) override {
+      if(memcmp(_trace->values, newValues, nChannels) == 0){return;}
+      memcpy(_trace->values, newValues, nChannels);
+      _trace->changes++;
+      for(uint8_t i = 0; i < nChannels; i++){
+        _trace->checksum = (_trace->checksum ^ newValues[i]) * 16777619;
+      }
+    }
+};
+
+/**
+ * @brief passes everything through to the real ModalLightsController, but records the setModeByUUID() calls
+ *
+ */
+class RecordingModalLights : public ModalLightsInterface{
+  private:
+    std::shared_ptr<ModalLightsController> _modalLights;
+    std::shared_ptr<DeviceTimeClass> _deviceTime;
+  public:
+    std::vector<ModeCallRecord> calls;
+
+    RecordingModalLights(
+      std::shared_ptr<ModalLightsController> modalLights,
+      std::shared_ptr<DeviceTimeClass> deviceTime
+    ) : _modalLights(modalLights), _deviceTime(deviceTime){};
+
+    void setModeByUUID(modeUUID modeID, uint64_t triggerTimeLocal_S, bool isActive) override {
+      calls.push_back(ModeCallRecord{
+        .localTime_S = _deviceTime->getLocalTimestampSeconds(),
+        .triggerTimeLocal_S = triggerTimeLocal_S,
+        .modeID = modeID,
+        .isActive = isActive
+      });
+      _modalLights->setModeByUUID(modeID, triggerTimeLocal_S, isActive);
+    }
+
+    void updateLights() override {_modalLights->updateLights();}
+    bool cancelActiveMode() override {return _modalLights->cancelActiveMode();}
+    bool setState(bool newState) override {return _modalLights->setState(newState);}
+    duty_t setBrightnessLevel(duty_t brightness) override {return _modalLights->setBrightnessLevel(brightness);}
+    duty_t adjustBrightness(duty_t amount, bool increasing) override {return _modalLights->adjustBrightness(amount, increasing);}
+    void startBrightnessRamp(bool increasing, uint16_t rampWindow_mS, uint64_t startTimeUTC_uS) override {_modalLights->startBrightnessRamp(increasing, rampWindow_mS, startTimeUTC_uS);}
+    duty_t stopBrightnessRamp(uint64_t stopTimeUTC_uS) override {return _modalLights->stopBrightnessRamp(stopTimeUTC_uS);}
+    duty_t getSetBrightness() override {return _modalLights->getSetBrightness();}
+};
+
+struct SimulatorResultsStruct {
+  uint64_t loops = 0;
+  uint32_t syncs = 0;
+  uint32_t DSTTransitions = 0;
+  double runTime_S = 0;
+  double simulatedDaysPerSecond = 0;
+};
+
+class ScheduleSimulator{
+  private:
+    SimulatorConfigsStruct _configs;
+    std::vector<EventDataPacket> _events;
+
+    std::shared_ptr<VirtualClock> _clock = std::make_shared<VirtualClock>();
+    std::shared_ptr<ConfigManagerClass> _configManager;
+    std::shared_ptr<DeviceTimeClass> _deviceTime;
+    std::shared_ptr<RecordingModalLights> _modalLights;
+    std::unique_ptr<EventManager> _eventManager;
+
+  public:
+    LightTraceStruct lightTrace;
+
+    ScheduleSimulator(
+      SimulatorConfigsStruct configs,
+      const std::vector<TestModeDataStruct> modes,
+      const std::vector<EventDataPacket> events
+    ) : _configs(configs), _events(events){
+      _configManager = makeTestConfigManager();
+      _configManager->setModalConfigs(ModalConfigsStruct{});
+      _deviceTime = std::make_shared<DeviceTimeClass>(_configManager, _clock);
+      _deviceTime->setUTCTimestamp2000(_configs.startTimeUTC_S, _configs.timezone, 0);
+      _deviceTime->setDSTRules(_configs.dstRules);
+      _deviceTime->deferTimeUpdates(true); // same as main
+
+      auto storageHAL = std::make_shared<MockStorageHAL>(makeModeDataStructArray(modes, TestChannels::RGB), events);
+      auto storage = std::make_shared<DataStorageClass>(storageHAL);
+      storage->loadIDs();
+
+      auto controller = std::make_shared<ModalLightsController>(
+        std::make_unique<RecordingLightsClass>(&lightTrace),
+        _deviceTime,
+        storage,
+        _configManager
+      );
+      _modalLights = std::make_shared<RecordingModalLights>(controller, _deviceTime);
+      _eventManager = std::make_unique<EventManager>(_modalLights, _configManager, _deviceTime, storage);
+    }
+
+    /**
+     * @brief run the whole simulation
+     *
+     * @return SimulatorResultsStruct
+     */
+    SimulatorResultsStruct run(){
+      SimulatorResultsStruct results;
+      SteadyClockTimeSource stopwatch;
+      stopwatch.setTimestamp_uS(0);
+
+      const uint64_t step_uS = _configs.step_S * secondsToMicros;
+      const int64_t drift_uS = (int64_t)step_uS * _configs.clockDrift_ppm / 1000000;
+      const uint64_t endTime_S = _configs.startTimeUTC_S + (uint64_t)_configs.days * secondsInDay;
+
+      uint64_t trueTime_S = _configs.startTimeUTC_S;
+      uint64_t nextSync_S = trueTime_S + _configs.syncInterval_S;
+      while(trueTime_S < endTime_S){
+        trueTime_S += _configs.step_S;
+        _clock->advance_uS(step_uS + drift_uS);
+
+        if(trueTime_S >= nextSync_S){
+          _deviceTime->setUTCTimestamp2000(trueTime_S, _configs.timezone, _deviceTime->getConfigs().DST);
+          nextSync_S += _configs.syncInterval_S;
+          results.syncs++;
+        }
+
+        const uint16_t oldDST = _deviceTime->getConfigs().DST;
+        _eventManager->check();
+        results.DSTTransitions += oldDST != _deviceTime->getConfigs().DST;
+
+        _deviceTime->flushTimeUpdates();
+        _modalLights->updateLights();
+        results.loops++;
+      }
+
+      results.runTime_S = stopwatch.getTimestamp_uS() / 1000000.;
+      results.simulatedDaysPerSecond = _configs.days / results.runTime_S;
+      return results;
+    }
+
+    const std::vector<ModeCallRecord>& getModeCalls(){return _modalLights->calls;}
+
+    std::shared_ptr<DeviceTimeClass> getDeviceTime(){return _deviceTime;}
+
+    /**
+     * @brief prints one line per mode call: local time, trigger time, mode ID, and A(ctive) or B(ackground)
+     *
+     */
+    void printTrace(){
+      for(const ModeCallRecord& call : _modalLights->calls){
+        printf("%llu %llu %u %c\n",
+          (unsigned long long)call.localTime_S,
+          (unsigned long long)call.triggerTimeLocal_S,
+          call.modeID,
+          call.isActive ? 'A' : 'B'
+        );
+      }
+    }
+};
+
+#endif
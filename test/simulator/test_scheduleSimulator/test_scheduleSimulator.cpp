@@ -0,0 +1,138 @@
+#include <unity.h>
+
+#include "scheduleSimulator.h"
+
+const uint64_t mondayJan6th2025_S = 789436800;
+const uint32_t oneHour = 60*60;
+
+const EventDataPacket weekdayAlarm = {1, 2, timeToSeconds(6, 45, 0), 0b00011111 /*mon-fri*/, oneHour, true};
+const EventDataPacket weekendAlarm = {2, 255, timeToSeconds(10, 0, 0), 0b01100000 /*weekend*/, oneHour, true};
+const EventDataPacket daytime = {3, 1, timeToSeconds(9, 0, 0), 0b01111111 /*everyday*/, oneHour*8, false};
+const EventDataPacket nighttime = {4, 2, timeToSeconds(21, 0, 0), 0b01111111 /*everyday*/, oneHour, false};
+
+std::vector<EventDataPacket> getSimulatorEvents(){
+  return {weekdayAlarm, weekendAlarm, daytime, nighttime};
+}
+
+SimulatorConfigsStruct ukConfigs(){
+  SimulatorConfigsStruct configs;
+  configs.startTimeUTC_S = mondayJan6th2025_S;
+  configs.dstRules.start = {3, 5, 7, 1*60*60};
+  configs.dstRules.end = {10, 5, 7, 2*60*60};
+  configs.dstRules.DST = 60*60;
+  return configs;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * @brief checks that every mode call matches an event, and that active modes happened inside their window
+ *
+ * @param calls
+ * @param events
+ * @param step_S
+ */
+void TEST_MODE_CALLS_MATCH_EVENTS(const std::vector<ModeCallRecord>& calls, const std::vector<EventDataPacket>& events, uint32_t step_S){
+  for(const ModeCallRecord& call : calls){
+    const std::string message = "local time = " + std::to_string(call.localTime_S) + "; mode = " + std::to_string(call.modeID);
+    const UsefulTimeStruct triggerTime(call.triggerTimeLocal_S);
+    const EventDataPacket* matchingEvent = nullptr;
+    for(const EventDataPacket& event : events){
+      if(
+        event.modeID == call.modeID
+        && event.isActive == call.isActive
+        && event.timeOfDay == triggerTime.timeInDay
+        && (event.daysOfWeek & (1 << (triggerTime.dayOfWeek - 1)))
+      ){
+        matchingEvent = &event;
+        break;
+      }
+    }
+    TEST_ASSERT_NOT_NULL_MESSAGE(matchingEvent, message.c_str());
+    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(call.triggerTimeLocal_S, call.localTime_S, message.c_str());
+    if(call.isActive){
+      // background modes carry on until the next one, so only active modes care about the window
+      TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(call.triggerTimeLocal_S + matchingEvent->eventWindow + step_S, call.localTime_S, message.c_str());
+    }
+  }
+}
+
+uint32_t countCalls(const std::vector<ModeCallRecord>& calls, const EventDataPacket& event){
+  uint32_t count = 0;
+  for(const ModeCallRecord& call : calls){
+    count += (call.modeID == event.modeID)
+      && (call.isActive == event.isActive)
+      && (UsefulTimeStruct(call.triggerTimeLocal_S).timeInDay == event.timeOfDay);
+  }
+  return count;
+}
+
+void printResults(const char* name, SimulatorResultsStruct& results, ScheduleSimulator& simulator){
+  printf("%s: %llu loops, %u syncs, %u DST transitions, %u mode calls, %u light changes, checksum %08x, %.3f s (%.0f simulated days/s)\n",
+    name,
+    (unsigned long long)results.loops,
+    results.syncs,
+    results.DSTTransitions,
+    (unsigned)simulator.getModeCalls().size(),
+    simulator.lightTrace.changes,
+    simulator.lightTrace.checksum,
+    results.runTime_S,
+    results.simulatedDaysPerSecond
+  );
+#ifdef SIMULATOR_PRINT_TRACE
+  simulator.printTrace();
+#endif
+}
+
+void simulateYearUK(void){
+  const SimulatorConfigsStruct configs = ukConfigs();
+  ScheduleSimulator simulator(configs, getAllTestingModes(), getSimulatorEvents());
+  SimulatorResultsStruct results = simulator.run();
+  printResults("UK, 1 minute steps", results, simulator);
+
+  TEST_ASSERT_EQUAL(configs.days * secondsInDay / configs.step_S, results.loops);
+  TEST_ASSERT_EQUAL(configs.days, results.syncs);
+  TEST_ASSERT_EQUAL(2, results.DSTTransitions);
+
+  const std::vector<ModeCallRecord>& calls = simulator.getModeCalls();
+  TEST_MODE_CALLS_MATCH_EVENTS(calls, getSimulatorEvents(), configs.step_S);
+
+  // 2025 starts on a Wednesday, and the simulation starts on Monday 6th of January
+  TEST_ASSERT_EQUAL(261, countCalls(calls, weekdayAlarm));
+  TEST_ASSERT_EQUAL(104, countCalls(calls, weekendAlarm));
+  TEST_ASSERT_GREATER_OR_EQUAL(configs.days, countCalls(calls, daytime));
+  TEST_ASSERT_GREATER_OR_EQUAL(configs.days, countCalls(calls, nighttime));
+
+  TEST_ASSERT_GREATER_THAN(0, simulator.lightTrace.changes);
+}
+
+void simulationIsDeterministic(void){
+  SimulatorConfigsStruct configs = ukConfigs();
+  configs.days = 60;
+  configs.step_S = 5*60;
+
+  ScheduleSimulator simulator1(configs, getAllTestingModes(), getSimulatorEvents());
+  simulator1.run();
+  ScheduleSimulator simulator2(configs, getAllTestingModes(), getSimulatorEvents());
+  SimulatorResultsStruct results = simulator2.run();
+  printResults("UK, 5 minute steps", results, simulator2);
+
+  TEST_ASSERT_EQUAL(simulator1.getModeCalls().size(), simulator2.getModeCalls().size());
+  TEST_ASSERT_EQUAL(simulator1.lightTrace.changes, simulator2.lightTrace.changes);
+  TEST_ASSERT_EQUAL(simulator1.lightTrace.checksum, simulator2.lightTrace.checksum);
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(simulateYearUK);
+  RUN_TEST(simulationIsDeterministic);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
\ No newline at end of file
@@ -4,6 +4,8 @@
 // #include "DeviceTime.h"
 
 #include "../nativeMocksAndHelpers/mockConfig.h"
+#include "../nativeMocksAndHelpers/flashSimulator.h"
+#include "timeSource.h"
 
 // ConfigManagerClass configs;
 std::shared_ptr<ConfigManagerClass> configs;
@@ -125,6 +127,290 @@ void ModalConfigs(void){
   }
 }
 
+namespace ConfigManagerTests{
+  const char* flashPath = "test_ConfigManager_flash.bin";
+  const FlashGeometryStruct geometry{
+    .size = 4*4096,
+    .pageSize = 256,
+    .sectorSize = 4096
+  };
+
+  /**
+   * @brief a fresh flash file, like a device that's never been flashed
+   */
+  std::shared_ptr<FlashSimulator> makeErasedFlash(){
+    remove(flashPath);
+    return std::make_shared<FlashSimulator>(geometry, FlashTimingsStruct(), flashPath);
+  }
+
+  /**
+   * @brief reopens the flash file, and reads the configs out of it
+   */
+  std::unique_ptr<DoubleBufferedConfigHAL> reboot(std::shared_ptr<FlashSimulator>& flash){
+    flash.reset();
+    flash = std::make_shared<FlashSimulator>(geometry, FlashTimingsStruct(), flashPath);
+    return std::make_unique<DoubleBufferedConfigHAL>(std::make_unique<FlashConfigSlots>(flash));
+  }
+
+  ConfigsStruct makeConfigs(uint32_t n){
+    ConfigsStruct configs;
+    configs.rtcConfigs.timezone = n;
+    configs.eventConfigs.defaultEventWindow_S = 60 + n;
+    configs.modalConfigs.minOnBrightness = 1 + (n % 200);
+    return configs;
+  }
+
+  void assertConfigs(uint32_t n, const ConfigsStruct& configs){
+    TEST_ASSERT_EQUAL(n, configs.rtcConfigs.timezone);
+    TEST_ASSERT_EQUAL(60 + n, configs.eventConfigs.defaultEventWindow_S);
+    TEST_ASSERT_EQUAL(1 + (n % 200), configs.modalConfigs.minOnBrightness);
+  }
+
+  /**
+   * @brief counts the writes, and remembers which fields they were for
+   */
+  class CountingConfigHal : public MockConfigHal{
+    public:
+      uint16_t writes = 0;
+      configFields_t lastFields = ConfigFields::none;
+      bool isBroken = false;
+
+      bool setConfigFields(const ConfigsStruct& configs, configFields_t changedFields) override {
+        if(isBroken){return false;}
+        writes++;
+        lastFields = changedFields;
+        return setConfigs(configs);
+      }
+  };
+}
+
+void CoalescedWrites(void){
+  using namespace ConfigManagerTests;
+  auto hal = std::make_unique<CountingConfigHal>();
+  CountingConfigHal* halPtr = hal.get();
+  ConfigManagerClass configManager(std::move(hal));
+  const uint32_t delay_uS = CONFIG_FLUSH_DELAY_uS;
+  uint64_t now_uS = 1000;
+
+  // nothing to write
+  TEST_ASSERT_FALSE(configManager.update(now_uS));
+  TEST_ASSERT_EQUAL(ConfigFields::none, configManager.getDirtyFields());
+
+  // setting the same values doesn't make anything dirty
+  TEST_ASSERT_TRUE(configManager.setModalConfigs(configManager.getModalConfigs()));
+  TEST_ASSERT_EQUAL(ConfigFields::none, configManager.getDirtyFields());
+
+  // even if the padding is different
+  {
+    alignas(DSTRulesStruct) uint8_t bytes[sizeof(DSTRulesStruct)];
+    memset(bytes, 0xAA, sizeof(bytes));
+    DSTRulesStruct* sameRules = new (bytes) DSTRulesStruct;
+    const DSTRulesStruct currentRules = configManager.getDSTRules();
+    sameRules->start.month = currentRules.start.month;
+    sameRules->start.week = currentRules.start.week;
+    sameRules->start.dayOfWeek = currentRules.start.dayOfWeek;
+    sameRules->start.timeOfDay_S = currentRules.start.timeOfDay_S;
+    sameRules->end.month = currentRules.end.month;
+    sameRules->end.week = currentRules.end.week;
+    sameRules->end.dayOfWeek = currentRules.end.dayOfWeek;
+    sameRules->end.timeOfDay_S = currentRules.end.timeOfDay_S;
+    sameRules->DST = currentRules.DST;
+    TEST_ASSERT_TRUE(configManager.setDSTRules(*sameRules));
+    TEST_ASSERT_EQUAL(ConfigFields::none, configManager.getDirtyFields());
+  }
+
+  // lots of changes in quick succession only get written once they stop
+  ModalConfigsStruct modalConfigs = configManager.getModalConfigs();
+  for(duty_t b = 10; b < 30; b++){
+    modalConfigs.minOnBrightness = b;
+    TEST_ASSERT_TRUE(configManager.setModalConfigs(modalConfigs));
+    TEST_ASSERT_FALSE(configManager.update(now_uS));
+    now_uS += delay_uS / 4;
+  }
+  RTCConfigsStruct rtcConfigs = configManager.getRTCConfigs();
+  rtcConfigs.timezone = 3600;
+  configManager.setRTCConfigs(rtcConfigs);
+  TEST_ASSERT_EQUAL(ConfigFields::modalConfigs | ConfigFields::rtcConfigs, configManager.getDirtyFields());
+  TEST_ASSERT_EQUAL(0, halPtr->writes);
+
+  TEST_ASSERT_FALSE(configManager.update(now_uS));
+  TEST_ASSERT_FALSE(configManager.update(now_uS + delay_uS - 1));
+  TEST_ASSERT_TRUE(configManager.update(now_uS + delay_uS));
+  TEST_ASSERT_EQUAL(1, halPtr->writes);
+  TEST_ASSERT_EQUAL(ConfigFields::modalConfigs | ConfigFields::rtcConfigs, halPtr->lastFields);
+  TEST_ASSERT_EQUAL(29, halPtr->getAllConfigs().modalConfigs.minOnBrightness);
+  TEST_ASSERT_EQUAL(3600, halPtr->getAllConfigs().rtcConfigs.timezone);
+  TEST_ASSERT_EQUAL(ConfigFields::none, configManager.getDirtyFields());
+  now_uS += delay_uS;
+
+  // a failed write keeps the fields dirty, and waits before trying again
+  EventManagerConfigsStruct eventConfigs = configManager.getEventManagerConfigs();
+  eventConfigs.defaultEventWindow_S += 60;
+  configManager.setEventManagerConfigs(eventConfigs);
+  halPtr->isBroken = true;
+  configManager.update(now_uS);
+  TEST_ASSERT_FALSE(configManager.update(now_uS + delay_uS));
+  TEST_ASSERT_EQUAL(ConfigFields::eventConfigs, configManager.getDirtyFields());
+  halPtr->isBroken = false;
+  TEST_ASSERT_FALSE(configManager.update(now_uS + delay_uS + 1));
+  TEST_ASSERT_TRUE(configManager.update(now_uS + 2*delay_uS));
+  TEST_ASSERT_EQUAL(2, halPtr->writes);
+  TEST_ASSERT_EQUAL(ConfigFields::eventConfigs, halPtr->lastFields);
+
+  // flush() doesn't wait
+  DSTRulesStruct dstRules = configManager.getDSTRules();
+  dstRules.DST = 3600;
+  configManager.setDSTRules(dstRules);
+  TEST_ASSERT_TRUE(configManager.flush());
+  TEST_ASSERT_EQUAL(3, halPtr->writes);
+  TEST_ASSERT_EQUAL(ConfigFields::dstRules, halPtr->lastFields);
+  TEST_ASSERT_TRUE(configManager.flush());
+  TEST_ASSERT_EQUAL(3, halPtr->writes);
+}
+
+void DoubleBufferedCommits(void){
+  using namespace ConfigManagerTests;
+  auto flash = makeErasedFlash();
+
+  // nothing stored yet, so it's the defaults
+  {
+    DoubleBufferedConfigHAL hal(std::make_unique<FlashConfigSlots>(flash));
+    TEST_ASSERT_EQUAL(0xFF, hal.getNewestSlot());
+    TEST_ASSERT_EQUAL(ConfigsStruct().eventConfigs.defaultEventWindow_S, hal.getAllConfigs().eventConfigs.defaultEventWindow_S);
+    TEST_ASSERT_FALSE(hal.reloadConfigs());
+  }
+
+  // commits alternate between the slots, and a commit is one sector
+  {
+    auto hal = reboot(flash);
+    for(uint32_t n = 1; n <= 5; n++){
+      const uint32_t erasesBefore = flash->stats.erases;
+      TEST_ASSERT_TRUE(hal->setConfigs(makeConfigs(n)));
+      TEST_ASSERT_EQUAL(erasesBefore + 1, flash->stats.erases);
+      TEST_ASSERT_EQUAL(n, hal->getSequence());
+      TEST_ASSERT_EQUAL((n - 1) % 2, hal->getNewestSlot());
+    }
+  }
+
+  // the newest survives a reboot
+  {
+    auto hal = reboot(flash);
+    TEST_ASSERT_EQUAL(5, hal->getSequence());
+    TEST_ASSERT_EQUAL(0, hal->getNewestSlot());
+    assertConfigs(5, hal->getAllConfigs());
+
+    // and works through ConfigManager
+    ConfigManagerClass configManager(std::move(hal));
+    TEST_ASSERT_EQUAL(5, configManager.getRTCConfigs().timezone);
+  }
+  remove(flashPath);
+}
+
+void PowerLossDuringCommit(void){
+  using namespace ConfigManagerTests;
+  auto flash = makeErasedFlash();
+  {
+    DoubleBufferedConfigHAL hal(std::make_unique<FlashConfigSlots>(flash));
+    TEST_ASSERT_TRUE(hal.setConfigs(makeConfigs(1)));
+    TEST_ASSERT_TRUE(hal.setConfigs(makeConfigs(2)));
+  }
+
+  // lose power at every point in the commit. it's always either the old configs or the new ones
+  for(uint32_t cutAt = 0; cutAt <= sizeof(ConfigSlotRecord); cutAt += 4){
+    std::string message = "power cut after " + std::to_string(cutAt) + " bytes";
+    auto hal = reboot(flash);
+    const uint32_t before = hal->getSequence();
+    flash->schedulePowerCut(cutAt);
+    const bool committed = hal->setConfigs(makeConfigs(before + 1));
+    flash->powerOn();
+
+    // if the power goes right at the end, the commit can be there even though it wasn't confirmed
+    hal = reboot(flash);
+    if(committed){
+      TEST_ASSERT_EQUAL_MESSAGE(before + 1, hal->getSequence(), message.c_str());
+    }
+    else{
+      TEST_ASSERT_TRUE_MESSAGE(hal->getSequence() == before || hal->getSequence() == before + 1, message.c_str());
+    }
+    assertConfigs(hal->getSequence(), hal->getAllConfigs());
+  }
+
+  // a slot that's been corrupted afterwards gets skipped
+  {
+    auto hal = reboot(flash);
+    const uint32_t newest = hal->getSequence();
+    const uint8_t newestSlot = hal->getNewestSlot();
+    const uint8_t zeros[4] = {0, 0, 0, 0};
+    flash->program(newestSlot * geometry.sectorSize + offsetof(ConfigSlotRecord, configs), zeros, sizeof(zeros));
+    hal = reboot(flash);
+    TEST_ASSERT_EQUAL(newest - 1, hal->getSequence());
+    assertConfigs(newest - 1, hal->getAllConfigs());
+
+    // the next commit goes over the corrupted slot
+    TEST_ASSERT_TRUE(hal->setConfigs(makeConfigs(newest)));
+    TEST_ASSERT_EQUAL(newestSlot, hal->getNewestSlot());
+    hal = reboot(flash);
+    assertConfigs(newest, hal->getAllConfigs());
+  }
+  remove(flashPath);
+}
+
+void SequenceWrapping(void){
+  using namespace ConfigManagerTests;
+  auto flash = makeErasedFlash();
+
+  // write records by hand, either side of the wrap
+  ConfigSlotRecord records[2] = {};
+  const uint32_t sequences[2] = {0, 0xFFFFFFFF};
+  for(uint8_t slot = 0; slot < 2; slot++){
+    records[slot].magic = ConfigSlotRecord::expectedMagic;
+    records[slot].sequence = sequences[slot];
+    records[slot].size = sizeof(ConfigsStruct);
+    records[slot].configs = makeConfigs(slot);
+    records[slot].crc = records[slot].calculateCRC();
+    FlashConfigSlots(flash).writeSlot(slot, reinterpret_cast<const uint8_t*>(&records[slot]), sizeof(ConfigSlotRecord));
+  }
+  auto hal = reboot(flash);
+  TEST_ASSERT_EQUAL(0, hal->getNewestSlot());
+  assertConfigs(0, hal->getAllConfigs());
+  remove(flashPath);
+}
+
+void benchmarkConfigCommit(void){
+  using namespace ConfigManagerTests;
+  auto flash = makeErasedFlash();
+  DoubleBufferedConfigHAL hal(std::make_unique<FlashConfigSlots>(flash));
+  const uint16_t commits = 200;
+  SteadyClockTimeSource stopwatch;
+  uint64_t worst_uS = 0;
+  uint64_t total_uS = 0;
+  flash->resetStats();
+  for(uint16_t n = 0; n < commits; n++){
+    const ConfigsStruct configs = makeConfigs(n);
+    stopwatch.setTimestamp_uS(0);
+    TEST_ASSERT_TRUE(hal.setConfigs(configs));
+    const uint64_t commit_uS = stopwatch.getTimestamp_uS();
+    total_uS += commit_uS;
+    if(commit_uS > worst_uS){worst_uS = commit_uS;}
+  }
+  const FlashStatsStruct commitStats = flash->stats;
+  const uint32_t maxSectorErases = flash->getMaxSectorErases();  // the wear doesn't survive the reboot
+  stopwatch.setTimestamp_uS(0);
+  auto rebooted = reboot(flash);
+  const uint64_t boot_uS = stopwatch.getTimestamp_uS();
+  printf("config commit (%u byte record): cpu mean %.1f uS, worst %llu uS. simulated flash %.1f mS per commit, %lu erases on the busiest sector after %u commits\n",
+    (unsigned)sizeof(ConfigSlotRecord), (double)total_uS / commits, (unsigned long long)worst_uS,
+    commitStats.simulatedTime_nS / 1e6 / commits, (unsigned long)maxSectorErases, commits
+  );
+  printf("config boot: cpu %llu uS, simulated flash %.1f uS over %lu reads\n",
+    (unsigned long long)boot_uS, flash->stats.simulatedTime_nS / 1e3, (unsigned long)flash->stats.reads
+  );
+  TEST_ASSERT_EQUAL(commits / 2, maxSectorErases);
+  TEST_ASSERT_EQUAL(3, flash->stats.reads);  // both headers, then only the newest slot
+  assertConfigs(commits - 1, rebooted->getAllConfigs());
+  remove(flashPath);
+}
+
 void noEmbeddedUnfriendlyLibraries(){
   #ifdef __PRINT_DEBUG_H__
     TEST_ASSERT_MESSAGE(false, "did you forget to remove the print debugs?");
@@ -145,6 +431,11 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(RTCConfigs);
   RUN_TEST(EventManagerConfigs);
   RUN_TEST(ModalConfigs);
+  RUN_TEST(CoalescedWrites);
+  RUN_TEST(DoubleBufferedCommits);
+  RUN_TEST(PowerLossDuringCommit);
+  RUN_TEST(SequenceWrapping);
+  RUN_TEST(benchmarkConfigCommit);
   UNITY_END();
 }
 
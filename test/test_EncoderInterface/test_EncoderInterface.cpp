@@ -0,0 +1,265 @@
+#include <unity.h>
+
+#include "EncoderInterface.hpp"
+
+#include "../EventManager/test_EventManager/mockModalLights.hpp"
+#include "../nativeMocksAndHelpers/mockConfig.h"
+
+/**
+ * @brief behaves like the pulse counter peripheral: a 16 bit counter that resets to 0 at its limits, and an overflow that the limit interrupt would keep
+ *
+ */
+class MockPCNTEncoder : public EncoderInterface {
+  private:
+    int16_t _counter = 0;
+    int32_t _overflow = 0;
+
+  public:
+    const int16_t counterLimit;
+
+    MockPCNTEncoder(
+      std::shared_ptr<DeviceTimeClass> deviceTime,
+      std::shared_ptr<ModalLightsInterface> modalLights,
+      EncoderConfigs configs = EncoderConfigs{},
+      int16_t limit = 10000
+    ) : EncoderInterface(deviceTime, modalLights, configs), counterLimit(limit) {};
+
+    /**
+     * @brief turn the encoder one count at a time
+     *
+     * @param counts positive for clockwise
+     */
+    void turn(int32_t counts){
+      const int16_t dir = counts > 0 ? 1 : -1;
+      for(int32_t i = 0; i != counts; i += dir){
+        _counter += dir;
+        if(_counter == counterLimit || _counter == -counterLimit){
+          _overflow += _counter;
+          _counter = 0;
+        }
+      }
+    }
+
+    int16_t getCounter(){return _counter;}
+
+    int32_t getCount() override {
+      return _overflow + _counter;
+    }
+};
+
+void setUp(void){}
+void tearDown(void){}
+
+namespace EncoderInterfaceTests{
+  struct TestObjects{
+    std::shared_ptr<OnboardTimestamp> timestamp;
+    std::shared_ptr<MockModalLights> modalLights;
+    std::shared_ptr<MockPCNTEncoder> encoder;
+
+    /**
+     * @brief increment the time, then call update on the encoder
+     *
+     * @param increment_mS
+     * @return int16_t the number of clicks
+     */
+    int16_t incrementTimeAndUpdate_mS(uint64_t increment_mS){
+      timestamp->setTimestamp_uS(timestamp->getTimestamp_uS() + increment_mS*1000);
+      return encoder->update();
+    }
+  };
+
+  TestObjects testEncoderFactory(EncoderConfigs configs = EncoderConfigs{}, int16_t counterLimit = 10000){
+    TestObjects testObjects;
+    std::shared_ptr<ConfigManagerClass> configManager = makeTestConfigManager();
+    testObjects.timestamp = std::make_shared<OnboardTimestamp>();
+    std::shared_ptr<DeviceTimeClass> deviceTime = std::make_shared<DeviceTimeClass>(configManager);
+    deviceTime->setUTCTimestamp2000(794275200, 0, 0);
+    testObjects.modalLights = std::make_shared<MockModalLights>();
+    testObjects.modalLights->setBrightnessLevel(100);
+    testObjects.modalLights->setState(true);
+    testObjects.encoder = std::make_shared<MockPCNTEncoder>(deviceTime, testObjects.modalLights, configs, counterLimit);
+    testObjects.encoder->update();
+    return testObjects;
+  }
+}
+
+void testSlowTurning(){
+  using namespace EncoderInterfaceTests;
+  const EncoderConfigs configs;
+
+  // no turning, no adjustment
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.modalLights->previousAdjustment = 500;
+    for(uint8_t i = 0; i < 10; i++){
+      TEST_ASSERT_EQUAL(0, testObjects.incrementTimeAndUpdate_mS(20));
+    }
+    TEST_ASSERT_EQUAL(500, testObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(100, testObjects.modalLights->getBrightnessLevel());
+  }
+
+  // one click per second adjusts by stepsPerDetent
+  {
+    TestObjects testObjects = testEncoderFactory();
+    for(uint8_t i = 0; i < 5; i++){
+      testObjects.encoder->turn(configs.countsPerDetent);
+      TEST_ASSERT_EQUAL(1, testObjects.incrementTimeAndUpdate_mS(1000));
+      TEST_ASSERT_EQUAL(configs.stepsPerDetent, testObjects.modalLights->previousAdjustment);
+    }
+    TEST_ASSERT_EQUAL(100 + 5*configs.stepsPerDetent, testObjects.modalLights->getBrightnessLevel());
+
+    for(uint8_t i = 0; i < 5; i++){
+      testObjects.encoder->turn(-configs.countsPerDetent);
+      TEST_ASSERT_EQUAL(-1, testObjects.incrementTimeAndUpdate_mS(1000));
+      TEST_ASSERT_EQUAL(-configs.stepsPerDetent, testObjects.modalLights->previousAdjustment);
+    }
+    TEST_ASSERT_EQUAL(100, testObjects.modalLights->getBrightnessLevel());
+  }
+
+  // part clicks carry over to the next update
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.modalLights->previousAdjustment = 500;
+    testObjects.encoder->turn(configs.countsPerDetent - 1);
+    TEST_ASSERT_EQUAL(0, testObjects.incrementTimeAndUpdate_mS(1000));
+    TEST_ASSERT_EQUAL(500, testObjects.modalLights->previousAdjustment);
+    testObjects.encoder->turn(1);
+    TEST_ASSERT_EQUAL(1, testObjects.incrementTimeAndUpdate_mS(1000));
+    TEST_ASSERT_EQUAL(configs.stepsPerDetent, testObjects.modalLights->previousAdjustment);
+
+    // and turning back cancels them out
+    testObjects.modalLights->previousAdjustment = 500;
+    testObjects.encoder->turn(configs.countsPerDetent - 1);
+    testObjects.incrementTimeAndUpdate_mS(1000);
+    testObjects.encoder->turn(-(configs.countsPerDetent - 1));
+    TEST_ASSERT_EQUAL(0, testObjects.incrementTimeAndUpdate_mS(1000));
+    TEST_ASSERT_EQUAL(500, testObjects.modalLights->previousAdjustment);
+  }
+
+  // polling faster than the clicks doesn't make them fast
+  {
+    TestObjects testObjects = testEncoderFactory();
+    for(uint8_t click = 0; click < 5; click++){
+      for(uint8_t i = 0; i < 24; i++){
+        TEST_ASSERT_EQUAL(0, testObjects.incrementTimeAndUpdate_mS(20));
+      }
+      testObjects.encoder->turn(configs.countsPerDetent);
+      TEST_ASSERT_EQUAL(1, testObjects.incrementTimeAndUpdate_mS(20));
+      TEST_ASSERT_EQUAL(configs.stepsPerDetent, testObjects.modalLights->previousAdjustment);
+    }
+    TEST_ASSERT_EQUAL(100 + 5*configs.stepsPerDetent, testObjects.modalLights->getBrightnessLevel());
+  }
+}
+
+void testFastTurning(){
+  using namespace EncoderInterfaceTests;
+  const EncoderConfigs configs;
+
+  // turning at fastDetentRate or faster gets maxStepsPerDetent
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.encoder->turn(configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(1, testObjects.incrementTimeAndUpdate_mS(1000/configs.fastDetentRate));
+    TEST_ASSERT_EQUAL(configs.maxStepsPerDetent, testObjects.modalLights->previousAdjustment);
+
+    testObjects.encoder->turn(-3*configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(-3, testObjects.incrementTimeAndUpdate_mS(20));
+    TEST_ASSERT_EQUAL(-3*configs.maxStepsPerDetent, testObjects.modalLights->previousAdjustment);
+  }
+
+  // half speed is half way between
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.encoder->turn(configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(1, testObjects.incrementTimeAndUpdate_mS(2000/configs.fastDetentRate));
+    const int16_t expectedSteps = configs.stepsPerDetent + (configs.maxStepsPerDetent - configs.stepsPerDetent)/2;
+    TEST_ASSERT_EQUAL(expectedSteps, testObjects.modalLights->previousAdjustment);
+  }
+
+  // the adjustment can't be more than 255
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.encoder->turn(100*configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(100, testObjects.incrementTimeAndUpdate_mS(20));
+    TEST_ASSERT_EQUAL(255, testObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(255, testObjects.modalLights->getBrightnessLevel());
+  }
+
+  // time going backwards is slow
+  {
+    TestObjects testObjects = testEncoderFactory();
+    testObjects.timestamp->setTimestamp_uS(testObjects.timestamp->getTimestamp_uS() - 1000000);
+    testObjects.encoder->turn(2*configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(2, testObjects.encoder->update());
+    TEST_ASSERT_EQUAL(2*configs.stepsPerDetent, testObjects.modalLights->previousAdjustment);
+  }
+}
+
+void testCounterLimits(){
+  using namespace EncoderInterfaceTests;
+  const EncoderConfigs configs = {.countsPerDetent = 4, .stepsPerDetent = 1, .maxStepsPerDetent = 1};
+
+  // the hardware counter resetting at its limits shouldn't lose any counts
+  TestObjects testObjects = testEncoderFactory(configs, 20);
+  testObjects.modalLights->setBrightnessLevel(0);
+  for(uint8_t i = 0; i < 10; i++){
+    testObjects.encoder->turn(7*configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(7, testObjects.incrementTimeAndUpdate_mS(100));
+  }
+  TEST_ASSERT_EQUAL(70, testObjects.modalLights->getBrightnessLevel());
+  for(uint8_t i = 0; i < 10; i++){
+    testObjects.encoder->turn(-5*configs.countsPerDetent);
+    TEST_ASSERT_EQUAL(-5, testObjects.incrementTimeAndUpdate_mS(100));
+  }
+  TEST_ASSERT_EQUAL(20, testObjects.modalLights->getBrightnessLevel());
+  TEST_ASSERT_NOT_EQUAL(testObjects.encoder->getCount(), testObjects.encoder->getCounter());
+}
+
+void testCountWrapping(){
+  using namespace EncoderInterfaceTests;
+
+  // the accumulated count wrapping around int32 shouldn't make a jump
+  class WrappingEncoder : public MockPCNTEncoder {
+    public:
+      using MockPCNTEncoder::MockPCNTEncoder;
+      int32_t count = INT32_MAX - 2;
+      int32_t getCount() override {return count;}
+  };
+
+  TestObjects testObjects = testEncoderFactory();
+  WrappingEncoder encoder(std::make_shared<DeviceTimeClass>(makeTestConfigManager()), testObjects.modalLights);
+  encoder.update();
+  encoder.count = static_cast<int32_t>(static_cast<uint32_t>(encoder.count) + 8);
+  TEST_ASSERT_EQUAL(2, encoder.update());
+  TEST_ASSERT_EQUAL(102, testObjects.modalLights->getBrightnessLevel());
+}
+
+void noEmbeddedUnfriendlyLibraries(){
+  #ifdef __PRINT_DEBUG_H__
+    TEST_ASSERT_MESSAGE(false, "did you forget to remove the print debugs?");
+  #else
+    TEST_ASSERT(true);
+  #endif
+
+  #ifdef _GLIBCXX_MAP
+    TEST_ASSERT_MESSAGE(false, "std::map is included");
+  #else
+    TEST_ASSERT(true);
+  #endif
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(noEmbeddedUnfriendlyLibraries);
+  RUN_TEST(testSlowTurning);
+  RUN_TEST(testFastTurning);
+  RUN_TEST(testCounterLimits);
+  RUN_TEST(testCountWrapping);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
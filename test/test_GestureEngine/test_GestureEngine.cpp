@@ -0,0 +1,354 @@
+#include <unity.h>
+
+#include "GestureEngine.hpp"
+#include "timeSource.h"
+
+void setUp(void){}
+void tearDown(void){}
+
+namespace GestureEngineTests{
+  enum TestGestures : gestureID_t {
+    tap0 = 1,
+    doubleTap0,
+    tripleTap0,
+    hold0,
+    tap1,
+    chordTap01,
+    chordHold01,
+    tap2,
+    hold2
+  };
+
+  const GestureDefinition testGestures[] = {
+    {tap0, 0b001, 1},
+    {doubleTap0, 0b001, 2},
+    {tripleTap0, 0b001, 3},
+    {hold0, 0b001, 0},
+    {tap1, 0b010, 1},
+    {chordTap01, 0b011, 1},
+    {chordHold01, 0b011, 0},
+    {tap2, 0b100, 1},
+    {hold2, 0b100, 0},
+  };
+
+  const GestureConfigs configs;
+
+  /**
+   * @brief holds the engine and the current time and inputs
+   *
+   */
+  struct TestEngine {
+    GestureEngine<4, sizeof(testGestures)/sizeof(GestureDefinition)> engine{testGestures, configs};
+    uint64_t time_uS = 794275200000000;
+    inputMask_t inputs = 0;
+
+    uint8_t setInputs(inputMask_t newInputs){
+      inputs = newInputs;
+      return engine.update(inputs, time_uS);
+    }
+
+    /**
+     * @brief advance time in 10 mS ticks. fails the test if a gesture gets recognised
+     *
+     * @param time_mS
+     */
+    void advanceQuietly_mS(uint32_t time_mS){
+      for(uint32_t t = 0; t < time_mS; t += 10){
+        time_uS += 10000;
+        TEST_ASSERT_EQUAL(0, engine.update(inputs, time_uS));
+      }
+    }
+
+    /**
+     * @brief advance time in 10 mS ticks until a gesture gets recognised
+     *
+     * @param maxTime_mS fails the test if nothing is recognised by this time
+     * @return uint32_t how long it took in mS
+     */
+    uint32_t advanceUntilGesture_mS(uint32_t maxTime_mS){
+      for(uint32_t t = 10; t <= maxTime_mS; t += 10){
+        time_uS += 10000;
+        if(engine.update(inputs, time_uS) != 0){return t;}
+      }
+      TEST_FAIL_MESSAGE("no gesture was recognised");
+      return 0;
+    }
+
+    void tap(inputMask_t tapInputs, uint32_t pressTime_mS = 50){
+      setInputs(tapInputs);
+      advanceQuietly_mS(pressTime_mS);
+      setInputs(0);
+    }
+  };
+
+  #define TEST_GESTURE(testEngine, expectedID, expectedPhase) do{ \
+    TEST_ASSERT_EQUAL(expectedID, testEngine.engine.getEvent(0).ID); \
+    TEST_ASSERT_EQUAL(expectedPhase, testEngine.engine.getEvent(0).phase); \
+    TEST_ASSERT_EQUAL(testEngine.time_uS, testEngine.engine.getEvent(0).time_uS); \
+  }while(0)
+}
+
+void testGrouping(){
+  using namespace GestureEngineTests;
+  TestEngine testEngine;
+  // inputs 0 and 1 are a chord, 2 and 3 are on their own
+  TEST_ASSERT_EQUAL(3, testEngine.engine.getNumberOfGroups());
+  TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+}
+
+void testTaps(){
+  using namespace GestureEngineTests;
+
+  // single tap gets recognised when the multi-tap window ends
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b001);
+    TEST_ASSERT_FALSE(testEngine.engine.isIdle());
+    testEngine.advanceQuietly_mS(50);
+    TEST_ASSERT_EQUAL(0, testEngine.setInputs(0));
+    TEST_ASSERT_EQUAL(configs.multiTapWindow_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, tap0, GesturePhases::tap);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+
+  // double tap
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.tap(0b001);
+    TEST_ASSERT_EQUAL(configs.multiTapWindow_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, doubleTap0, GesturePhases::tap);
+  }
+
+  // triple tap gets recognised on release, because there aren't any quadruple taps
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.tap(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.setInputs(0b001);
+    testEngine.advanceQuietly_mS(50);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0));
+    TEST_GESTURE(testEngine, tripleTap0, GesturePhases::tap);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+
+  // taps too far apart are separate
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b001);
+    testEngine.advanceUntilGesture_mS(1000);
+    TEST_GESTURE(testEngine, tap0, GesturePhases::tap);
+    testEngine.tap(0b001);
+    testEngine.advanceUntilGesture_mS(1000);
+    TEST_GESTURE(testEngine, tap0, GesturePhases::tap);
+  }
+
+  // tap gets recognised on release when there aren't any multi-taps
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b100);
+    testEngine.advanceQuietly_mS(50);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0));
+    TEST_GESTURE(testEngine, tap2, GesturePhases::tap);
+  }
+
+  // inputs that aren't in the table don't do anything
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b1000);
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+}
+
+void testHolds(){
+  using namespace GestureEngineTests;
+
+  // hold starts after holdTime_mS, and ends on release
+  {
+    TestEngine testEngine;
+    const uint64_t pressStart_uS = testEngine.time_uS;
+    testEngine.setInputs(0b001);
+    TEST_ASSERT_EQUAL(configs.holdTime_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, hold0, GesturePhases::holdStart);
+    TEST_ASSERT_EQUAL(pressStart_uS, testEngine.engine.getEvent(0).pressStart_uS);
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0));
+    TEST_GESTURE(testEngine, hold0, GesturePhases::holdEnd);
+    TEST_ASSERT_EQUAL(pressStart_uS, testEngine.engine.getEvent(0).pressStart_uS);
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+
+  // a hold that nothing ticked through still starts and ends on release
+  {
+    TestEngine testEngine;
+    const uint64_t pressStart_uS = testEngine.time_uS;
+    testEngine.setInputs(0b001);
+    testEngine.time_uS += 700000;
+    TEST_ASSERT_EQUAL(2, testEngine.setInputs(0));
+    TEST_ASSERT_EQUAL(hold0, testEngine.engine.getEvent(0).ID);
+    TEST_ASSERT_EQUAL(GesturePhases::holdStart, testEngine.engine.getEvent(0).phase);
+    TEST_ASSERT_EQUAL(pressStart_uS, testEngine.engine.getEvent(0).pressStart_uS);
+    TEST_ASSERT_EQUAL(hold0, testEngine.engine.getEvent(1).ID);
+    TEST_ASSERT_EQUAL(GesturePhases::holdEnd, testEngine.engine.getEvent(1).phase);
+    TEST_ASSERT_EQUAL(testEngine.time_uS, testEngine.engine.getEvent(1).time_uS);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+
+  // reset forgets the press without emitting anything
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b001);
+    TEST_ASSERT_EQUAL(configs.holdTime_mS, testEngine.advanceUntilGesture_mS(1000));
+    testEngine.engine.reset();
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+    testEngine.inputs = 0;
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_EQUAL(3, testEngine.engine.getNumberOfGroups());
+    testEngine.tap(0b001);
+    TEST_ASSERT_EQUAL(configs.multiTapWindow_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, tap0, GesturePhases::tap);
+  }
+
+  // a long press without a hold doesn't do anything
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b010);
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_EQUAL(0, testEngine.setInputs(0));
+    testEngine.advanceQuietly_mS(1000);
+    TEST_ASSERT_TRUE(testEngine.engine.isIdle());
+  }
+
+  // tap then hold finishes the taps first
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.setInputs(0b001);
+    TEST_ASSERT_EQUAL(configs.holdTime_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_ASSERT_EQUAL(tap0, testEngine.engine.getEvent(0).ID);
+    TEST_ASSERT_EQUAL(hold0, testEngine.engine.getEvent(1).ID);
+  }
+}
+
+void testChords(){
+  using namespace GestureEngineTests;
+
+  // pressing both inputs taps the chord, even if they're pressed at different times
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b001);
+    testEngine.advanceQuietly_mS(30);
+    testEngine.setInputs(0b011);
+    testEngine.advanceQuietly_mS(50);
+    testEngine.setInputs(0b010);
+    testEngine.advanceQuietly_mS(20);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0));
+    TEST_GESTURE(testEngine, chordTap01, GesturePhases::tap);
+  }
+
+  // chord hold
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b011);
+    TEST_ASSERT_EQUAL(configs.holdTime_mS, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, chordHold01, GesturePhases::holdStart);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0));
+    TEST_GESTURE(testEngine, chordHold01, GesturePhases::holdEnd);
+  }
+
+  // a different chord finishes the previous taps
+  {
+    TestEngine testEngine;
+    testEngine.tap(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.setInputs(0b011);
+    testEngine.advanceQuietly_mS(50);
+    TEST_ASSERT_EQUAL(2, testEngine.setInputs(0));
+    TEST_ASSERT_EQUAL(tap0, testEngine.engine.getEvent(0).ID);
+    TEST_ASSERT_EQUAL(chordTap01, testEngine.engine.getEvent(1).ID);
+  }
+
+  // separate groups don't affect each other
+  {
+    TestEngine testEngine;
+    testEngine.setInputs(0b001);
+    testEngine.advanceQuietly_mS(100);
+    testEngine.setInputs(0b101);
+    testEngine.advanceQuietly_mS(50);
+    TEST_ASSERT_EQUAL(1, testEngine.setInputs(0b001));
+    TEST_GESTURE(testEngine, tap2, GesturePhases::tap);
+    TEST_ASSERT_EQUAL(configs.holdTime_mS - 150, testEngine.advanceUntilGesture_mS(1000));
+    TEST_GESTURE(testEngine, hold0, GesturePhases::holdStart);
+  }
+}
+
+namespace GestureEngineTests{
+  /**
+   * @brief time update() with every input getting a tap and hold, and a pseudo-random press pattern
+   *
+   * @tparam nInputs
+   * @param ticks
+   * @return double nanoseconds per tick
+   */
+  template<uint8_t nInputs>
+  double benchmarkTicks(uint32_t ticks){
+    GestureDefinition gestures[2*nInputs];
+    for(uint8_t i = 0; i < nInputs; i++){
+      gestures[2*i] = GestureDefinition{.ID = (gestureID_t)(2*i + 1), .inputs = (inputMask_t)1 << i, .taps = 1};
+      gestures[2*i + 1] = GestureDefinition{.ID = (gestureID_t)(2*i + 2), .inputs = (inputMask_t)1 << i, .taps = 0};
+    }
+    GestureEngine<nInputs, 2*nInputs> engine(gestures);
+
+    // each input toggles every 7-70 ticks
+    uint32_t nextToggle[nInputs];
+    uint32_t seed = 12345;
+    for(uint8_t i = 0; i < nInputs; i++){nextToggle[i] = 7 + (i*13) % 64;}
+
+    SteadyClockTimeSource stopwatch;
+    stopwatch.setTimestamp_uS(0);
+    inputMask_t inputs = 0;
+    uint32_t totalEvents = 0;
+    for(uint32_t tick = 0; tick < ticks; tick++){
+      for(uint8_t i = 0; i < nInputs; i++){
+        if(tick != nextToggle[i]){continue;}
+        inputs ^= (inputMask_t)1 << i;
+        seed = seed*1103515245 + 12345;
+        nextToggle[i] = tick + 7 + (seed >> 16) % 64;
+      }
+      totalEvents += engine.update(inputs, (uint64_t)tick*10000);
+    }
+    const double time_nS = stopwatch.getTimestamp_uS() * 1000.;
+    TEST_ASSERT_GREATER_THAN(0, totalEvents);
+    return time_nS / ticks;
+  }
+}
+
+void benchmarkGestureEngine(){
+  using namespace GestureEngineTests;
+  const uint32_t ticks = 100000;
+  printf("gesture engine, 1 input: %.1f nS per tick\n", benchmarkTicks<1>(ticks));
+  printf("gesture engine, 8 inputs: %.1f nS per tick\n", benchmarkTicks<8>(ticks));
+  printf("gesture engine, 32 inputs: %.1f nS per tick\n", benchmarkTicks<32>(ticks));
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testGrouping);
+  RUN_TEST(testTaps);
+  RUN_TEST(testHolds);
+  RUN_TEST(testChords);
+  RUN_TEST(benchmarkGestureEngine);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
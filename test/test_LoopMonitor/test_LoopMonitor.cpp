@@ -0,0 +1,210 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+
+#include "loopDeadlineMonitor.h"
+
+void setUp(void){
+  getMetrics().reset();
+}
+void tearDown(void){}
+
+namespace LoopMonitorTests{
+  std::vector<std::string> reportLines;
+
+  void collectLine(const char* line){
+    reportLines.push_back(line);
+  }
+
+  /**
+   * @brief a snapshot full of junk, like RTC memory after a power-on
+   */
+  OverrunSnapshotStruct makeJunkSnapshot(){
+    OverrunSnapshotStruct snapshot{};
+    snapshot.magic = 0xA5A5A5A5;
+    snapshot.overruns = 0xA5A5A5A5;
+    snapshot.worstIteration_uS = 0xA5A5A5A5;
+    snapshot.budget_uS = 0xA5A5A5A5;
+    snapshot.slowestStage = 0xA5;
+    snapshot.currentStage = 0xA5;
+    snapshot.isIterationInProgress = true;
+    snapshot.hasWatchdogFired = true;
+    for(uint32_t& counter : snapshot.counters){counter = 0xA5A5A5A5;}
+    snapshot.nTraceRecords = 0xA5A5;
+    return snapshot;
+  }
+
+  /**
+   * @brief run one iteration of a pretend loop
+   *
+   * @return bool true if it overran
+   */
+  bool runIteration(LoopDeadlineMonitor& monitor, uint64_t& now_uS, const uint32_t button_uS, const uint32_t lights_uS){
+    monitor.beginIteration(now_uS);
+    now_uS += 10;   // idle
+    monitor.setStage(LoopStages::button, now_uS);
+    now_uS += button_uS;
+    monitor.setStage(LoopStages::lights, now_uS);
+    now_uS += lights_uS;
+    const bool overran = monitor.endIteration(now_uS);
+    now_uS += 20000;
+    return overran;
+  }
+}
+
+void testJunkSnapshotIsCleared(){
+  using namespace LoopMonitorTests;
+  OverrunSnapshotStruct snapshot = makeJunkSnapshot();
+  LoopDeadlineMonitor monitor(1000, snapshot);
+  TEST_ASSERT_EQUAL(0, snapshot.overruns);
+  TEST_ASSERT_FALSE(snapshot.isIterationInProgress);
+  TEST_ASSERT_EQUAL(1000, snapshot.budget_uS);
+
+  reportLines.clear();
+  TEST_ASSERT_FALSE(monitor.reportPrevious(collectLine));
+  TEST_ASSERT_EQUAL(0, reportLines.size());
+}
+
+void testWithinBudget(){
+  using namespace LoopMonitorTests;
+  OverrunSnapshotStruct snapshot = makeJunkSnapshot();
+  LoopDeadlineMonitor monitor(1000, snapshot);
+  uint64_t now_uS = 5000;
+  for(uint8_t i = 0; i < 10; i++){
+    TEST_ASSERT_FALSE(runIteration(monitor, now_uS, 100, 800));
+  }
+  TEST_ASSERT_EQUAL(0, snapshot.overruns);
+  TEST_ASSERT_FALSE(snapshot.isIterationInProgress);
+  TEST_ASSERT_FALSE(monitor.reportPrevious(collectLine));
+}
+
+void testOverrun(){
+  using namespace LoopMonitorTests;
+  OverrunSnapshotStruct snapshot = makeJunkSnapshot();
+  LoopDeadlineMonitor monitor(1000, snapshot);
+  uint64_t now_uS = 5000;
+
+  getMetrics().count(MetricCounters::storageReads, 3);
+  TEST_ASSERT_TRUE(runIteration(monitor, now_uS, 100, 2000));
+  TEST_ASSERT_EQUAL(1, snapshot.overruns);
+  TEST_ASSERT_EQUAL(2110, snapshot.worstIteration_uS);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(LoopStages::lights), snapshot.slowestStage);
+  TEST_ASSERT_EQUAL(2000, snapshot.slowestStage_uS);
+  TEST_ASSERT_EQUAL(3, snapshot.counters[static_cast<uint8_t>(MetricCounters::storageReads)]);
+
+  // a smaller overrun gets counted, but doesn't replace the worst one
+  getMetrics().count(MetricCounters::storageReads, 3);
+  TEST_ASSERT_TRUE(runIteration(monitor, now_uS, 1500, 10));
+  TEST_ASSERT_EQUAL(2, snapshot.overruns);
+  TEST_ASSERT_EQUAL(2110, snapshot.worstIteration_uS);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(LoopStages::lights), snapshot.slowestStage);
+  TEST_ASSERT_EQUAL(3, snapshot.counters[static_cast<uint8_t>(MetricCounters::storageReads)]);
+
+  // a bigger one does
+  TEST_ASSERT_TRUE(runIteration(monitor, now_uS, 5000, 10));
+  TEST_ASSERT_EQUAL(3, snapshot.overruns);
+  TEST_ASSERT_EQUAL(5020, snapshot.worstIteration_uS);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(LoopStages::button), snapshot.slowestStage);
+  TEST_ASSERT_EQUAL(6, snapshot.counters[static_cast<uint8_t>(MetricCounters::storageReads)]);
+}
+
+void testReportAfterReset(){
+  using namespace LoopMonitorTests;
+  OverrunSnapshotStruct snapshot = makeJunkSnapshot();
+  {
+    LoopDeadlineMonitor monitor(1000, snapshot);
+    uint64_t now_uS = 5000;
+    getMetrics().count(MetricCounters::modeSwitches, 2);
+    runIteration(monitor, now_uS, 100, 2000);
+
+    // then it gets stuck loading a mode, and the watchdog resets it
+    monitor.beginIteration(now_uS);
+    monitor.setStage(LoopStages::lights, now_uS);
+    snapshot.hasWatchdogFired = true;
+  }
+
+  // after the reset, the snapshot is still there
+  LoopDeadlineMonitor monitor(1000, snapshot);
+  reportLines.clear();
+  TEST_ASSERT_TRUE(monitor.reportPrevious(collectLine));
+  const std::vector<std::string> expected = {
+    "overrun begin",
+    "overruns 1",
+    "worst 2110 1000 lights 2000",
+    "interrupted lights watchdog",
+    "counter modeSwitches 2",
+    "counter storageReads 0",
+    "counter storageCacheHits 0",
+    "counter eventTriggers 0",
+    "counter timeSyncs 0",
+    "counter pwmWrites 0",
+    "counter lightCommandDrops 0",
+#ifdef esp32_lights_trace
+    "trace begin 0 0",
+    "trace end",
+#endif
+    "overrun end"
+  };
+  TEST_ASSERT_EQUAL(expected.size(), reportLines.size());
+  for(uint8_t i = 0; i < expected.size(); i++){
+    TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), reportLines[i].c_str());
+  }
+
+  // it only gets reported once
+  TEST_ASSERT_EQUAL(0, snapshot.overruns);
+  TEST_ASSERT_FALSE(snapshot.isIterationInProgress);
+  TEST_ASSERT_FALSE(snapshot.hasWatchdogFired);
+  TEST_ASSERT_FALSE(monitor.reportPrevious(collectLine));
+}
+
+void testControlLoopStages(){
+  using namespace LoopMonitorTests;
+  OverrunSnapshotStruct outputSnapshot = makeJunkSnapshot();
+  OverrunSnapshotStruct controlSnapshot = makeJunkSnapshot();
+  LoopDeadlineMonitor outputMonitor(1000, outputSnapshot);
+  LoopDeadlineMonitor controlMonitor(100000, controlSnapshot);
+  uint64_t now_uS = 5000;
+
+  // a slow config write overruns the control loop
+  controlMonitor.beginIteration(now_uS);
+  controlMonitor.setStage(LoopStages::events, now_uS);
+  now_uS += 500;
+  controlMonitor.setStage(LoopStages::config, now_uS);
+  now_uS += 150000;
+  controlMonitor.setStage(LoopStages::serial, now_uS);
+  now_uS += 10;
+  TEST_ASSERT_TRUE(controlMonitor.endIteration(now_uS));
+  TEST_ASSERT_EQUAL(1, controlSnapshot.overruns);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(LoopStages::config), controlSnapshot.slowestStage);
+
+  // the output loop's snapshot doesn't see it
+  TEST_ASSERT_FALSE(runIteration(outputMonitor, now_uS, 100, 800));
+  TEST_ASSERT_EQUAL(0, outputSnapshot.overruns);
+  TEST_ASSERT_FALSE(outputMonitor.reportPrevious(collectLine));
+
+  // then it gets stuck on an event
+  controlMonitor.beginIteration(now_uS);
+  controlMonitor.setStage(LoopStages::events, now_uS);
+  controlSnapshot.hasWatchdogFired = true;
+
+  reportLines.clear();
+  TEST_ASSERT_TRUE(controlMonitor.reportPrevious(collectLine));
+  TEST_ASSERT_EQUAL_STRING("worst 150510 100000 config 150000", reportLines.at(2).c_str());
+  TEST_ASSERT_EQUAL_STRING("interrupted events watchdog", reportLines.at(3).c_str());
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testJunkSnapshotIsCleared);
+  RUN_TEST(testWithinBudget);
+  RUN_TEST(testOverrun);
+  RUN_TEST(testReportAfterReset);
+  RUN_TEST(testControlLoopStages);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
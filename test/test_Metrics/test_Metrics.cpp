@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "metrics.h"
+#include "timeSource.h"
+
+void setUp(void){
+  getMetrics().reset();
+}
+void tearDown(void){}
+
+namespace MetricsTests{
+  std::vector<std::string> reportLines;
+
+  void collectLine(const char* line){
+    reportLines.push_back(line);
+  }
+}
+
+void testBuckets(){
+  TEST_ASSERT_EQUAL(0, LatencyHistogram::getBucket(0));
+  TEST_ASSERT_EQUAL(1, LatencyHistogram::getBucket(1));
+  TEST_ASSERT_EQUAL(2, LatencyHistogram::getBucket(2));
+  TEST_ASSERT_EQUAL(2, LatencyHistogram::getBucket(3));
+  TEST_ASSERT_EQUAL(3, LatencyHistogram::getBucket(4));
+  TEST_ASSERT_EQUAL(11, LatencyHistogram::getBucket(1500));
+  TEST_ASSERT_EQUAL(15, LatencyHistogram::getBucket(20000));  // a whole lights loop
+  // everything too big goes in the last bucket
+  TEST_ASSERT_EQUAL(LatencyHistogram::nBuckets - 1, LatencyHistogram::getBucket(1UL << 20));
+  TEST_ASSERT_EQUAL(LatencyHistogram::nBuckets - 1, LatencyHistogram::getBucket(UINT32_MAX));
+
+  for(uint8_t b = 1; b < LatencyHistogram::nBuckets; b++){
+    const uint32_t floor_uS = LatencyHistogram::getBucketFloor_uS(b);
+    TEST_ASSERT_EQUAL(b, LatencyHistogram::getBucket(floor_uS));
+    TEST_ASSERT_EQUAL(b - 1, LatencyHistogram::getBucket(floor_uS - 1));
+  }
+}
+
+void testHistogram(){
+  LatencyHistogram histogram;
+  TEST_ASSERT_EQUAL(0, histogram.getCount());
+  TEST_ASSERT_EQUAL(0, histogram.getMean_uS());
+  TEST_ASSERT_EQUAL(0, histogram.getPercentileCeiling_uS(99));
+
+  // 98 fast ticks and 2 slow ones
+  for(uint8_t i = 0; i < 98; i++){histogram.record(5);}
+  histogram.record(600);
+  histogram.record(1000);
+  TEST_ASSERT_EQUAL(100, histogram.getCount());
+  TEST_ASSERT_EQUAL(98, histogram.getBucketCount(3));
+  TEST_ASSERT_EQUAL(2, histogram.getBucketCount(10));
+  TEST_ASSERT_EQUAL(0, histogram.getBucketCount(LatencyHistogram::nBuckets));  // out of range
+  TEST_ASSERT_EQUAL(1000, histogram.getMax_uS());
+  TEST_ASSERT_EQUAL((98*5 + 1600)/100, histogram.getMean_uS());
+  TEST_ASSERT_EQUAL(7, histogram.getPercentileCeiling_uS(50));
+  TEST_ASSERT_EQUAL(7, histogram.getPercentileCeiling_uS(98));
+  TEST_ASSERT_EQUAL(1023, histogram.getPercentileCeiling_uS(99));
+
+  // the last bucket doesn't have a top, so the max is used
+  histogram.record(UINT32_MAX);
+  TEST_ASSERT_EQUAL(UINT32_MAX, histogram.getPercentileCeiling_uS(100));
+
+  histogram.reset();
+  TEST_ASSERT_EQUAL(0, histogram.getCount());
+  TEST_ASSERT_EQUAL(0, histogram.getMax_uS());
+}
+
+void testCountersAndReport(){
+  using namespace MetricsTests;
+  MetricsRegistry& metrics = getMetrics();
+  metrics.count(MetricCounters::modeSwitches);
+  metrics.count(MetricCounters::modeSwitches);
+  metrics.count(MetricCounters::pwmWrites, 10);
+  metrics.recordLatency(MetricHistograms::updateLights, 0);
+  metrics.recordLatency(MetricHistograms::updateLights, 12);
+  TEST_ASSERT_EQUAL(2, metrics.getCount(MetricCounters::modeSwitches));
+  TEST_ASSERT_EQUAL(10, metrics.getCount(MetricCounters::pwmWrites));
+  TEST_ASSERT_EQUAL(0, metrics.getCount(MetricCounters::timeSyncs));
+  TEST_ASSERT_EQUAL(2, metrics.getHistogram(MetricHistograms::updateLights).getCount());
+  TEST_ASSERT_EQUAL(0, metrics.getHistogram(MetricHistograms::mainLoop).getCount());
+
+  reportLines.clear();
+  metrics.report(collectLine);
+  const std::vector<std::string> expected = {
+    "metrics begin",
+    "counter modeSwitches 2",
+    "counter storageReads 0",
+    "counter storageCacheHits 0",
+    "counter eventTriggers 0",
+    "counter timeSyncs 0",
+    "counter pwmWrites 10",
+    "counter lightCommandDrops 0",
+    "histogram mainLoop 0 0 0 0",
+    "histogram updateLights 2 6 15 12",
+    "bucket 0 1",
+    "bucket 8 1",
+    "metrics end"
+  };
+  TEST_ASSERT_EQUAL(expected.size(), reportLines.size());
+  for(uint8_t i = 0; i < expected.size(); i++){
+    TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), reportLines[i].c_str());
+  }
+
+  metrics.reset();
+  TEST_ASSERT_EQUAL(0, metrics.getCount(MetricCounters::modeSwitches));
+  TEST_ASSERT_EQUAL(0, metrics.getHistogram(MetricHistograms::updateLights).getCount());
+}
+
+void testCountersFromTwoTasks(){
+  // the output task and the control task both count cache hits
+  const uint32_t nCounts = 100000;
+  auto countHits = [](){
+    for(uint32_t i = 0; i < nCounts; i++){
+      getMetrics().count(MetricCounters::storageCacheHits);
+    }
+  };
+  std::thread outputTask(countHits);
+  std::thread controlTask(countHits);
+  outputTask.join();
+  controlTask.join();
+  TEST_ASSERT_EQUAL(2*nCounts, getMetrics().getCount(MetricCounters::storageCacheHits));
+}
+
+void testScopedLatency(){
+  {
+    ScopedLatency latency(MetricHistograms::mainLoop);
+    const uint64_t start_uS = metricsClock_uS();
+    while(metricsClock_uS() - start_uS < 50){}
+  }
+  const LatencyHistogram& histogram = getMetrics().getHistogram(MetricHistograms::mainLoop);
+  TEST_ASSERT_EQUAL(1, histogram.getCount());
+  TEST_ASSERT_TRUE(histogram.getMax_uS() >= 50);
+}
+
+void benchmarkMetrics(){
+  // what a lights tick adds: the main loop and updateLights latencies, and the counters that get hit every tick
+  const uint32_t ticks = 1000000;
+  SteadyClockTimeSource stopwatch;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t i = 0; i < ticks; i++){
+    ScopedLatency loopLatency(MetricHistograms::mainLoop);
+    ScopedLatency lightsLatency(MetricHistograms::updateLights);
+    getMetrics().count(MetricCounters::pwmWrites);
+    getMetrics().count(MetricCounters::storageCacheHits);
+  }
+  const double tick_nS = stopwatch.getTimestamp_uS() * 1000. / ticks;
+  printf("metrics per tick: %.1f nS\n", tick_nS);
+  TEST_ASSERT_EQUAL(ticks, getMetrics().getCount(MetricCounters::pwmWrites));
+  TEST_ASSERT_EQUAL(ticks, getMetrics().getHistogram(MetricHistograms::updateLights).getCount());
+  TEST_ASSERT_TRUE_MESSAGE(tick_nS < 1000, "metrics should add less than 1 uS per tick");
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testBuckets);
+  RUN_TEST(testHistogram);
+  RUN_TEST(testCountersAndReport);
+  RUN_TEST(testCountersFromTwoTasks);
+  RUN_TEST(testScopedLatency);
+  RUN_TEST(benchmarkMetrics);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
@@ -18,24 +18,6 @@ class TestButton : public OneButtonInterface{
     bool isPressed;
 
     bool getCurrentStatus(){return isPressed;}
-
-    /**
-     * @brief test method to force class into theoretically innaccessible states
-     * 
-     * @param newStatus 
-     */
-    void setPreviousStatus(bool newStatus){_previousStatus = newStatus;}
-
-    /**
-     * @brief test method to force class into theoretically innaccessible states
-     * 
-     * @param state 
-     */
-    void setFSMState(PressStates state){_buttonState = state;}
-
-    ShortPressParams getShortPressParams(){return _shortPress;}
-
-    LongPressParams getLongPressParams(){return _longPress;}
 };
 
 void setUp(void){}
@@ -91,6 +73,7 @@ namespace OneButtonInterfaceTests{
     button->isPressed = false;
     button->update();
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::none, button->getFSMState(), message.c_str());
+    TEST_ASSERT_FALSE_MESSAGE(testObjects.modalLights->isRamping, message.c_str());
     return true;
   }
 
@@ -113,7 +96,6 @@ namespace OneButtonInterfaceTests{
 
     button->isPressed = true;
     button->update();
-    TEST_ASSERT_EQUAL_MESSAGE((1000*configs.timeUntilLongPress_mS) + startTime, button->getShortPressParams().endTimeUTC_uS, message.c_str());
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::shortPress, button->getFSMState(), message.c_str());
     return true;
   }
@@ -144,11 +126,6 @@ namespace OneButtonInterfaceTests{
     const uint32_t incr_mS = 20;
     for(uint32_t shortT = 0; shortT < shortPressTime_mS; shortT += incr_mS){
       TEST_ASSERT_EQUAL_MESSAGE(PressStates::shortPress, button->getFSMState(), message.c_str());
-      TEST_ASSERT_EQUAL_MESSAGE(
-        startTime + (shortPressTime_mS * 1000),
-        button->getShortPressParams().endTimeUTC_uS,
-        message.c_str()
-      );
       TEST_ASSERT_EQUAL_MESSAGE(initialLightsState, modalLights->getState(), message.c_str());
       TEST_ASSERT_EQUAL_MESSAGE(initialBrightness, modalLights->getBrightnessLevel(), message.c_str());
       currentTime_uS = testObjects.incrementTimeAndUpdate_mS(incr_mS);
@@ -156,11 +133,12 @@ namespace OneButtonInterfaceTests{
 
     TEST_ASSERT_EQUAL_MESSAGE(startTime+(1000*shortPressTime_mS), currentTime_uS, message.c_str());
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::longPress, button->getFSMState(), message.c_str());
-    TEST_ASSERT_EQUAL_MESSAGE(
-      1,
-      abs(modalLights->previousAdjustment),
-      message.c_str()
-    );
+
+    // the ramp should start when the press became long, and the brightness shouldn't be adjusted directly
+    TEST_ASSERT_TRUE_MESSAGE(modalLights->isRamping, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(startTime+(1000*shortPressTime_mS), modalLights->rampStartTimeUTC_uS, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(configs.longPressWindow_mS, modalLights->rampWindow_mS, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(500, modalLights->previousAdjustment, message.c_str());
     return currentTime_uS;
   }
   
@@ -171,7 +149,7 @@ namespace OneButtonInterfaceTests{
    * @param holdWindow_mS how long to hold the press for
    * @param testObjects 
    * @param configs 
-   * @return int16_t returns the cumulative adjustments made during the hold
+   * @return int16_t returns the expected cumulative adjustment for the hold. the ramp gets applied when the button is released
    */
   int16_t enterAndHoldLongPress_helper(
     const bool expectedDirection,
@@ -193,9 +171,7 @@ namespace OneButtonInterfaceTests{
     TEST_ASSERT_EQUAL_MESSAGE(testStartTime_uS + shortPressTime_uS, longPressStart, message.c_str());
     const uint64_t expectedTestEnd_uS = longPressStart + holdWindow_uS;
 
-    // button should have adjusted by 1 when it enters longPress
-    int16_t cumAdj_abs = 1; // as in cumulative. please do try to keep decorum
-    TEST_ASSERT_EQUAL_MESSAGE(dir*cumAdj_abs, modalLights->previousAdjustment, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(expectedDirection, modalLights->rampIncreasing, message.c_str());
     
     const uint64_t firstIncr_uS = static_cast<uint64_t>(100) * static_cast<uint64_t>(1000);
     uint64_t incrL_uS = MIN(firstIncr_uS, holdWindow_uS);
@@ -209,15 +185,9 @@ namespace OneButtonInterfaceTests{
       currentTime_uS = testObjects.incrementTimeAndUpdate_uS(incrL_uS);
       const std::string timeMessage = message + "; long press length (uS) = " + std::to_string(currentTime_uS-longPressStart);
 
-      const int16_t actualAdj = modalLights->previousAdjustment;
-      
-      // find expected absolute adjustment
-      const int16_t expAdj_abs = interpolate(1, 255, float(currentTime_uS - longPressStart)/adjWindow_uS) - cumAdj_abs;
-      cumAdj_abs += expAdj_abs;
-
-      // test the adjustment
-      const int16_t expectedAdj = expAdj_abs * dir;
-      TEST_ASSERT_EQUAL_MESSAGE(expectedAdj, actualAdj, timeMessage.c_str());
+      // the ramp should still be running, and nothing should be adjusted while it does
+      TEST_ASSERT_TRUE_MESSAGE(modalLights->isRamping, timeMessage.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(500, modalLights->previousAdjustment, timeMessage.c_str());
 
       // break when test end has been reached
       if(currentTime_uS >= (longPressStart + holdWindow_uS)){
@@ -241,14 +211,9 @@ namespace OneButtonInterfaceTests{
       endTime_uS, message.c_str()
     );
 
-    // test the adjustments were made properly
-    const int16_t totalAdjustments = dir * cumAdj_abs;
-    const int16_t expectedAdjustments = dir * interpolate(1, 255, float(endTime_uS - longPressStart)/adjWindow_uS);
-    TEST_ASSERT_EQUAL_MESSAGE(expectedAdjustments, totalAdjustments, message.c_str());
-    
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::longPress, button->getFSMState(), message.c_str());
 
-    return totalAdjustments;
+    return dir * interpolate(1, 255, float(endTime_uS - longPressStart)/adjWindow_uS);
   }
   
   /**
@@ -273,21 +238,19 @@ namespace OneButtonInterfaceTests{
     
     enterAndHoldLongPress_helper(expectedDirection, window_uS, testObjects, configs, message);
     
-    // adjustment should be 0 after the window
+    // keep holding after the window
     modalLights->previousAdjustment = 500;
     testObjects.incrementTimeAndUpdate_mS(500);
-    TEST_ASSERT_EQUAL_MESSAGE(0, modalLights->previousAdjustment, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(500, modalLights->previousAdjustment, message.c_str());
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::longPress, button->getFSMState(), message.c_str());
 
-    // and release
+    // and release. the ramp should have gone all the way
     button->isPressed = false;
-    modalLights->previousAdjustment = 500;  // it can't reach 500, so this indicates adjustments of 0
     const uint64_t endTime_uS = testObjects.incrementTimeAndUpdate_mS(700);
     TEST_ASSERT_EQUAL_MESSAGE(PressStates::none, button->getFSMState(), message.c_str());
-    TEST_ASSERT_EQUAL_MESSAGE(0, modalLights->previousAdjustment, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE((expectedDirection ? 255 : -255), modalLights->previousAdjustment, message.c_str());
     return endTime_uS;
   }
-
 }
 
 void testNoneState(){
@@ -316,31 +279,6 @@ void testNoneState(){
     }
   }
 
-  // fallingEdge tests
-  {
-    // should initialise into none state
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = false;
-    button->setPreviousStatus(true);
-    testObjects.incrementTimeAndUpdate_mS(10);
-
-    // shouldn't be accessible, so state should revert to none
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-
-    // modalLights shouldn't be updated
-    const uint8_t incr_mS = 20;
-    for(uint32_t t = 0; t <= (defaultConfigs.longPressWindow_mS+defaultConfigs.timeUntilLongPress_mS+(incr_mS*10)); t += incr_mS){
-      TEST_ASSERT_EQUAL(false, modalLights->getState());
-      TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-      TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-      testObjects.incrementTimeAndUpdate_mS(incr_mS);
-    }
-  }
-
   // risingEdge tests
   {
     TestObjects testObjects = testButtonFactory();
@@ -353,40 +291,12 @@ void testNoneState(){
     // pressing the button should enter shortPress
     const uint64_t testTime = testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      testTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
     // modal lights shouldn't be called yet
     TEST_ASSERT_EQUAL(false, modalLights->getState());
     TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
     TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
   }
-
-  // active tests
-  {
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = true;
-    button->setPreviousStatus(true);
-    
-    // should be inaccessible, but enter shortPress
-    const uint64_t testTime = testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      testTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
-    
-    // modal lights shouldn't be called yet
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
 };
 
 void testShortPressState(){
@@ -394,62 +304,6 @@ void testShortPressState(){
 
   const OneButtonConfigs defaultConfigs;
 
-  // inactive tests (entering shortPress)
-  {
-    // pressing button should enter shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = true;
-
-    const uint64_t testTime = testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      testTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
-
-    // modal lights shouldn't be called yet
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-
-    // create the inactive state conditions
-    button->isPressed = false;
-    button->setPreviousStatus(false);
-
-    testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-
-    // modal lights shouldn't be called
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
-  
-  // inactive tests (forced into shortPress)
-  {
-    // force shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = false;
-    button->setPreviousStatus(false);
-    button->setFSMState(PressStates::shortPress);
-
-    testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-
-    // modal lights shouldn't be called
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
-  
   // fallingEdge (entering shortPress)
   {
     // pressing the button should enter shortPress
@@ -462,10 +316,6 @@ void testShortPressState(){
 
     const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      startTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
     // modal lights shouldn't be called yet
     TEST_ASSERT_EQUAL(false, modalLights->getState());
@@ -483,102 +333,6 @@ void testShortPressState(){
     TEST_ASSERT_NOT_EQUAL(0, modalLights->getBrightnessLevel());
   }
 
-  // fallingEdge (forced into shortPress)
-  {
-    // pressing the button should enter shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = false;
-    button->setPreviousStatus(true);
-    button->setFSMState(PressStates::shortPress);
-
-    testObjects.incrementTimeAndUpdate_mS(50);
-    
-    // modal lights should be toggled
-    testObjects.incrementTimeAndUpdate_mS(100);
-    TEST_ASSERT_EQUAL(true, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_NOT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
-  
-  // risingEdge (entered into shortPress)
-  {
-    // pressing the button should enter shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = true;
-
-    const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      startTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
-
-    // modal lights shouldn't be called yet
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-
-    // force a rising edge (this shouldn't happen)
-    button->setPreviousStatus(false);
-    button->isPressed = true;
-    const uint64_t testTime = testObjects.incrementTimeAndUpdate_mS(50);
-    
-    // should have re-entered shortPress
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      testTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
-
-    // modal lights shouldn't be called
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
-  
-  // risingEdge (forced into shortPress)
-  {
-    // pressing the button should enter shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->setPreviousStatus(false);
-    button->isPressed = true;
-    button->setFSMState(PressStates::shortPress);
-
-    // modal lights shouldn't be called yet
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-
-    // force a rising edge (this shouldn't happen)
-    button->setPreviousStatus(false);
-    button->isPressed = true;
-    const uint64_t testTime = testObjects.incrementTimeAndUpdate_mS(50);
-    
-    // should have re-entered shortPress
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      testTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
-
-    // modal lights shouldn't be called
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-  }
-
   // active should eventually enter longPress (entered into shortPress)
   {
     // pressing the button should enter shortPress
@@ -592,12 +346,8 @@ void testShortPressState(){
     const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
     const uint64_t longPressStart_uS = startTime + (defaultConfigs.timeUntilLongPress_mS * 1000);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      longPressStart_uS,
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
-    uint64_t currentTime;
+    uint64_t currentTime = startTime;
     const uint32_t incr_mS = 20;
     while(currentTime < longPressStart_uS){
       TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
@@ -612,41 +362,6 @@ void testShortPressState(){
     // should have entered long press
     TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
   }
-
-  // forced active should re-enter shortPress
-  {
-    // force shortPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = true;
-    button->setPreviousStatus(true);
-    button->setFSMState(PressStates::shortPress);
-
-    const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
-    const uint64_t longPressStart_uS = startTime + (defaultConfigs.timeUntilLongPress_mS * 1000);
-    TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      longPressStart_uS,
-      button->getShortPressParams().endTimeUTC_uS
-    );
-
-    uint64_t currentTime;
-    const uint32_t incr_mS = 20;
-    while(currentTime < longPressStart_uS){
-      // modal lights shouldn't be called yet
-      TEST_ASSERT_EQUAL(false, modalLights->getState());
-      TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-      TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
-
-      currentTime = testObjects.incrementTimeAndUpdate_mS(incr_mS);
-    }
-
-    // should have entered long press
-    TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
-  }
 }
 
 void testLongPressState(){
@@ -669,49 +384,23 @@ void testLongPressState(){
 
     const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      startTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
     const uint64_t longPressTime = testObjects.incrementTimeAndUpdate_mS(defaultConfigs.timeUntilLongPress_mS);
     TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
 
-    // create the inactive state conditions
+    // release the button
     button->isPressed = false;
-    button->setPreviousStatus(false);
 
     testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
 
-    // modal lights should be adjusted by +1
+    // the ramp should be stopped, and modal lights should be adjusted up from off
+    const duty_t expAdj = interpolate(1, 255, float(10)/window_mS);
+    TEST_ASSERT_FALSE(modalLights->isRamping);
     TEST_ASSERT_EQUAL(true, modalLights->getState());
-    TEST_ASSERT_EQUAL(1, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(1, modalLights->getBrightnessLevel());
-    TEST_ASSERT_EQUAL(1, modalLights->previousAdjustment);
-  }
-
-  // inactive tests (forced into longPress)
-  {
-    // pressing and holding the button should enter longPress
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-
-    // create the inactive state conditions
-    button->setFSMState(PressStates::longPress);
-    button->isPressed = false;
-    button->setPreviousStatus(false);
-
-    testObjects.incrementTimeAndUpdate_mS(10);
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-
-    // modal lights shouldn't be called
-    TEST_ASSERT_EQUAL(false, modalLights->getState());
-    TEST_ASSERT_EQUAL(100, modalLights->getSetBrightness());
-    TEST_ASSERT_EQUAL(0, modalLights->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(expAdj, modalLights->getSetBrightness());
+    TEST_ASSERT_EQUAL(expAdj, modalLights->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(expAdj, modalLights->previousAdjustment);
   }
 
   // fallingEdge tests (entered into longPress)
@@ -726,24 +415,23 @@ void testLongPressState(){
 
     const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      startTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
     const uint64_t longPressTime = testObjects.incrementTimeAndUpdate_mS(defaultConfigs.timeUntilLongPress_mS);
     TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
 
-    const uint64_t testTime1 = testObjects.incrementTimeAndUpdate_mS(500);
-    const uint16_t expAdj1 = interpolate(0, 255, float(testTime1-longPressTime)/(window_mS*1000));
-    TEST_ASSERT_EQUAL(expAdj1, modalLights->previousAdjustment);
+    // nothing gets adjusted while the ramp is running
+    modalLights->previousAdjustment = 500;
+    testObjects.incrementTimeAndUpdate_mS(500);
+    TEST_ASSERT_EQUAL(500, modalLights->previousAdjustment);
+    TEST_ASSERT_TRUE(modalLights->isRamping);
     
     // release the button
     {
       button->isPressed = false;
       const uint64_t testTime2 = testObjects.incrementTimeAndUpdate_mS(600);
       TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-      const uint16_t expAdj2 = interpolate(0, 255, float(testTime2-longPressTime)/(window_mS*1000)) - expAdj1;
+      TEST_ASSERT_FALSE(modalLights->isRamping);
+      const uint16_t expAdj2 = interpolate(1, 255, float(testTime2-longPressTime)/(window_mS*1000));
       TEST_ASSERT_EQUAL(expAdj2, modalLights->previousAdjustment);
     }
 
@@ -753,26 +441,6 @@ void testLongPressState(){
     TEST_ASSERT_EQUAL(500, modalLights->previousAdjustment);
   }
   
-  // fallingEdge tests (forced into longPress)
-  {
-    // pressing and holding the button should enter longPress
-    TestObjects testObjects = testButtonFactory(794275200 + 69420);
-    testObjects.incrementTimeAndUpdate_mS(8008135);
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = false;
-    button->setPreviousStatus(true);
-    button->setFSMState(PressStates::longPress);
-    modalLights->previousAdjustment = 500;
-
-    // adjustment should be 0, and exit into none state
-    const uint64_t testTime1 = testObjects.incrementTimeAndUpdate_mS(500);
-    TEST_ASSERT_EQUAL(0, modalLights->previousAdjustment);
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-  }
-
   // active tests (entered into longPress)
   {
     // pressing and holding the button should enter longPress
@@ -785,73 +453,31 @@ void testLongPressState(){
 
     const uint64_t startTime = testObjects.incrementTimeAndUpdate_mS(10);
     TEST_ASSERT_EQUAL(PressStates::shortPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(
-      startTime + (defaultConfigs.timeUntilLongPress_mS * 1000),
-      button->getShortPressParams().endTimeUTC_uS
-    );
 
     const uint64_t longPressTime = testObjects.incrementTimeAndUpdate_mS(defaultConfigs.timeUntilLongPress_mS);
     TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
 
-    const uint16_t expAdj0 = 1;
-    TEST_ASSERT_EQUAL(expAdj0, modalLights->previousAdjustment);
+    // entering longPress starts the ramp up from off
+    TEST_ASSERT_TRUE(modalLights->isRamping);
+    TEST_ASSERT_TRUE(modalLights->rampIncreasing);
+    TEST_ASSERT_EQUAL(longPressTime, modalLights->rampStartTimeUTC_uS);
+    TEST_ASSERT_EQUAL(window_mS, modalLights->rampWindow_mS);
 
-    const uint64_t testTime1 = testObjects.incrementTimeAndUpdate_mS(500);
-    const uint16_t expAdj1 = interpolate(1, 255, float(500)/window_mS) - expAdj0;
-    TEST_ASSERT_EQUAL(expAdj1, modalLights->previousAdjustment);
-    
-    // keep pressing the button
-    const uint64_t testTime2 = testObjects.incrementTimeAndUpdate_mS(600);
-    TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
-    const uint16_t expAdj2 = interpolate(1, 255, float(testTime2-longPressTime)/(window_mS*1000))-expAdj1 - expAdj0;
-    TEST_ASSERT_EQUAL(expAdj2, modalLights->previousAdjustment);
-
-    // keep pressing for window duration
-    const uint64_t testTime3 = testObjects.incrementTimeAndUpdate_mS(window_mS);
-    TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
-    const uint16_t expAdj3 = 255 - expAdj1 - expAdj2 - expAdj0;
-    TEST_ASSERT_EQUAL(expAdj3, modalLights->previousAdjustment);
-    
-    // keep pressing after window
-    modalLights->previousAdjustment = 500;  // it can't reach 500, so this indicates adjustments of 0
-    testObjects.incrementTimeAndUpdate_mS(700);
-    TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
-    TEST_ASSERT_EQUAL(0, modalLights->previousAdjustment);
-
-    // and release
-    button->isPressed = false;
-    modalLights->previousAdjustment = 500;  // it can't reach 500, so this indicates adjustments of 0
-    testObjects.incrementTimeAndUpdate_mS(700);
-    TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
-    TEST_ASSERT_EQUAL(0, modalLights->previousAdjustment);
-  }
-
-  // active tests (forced into longPress)
-  {
-    TestObjects testObjects = testButtonFactory();
-    auto button = testObjects.button;
-    auto modalLights = testObjects.modalLights;
-    modalLights->setBrightnessLevel(100);
-    modalLights->setState(false);
-    button->isPressed = true;
-    button->setPreviousStatus(true);
-    button->setFSMState(PressStates::longPress);
+    // keep pressing the button, through and after the window. it can't reach 500, so this indicates no adjustments
     modalLights->previousAdjustment = 500;
-
-    // adjustment should be 0
-    const uint32_t incr_mS = 20;
-    for(uint32_t t = 0; t < 2*window_mS; t += incr_mS){
-      modalLights->previousAdjustment = 500;
-      testObjects.incrementTimeAndUpdate_mS(incr_mS);
-      TEST_ASSERT_EQUAL(0, modalLights->previousAdjustment);
+    for(const uint32_t t : {(uint32_t)500, (uint32_t)600, (uint32_t)window_mS, (uint32_t)700}){
+      testObjects.incrementTimeAndUpdate_mS(t);
+      TEST_ASSERT_EQUAL(PressStates::longPress, button->getFSMState());
+      TEST_ASSERT_EQUAL(500, modalLights->previousAdjustment);
+      TEST_ASSERT_TRUE(modalLights->isRamping);
     }
 
-    // falling edge should enter none state
+    // and release. the whole ramp gets applied
     button->isPressed = false;
-    modalLights->previousAdjustment = 500;
-    testObjects.incrementTimeAndUpdate_mS(incr_mS);
-    TEST_ASSERT_EQUAL(0, modalLights->previousAdjustment);
+    testObjects.incrementTimeAndUpdate_mS(700);
     TEST_ASSERT_EQUAL(PressStates::none, button->getFSMState());
+    TEST_ASSERT_FALSE(modalLights->isRamping);
+    TEST_ASSERT_EQUAL(255, modalLights->previousAdjustment);
   }
 }
 
@@ -875,7 +501,7 @@ void testButtonOperation(){
   volatile const uint64_t testStart_uS = testObjects.incrementTimeAndUpdate_mS(60000);
   modalLights->updateLights();
 
-  // longPress should adjust in interpolated increments from 0 to a cummulative 255
+  // longPress should ramp from 0 to a cummulative 255, and the ramp gets applied on release
   
   // adjustment direction should be positive initially
   {
@@ -892,8 +518,8 @@ void testButtonOperation(){
     volatile const uint64_t holdWindow_uS = getTimeDiffToInterpValue(155, 0, 255, window_mS) * 1000;
     int16_t adjustment = enterAndHoldLongPress_helper(false, holdWindow_uS, testObjects, defaultConfigs, message);
     TEST_ASSERT_EQUAL_MESSAGE(-155, adjustment, message.c_str());
-    TEST_ASSERT_EQUAL(100, modalLights->getBrightnessLevel());
     releasePress_helper(testObjects, defaultConfigs, message);
+    TEST_ASSERT_EQUAL(100, modalLights->getBrightnessLevel());
   }
 
   // adjustment direction should be flipped to be positive
@@ -902,8 +528,8 @@ void testButtonOperation(){
     const uint64_t holdWindow_uS = getTimeDiffToInterpValue(50, 1, 255, window_mS) * 1000;
     int16_t adjustment = enterAndHoldLongPress_helper(true, holdWindow_uS, testObjects, defaultConfigs, message);
     TEST_ASSERT_EQUAL(50, adjustment);
-    TEST_ASSERT_EQUAL(150, modalLights->getBrightnessLevel());
     releasePress_helper(testObjects, defaultConfigs, message);
+    TEST_ASSERT_EQUAL(150, modalLights->getBrightnessLevel());
   }
 
   // short press should turn lights off
@@ -984,6 +610,137 @@ void testButtonOperation(){
   }
 }
 
+void testEdgeQueue(){
+  ButtonEdgeQueue<4> queue;
+  ButtonEdge edge;
+  TEST_ASSERT_TRUE(queue.isEmpty());
+  TEST_ASSERT_FALSE(queue.pop(edge));
+
+  // first in first out, and it keeps working as the indexes wrap
+  for(uint16_t i = 0; i < 300; i++){
+    TEST_ASSERT_TRUE(queue.push(ButtonEdge{.timestamp_uS = i, .isPressed = (i % 2) == 0}));
+    TEST_ASSERT_TRUE(queue.push(ButtonEdge{.timestamp_uS = i + 1000, .isPressed = (i % 2) != 0}));
+    TEST_ASSERT_FALSE(queue.isEmpty());
+
+    TEST_ASSERT_TRUE(queue.pop(edge));
+    TEST_ASSERT_EQUAL(i, edge.timestamp_uS);
+    TEST_ASSERT_EQUAL((i % 2) == 0, edge.isPressed);
+    TEST_ASSERT_TRUE(queue.pop(edge));
+    TEST_ASSERT_EQUAL(i + 1000, edge.timestamp_uS);
+    TEST_ASSERT_TRUE(queue.isEmpty());
+  }
+  TEST_ASSERT_FALSE(queue.checkAndClearOverflow());
+
+  // edges get dropped when full
+  for(uint8_t i = 0; i < 4; i++){
+    TEST_ASSERT_TRUE(queue.push(ButtonEdge{.timestamp_uS = i}));
+  }
+  TEST_ASSERT_FALSE(queue.push(ButtonEdge{.timestamp_uS = 4}));
+  TEST_ASSERT_TRUE(queue.checkAndClearOverflow());
+  TEST_ASSERT_FALSE(queue.checkAndClearOverflow());
+  for(uint8_t i = 0; i < 4; i++){
+    TEST_ASSERT_TRUE(queue.pop(edge));
+    TEST_ASSERT_EQUAL(i, edge.timestamp_uS);
+  }
+  TEST_ASSERT_FALSE(queue.pop(edge));
+}
+
+void testEdgeProcessing(){
+  using namespace OneButtonInterfaceTests;
+  const OneButtonConfigs defaultConfigs;
+
+  // the polled button gets updated at the exact edge times, the edge button gets processed late. they should end up the same
+  TestObjects polledObjects = testButtonFactory();
+  TestObjects edgeObjects = testButtonFactory();
+  auto polledButton = polledObjects.button;
+  auto edgeButton = edgeObjects.button;
+  for(auto modalLights : {polledObjects.modalLights, edgeObjects.modalLights}){
+    modalLights->setBrightnessLevel(100);
+    modalLights->setState(false);
+  }
+  ButtonEdgeQueue<8> edges;
+
+  // the edges are timestamped by a different clock
+  const uint64_t monotonicOffset_uS = polledObjects.timestamp->getTimestamp_uS() - 12345;
+  auto monotonicNow = [&](){return polledObjects.timestamp->getTimestamp_uS() - monotonicOffset_uS;};
+  auto pressAt = [&](bool isPressed){
+    edges.push(ButtonEdge{.timestamp_uS = monotonicNow(), .isPressed = isPressed});
+    polledButton->isPressed = isPressed;
+    polledButton->update();
+  };
+  auto advance_mS = [&](uint64_t time_mS){
+    polledObjects.timestamp->setTimestamp_uS(polledObjects.timestamp->getTimestamp_uS() + time_mS*1000);
+  };
+
+  // short press
+  {
+    advance_mS(10);
+    pressAt(true);
+    advance_mS(100);
+    pressAt(false);
+    TEST_ASSERT_TRUE(edgeButton->isIdle());
+
+    advance_mS(40);
+    edgeButton->processEdges(edges, monotonicNow());
+    TEST_ASSERT_EQUAL(PressStates::none, edgeButton->getFSMState());
+    TEST_ASSERT_TRUE(edgeButton->isIdle());
+    TEST_ASSERT_EQUAL(true, edgeObjects.modalLights->getState());
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->getBrightnessLevel(), edgeObjects.modalLights->getBrightnessLevel());
+  }
+
+  // long press
+  {
+    advance_mS(1000);
+    pressAt(true);
+    advance_mS(defaultConfigs.timeUntilLongPress_mS + 100);
+    polledButton->update();
+    edgeButton->processEdges(edges, monotonicNow());
+    TEST_ASSERT_EQUAL(PressStates::longPress, edgeButton->getFSMState());
+    TEST_ASSERT_FALSE(edgeButton->isIdle());
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->previousAdjustment, edgeObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->getBrightnessLevel(), edgeObjects.modalLights->getBrightnessLevel());
+
+    advance_mS(900);
+    pressAt(false);
+    // the release gets processed late, but the adjustment should be for when the button was released
+    advance_mS(400);
+    edgeButton->processEdges(edges, monotonicNow());
+    TEST_ASSERT_EQUAL(PressStates::none, edgeButton->getFSMState());
+    TEST_ASSERT_NOT_EQUAL(100, edgeObjects.modalLights->getBrightnessLevel());
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->previousAdjustment, edgeObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->getBrightnessLevel(), edgeObjects.modalLights->getBrightnessLevel());
+  }
+
+  // a long press that gets processed after it was released still ramps, from when it became long
+  {
+    advance_mS(1000);
+    pressAt(true);
+    advance_mS(defaultConfigs.timeUntilLongPress_mS + 300);
+    pressAt(false);
+    TEST_ASSERT_TRUE(edgeButton->isIdle());
+
+    advance_mS(40);
+    edgeObjects.modalLights->previousAdjustment = 500;
+    edgeButton->processEdges(edges, monotonicNow());
+    TEST_ASSERT_EQUAL(PressStates::none, edgeButton->getFSMState());
+    TEST_ASSERT_FALSE(edgeObjects.modalLights->isRamping);
+    TEST_ASSERT_NOT_EQUAL(500, edgeObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->previousAdjustment, edgeObjects.modalLights->previousAdjustment);
+    TEST_ASSERT_EQUAL(polledObjects.modalLights->getBrightnessLevel(), edgeObjects.modalLights->getBrightnessLevel());
+  }
+
+  // lost edges should reset the gesture engine
+  {
+    advance_mS(1000);
+    edges.push(ButtonEdge{.timestamp_uS = monotonicNow(), .isPressed = true});
+    for(uint8_t i = 0; i < 8; i++){
+      edges.push(ButtonEdge{.timestamp_uS = monotonicNow(), .isPressed = (i % 2) != 0});
+    }
+    edgeButton->processEdges(edges, monotonicNow());
+    TEST_ASSERT_EQUAL(PressStates::none, edgeButton->getFSMState());
+  }
+}
+
 void testTimeUpdates(){
   // button interface needs to subscribe to DeviceTime, as state changes are based on time and longPress performs a timed interpolation
   TEST_IGNORE_MESSAGE("important TODO, but build a working model first");
@@ -1010,6 +767,8 @@ void RUN_UNITY_TESTS(){
   RUN_TEST(testShortPressState);
   RUN_TEST(testLongPressState);
   RUN_TEST(testButtonOperation);
+  RUN_TEST(testEdgeQueue);
+  RUN_TEST(testEdgeProcessing);
   RUN_TEST(testTimeUpdates);
   UNITY_END();
 }
@@ -0,0 +1,118 @@
+// the profiler is compiled out everywhere else, so turn it on for this file
+#define esp32_lights_profile
+
+#include <unity.h>
+#include <string>
+#include <vector>
+
+#include "profiler.h"
+#include "timeSource.h"
+
+void setUp(void){
+  profileReset();
+}
+void tearDown(void){}
+
+namespace ProfilerTests{
+  std::vector<std::string> reportLines;
+
+  void collectLine(const char* line){
+    reportLines.push_back(line);
+  }
+
+  void spin_uS(const uint64_t duration_uS){
+    SteadyClockTimeSource clock;
+    clock.setTimestamp_uS(0);
+    while(clock.getTimestamp_uS() < duration_uS){}
+  }
+
+  void profiledButtonUpdate(){
+    PROFILE_SCOPE(buttonUpdate);
+    spin_uS(100);
+  }
+}
+
+void testStats(){
+  ProfileStatsStruct stats;
+  TEST_ASSERT_EQUAL(0, stats.count);
+  TEST_ASSERT_EQUAL(0, stats.getMeanCycles());
+
+  stats.record(30);
+  stats.record(10);
+  stats.record(50);
+  TEST_ASSERT_EQUAL(3, stats.count);
+  TEST_ASSERT_EQUAL(10, stats.minCycles);
+  TEST_ASSERT_EQUAL(30, stats.getMeanCycles());
+  TEST_ASSERT_EQUAL(50, stats.maxCycles);
+
+  profileRecord(ProfileRegions::modeChange, 7);
+  TEST_ASSERT_EQUAL(1, getProfileStats(ProfileRegions::modeChange).count);
+  TEST_ASSERT_EQUAL(7, getProfileStats(ProfileRegions::modeChange).maxCycles);
+  TEST_ASSERT_EQUAL(0, getProfileStats(ProfileRegions::updateLights).count);
+  profileReset();
+  TEST_ASSERT_EQUAL(0, getProfileStats(ProfileRegions::modeChange).count);
+}
+
+void testScopedProfile(){
+  using namespace ProfilerTests;
+  {
+    PROFILE_SCOPE(updateLights);
+    profiledButtonUpdate();
+    profiledButtonUpdate();
+  }
+  const uint32_t cyclesPerMicro = profilerCyclesPerMicro();
+  TEST_ASSERT_TRUE(cyclesPerMicro > 0);
+
+  const ProfileStatsStruct& button = getProfileStats(ProfileRegions::buttonUpdate);
+  TEST_ASSERT_EQUAL(2, button.count);
+  TEST_ASSERT_TRUE(button.minCycles >= 100 * cyclesPerMicro * 9 / 10);
+
+  // nested regions get counted by both
+  const ProfileStatsStruct& lights = getProfileStats(ProfileRegions::updateLights);
+  TEST_ASSERT_EQUAL(1, lights.count);
+  TEST_ASSERT_TRUE(lights.maxCycles >= 2*button.minCycles);
+}
+
+void testReport(){
+  using namespace ProfilerTests;
+  profileRecord(ProfileRegions::writeLights, 100);
+  profileRecord(ProfileRegions::writeLights, 300);
+  profileRecord(ProfileRegions::buttonUpdate, 42);
+  reportLines.clear();
+  profileReport(collectLine);
+
+  TEST_ASSERT_EQUAL(4, reportLines.size());
+  const std::string header = "profile begin " + std::to_string(profilerCyclesPerMicro());
+  TEST_ASSERT_EQUAL_STRING(header.c_str(), reportLines[0].c_str());
+  // regions that haven't been entered are skipped
+  TEST_ASSERT_EQUAL_STRING("region writeLights 2 100 200 300", reportLines[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("region buttonUpdate 1 42 42 42", reportLines[2].c_str());
+  TEST_ASSERT_EQUAL_STRING("profile end", reportLines[3].c_str());
+}
+
+void benchmarkProfiler(){
+  const uint32_t scopes = 1000000;
+  SteadyClockTimeSource stopwatch;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t i = 0; i < scopes; i++){
+    PROFILE_SCOPE(writeLights);
+  }
+  const double scope_nS = stopwatch.getTimestamp_uS() * 1000. / scopes;
+  printf("profiled scope: %.1f nS\n", scope_nS);
+  TEST_ASSERT_EQUAL(scopes, getProfileStats(ProfileRegions::writeLights).count);
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testStats);
+  RUN_TEST(testScopedProfile);
+  RUN_TEST(testReport);
+  RUN_TEST(benchmarkProfiler);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
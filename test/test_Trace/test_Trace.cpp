@@ -0,0 +1,172 @@
+// the trace is compiled out everywhere else, so turn it on for this file
+#define esp32_lights_trace
+
+#include <unity.h>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+#include "DeviceTime.h"
+#include "timeSource.h"
+#include "../nativeMocksAndHelpers/mockConfig.h"
+
+void setUp(void){
+  getTraceBuffer().clear();
+}
+void tearDown(void){}
+
+namespace TraceTests{
+  std::vector<std::string> dumpLines;
+
+  /**
+   * @brief a timestamp after the build time, so that DeviceTime doesn't reset it, with the bottom 32 bits set
+   */
+  uint64_t afterBuildTime(const uint32_t bottomBits_uS){
+    return (((BUILD_TIMESTAMP >> 32) + 1) << 32) + bottomBits_uS;
+  }
+
+  void collectLine(const char* line){
+    dumpLines.push_back(line);
+  }
+
+  /**
+   * @brief makes a device time running off a virtual clock, and uses it for the trace timestamps
+   *
+   * @return std::shared_ptr<VirtualClock>
+   */
+  std::shared_ptr<VirtualClock> makeTraceClock(const uint64_t startTime_uS){
+    auto clock = std::make_shared<VirtualClock>(startTime_uS);
+    auto configManager = std::make_shared<ConfigManagerClass>(makeConcreteConfigHal<MockConfigHal>());
+    traceSetClock(std::make_shared<DeviceTimeClass>(configManager, clock));
+    return clock;
+  }
+
+  void recordSpans(VirtualClock& clock){
+    TRACE_SPAN(updateLights);
+    clock.advance_uS(10);
+    {
+      TRACE_SPAN_ARG(modeChange, 7);
+      clock.advance_uS(25);
+    }
+    TRACE_INSTANT(storageReadMode, 3);
+    clock.advance_uS(5);
+  }
+}
+
+void testRingBuffer(){
+  TraceRingBuffer<8> buffer;
+  TEST_ASSERT_EQUAL(8, buffer.getCapacity());
+  TraceRecord records[8];
+  TEST_ASSERT_EQUAL(0, buffer.snapshot(records, 8));
+
+  for(uint16_t i = 0; i < 5; i++){
+    buffer.record(i*100, TraceEvents::updateLights, TracePhases::instant, i);
+  }
+  TEST_ASSERT_EQUAL(5, buffer.snapshot(records, 8));
+  TEST_ASSERT_EQUAL(0, buffer.getDropped());
+  for(uint16_t i = 0; i < 5; i++){
+    TEST_ASSERT_EQUAL(i*100, records[i].time_uS);
+    TEST_ASSERT_EQUAL(i, records[i].arg);
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(TraceEvents::updateLights), records[i].event);
+  }
+
+  // the oldest records get overwritten, and the snapshot is still oldest first
+  for(uint16_t i = 5; i < 20; i++){
+    buffer.record(i*100, TraceEvents::eventCheck, TracePhases::begin, i);
+  }
+  TEST_ASSERT_EQUAL(12, buffer.getDropped());
+  TEST_ASSERT_EQUAL(8, buffer.snapshot(records, 8));
+  for(uint16_t i = 0; i < 8; i++){
+    TEST_ASSERT_EQUAL(12 + i, records[i].arg);
+  }
+
+  // a smaller snapshot gets the newest records
+  TEST_ASSERT_EQUAL(3, buffer.snapshot(records, 3));
+  TEST_ASSERT_EQUAL(17, records[0].arg);
+  TEST_ASSERT_EQUAL(19, records[2].arg);
+
+  buffer.clear();
+  TEST_ASSERT_EQUAL(0, buffer.snapshot(records, 8));
+  TEST_ASSERT_EQUAL(0, buffer.getDropped());
+}
+
+void testSpans(){
+  using namespace TraceTests;
+  const uint64_t startTime_uS = afterBuildTime(0xFFFFFFF0);  // the bottom 32 bits wrap during the spans
+  auto clock = makeTraceClock(startTime_uS);
+  recordSpans(*clock);
+
+  TraceRecord records[8];
+  TEST_ASSERT_EQUAL(5, getTraceBuffer().snapshot(records, 8));
+  const uint8_t expectedEvents[] = {
+    static_cast<uint8_t>(TraceEvents::updateLights),
+    static_cast<uint8_t>(TraceEvents::modeChange),
+    static_cast<uint8_t>(TraceEvents::modeChange),
+    static_cast<uint8_t>(TraceEvents::storageReadMode),
+    static_cast<uint8_t>(TraceEvents::updateLights)
+  };
+  const uint8_t expectedPhases[] = {0, 0, 1, 2, 1};
+  const uint32_t expectedTimes[] = {0, 10, 35, 35, 40};
+  const uint16_t expectedArgs[] = {0, 7, 7, 3, 0};
+  for(uint8_t i = 0; i < 5; i++){
+    std::string message = "failed on record " + std::to_string(i);
+    TEST_ASSERT_EQUAL_MESSAGE(expectedEvents[i], records[i].event, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(expectedPhases[i], records[i].phase, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<uint32_t>(startTime_uS + expectedTimes[i]), records[i].time_uS, message.c_str());
+    TEST_ASSERT_EQUAL_MESSAGE(expectedArgs[i], records[i].arg, message.c_str());
+  }
+  traceSetClock(nullptr);
+}
+
+void testDump(){
+  using namespace TraceTests;
+  auto clock = makeTraceClock(afterBuildTime(0xABCDEF00));
+  recordSpans(*clock);
+  dumpLines.clear();
+  traceDump(collectLine);
+
+  TEST_ASSERT_EQUAL(7, dumpLines.size());
+  TEST_ASSERT_EQUAL_STRING("trace begin 5 0", dumpLines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("abcdef0001000000", dumpLines[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("abcdef0a02000007", dumpLines[2].c_str());
+  TEST_ASSERT_EQUAL_STRING("abcdef2302010007", dumpLines[3].c_str());
+  TEST_ASSERT_EQUAL_STRING("abcdef2304020003", dumpLines[4].c_str());
+  TEST_ASSERT_EQUAL_STRING("abcdef2801010000", dumpLines[5].c_str());
+  TEST_ASSERT_EQUAL_STRING("trace end", dumpLines[6].c_str());
+
+  // dumping clears the buffer
+  dumpLines.clear();
+  traceDump(collectLine);
+  TEST_ASSERT_EQUAL(2, dumpLines.size());
+  TEST_ASSERT_EQUAL_STRING("trace begin 0 0", dumpLines[0].c_str());
+  traceSetClock(nullptr);
+}
+
+void benchmarkTrace(){
+  // a record is one atomic increment and an 8 byte write, plus getting the time
+  const uint32_t records = 1000000;
+  TraceRingBuffer<TRACE_BUFFER_SIZE> buffer;
+  SteadyClockTimeSource stopwatch;
+  stopwatch.setTimestamp_uS(0);
+  for(uint32_t i = 0; i < records; i++){
+    buffer.record(i, TraceEvents::updateLights, TracePhases::instant, i);
+  }
+  const double record_nS = stopwatch.getTimestamp_uS() * 1000. / records;
+  printf("trace record (without the clock): %.1f nS\n", record_nS);
+  TEST_ASSERT_EQUAL(records - TRACE_BUFFER_SIZE, buffer.getDropped());
+}
+
+void RUN_UNITY_TESTS(){
+  UNITY_BEGIN();
+  RUN_TEST(testRingBuffer);
+  RUN_TEST(testSpans);
+  RUN_TEST(testDump);
+  RUN_TEST(benchmarkTrace);
+  UNITY_END();
+}
+
+#ifdef native_env
+void WinMain(){
+  RUN_UNITY_TESTS();
+}
+#endif
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+decodes trace dumps from lib/Trace into a timeline and latency histograms.
+
+capture the serial output of a build with esp32_lights_trace defined (send "t" to get a dump), then:
+  python3 tools/traceDecoder.py dump.txt
+  python3 tools/traceDecoder.py --histogram < dump.txt
+
+anything outside of "trace begin" and "trace end" is ignored, so the serial log can be fed in as-is. the event names are read out of lib/Trace/include/trace.h, so they don't need updating here.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lib", "Trace", "include", "trace.h")
+PHASES = {0: "begin", 1: "end", 2: "instant"}
+WRAP = 1 << 32
+
+
+def read_event_names(header_path):
+  """reads the TraceEvents enum out of trace.h"""
+  with open(header_path) as f:
+    text = f.read()
+  match = re.search(r"enum class TraceEvents[^{]*\{(.*?)\};", text, re.S)
+  if not match:
+    raise ValueError("couldn't find TraceEvents in " + header_path)
+  names = {}
+  value = -1
+  for line in match.group(1).splitlines():
+    line = line.split("//")[0].strip().rstrip(",")
+    if not line:
+      continue
+    parts = [p.strip() for p in line.split("=")]
+    value = int(parts[1], 0) if len(parts) > 1 else value + 1
+    names[value] = parts[0]
+  return names
+
+
+def read_dumps(lines):
+  """yields (records, dropped) for each dump. records are (time_uS, event, phase, arg), with the 32 bit times unwrapped"""
+  records = None
+  dropped = 0
+  for line in lines:
+    line = line.strip()
+    if line.startswith("trace begin"):
+      fields = line.split()
+      dropped = int(fields[3]) if len(fields) > 3 else 0
+      records = []
+      offset = 0
+      previous = None
+      continue
+    if records is None:
+      continue
+    if line == "trace end":
+      yield records, dropped
+      records = None
+      continue
+    if not re.fullmatch(r"[0-9a-fA-F]{16}", line):
+      continue  # serial noise
+    time_uS = int(line[0:8], 16)
+    if previous is not None and time_uS + offset < previous - WRAP // 2:
+      offset += WRAP
+    time_uS += offset
+    previous = time_uS
+    records.append((time_uS, int(line[8:10], 16), int(line[10:12], 16), int(line[12:16], 16)))
+
+
+def find_spans(records, names):
+  """pairs up begins and ends. returns a list of (start_uS, duration_uS or None, depth, name, arg). spans that started before the dump are dropped"""
+  spans = []
+  stack = []
+  for time_uS, event, phase, arg in records:
+    name = names.get(event, "event%d" % event)
+    if phase == 0:
+      stack.append(len(spans))
+      spans.append([time_uS, None, len(stack) - 1, name, arg])
+    elif phase == 1:
+      # the matching begin is the innermost open span with the same event
+      for i in range(len(stack) - 1, -1, -1):
+        span = spans[stack[i]]
+        if span[3] == name and span[4] == arg:
+          span[1] = time_uS - span[0]
+          del stack[i]
+          break
+    else:
+      spans.append([time_uS, 0, len(stack), name + " (instant)", arg])
+  return spans
+
+
+def print_timeline(spans, out):
+  if not spans:
+    return
+  start = spans[0][0]
+  out.write("%12s %10s  %s\n" % ("time (mS)", "took (uS)", "event"))
+  for time_uS, duration_uS, depth, name, arg in spans:
+    took = "?" if duration_uS is None else str(duration_uS)
+    label = name if arg == 0 else "%s [%d]" % (name, arg)
+    out.write("%12.3f %10s  %s%s\n" % ((time_uS - start) / 1000, took, "  " * depth, label))
+
+
+def print_histograms(spans, out, width=40):
+  durations = {}
+  for _, duration_uS, _, name, _ in spans:
+    if duration_uS is not None and not name.endswith("(instant)"):
+      durations.setdefault(name, []).append(duration_uS)
+  for name in sorted(durations):
+    values = sorted(durations[name])
+    n = len(values)
+    out.write("\n%s: %d spans, min %d uS, median %d uS, mean %.1f uS, max %d uS\n" % (
+      name, n, values[0], values[n // 2], sum(values) / n, values[-1]
+    ))
+    # power of 2 buckets
+    buckets = {}
+    for v in values:
+      bucket = 0 if v == 0 else v.bit_length()
+      buckets[bucket] = buckets.get(bucket, 0) + 1
+    biggest = max(buckets.values())
+    for bucket in range(min(buckets), max(buckets) + 1):
+      count = buckets.get(bucket, 0)
+      low = 0 if bucket == 0 else 1 << (bucket - 1)
+      high = 0 if bucket == 0 else (1 << bucket) - 1
+      bar = "#" * ((count * width + biggest - 1) // biggest)
+      out.write("  %7d - %-7d uS %6d %s\n" % (low, high, count, bar))
+
+
+def main():
+  parser = argparse.ArgumentParser(description="decode lib/Trace dumps")
+  parser.add_argument("dump", nargs="?", help="serial log containing the dump. reads stdin if not given")
+  parser.add_argument("--header", default=DEFAULT_HEADER, help="trace.h, for the event names")
+  parser.add_argument("--timeline", action="store_true", help="only print the timeline")
+  parser.add_argument("--histogram", action="store_true", help="only print the histograms")
+  args = parser.parse_args()
+
+  names = read_event_names(args.header)
+  lines = open(args.dump) if args.dump else sys.stdin
+  showTimeline = args.timeline or not args.histogram
+  showHistograms = args.histogram or not args.timeline
+
+  for number, (records, dropped) in enumerate(read_dumps(lines)):
+    sys.stdout.write("##### dump %d: %d records, %d dropped #####\n" % (number, len(records), dropped))
+    spans = find_spans(records, names)
+    if showTimeline:
+      print_timeline(spans, sys.stdout)
+    if showHistograms:
+      print_histograms(spans, sys.stdout)
+
+
+if __name__ == "__main__":
+  main()